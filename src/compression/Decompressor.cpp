@@ -42,6 +42,20 @@ bool DecompressorBase::identify()
 	return identify(f);
 }
 
+bool DecompressorBase::decompress(const PPSystemString& outFileName, Hints hint)
+{
+	XMFile f(outFileName, true);
+	if (!f.isOpenForWriting())
+		return false;
+	
+	return decompress(f, hint);
+}
+
+bool DecompressorBase::decompress(XMFileBase& outFile, Hints hint)
+{
+	return false;
+}
+
 void DecompressorBase::setFilename(const PPSystemString& fileName)
 {
 	this->fileName = fileName;
@@ -133,6 +147,25 @@ bool Decompressor::decompress(const PPSystemString& outFileName, Hints hint)
 	return result;
 }
 
+bool Decompressor::decompress(XMFileBase& outFile, Hints hint)
+{
+	const mp_uint32 startPos = outFile.pos();
+	
+	bool result = false;
+	for (pp_int32 i = 0; i < decompressors.size(); i++)
+	{
+		if (decompressors.get(i)->identify())
+		{
+			result = decompressors.get(i)->decompress(outFile, hint);
+			// what a failing decompressor has written can't be taken back
+			if (result || outFile.pos() != startPos)
+				break;
+		}
+	}
+	
+	return result;
+}
+
 DecompressorBase* Decompressor::clone()
 {
 	return new Decompressor(fileName);
@@ -35,6 +35,7 @@
 #include "SimpleVector.h"
 
 class XMFile;
+class XMFileBase;
 
 class DecompressorBase
 {
@@ -66,7 +67,12 @@ class DecompressorBase
 	
 	virtual const PPSimpleVector<Descriptor>& getDescriptors(Hints hint) const = 0;
 	
-	virtual bool decompress(const PPSystemString& outFileName, Hints hint) = 0;
+	// Unpacks into a new file, by default through decompress(XMFileBase&)
+	virtual bool decompress(const PPSystemString& outFileName, Hints hint);
+	
+	// Unpacks into an open file or into memory (see XMBufferFile).
+	// Returns false if this decompressor can only write files.
+	virtual bool decompress(XMFileBase& outFile, Hints hint);
 	
 	static void removeFile(const PPSystemString& fileName);
 	
@@ -95,6 +101,8 @@ class Decompressor : public DecompressorBase
 	virtual const PPSimpleVector<Descriptor>& getDescriptors(Hints hint) const;
 
 	virtual bool decompress(const PPSystemString& outFileName, Hints hint);
+
+	virtual bool decompress(XMFileBase& outFile, Hints hint);
 	
 	virtual DecompressorBase* clone();
 
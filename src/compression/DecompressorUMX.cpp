@@ -63,7 +63,7 @@ const PPSimpleVector<Descriptor>& DecompressorUMX::getDescriptors(Hints hint) co
 #define MAGIC_SCRM	MAGIC4('S','C','R','M')
 #define MAGIC_M_K_	MAGIC4('M','.','K','.')
 	
-bool DecompressorUMX::decompress(const PPSystemString& outFileName, Hints hint)
+bool DecompressorUMX::decompress(XMFileBase& outFile, Hints hint)
 {
 	// If client requests something else than a module we can't deal we that
 	if (hint != HintAll &&
@@ -110,11 +110,9 @@ bool DecompressorUMX::decompress(const PPSystemString& outFileName, Hints hint)
 
 	f.seek(offset);
 	
-	XMFile fOut(outFileName, true);
-
 	do {
 		len = f.read(buf, 1, 0x10000);
-		fOut.write(buf, 1, len);
+		outFile.write(buf, 1, len);
 	} while (len == 0x10000);
 
 	delete[] buf;
@@ -48,7 +48,7 @@ class DecompressorUMX : public DecompressorBase
 	
 	virtual const PPSimpleVector<Descriptor>& getDescriptors(Hints hint) const;
 	
-	virtual bool decompress(const PPSystemString& outFileName, Hints hint);
+	virtual bool decompress(XMFileBase& outFile, Hints hint);
 	
 	virtual DecompressorBase* clone();
 };
@@ -610,8 +610,12 @@ void Unlzx::decrunch(struct UnLZX *unlzx)
 	unlzx->global_shift = shift;
 }
 
-XMFile* Unlzx::open_output(const PPSystemString& filename)
+XMFileBase* Unlzx::open_output(const PPSystemString& filename)
 {
+	// files are unpacked into memory until one of them gets identified
+	if (unlzx->output)
+		return new XMBufferFile();
+
 	XMFile *file = new XMFile(filename, true);
 	
 	if (!file->isOpenForWriting())
@@ -620,11 +624,20 @@ XMFile* Unlzx::open_output(const PPSystemString& filename)
 	return(file);
 }
 
+bool Unlzx::write_output(XMBufferFile& file)
+{
+	file.seek(0);
+	if (!identificator->identify(file))
+		return false;
+
+	return unlzx->output->write(file.getData(), 1, file.size()) == (signed)file.size();
+}
+
 signed long Unlzx::extract_normal(XMFile* in_file, struct UnLZX *unlzx, bool& found)
 {
 	found = false;
 	struct filename_node *node;
-	XMFile *out_file = NULL;
+	XMFileBase *out_file = NULL;
 	unsigned char *pos, *temp;
 	unsigned long count;
 	signed long abort = 0;
@@ -651,12 +664,12 @@ signed long Unlzx::extract_normal(XMFile* in_file, struct UnLZX *unlzx, bool& fo
 			strcpy((char*)unlzx->work_buffer, (char*)node->filename);
 		}
 		fflush(stdout);
-		if (!pmatch((char*)unlzx->match_pattern, (char*)node->filename))
+		if (!found && !pmatch((char*)unlzx->match_pattern, (char*)node->filename))
 		{
 #ifdef UNLZX_DEBUG
 			printf("Extracting \"%s\"...", (char *)node->filename);
 #endif			
-			out_file = unlzx->temporaryFile ? open_output(*(unlzx->temporaryFile)) : open_output(PPSystemString((const char*)unlzx->work_buffer));
+			out_file = open_output(PPSystemString((const char*)unlzx->work_buffer));
 		}
 		else
 		{
@@ -741,16 +754,15 @@ signed long Unlzx::extract_normal(XMFile* in_file, struct UnLZX *unlzx, bool& fo
 		}
 		if (out_file)
 		{
-			PPSystemString fileName = out_file->getFileName();
-			delete out_file;
 			if (!abort)
 			{
 #ifdef UNLZX_DEBUG
 				printf(" crc %s\n", (char *)((node->crc == unlzx->sum) ? "good" : "bad"));
 #endif				
-				if (identificator)
-					found = identificator->identify(fileName);
+				if (identificator && unlzx->output)
+					found = write_output(*static_cast<XMBufferFile*>(out_file));
 			}
+			delete out_file;
 		}
 	}
 	return(abort);
@@ -759,7 +771,7 @@ signed long Unlzx::extract_normal(XMFile* in_file, struct UnLZX *unlzx, bool& fo
 signed long Unlzx::extract_store(XMFile* in_file, struct UnLZX *unlzx, bool& found)
 {
 	struct filename_node *node;
-	XMFile *out_file = NULL;
+	XMFileBase *out_file = NULL;
 	unsigned long count;
 	signed long abort = 0;
 	
@@ -776,12 +788,12 @@ signed long Unlzx::extract_store(XMFile* in_file, struct UnLZX *unlzx, bool& fou
 			strcpy((char*)unlzx->work_buffer, (char*)node->filename);
 		}
 		fflush(stdout);
-		if (!pmatch((char*)unlzx->match_pattern, (char*)node->filename))
+		if (!found && !pmatch((char*)unlzx->match_pattern, (char*)node->filename))
 		{
 #ifdef UNLZX_DEBUG
 			printf("Storing \"%s\"...", (char *)node->filename);
 #endif
-			out_file = unlzx->temporaryFile ? open_output(*(unlzx->temporaryFile)) : open_output(PPSystemString((const char*)unlzx->work_buffer));
+			out_file = open_output(PPSystemString((const char*)unlzx->work_buffer));
 		}
 		else
 		{
@@ -825,16 +837,15 @@ signed long Unlzx::extract_store(XMFile* in_file, struct UnLZX *unlzx, bool& fou
 		}
 		if (out_file)
 		{
-			PPSystemString fileName = out_file->getFileName();
-			delete out_file;
 			if (!abort)
 			{
 #ifdef UNLZX_DEBUG
 				printf(" crc %s\n", (char *)((node->crc == unlzx->sum) ? "good" : "bad"));
 #endif				
-				if (identificator)
-					found = identificator->identify(fileName);
+				if (identificator && unlzx->output)
+					found = write_output(*static_cast<XMBufferFile*>(out_file));
 			}
+			delete out_file;
 		}
 	}
 	return(abort);
@@ -1323,7 +1334,7 @@ Unlzx::~Unlzx()
 		unlzx_free(unlzx);
 }
 
-bool Unlzx::extractFile(bool extract, const PPSystemString* outFilename)
+bool Unlzx::extractFile(bool extract, XMFileBase* outFile)
 {
 	int result = 0;
 	
@@ -1332,7 +1343,7 @@ bool Unlzx::extractFile(bool extract, const PPSystemString* outFilename)
 		if (extract)
 		{
 			unlzx->mode = 1;
-			unlzx->temporaryFile = outFilename;
+			unlzx->output = outFile;
 			bool found = false;
 			// TODO: make this all type safe
 			result = process_archive(archiveFilename, unlzx, found);
@@ -104,6 +104,10 @@ class AudioDriverInterface
 	virtual		bool		isMixerActive() = 0;
 	virtual		void		setIdle(bool idle) = 0;
 
+	// return true here if the device takes 32 bit float samples, it
+	// should then call MasterMixer::mixerHandlerFloat instead of mixerHandler
+	virtual		bool		supportsFloat() const { return false; }
+
 	virtual     mp_sint32   getStatValue(mp_uint32 key) { return 0; }
 	virtual     mp_sint32   getChannels() const { return -1; }
 	virtual     bool        isMultiChannel() const { return false; }
@@ -162,7 +162,7 @@ AudioDriverManager::AudioDriverManager() :
 	count++;
 #endif
 #ifdef HAVE_JACK_JACK_H
-	count++;
+	count+=2;
 #endif
 	ALLOC_DRIVERLIST(count);
 	count = 0;
@@ -172,6 +172,7 @@ AudioDriverManager::AudioDriverManager() :
 #endif
 #if HAVE_JACK_JACK_H
 	driverList[count++] = new AudioDriver_JACK();
+	driverList[count++] = new AudioDriver_JACK(AudioDriver_JACK::MultiChannelOutputs);
 #endif
 }
 
@@ -77,6 +77,24 @@ class AudioDriver_COMPENSATE : public AudioDriverBase
 		else
 			memset(stream, 0, length);
 	}
+
+	// Same as above for drivers which support float (see supportsFloat()),
+	// stream MUST be interleaved float stereo, length is in sample frames
+	void fillAudioWithCompensationFloat(float* stream, int length)
+	{
+		// sanity check
+		if (!this->deviceHasStarted)
+			return;
+
+		MasterMixer* mixer = this->mixer;
+
+		this->sampleCounter+=length;
+
+		if (isMixerActive())
+			mixer->mixerHandlerFloat(stream);
+		else
+			memset(stream, 0, length * MP_NUMCHANNELS * sizeof(float));
+	}
 };
 
 #endif
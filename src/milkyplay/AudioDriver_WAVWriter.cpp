@@ -36,6 +36,8 @@
  */
 
 #include "AudioDriver_WAVWriter.h"
+#include "MasterMixer.h"
+#include "MilkyPlayThread.h"
 
 struct TWAVHeader
 {
@@ -49,11 +51,34 @@ struct TWAVHeader
 	mp_dword sampleRate;		// Samples per second: e.g., 44100
 	mp_dword bytesPerSecond;	// sample rate * block align
 	mp_uword blockAlign;		// channels * numBits / 8
-	mp_uword numBits;			// 8 or 16
+	mp_uword numBits;			// 8, 16 or 32 (float)
 	mp_ubyte DATA[4];			// "data"
 	mp_dword dataLength;		// sample data size
 };
 
+enum
+{
+	WAVEncodingPCM = 1,
+	WAVEncodingFloat = 3
+};
+
+static void buildWAVHeader(TWAVHeader& hdr, mp_sint32 mixFreq, bool floatFormat, mp_uint32 numSamples)
+{
+	memcpy(hdr.RIFF, "RIFF", 4);
+	memcpy(hdr.WAVE, "WAVE", 4);
+	memcpy(hdr.FMT, "fmt ", 4);
+	hdr.fmtDataLength = 16;
+	hdr.encodingTag = floatFormat ? WAVEncodingFloat : WAVEncodingPCM;
+	hdr.numChannels = 2;
+	hdr.sampleRate = mixFreq;
+	hdr.numBits = floatFormat ? 32 : 16;
+	hdr.blockAlign = (hdr.numChannels*hdr.numBits) / 8;
+	hdr.bytesPerSecond = hdr.sampleRate*hdr.blockAlign;
+	memcpy(hdr.DATA, "data", 4);
+	hdr.dataLength = numSamples*hdr.blockAlign;
+	hdr.length = 44 + hdr.dataLength - 8;
+}
+
 static void writeWAVHeader(XMFile* f, const TWAVHeader& hdr)
 {
 	f->write(hdr.RIFF, 1, 4);
@@ -77,10 +102,12 @@ static void writeWAVHeader(XMFile* f, const TWAVHeader& hdr)
 	f->writeDword(hdr.dataLength);
 }
 
-WAVWriter::WAVWriter(const SYSCHAR* fileName) :
+WAVWriter::WAVWriter(const SYSCHAR* fileName, bool floatFormat/* = false*/) :
 	AudioDriver_NULL(),
 	f(NULL),
-	mixFreq(44100)
+	mixFreq(44100),
+	floatFormat(floatFormat),
+	floatBuffer(NULL)
 {
 	TWAVHeader hdr;
 	
@@ -93,21 +120,7 @@ WAVWriter::WAVWriter(const SYSCHAR* fileName) :
 	}
 	else
 	{
-		// build wav header
-		memcpy(hdr.RIFF, "RIFF", 4);
-		hdr.length = 44 - 8;
-		memcpy(hdr.WAVE, "WAVE", 4);
-		memcpy(hdr.FMT, "fmt ", 4);
-		hdr.fmtDataLength = 16;
-		hdr.encodingTag = 1;
-		hdr.numChannels = 2;
-		hdr.sampleRate = mixFreq;
-		hdr.numBits = 16;
-		hdr.blockAlign = (hdr.numChannels*hdr.numBits) / 8;
-		hdr.bytesPerSecond = hdr.sampleRate*hdr.blockAlign;
-		memcpy(hdr.DATA, "data", 4);
-		hdr.dataLength = 0;	
-		
+		buildWAVHeader(hdr, mixFreq, floatFormat, 0);
 		writeWAVHeader(f, hdr);
 	}
 }
@@ -116,6 +129,8 @@ WAVWriter::~WAVWriter()
 {
 	if (f)
 		delete f;
+
+	delete[] floatBuffer;
 }
 
 mp_sint32 WAVWriter::initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mixFrequency, MasterMixer* mixer)
@@ -124,6 +139,13 @@ mp_sint32 WAVWriter::initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mixFreque
 	if (res < 0)
 		return res;
 
+	if (floatFormat)
+	{
+		delete[] floatBuffer;
+		floatBuffer = new float[bufferSizeInWords];
+		memset(floatBuffer, 0, bufferSizeInWords * sizeof(float));
+	}
+
 	mixFreq = mixFrequency;
 	return MP_OK;
 }
@@ -135,20 +157,7 @@ mp_sint32 WAVWriter::closeDevice()
 		
 	TWAVHeader hdr;
 	
-	// build wav header
-	memcpy(hdr.RIFF, "RIFF", 4);
-	hdr.length = 44 + numSamplesWritten*4 - 8;
-	memcpy(hdr.WAVE, "WAVE", 4);
-	memcpy(hdr.FMT, "fmt ", 4);
-	hdr.fmtDataLength = 16;
-	hdr.encodingTag = 1;
-	hdr.numChannels = 2;
-	hdr.sampleRate = mixFreq;
-	hdr.numBits = 16;
-	hdr.blockAlign = (hdr.numChannels*hdr.numBits) / 8;
-	hdr.bytesPerSecond = hdr.sampleRate*hdr.blockAlign;
-	memcpy(hdr.DATA, "data", 4);
-	hdr.dataLength = (numSamplesWritten*2*hdr.numBits)/8;	
+	buildWAVHeader(hdr, mixFreq, floatFormat, numSamplesWritten);
 		
 	f->seek(0);
 
@@ -159,11 +168,349 @@ mp_sint32 WAVWriter::closeDevice()
 
 void WAVWriter::advance()
 {
-	AudioDriver_NULL::advance();
+	if (!floatFormat)
+	{
+		AudioDriver_NULL::advance();
+
+		if (!f)
+			return;
+	
+		f->writeWords((mp_uword*)compensateBuffer, bufferSize);
+	}
+	else
+	{
+		numSamplesWritten+=bufferSize / MP_NUMCHANNELS;
+
+		if (mixer->isPlaying())
+			mixer->mixerHandlerFloat(floatBuffer);
+
+		if (!f)
+			return;
+
+		f->writeDwords((mp_dword*)floatBuffer, bufferSize);
+	}
+}
+
+void WAVWriter::writeSamples(const void* data, mp_uint32 numSamples)
+{
+	numSamplesWritten+=numSamples;
 
 	if (!f)
 		return;
-	
-	f->writeWords((mp_uword*)compensateBuffer, bufferSize);
+
+	if (!floatFormat)
+		f->writeWords((const mp_uword*)data, numSamples * MP_NUMCHANNELS);
+	else
+		f->writeDwords((const mp_dword*)data, numSamples * MP_NUMCHANNELS);
+}
+
+WAVMemoryWriter::WAVMemoryWriter(bool floatFormat/* = false*/) :
+	AudioDriver_NULL(),
+	floatFormat(floatFormat),
+	floatBuffer(NULL),
+	output(NULL)
+{
+}
+
+WAVMemoryWriter::~WAVMemoryWriter()
+{
+	delete[] floatBuffer;
+}
+
+mp_sint32 WAVMemoryWriter::initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mixFrequency, MasterMixer* mixer)
+{
+	mp_sint32 res = AudioDriver_NULL::initDevice(bufferSizeInWords, mixFrequency, mixer);
+	if (res < 0)
+		return res;
+
+	if (floatFormat)
+	{
+		delete[] floatBuffer;
+		floatBuffer = new float[bufferSizeInWords];
+		memset(floatBuffer, 0, bufferSizeInWords * sizeof(float));
+	}
+
+	return MP_OK;
+}
+
+void WAVMemoryWriter::advance()
+{
+	if (!floatFormat)
+	{
+		AudioDriver_NULL::advance();
+
+		if (!output)
+			return;
+
+		memcpy(output, compensateBuffer, bufferSize * sizeof(mp_sword));
+		output+=bufferSize * sizeof(mp_sword);
+	}
+	else
+	{
+		numSamplesWritten+=bufferSize / MP_NUMCHANNELS;
+
+		if (mixer->isPlaying())
+			mixer->mixerHandlerFloat(floatBuffer);
+
+		if (!output)
+			return;
+
+		memcpy(output, floatBuffer, bufferSize * sizeof(float));
+		output+=bufferSize * sizeof(float);
+	}
 }
 
+/*
+ * Threads writing the stems, stem n is written by thread n % numThreads.
+ * The thread calling writeStems() is thread 0.
+ */
+class WAVStemWriter::WriterPool
+{
+private:
+	class Worker : public MPThread
+	{
+	private:
+		WriterPool& pool;
+		const mp_uint32 index;
+
+	protected:
+		virtual void run();
+
+	public:
+		Worker(WriterPool& pool, mp_uint32 index) :
+			pool(pool),
+			index(index)
+		{
+		}
+
+		virtual ~Worker()
+		{
+			join();
+		}
+	};
+
+	WAVStemWriter& owner;
+
+	Worker** workers;
+	mp_uint32 numWorkers;
+	mp_ubyte** scratch;
+
+	MPMutex mutex;
+	MPCondition startCondition;
+	MPCondition doneCondition;
+	mp_uint32 generation;
+	mp_uint32 numPending;
+	bool quit;
+
+public:
+	WriterPool(WAVStemWriter& owner, mp_uint32 numThreads, mp_uint32 scratchSize);
+	~WriterPool();
+
+	void writeStems();
+};
+
+void WAVStemWriter::WriterPool::Worker::run()
+{
+	mp_uint32 lastGeneration = 0;
+
+	pool.mutex.lock();
+	for (;;)
+	{
+		while (pool.generation == lastGeneration && !pool.quit)
+			pool.startCondition.wait(pool.mutex);
+
+		if (pool.quit)
+			break;
+
+		lastGeneration = pool.generation;
+
+		pool.mutex.unlock();
+		pool.owner.writeStems(index, pool.numWorkers + 1, pool.scratch[index]);
+		pool.mutex.lock();
+
+		if (--pool.numPending == 0)
+			pool.doneCondition.signal();
+	}
+	pool.mutex.unlock();
+}
+
+WAVStemWriter::WriterPool::WriterPool(WAVStemWriter& owner, mp_uint32 numThreads, mp_uint32 scratchSize) :
+	owner(owner),
+	workers(new Worker*[numThreads]),
+	numWorkers(0),
+	scratch(new mp_ubyte*[numThreads]),
+	generation(0),
+	numPending(0),
+	quit(false)
+{
+	for (mp_uint32 i = 0; i < numThreads; i++)
+		scratch[i] = new mp_ubyte[scratchSize];
+
+	for (mp_uint32 i = 1; i < numThreads; i++)
+	{
+		Worker* worker = new Worker(*this, i);
+		if (!worker->start())
+		{
+			delete worker;
+			break;
+		}
+		workers[numWorkers++] = worker;
+	}
+}
+
+WAVStemWriter::WriterPool::~WriterPool()
+{
+	mutex.lock();
+	quit = true;
+	startCondition.broadcast();
+	mutex.unlock();
+
+	// joins the thread
+	for (mp_uint32 i = 0; i < numWorkers; i++)
+		delete workers[i];
+
+	delete[] workers;
+
+	for (mp_uint32 i = 0; i < numWorkers + 1; i++)
+		delete[] scratch[i];
+	delete[] scratch;
+}
+
+void WAVStemWriter::WriterPool::writeStems()
+{
+	mutex.lock();
+	numPending = numWorkers;
+	generation++;
+	startCondition.broadcast();
+	mutex.unlock();
+
+	owner.writeStems(0, numWorkers + 1, scratch[0]);
+
+	mutex.lock();
+	while (numPending)
+		doneCondition.wait(mutex);
+	mutex.unlock();
+}
+
+WAVStemWriter::WAVStemWriter(const SYSCHAR** fileNames, mp_uint32 numStems, bool floatFormat/* = false*/) :
+	AudioDriver_NULL(),
+	files(new XMFile*[numStems]),
+	numStems(numStems),
+	mixFreq(44100),
+	floatFormat(floatFormat),
+	allOpen(true),
+	stemProxy(NULL),
+	writerPool(NULL)
+{
+	TWAVHeader hdr;
+	buildWAVHeader(hdr, mixFreq, floatFormat, 0);
+
+	for (mp_uint32 i = 0; i < numStems; i++)
+	{
+		files[i] = NULL;
+		if (fileNames[i] == NULL)
+			continue;
+
+		files[i] = new XMFile(fileNames[i], true);
+
+		if (!files[i]->isOpenForWriting())
+		{
+			delete files[i];
+			files[i] = NULL;
+			allOpen = false;
+		}
+		else
+		{
+			writeWAVHeader(files[i], hdr);
+		}
+	}
+}
+
+WAVStemWriter::~WAVStemWriter()
+{
+	delete writerPool;
+	delete stemProxy;
+
+	for (mp_uint32 i = 0; i < numStems; i++)
+		delete files[i];
+
+	delete[] files;
+}
+
+mp_sint32 WAVStemWriter::initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mixFrequency, MasterMixer* mixer)
+{
+	mp_sint32 res = AudioDriver_NULL::initDevice(bufferSizeInWords, mixFrequency, mixer);
+	if (res < 0)
+		return res;
+
+	delete writerPool;
+	delete stemProxy;
+
+	stemProxy = new MixerProxyMixDownStems(numStems);
+
+	mp_uint32 numFiles = 0;
+	for (mp_uint32 i = 0; i < numStems; i++)
+		if (files[i])
+			numFiles++;
+
+	mp_uint32 numThreads = MPThread::getNumProcessors();
+	if (numThreads > numFiles)
+		numThreads = numFiles;
+	if (numThreads < 1)
+		numThreads = 1;
+
+	writerPool = new WriterPool(*this, numThreads, bufferSizeInWords * (floatFormat ? sizeof(float) : sizeof(mp_sword)));
+
+	mixFreq = mixFrequency;
+	return MP_OK;
+}
+
+mp_sint32 WAVStemWriter::closeDevice()
+{
+	TWAVHeader hdr;
+
+	buildWAVHeader(hdr, mixFreq, floatFormat, numSamplesWritten);
+
+	for (mp_uint32 i = 0; i < numStems; i++)
+	{
+		if (!files[i])
+			continue;
+
+		files[i]->seek(0);
+		writeWAVHeader(files[i], hdr);
+	}
+
+	return MP_OK;
+}
+
+void WAVStemWriter::writeStems(mp_uint32 first, mp_uint32 stride, void* scratch)
+{
+	for (mp_uint32 i = first; i < numStems; i+=stride)
+	{
+		if (!files[i])
+			continue;
+
+		if (floatFormat)
+		{
+			stemProxy->bounce(i, (float*)scratch);
+			files[i]->writeDwords((mp_dword*)scratch, bufferSize);
+		}
+		else
+		{
+			stemProxy->bounce(i, (mp_sword*)scratch);
+			files[i]->writeWords((mp_uword*)scratch, bufferSize);
+		}
+	}
+}
+
+void WAVStemWriter::advance()
+{
+	if (!mixer->isPlaying())
+		return;
+
+	numSamplesWritten+=bufferSize / MP_NUMCHANNELS;
+
+	mixer->mixerHandler(NULL, stemProxy);
+
+	writerPool->writeStems();
+}
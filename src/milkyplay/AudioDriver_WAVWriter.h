@@ -46,9 +46,12 @@ class WAVWriter : public AudioDriver_NULL
 private:
 	XMFile*		f;
 	mp_sint32	mixFreq;
+	bool		floatFormat;
+	float*		floatBuffer;
 	
 public:
-				WAVWriter(const SYSCHAR* fileName);
+				// floatFormat = true writes 32 bit IEEE float instead of 16 bit PCM
+				WAVWriter(const SYSCHAR* fileName, bool floatFormat = false);
 
 	virtual		~WAVWriter();
 			
@@ -56,10 +59,85 @@ class WAVWriter : public AudioDriver_NULL
 	virtual     mp_sint32   closeDevice();
 
 	virtual		const char* getDriverID() { return "WAVWriter"; }
+	virtual		bool		supportsFloat() const { return floatFormat; }
 
 	virtual		void		advance();
 
+	// append numSamples stereo samples rendered by a WAVMemoryWriter
+	// in the same format
+	void					writeSamples(const void* data, mp_uint32 numSamples);
+
 	bool					isOpen() { return f != NULL; }
 };
 
+// Renders into memory in the format of a WAVWriter, used for rendering
+// parts of a song concurrently (see PlayerGeneric::exportToWAV).
+// Without an output buffer the rendered data is dropped.
+class WAVMemoryWriter : public AudioDriver_NULL
+{
+private:
+	bool		floatFormat;
+	float*		floatBuffer;
+	mp_ubyte*	output;
+
+public:
+				WAVMemoryWriter(bool floatFormat = false);
+
+	virtual		~WAVMemoryWriter();
+
+	virtual     mp_sint32   initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mixFrequency, MasterMixer* mixer);
+
+	virtual		const char* getDriverID() { return "WAVMemoryWriter"; }
+	virtual		bool		supportsFloat() const { return floatFormat; }
+
+	virtual		void		advance();
+
+	// output needs room for everything rendered until it is changed again
+	void					setOutput(void* output) { this->output = (mp_ubyte*)output; }
+
+	// continue counting from a restored player state (see PlayerBase::restoreState)
+	void					setNumPlayedSamples(mp_uint32 numSamples) { numSamplesWritten = numSamples; }
+
+	mp_uint32				getBytesPerSample() const { return MP_NUMCHANNELS * (floatFormat ? sizeof(float) : sizeof(mp_sword)); }
+};
+
+class MixerProxyMixDownStems;
+
+// Renders every mixer channel into a WAV file of its own while playing the
+// song only once (see MixerProxyMixDownStems). A NULL file name skips the
+// channel. The stems are converted and written by several threads.
+class WAVStemWriter : public AudioDriver_NULL
+{
+private:
+	class WriterPool;
+	friend class WriterPool;
+
+	XMFile**	files;
+	mp_uint32	numStems;
+	mp_sint32	mixFreq;
+	bool		floatFormat;
+	bool		allOpen;
+
+	MixerProxyMixDownStems*	stemProxy;
+	WriterPool*	writerPool;
+
+	// write every stride-th stem starting at first, scratch holds one stem buffer
+	void		writeStems(mp_uint32 first, mp_uint32 stride, void* scratch);
+
+public:
+				WAVStemWriter(const SYSCHAR** fileNames, mp_uint32 numStems, bool floatFormat = false);
+
+	virtual		~WAVStemWriter();
+
+	virtual     mp_sint32   initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mixFrequency, MasterMixer* mixer);
+	virtual     mp_sint32   closeDevice();
+
+	virtual		const char* getDriverID() { return "WAVStemWriter"; }
+
+	virtual		void		advance();
+
+	// false if any of the files couldn't be created
+	bool					isOpen() { return allOpen; }
+};
+
 #endif
@@ -0,0 +1,214 @@
+/*
+ * Copyright (c) 2026, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  ChannelInsert.cpp
+ *  MilkyPlay
+ *
+ */
+
+#include "ChannelInsert.h"
+#include "MilkyPlayCommon.h"
+#include "AudioDriverBase.h"
+#include <math.h>
+
+void ChannelInsertGain::process(mp_sint32* buffer, mp_uint32 numSamples)
+{
+	const float gain = this->gain;
+	if (gain == 1.0f)
+		return;
+
+	for (mp_uint32 i = 0; i < numSamples*MP_NUMCHANNELS; i++)
+		buffer[i] = (mp_sint32)((float)buffer[i] * gain);
+}
+
+ChannelInsertCompressor::ChannelInsertCompressor() :
+	threshold(1.0f),
+	ratio(1.0f),
+	attackMillis(1.0f),
+	releaseMillis(100.0f),
+	makeUpGain(1.0f),
+	sampleRate(44100),
+	attackCoeff(0.0f),
+	releaseCoeff(0.0f),
+	envelope(0.0f),
+	gain(1.0f)
+{
+	calcCoeffs();
+}
+
+void ChannelInsertCompressor::calcCoeffs()
+{
+	// the envelope is updated once per control period
+	const float periodsPerMilli = (float)sampleRate / (1000.0f * CONTROLRATE);
+	attackCoeff = attackMillis > 0.0f ? (float)exp(-1.0 / (attackMillis * periodsPerMilli)) : 0.0f;
+	releaseCoeff = releaseMillis > 0.0f ? (float)exp(-1.0 / (releaseMillis * periodsPerMilli)) : 0.0f;
+}
+
+void ChannelInsertCompressor::setParameters(float thresholdDB, float ratio, float attackMillis, float releaseMillis, float makeUpDB/* = 0.0f*/)
+{
+	this->threshold = (float)pow(10.0, thresholdDB / 20.0);
+	this->ratio = ratio < 1.0f ? 1.0f : ratio;
+	this->attackMillis = attackMillis;
+	this->releaseMillis = releaseMillis;
+	this->makeUpGain = (float)pow(10.0, makeUpDB / 20.0);
+	calcCoeffs();
+}
+
+void ChannelInsertCompressor::setSampleRate(mp_uint32 sampleRate)
+{
+	this->sampleRate = sampleRate;
+	calcCoeffs();
+}
+
+void ChannelInsertCompressor::reset()
+{
+	envelope = 0.0f;
+	gain = 1.0f;
+}
+
+void ChannelInsertCompressor::process(mp_sint32* buffer, mp_uint32 numSamples)
+{
+	const float scale = 1.0f / 32768.0f;
+	const float slope = 1.0f / ratio - 1.0f;
+
+	while (numSamples)
+	{
+		const mp_uint32 count = numSamples < CONTROLRATE ? numSamples : CONTROLRATE;
+
+		mp_sint32 maxAbs = 0;
+		for (mp_uint32 i = 0; i < count*MP_NUMCHANNELS; i++)
+		{
+			const mp_sint32 s = buffer[i] < 0 ? -buffer[i] : buffer[i];
+			if (s > maxAbs)
+				maxAbs = s;
+		}
+		const float peak = (float)maxAbs * scale;
+
+		const float coeff = peak > envelope ? attackCoeff : releaseCoeff;
+		envelope = peak + coeff * (envelope - peak);
+
+		float target = makeUpGain;
+		if (envelope > threshold)
+			target *= (float)pow(envelope / threshold, slope);
+
+		// ramp from the last gain to avoid steps at the period boundaries
+		const float step = (target - gain) / (float)count;
+		for (mp_uint32 i = 0; i < count; i++)
+		{
+			gain+=step;
+			buffer[i*MP_NUMCHANNELS] = (mp_sint32)((float)buffer[i*MP_NUMCHANNELS] * gain);
+			buffer[i*MP_NUMCHANNELS+1] = (mp_sint32)((float)buffer[i*MP_NUMCHANNELS+1] * gain);
+		}
+		gain = target;
+
+		buffer+=count*MP_NUMCHANNELS;
+		numSamples-=count;
+	}
+}
+
+ChannelInsertChain::ChannelInsertChain() :
+	numInserts(0),
+	bypass(false),
+	buffer(0),
+	bufferSize(0),
+	sampleRate(0)
+{
+}
+
+ChannelInsertChain::~ChannelInsertChain()
+{
+	clear();
+	delete[] buffer;
+}
+
+bool ChannelInsertChain::add(ChannelInsert* insert)
+{
+	if (numInserts >= MAXINSERTS)
+	{
+		delete insert;
+		return false;
+	}
+
+	if (sampleRate)
+		insert->setSampleRate(sampleRate);
+
+	inserts[numInserts++] = insert;
+	return true;
+}
+
+void ChannelInsertChain::clear()
+{
+	for (mp_uint32 i = 0; i < numInserts; i++)
+		delete inserts[i];
+	numInserts = 0;
+}
+
+void ChannelInsertChain::reset()
+{
+	for (mp_uint32 i = 0; i < numInserts; i++)
+		inserts[i]->reset();
+}
+
+void ChannelInsertChain::prepare(mp_uint32 maxNumSamples, mp_uint32 sampleRate)
+{
+	if (maxNumSamples > bufferSize)
+	{
+		delete[] buffer;
+		bufferSize = maxNumSamples;
+		buffer = new mp_sint32[bufferSize*MP_NUMCHANNELS];
+		memset(buffer, 0, bufferSize*MP_NUMCHANNELS*sizeof(mp_sint32));
+	}
+
+	if (sampleRate != this->sampleRate)
+	{
+		this->sampleRate = sampleRate;
+		for (mp_uint32 i = 0; i < numInserts; i++)
+			inserts[i]->setSampleRate(sampleRate);
+	}
+}
+
+void ChannelInsertChain::process(mp_sint32* buffer, mp_uint32 numSamples)
+{
+	if (bypass)
+		return;
+
+	for (mp_uint32 i = 0; i < numInserts; i++)
+		inserts[i]->process(buffer, numSamples);
+}
+
+void ChannelInsertChain::processAndAdd(mp_sint32* dest, mp_uint32 numSamples)
+{
+	process(buffer, numSamples);
+
+	for (mp_uint32 i = 0; i < numSamples*MP_NUMCHANNELS; i++)
+		dest[i]+=buffer[i];
+
+	memset(buffer, 0, numSamples*MP_NUMCHANNELS*sizeof(mp_sint32));
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) 2026, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  ChannelInsert.h
+ *  MilkyPlay
+ *
+ *  Processing stages for single mixer channels, see
+ *  ChannelMixer::setInsertChain. Each beat packet of a channel is mixed
+ *  into a buffer of its own, run through the chain and then added to the
+ *  mix. process() is called from the audio thread or from a mixer worker
+ *  thread, it must neither allocate nor block.
+ *
+ */
+#ifndef __CHANNELINSERT_H__
+#define __CHANNELINSERT_H__
+
+#include "MilkyPlayTypes.h"
+
+class ChannelInsert
+{
+public:
+	virtual ~ChannelInsert()
+	{
+	}
+
+	// interleaved stereo in the 32 bit format of the mixer (16 bit range,
+	// not clipped), processed in place
+	virtual void process(mp_sint32* buffer, mp_uint32 numSamples) = 0;
+
+	// called when the chain is attached and when the mixing frequency changes
+	virtual void setSampleRate(mp_uint32 sampleRate) { }
+
+	// forget the state built up from previous samples
+	virtual void reset() { }
+};
+
+class ChannelInsertGain : public ChannelInsert
+{
+private:
+	float gain;
+
+public:
+	ChannelInsertGain(float gain = 1.0f) :
+		gain(gain)
+	{
+	}
+
+	void setGain(float gain) { this->gain = gain; }
+	float getGain() const { return gain; }
+
+	virtual void process(mp_sint32* buffer, mp_uint32 numSamples);
+};
+
+// Feed forward peak compressor, both sides are compressed by the louder one
+class ChannelInsertCompressor : public ChannelInsert
+{
+private:
+	enum
+	{
+		// the gain is computed every that many samples and interpolated in between
+		CONTROLRATE = 32
+	};
+
+	float threshold;		// linear, 1.0 = 16 bit full scale
+	float ratio;
+	float attackMillis;
+	float releaseMillis;
+	float makeUpGain;		// linear
+
+	mp_uint32 sampleRate;
+	float attackCoeff;
+	float releaseCoeff;
+
+	float envelope;
+	float gain;
+
+	void calcCoeffs();
+
+public:
+	ChannelInsertCompressor();
+
+	// threshold and makeUp in dB (0 dB = 16 bit full scale), ratio as in ratio:1
+	void setParameters(float thresholdDB, float ratio, float attackMillis, float releaseMillis, float makeUpDB = 0.0f);
+
+	virtual void process(mp_sint32* buffer, mp_uint32 numSamples);
+	virtual void setSampleRate(mp_uint32 sampleRate);
+	virtual void reset();
+};
+
+// Up to MAXINSERTS inserts processed in order, the chain owns them
+class ChannelInsertChain
+{
+public:
+	enum
+	{
+		MAXINSERTS = 8
+	};
+
+private:
+	ChannelInsert* inserts[MAXINSERTS];
+	mp_uint32 numInserts;
+	bool bypass;
+
+	// the channel is mixed into this buffer before it goes through the chain
+	mp_sint32* buffer;
+	mp_uint32 bufferSize;
+	mp_uint32 sampleRate;
+
+	ChannelInsertChain(const ChannelInsertChain&);
+	ChannelInsertChain& operator=(const ChannelInsertChain&);
+
+public:
+	ChannelInsertChain();
+	~ChannelInsertChain();
+
+	// false if the chain is full, the insert is deleted then
+	bool add(ChannelInsert* insert);
+	void clear();
+
+	mp_uint32 getNumInserts() const { return numInserts; }
+	ChannelInsert* getInsert(mp_uint32 index) const { return index < numInserts ? inserts[index] : 0; }
+
+	// the channel is still mixed separately, but passes unchanged
+	void setBypass(bool bypass) { this->bypass = bypass; }
+	bool isBypassed() const { return bypass; }
+
+	void reset();
+
+	// used by the mixer, prepare() allocates and is never called while mixing
+	void prepare(mp_uint32 maxNumSamples, mp_uint32 sampleRate);
+	mp_sint32* getBuffer() const { return buffer; }
+	// run the buffer through the chain, add it to dest and clear it for the next beat packet
+	void processAndAdd(mp_sint32* dest, mp_uint32 numSamples);
+	// run an external buffer through the chain
+	void process(mp_sint32* buffer, mp_uint32 numSamples);
+};
+
+#endif
@@ -40,10 +40,13 @@
  */
 #include "ChannelMixer.h"
 #include "ResamplerFactory.h"
+#include "MixerThreadPool.h"
+#include "ChannelInsert.h"
 #include "ResamplerMacros.h"
 #include "AudioDriverManager.h"
 #include "ProxyProcessor.h"
 #include <math.h>
+#include <new>
 
 // Ramp out will last (THEBEATLENGTH*RAMPDOWNFRACTION)>>8 samples
 #define RAMPDOWNFRACTION 256
@@ -64,6 +67,23 @@ static inline mp_sint32 myMod(mp_sint32 a, mp_sint32 b)
   - Saga_Musix @ http://modarchive.org/forums/index.php?topic=3517.0
 */
 mp_sint32 ChannelMixer::panLUT[257];
+float ChannelMixer::filterLossLUT[ChannelMixer::FILTER_NUMRESONANCES];
+
+bool ChannelMixer::buildStaticTables()
+{
+	// FT2 panning law
+	for (int i = 0; i <= 256; i++)
+		panLUT[i] = static_cast<mp_sint32> (8192.0 * sqrt(i/256.0) + 0.5);
+
+	for (int i = 0; i < FILTER_NUMRESONANCES; i++)
+		filterLossLUT[i] = calcFilterLoss(i);
+
+	return true;
+}
+
+// built during static initialization, before any mixer can read them
+bool ChannelMixer::staticTablesBuilt = ChannelMixer::buildStaticTables();
+
 void ChannelMixer::panToVol(ChannelMixer::TMixerChannel *chn, mp_sint32 &volL, mp_sint32 &volR)
 {
 	mp_sint32 pan = (((chn->pan - 128)*panningSeparation) >> 8) + 128;
@@ -121,16 +141,26 @@ void ChannelMixer::ResamplerBase::directOutChannel(ChannelMixer* mixer, mp_uint3
 		directOutBlockFull((buffer), chn, (beatlength));
 }
 
-void ChannelMixer::ResamplerBase::addChannelsNormal(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength)
+void ChannelMixer::ResamplerBase::addChannelsNormal(ChannelMixer* mixer, mp_uint32 firstVoice, mp_uint32 voiceStride, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength, mp_uint32 channelStride)
 {
 	ChannelMixer::TMixerChannel* channel = mixer->channel;
 	ChannelMixer::TMixerChannel* newChannel = mixer->newChannel;
+	const mp_uint32* activeVoices = mixer->activeVoices;
+	const mp_uint32 numActiveVoices = mixer->numActiveVoices;
 
-	for (mp_uint32 c=0;c<numChannels;c++)
+	for (mp_uint32 v=firstVoice;v<numActiveVoices;v+=voiceStride)
 	{
+		const mp_uint32 c = activeVoices[v];
+		if (c >= numChannels)
+			continue;
+
 		ChannelMixer::TMixerChannel* chn = &channel[c];
 		chn->index = c;		// For Amiga resampler
 
+		// channel c has a buffer of its own when rendering stems or when it
+		// goes through an insert chain
+		mp_sint32* chnBuffer32 = mixer->getChannelBuffer(c, buffer32, channelStride);
+
 		if (!(chn->flags & MP_SAMPLE_PLAY))
 			continue;
 
@@ -164,21 +194,31 @@ void ChannelMixer::ResamplerBase::addChannelsNormal(ChannelMixer* mixer, mp_uint
 		}
 
 		// mix here
-		addChannel(chn, buffer32, beatlength, beatlength);
+		addChannel(chn, chnBuffer32, beatlength, beatlength);
 
 	}
 }
 
-void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength)
+void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uint32 firstVoice, mp_uint32 voiceStride, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength, mp_uint32 channelStride)
 {
 	ChannelMixer::TMixerChannel* channel = mixer->channel;
 	ChannelMixer::TMixerChannel* newChannel = mixer->newChannel;
+	const mp_uint32* activeVoices = mixer->activeVoices;
+	const mp_uint32 numActiveVoices = mixer->numActiveVoices;
 
-	for (mp_uint32 c=0;c<numChannels;c++)
+	for (mp_uint32 v=firstVoice;v<numActiveVoices;v+=voiceStride)
 	{
+		const mp_uint32 c = activeVoices[v];
+		if (c >= numChannels)
+			continue;
+
 		ChannelMixer::TMixerChannel* chn = &channel[c];
 		chn->index = c;		// For Amiga resampler
 
+		// channel c has a buffer of its own when rendering stems or when it
+		// goes through an insert chain
+		mp_sint32* chnBuffer32 = mixer->getChannelBuffer(c, buffer32, channelStride);
+
 		if (!(chn->flags & MP_SAMPLE_PLAY))
 			continue;
 
@@ -196,7 +236,7 @@ void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uin
 				chn->rampFromVolStepR = (-chn->finalvolr)/beatl;
 
 				if (beatl)
-					addChannel(chn, buffer32, beatl, beatlength);
+					addChannel(chn, chnBuffer32, beatl, beatlength);
 				chn->flags&=~(MP_SAMPLE_PLAY | MP_SAMPLE_FADEOFF);
 				continue;
 			}
@@ -221,7 +261,7 @@ void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uin
 
 				// mix here
 				if (beatl)
-					addChannel(chn, buffer32, beatl, beatlength);
+					addChannel(chn, chnBuffer32, beatl, beatlength);
 
 				//chn->finalvoll = volL;
 				//chn->finalvolr = volR;
@@ -234,7 +274,7 @@ void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uin
 				beatl = beatlength - beatl;
 
 				if (beatl)
-					addChannel(chn, buffer32+offset*MP_NUMCHANNELS, beatl, beatlength);
+					addChannel(chn, chnBuffer32+offset*MP_NUMCHANNELS, beatl, beatlength);
 				break;
 			}
 
@@ -269,7 +309,7 @@ void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uin
 				chn->b = newChannel[c].b;
 				chn->c = newChannel[c].c;
 				if (beatl)
-					addChannel(chn, buffer32, beatl, beatlength);
+					addChannel(chn, chnBuffer32, beatl, beatlength);
 				chn->smpadd = tmpsmpadd;
 				chn->rsmpadd = tmprsmpadd;
 				chn->currsample = tmpcurrsample;
@@ -304,7 +344,7 @@ void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uin
 				chn->finalvoll = chn->finalvolr = 0;
 
 				if (beatl)
-					addChannel(chn, buffer32, beatl, beatlength);
+					addChannel(chn, chnBuffer32, beatl, beatlength);
 
 				chn->rampFromVolStepL = 0;
 				chn->rampFromVolStepR = 0;
@@ -314,7 +354,7 @@ void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uin
 				beatl = beatlength - beatl;
 
 				if (beatl)
-					addChannel(chn, buffer32+offset*MP_NUMCHANNELS, beatl, beatlength);
+					addChannel(chn, chnBuffer32+offset*MP_NUMCHANNELS, beatl, beatlength);
 
 				continue;
 			}
@@ -327,7 +367,7 @@ void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uin
 				chn->rampFromVolStepR = (volR-chn->finalvolr)/beatlength;
 
 				// mix here
-				addChannel(chn, buffer32, beatlength, beatlength);
+				addChannel(chn, chnBuffer32, beatlength, beatlength);
 
 				//chn->finalvoll = volL;
 				//chn->finalvolr = volR;
@@ -338,15 +378,26 @@ void ChannelMixer::ResamplerBase::addChannelsRamping(ChannelMixer* mixer, mp_uin
 	}
 }
 
-void ChannelMixer::ResamplerBase::addChannels(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength)
+void ChannelMixer::ResamplerBase::addChannels(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength, mp_uint32 channelStride)
 {
 	if (beatNum >= (signed)mixer->getNumBeatPackets())
 		beatNum = mixer->getNumBeatPackets();
 
+	if (mixer->threadPool)
+		mixer->threadPool->addChannels(this, mixer, numChannels, buffer32, beatNum, beatlength, channelStride);
+	else
+		addChannelsPartial(mixer, 0, 1, numChannels, buffer32, beatNum, beatlength, channelStride);
+}
+
+void ChannelMixer::ResamplerBase::addChannelsPartial(ChannelMixer* mixer, mp_uint32 firstVoice, mp_uint32 voiceStride, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength, mp_uint32 channelStride)
+{
 	if (isRamping())
-		addChannelsRamping(mixer, numChannels, buffer32, beatNum, beatlength);
+		addChannelsRamping(mixer, firstVoice, voiceStride, numChannels, buffer32, beatNum, beatlength, channelStride);
 	else
-		addChannelsNormal(mixer, numChannels, buffer32, beatNum, beatlength);
+		addChannelsNormal(mixer, firstVoice, voiceStride, numChannels, buffer32, beatNum, beatlength, channelStride);
+
+	if (mixer->numInsertChains)
+		mixer->processInsertChains(firstVoice, voiceStride, numChannels, buffer32, beatlength, channelStride);
 }
 
 void ChannelMixer::ResamplerBase::addChannel(TMixerChannel* chn, mp_sint32* buffer32, const mp_sint32 beatlength, const mp_sint32 beatSize)
@@ -545,6 +596,26 @@ void ChannelMixer::setFrequency(mp_sint32 frequency)
 
 	mixbuffBeatPacket = new mp_sint32[beatPacketSize*MP_NUMCHANNELS];
 
+	if (threadPool)
+		threadPool->setMaxBeatLength(beatPacketSize);
+
+	// reallocated with the new beat packet size when needed
+	delete[] stemBeatPackets;
+	stemBeatPackets = NULL;
+	stemBeatPacketsSize = 0;
+
+	// filter coefficients depend on the mixing frequency
+	if (filterInvAngleLUT == NULL)
+		filterInvAngleLUT = new float[FILTER_NUMCUTOFFS];
+	memset(filterInvAngleLUT, 0, FILTER_NUMCUTOFFS*sizeof(float));
+
+	if (numInsertChains)
+	{
+		for (mp_uint32 i = 0; i < mixerNumAllocatedChannels; i++)
+			if (insertChains[i])
+				insertChains[i]->prepare(beatPacketSize, mixFrequency);
+	}
+
 	for(int i = 0; i < MAX_DIRECTOUT_CHANNELS; i++) {
 		if (mixbuffBeatPackets[i])
 			delete[] mixbuffBeatPackets[i];
@@ -559,25 +630,86 @@ void ChannelMixer::setFrequency(mp_sint32 frequency)
 		resamplerTable[resamplerType]->setFrequency(frequency);
 }
 
+ChannelMixer::TMixerChannel* ChannelMixer::TMixerChannel::allocArray(mp_uint32 num)
+{
+	const size_t cacheLineSize = 64;
+
+	// over-allocate for the alignment and the pointer to the actual block
+	mp_ubyte* memory = new mp_ubyte[num*sizeof(TMixerChannel) + cacheLineSize + sizeof(mp_ubyte*)];
+	mp_ubyte* aligned = (mp_ubyte*)(((size_t)(memory + sizeof(mp_ubyte*)) + cacheLineSize - 1) & ~(cacheLineSize - 1));
+	((mp_ubyte**)aligned)[-1] = memory;
+
+	TMixerChannel* channels = (TMixerChannel*)aligned;
+	for (mp_uint32 i = 0; i < num; i++)
+		new (&channels[i]) TMixerChannel();
+
+	return channels;
+}
+
+void ChannelMixer::TMixerChannel::freeArray(TMixerChannel* channels, mp_uint32 num)
+{
+	if (channels == NULL)
+		return;
+
+	for (mp_uint32 i = 0; i < num; i++)
+		channels[i].~TMixerChannel();
+
+	delete[] ((mp_ubyte**)channels)[-1];
+}
+
 void ChannelMixer::reallocChannels()
 {
 	// optimization in case we already have the allocated number of channels
 	if (mixerNumAllocatedChannels != mixerLastNumAllocatedChannels)
 	{
-		delete[] channel;
-		channel = new TMixerChannel[mixerNumAllocatedChannels];
+		TMixerChannel::freeArray(channel, mixerLastNumAllocatedChannels);
+		channel = TMixerChannel::allocArray(mixerNumAllocatedChannels);
 
-		delete[] newChannel;
-		newChannel = new TMixerChannel[mixerNumAllocatedChannels];
+		TMixerChannel::freeArray(newChannel, mixerLastNumAllocatedChannels);
+		newChannel = TMixerChannel::allocArray(mixerNumAllocatedChannels);
+
+		delete[] activeVoices;
+		activeVoices = new mp_uint32[mixerNumAllocatedChannels];
+
+		delete[] activeVoiceIdleBeats;
+		activeVoiceIdleBeats = new mp_sint32[mixerNumAllocatedChannels];
+
+		// keep the insert chains of the channels which are still there
+		if (insertChains)
+		{
+			ChannelInsertChain** oldInsertChains = insertChains;
+			insertChains = new ChannelInsertChain*[mixerNumAllocatedChannels];
+			numInsertChains = 0;
+			for (mp_uint32 i = 0; i < mixerNumAllocatedChannels; i++)
+			{
+				insertChains[i] = i < mixerLastNumAllocatedChannels ? oldInsertChains[i] : NULL;
+				if (insertChains[i])
+					numInsertChains++;
+			}
+			delete[] oldInsertChains;
+		}
 
 		clearChannels();
 	}
 
 #if defined(MILKYTRACKER) || defined (__MPTIMETRACKING__)
 	for (mp_uint32 i = 0; i < mixerNumAllocatedChannels; i++)
-		channel[i].reallocTimeRecord(getNumBeatPackets()+1);
+		channel[i].reallocTimeRecord(getNumTimeRecords());
 #endif
 
+	delete[] scopeRecords;
+	scopeRecords = NULL;
+	if (scopeRecording)
+	{
+		const mp_uint32 numScopeRecords = mixerNumAllocatedChannels*getNumTimeRecords();
+		scopeRecords = new TScopeRecord[numScopeRecords];
+		for (mp_uint32 i = 0; i < numScopeRecords; i++)
+		{
+			scopeRecords[i].playing = false;
+			memset(scopeRecords[i].data, 0, sizeof(scopeRecords[i].data));
+		}
+	}
+
 	mixerLastNumAllocatedChannels = mixerNumAllocatedChannels;
 
 	if (resamplerType != MIXER_INVALID && resamplerTable[resamplerType])
@@ -590,7 +722,37 @@ void ChannelMixer::clearChannels()
 	{
 		channel[i].clear();
 		newChannel[i].clear();
+		activeVoiceIdleBeats[i] = -1;
 	}
+
+	numActiveVoices = 0;
+}
+
+void ChannelMixer::updateActiveVoices()
+{
+	// keep stopped channels for another full buffer (in every time record
+	// slot) so all of their time records get overwritten with the idle state,
+	// with sample accurate ticks a buffer holds up to twice as many (shorter)
+	// beat packets
+	const mp_sint32 maxIdleBeats = getNumTimeRecords() * (sampleAccurateTicks ? 2 : 1);
+
+	mp_uint32 num = 0;
+	for (mp_uint32 i = 0; i < numActiveVoices; i++)
+	{
+		const mp_uint32 c = activeVoices[i];
+
+		if (channel[c].flags & MP_SAMPLE_PLAY)
+			activeVoiceIdleBeats[c] = 0;
+		else if (++activeVoiceIdleBeats[c] > maxIdleBeats)
+		{
+			activeVoiceIdleBeats[c] = -1;
+			continue;
+		}
+
+		activeVoices[num++] = c;
+	}
+
+	numActiveVoices = num;
 }
 
 ChannelMixer::ChannelMixer(mp_uint32 numChannels,
@@ -600,13 +762,28 @@ ChannelMixer::ChannelMixer(mp_uint32 numChannels,
 	mixerLastNumAllocatedChannels(0),
 	mixFrequency(0),
 	mixbuffBeatPacket(NULL),
+	stemBeatPackets(NULL),
+	stemBeatPacketsSize(0),
 	mixBufferSize(0),
+	numTimeRecordSlots(1),
+	timeRecordBase(0),
 	channel(NULL),
 	newChannel(NULL),
+	activeVoices(NULL),
+	activeVoiceIdleBeats(NULL),
+	numActiveVoices(0),
 	resamplerType(MIXER_INVALID),
+	threadPool(NULL),
+	insertChains(NULL),
+	numInsertChains(0),
+	scopeRecords(NULL),
+	scopeRecording(false),
+	dryRunResampler(NULL),
 	paused(false),
 	disableMixing(false),
 	allowFilters(false),
+	sampleAccurateTicks(false),
+	filterInvAngleLUT(NULL),
 	initialized(false),
 	sampleCounter(0)
 {
@@ -632,11 +809,6 @@ ChannelMixer::ChannelMixer(mp_uint32 numChannels,
 	setResamplerType(MIXER_NORMAL);
 
 	setBufferSize(BUFFERSIZE_DEFAULT);
-
-	// FT2 panning law
-	if (panLUT[1] == 0)
-		for (int i = 0; i <= 256; i++)
-			panLUT[i] = static_cast<mp_sint32> (8192.0 * sqrt(i/256.0) + 0.5);
 }
 
 ChannelMixer::~ChannelMixer()
@@ -649,6 +821,8 @@ ChannelMixer::~ChannelMixer()
 	if (mixbuffBeatPacket)
 		delete[] mixbuffBeatPacket;
 
+	delete[] stemBeatPackets;
+
 	for(int i = 0; i < MAX_DIRECTOUT_CHANNELS; i++) {
 		if(mixbuffBeatPackets[i]) {
 			delete[] mixbuffBeatPackets[i];
@@ -656,14 +830,128 @@ ChannelMixer::~ChannelMixer()
 	}
 	delete[] mixbuffBeatPackets;
 
-	if (channel)
-		delete[] channel;
+	TMixerChannel::freeArray(channel, mixerLastNumAllocatedChannels);
+	TMixerChannel::freeArray(newChannel, mixerLastNumAllocatedChannels);
 
-	if (newChannel)
-		delete[] newChannel;
+	delete[] activeVoices;
+	delete[] activeVoiceIdleBeats;
 
 	for (mp_uint32 i = 0; i < sizeof(resamplerTable) / sizeof(ResamplerBase*); i++)
 		delete resamplerTable[i];
+
+	delete threadPool;
+
+	delete[] insertChains;
+
+	delete[] scopeRecords;
+
+	delete dryRunResampler;
+
+	delete[] filterInvAngleLUT;
+}
+
+void ChannelMixer::setNumMixerThreads(mp_uint32 num)
+{
+	if (num == getNumMixerThreads())
+		return;
+
+	delete threadPool;
+	threadPool = NULL;
+
+	if (num > 1)
+	{
+		threadPool = new MixerThreadPool(num);
+		// no threads on this platform
+		if (threadPool->getNumThreads() < 2)
+		{
+			delete threadPool;
+			threadPool = NULL;
+		}
+		else
+		{
+			threadPool->setMaxBeatLength(beatPacketSize);
+		}
+	}
+}
+
+void ChannelMixer::setInsertChain(mp_uint32 c, ChannelInsertChain* chain)
+{
+	if (c >= mixerNumAllocatedChannels)
+		return;
+
+	if (insertChains == NULL)
+	{
+		if (chain == NULL)
+			return;
+
+		insertChains = new ChannelInsertChain*[mixerNumAllocatedChannels];
+		memset(insertChains, 0, mixerNumAllocatedChannels*sizeof(ChannelInsertChain*));
+	}
+
+	if (insertChains[c])
+		numInsertChains--;
+
+	insertChains[c] = chain;
+
+	if (chain)
+	{
+		// beat packets are never longer than beatPacketSize
+		chain->prepare(beatPacketSize, mixFrequency);
+		numInsertChains++;
+	}
+}
+
+ChannelInsertChain* ChannelMixer::getInsertChain(mp_uint32 c) const
+{
+	if (insertChains == NULL || c >= mixerNumAllocatedChannels)
+		return NULL;
+
+	return insertChains[c];
+}
+
+mp_sint32* ChannelMixer::insertChainBuffer(mp_uint32 c) const
+{
+	return insertChains[c]->getBuffer();
+}
+
+void ChannelMixer::processInsertChains(mp_uint32 firstVoice, mp_uint32 voiceStride, mp_uint32 numChannels,
+									   mp_sint32* buffer32, mp_sint32 beatlength, mp_uint32 channelStride)
+{
+	if (dryRunResampler)
+		return;
+
+	// every active voice, playing or not, so the chains can ring out
+	for (mp_uint32 v = firstVoice; v < numActiveVoices; v+=voiceStride)
+	{
+		const mp_uint32 c = activeVoices[v];
+		if (c >= numChannels || insertChains[c] == NULL)
+			continue;
+
+		if (channelStride)
+			insertChains[c]->process(buffer32 + c*channelStride, beatlength);
+		else
+			insertChains[c]->processAndAdd(buffer32, beatlength);
+	}
+}
+
+mp_uint32 ChannelMixer::getNumMixerThreads() const
+{
+	return threadPool ? threadPool->getNumThreads() : 1;
+}
+
+bool ChannelMixer::supportsDryRun() const
+{
+	return resamplerType != MIXER_INVALID && resamplerTable[resamplerType] &&
+		   resamplerTable[resamplerType]->supportsDryRun();
+}
+
+void ChannelMixer::setDryRun(bool dryRun)
+{
+	delete dryRunResampler;
+	dryRunResampler = NULL;
+
+	if (dryRun && supportsDryRun())
+		dryRunResampler = ResamplerFactory::createDryRunResampler(*resamplerTable[resamplerType]);
 }
 
 void ChannelMixer::startMixer()
@@ -709,6 +997,10 @@ void ChannelMixer::setResamplerType(ResamplerTypes type)
 		resamplerTable[resamplerType]->setFrequency(mixFrequency);
 		resamplerTable[resamplerType]->setNumChannels(mixerNumAllocatedChannels);
 	}
+
+	// follow the new resampler
+	if (dryRunResampler)
+		setDryRun(true);
 }
 
 void ChannelMixer::setNumChannels(mp_uint32 num)
@@ -742,6 +1034,93 @@ void ChannelMixer::setActiveChannels(mp_uint32 num)
 	mixerNumActiveChannels = num;
 }
 
+bool ChannelMixer::saveChannelState(PlayerSnapshot& snapshot, const XModule* module) const
+{
+	// the rest of a beat packet is already mixed and can't be stored
+	if (lastBeatRemainder)
+		return false;
+
+	for (mp_uint32 c = 0; c < mixerNumActiveChannels; c++)
+	{
+		TMixerChannel* chn = (TMixerChannel*)snapshot.writeStruct(&channel[c], sizeof(TMixerChannel));
+		chn->sample = NULL;
+		chn->timeRecordSize = 0;
+		chn->timeRecord = NULL;
+
+		if (!snapshot.writeSample(module, channel[c].sample))
+			return false;
+
+		// sample waiting for the current one to be ramped down
+		const bool fadeOut = (channel[c].flags & MP_SAMPLE_FADEOUT) != 0;
+		snapshot.write(fadeOut);
+		if (fadeOut)
+		{
+			chn = (TMixerChannel*)snapshot.writeStruct(&newChannel[c], sizeof(TMixerChannel));
+			chn->sample = NULL;
+			chn->timeRecordSize = 0;
+			chn->timeRecord = NULL;
+
+			if (!snapshot.writeSample(module, newChannel[c].sample))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+bool ChannelMixer::restoreChannelState(PlayerSnapshot::Reader& reader)
+{
+	for (mp_uint32 c = 0; c < mixerNumActiveChannels; c++)
+	{
+		const void* src = reader.readStruct(sizeof(TMixerChannel));
+		const mp_sbyte* sample;
+		if (src == NULL || !reader.readSample(sample))
+			return false;
+
+		// muting and the time records belong to the mixer which restores
+		TMixerChannel& chn = channel[c];
+		const mp_uint32 mute = chn.flags & MP_SAMPLE_MUTE;
+		const mp_uint32 timeRecordSize = chn.timeRecordSize;
+		TTimeRecord* timeRecord = chn.timeRecord;
+
+		memcpy((void*)&chn, src, sizeof(TMixerChannel));
+
+		chn.sample = sample;
+		chn.flags = (chn.flags & ~MP_SAMPLE_MUTE) | mute;
+		chn.timeRecordSize = timeRecordSize;
+		chn.timeRecord = timeRecord;
+
+		bool fadeOut;
+		if (!reader.read(fadeOut))
+			return false;
+
+		if (fadeOut)
+		{
+			src = reader.readStruct(sizeof(TMixerChannel));
+			if (src == NULL || !reader.readSample(sample))
+				return false;
+
+			TMixerChannel& newChn = newChannel[c];
+			const mp_uint32 newTimeRecordSize = newChn.timeRecordSize;
+			TTimeRecord* newTimeRecord = newChn.timeRecord;
+
+			memcpy((void*)&newChn, src, sizeof(TMixerChannel));
+
+			newChn.sample = sample;
+			newChn.timeRecordSize = newTimeRecordSize;
+			newChn.timeRecord = newTimeRecord;
+		}
+
+		// visit every channel once, so the time records of the
+		// ones which don't play are overwritten as well
+		activateVoice(c);
+	}
+
+	lastBeatRemainder = 0;
+
+	return true;
+}
+
 // Default lo precision calculations
 void ChannelMixer::setChannelFrequency(mp_sint32 c, mp_sint32 f, mp_sint32 per)
 {
@@ -754,6 +1133,21 @@ void ChannelMixer::setChannelFrequency(mp_sint32 c, mp_sint32 f, mp_sint32 per)
 		channel[c].rsmpadd = 0;
 }
 
+// Thanks to DUMB for the filter coefficient computations
+const mp_sint32 IT_ENVELOPE_SHIFT = 8;
+
+float ChannelMixer::calcFilterInvAngle(mp_uint32 mixFrequency, mp_sint32 cutoff)
+{
+	float sampfreq = mixFrequency;
+	return (float)(sampfreq * pow(0.5, 0.25 + cutoff*(1.0/(24<<IT_ENVELOPE_SHIFT))) * (1.0/(2*3.14159265358979323846*110.0)));
+}
+
+float ChannelMixer::calcFilterLoss(mp_sint32 resonance)
+{
+	const float LOG10 = 2.30258509299f;
+	return (float)exp(resonance*(-LOG10*1.2/128.0));
+}
+
 void ChannelMixer::setFilterAttributes(mp_sint32 chn, mp_sint32 cutoff, mp_sint32 resonance)
 {
 	if (!allowFilters ||
@@ -767,16 +1161,20 @@ void ChannelMixer::setFilterAttributes(mp_sint32 chn, mp_sint32 cutoff, mp_sint3
 	if (cutoff == MP_INVALID_VALUE || resonance == MP_INVALID_VALUE)
 		return;
 
-	// Thanks to DUMB for the filter coefficient computations
-	const float LOG10 = 2.30258509299f;
-	const mp_sint32 IT_ENVELOPE_SHIFT = 8;
-
 	float a, b, c;
 	{
-		float sampfreq = this->mixFrequency;
+		float inv_angle;
+		if (cutoff >= 0 && cutoff < FILTER_NUMCUTOFFS)
+		{
+			// zero means not computed yet
+			inv_angle = filterInvAngleLUT[cutoff];
+			if (inv_angle == 0.0f)
+				inv_angle = filterInvAngleLUT[cutoff] = calcFilterInvAngle(mixFrequency, cutoff);
+		}
+		else
+			inv_angle = calcFilterInvAngle(mixFrequency, cutoff);
 
-		float inv_angle = (float)(sampfreq * pow(0.5, 0.25 + cutoff*(1.0/(24<<IT_ENVELOPE_SHIFT))) * (1.0/(2*3.14159265358979323846*110.0)));
-		float loss = (float)exp(resonance*(-LOG10*1.2/128.0));
+		float loss = (resonance >= 0 && resonance < FILTER_NUMRESONANCES) ? filterLossLUT[resonance] : calcFilterLoss(resonance);
 		float d, e;
 #if 0
 		loss *= 2; // This is the mistake most players seem to make!
@@ -885,6 +1283,7 @@ void ChannelMixer::playSample(mp_sint32 c, // channel
 		channel[c].smpposfrac = smpoffsfrac;
 		channel[c].flags&=~MP_SAMPLE_FADEOFF;
 		channel[c].flags=flags|MP_SAMPLE_PLAY|(channel[c].flags&MP_SAMPLE_MUTE);
+		activateVoice(c);
 
 		channel[c].currsample = channel[c].prevsample = 0;
 
@@ -907,6 +1306,7 @@ void ChannelMixer::playSample(mp_sint32 c, // channel
 		channel[c].smpposfrac = smpoffsfrac;
 		channel[c].flags&=~MP_SAMPLE_FADEOFF;
 		channel[c].flags=flags|MP_SAMPLE_PLAY|(channel[c].flags&MP_SAMPLE_MUTE)|MP_SAMPLE_FADEIN;
+		activateVoice(c);
 		// if a new sample is played, its volume is ramped from zero to current volume
 		channel[c].finalvoll = 0;
 		channel[c].finalvolr = 0;
@@ -1016,6 +1416,141 @@ static inline void storeTimeRecordData(mp_sint32 nb, ChannelMixer::TMixerChannel
 	}
 }
 
+void ChannelMixer::recordVoices(mp_uint32 timeRecordIndex)
+{
+	const mp_uint32 numTimeRecords = getNumTimeRecords();
+	// nobody looks at the scopes of a dry run
+	const bool recordScopes = scopeRecords && !dryRunResampler;
+
+	for (mp_uint32 v=0;v<numActiveVoices;v++)
+	{
+		const mp_uint32 c = activeVoices[v];
+		if (c >= mixerNumActiveChannels)
+			continue;
+
+		storeTimeRecordData(timeRecordIndex, &channel[c]);
+
+		if (recordScopes)
+		{
+			TScopeRecord& record = scopeRecords[c*numTimeRecords + timeRecordIndex];
+			record.lock.beginWrite();
+			storeScopeData(record, &channel[c]);
+			record.lock.endWrite();
+		}
+	}
+}
+
+// Steps through the sample the way the block mixers do, SCOPESIZE times
+// over the length of a beat packet, with linear interpolation only
+void ChannelMixer::storeScopeData(TScopeRecord& record, const TMixerChannel* chn) const
+{
+	mp_sword* data = record.data;
+	const mp_sbyte* sample = chn->sample;
+	mp_sint32 flags = chn->flags;
+
+	record.playing = (flags & MP_SAMPLE_PLAY) && sample != NULL;
+	if (!record.playing)
+	{
+		memset(data, 0, sizeof(record.data));
+		return;
+	}
+
+	mp_sint32 vol = chn->vol;
+	if (vol > 256)
+		vol = 256;
+
+	const mp_sint32 loopstart = chn->loopstart;
+	mp_sint32 loopend = chn->loopend;
+
+	const mp_int64 step = ((mp_int64)chn->smpadd * beatPacketSize) / SCOPESIZE;
+	mp_int64 pos = ((mp_int64)chn->smppos << 16) + chn->smpposfrac;
+
+	mp_uint32 i = 0;
+	while (i < SCOPESIZE)
+	{
+		const mp_sint32 smppos = (mp_sint32)(pos >> 16);
+		const mp_sint32 smpposfrac = (mp_sint32)(pos & 65535);
+
+		mp_sint32 sd1, sd2;
+		if (flags & 4)
+		{
+			sd1 = ((const mp_sword*)sample)[smppos];
+			sd2 = ((const mp_sword*)sample)[smppos+1];
+		}
+		else
+		{
+			sd1 = sample[smppos] << 8;
+			sd2 = sample[smppos+1] << 8;
+		}
+		sd1 = ((sd1<<12)+(smpposfrac>>4)*(sd2-sd1))>>12;
+		data[i++] = (mp_sword)((sd1*vol)>>9);
+
+		if (flags & MP_SAMPLE_BACKWARD)
+		{
+			pos-=step;
+			const mp_sint32 newpos = (mp_sint32)(pos >> 16);
+			if (newpos < loopstart && (flags & 3) == 2 && loopend > loopstart)
+			{
+				flags &= ~MP_SAMPLE_BACKWARD;
+				pos = ((mp_int64)(loopstart + (loopstart - newpos) % (loopend - loopstart)) << 16) + (pos & 65535);
+			}
+			else if (newpos < 0)
+				break;
+		}
+		else
+		{
+			pos+=step;
+			const mp_sint32 newpos = (mp_sint32)(pos >> 16);
+			if (newpos < loopend)
+				continue;
+
+			if ((flags & 3) == 0 && (flags & MP_SAMPLE_ONESHOT))
+			{
+				flags = (flags & ~MP_SAMPLE_ONESHOT) | 1;
+				loopend = chn->loopendcopy;
+			}
+
+			if ((flags & 3) == 0 || loopend <= loopstart)
+				break;
+
+			if ((flags & 3) == 1)
+				pos = ((mp_int64)(loopstart + (newpos - loopstart) % (loopend - loopstart)) << 16) + (pos & 65535);
+			else
+			{
+				flags |= MP_SAMPLE_BACKWARD;
+				pos = ((mp_int64)(loopend - 1 - (newpos - loopend) % (loopend - loopstart)) << 16) + (pos & 65535);
+			}
+		}
+	}
+
+	// the sample ended within the beat packet
+	if (i < SCOPESIZE)
+		memset(data + i, 0, (SCOPESIZE - i)*sizeof(mp_sword));
+}
+
+void ChannelMixer::setScopeRecording(bool scopeRecording)
+{
+	if (this->scopeRecording == scopeRecording)
+		return;
+
+	this->scopeRecording = scopeRecording;
+
+	reallocChannels();
+}
+
+bool ChannelMixer::getScopeData(mp_uint32 c, mp_uint32 timeRecordIndex, mp_sword* data, bool& playing) const
+{
+	const mp_uint32 numTimeRecords = getNumTimeRecords();
+	if (scopeRecords == NULL || c >= mixerNumAllocatedChannels || timeRecordIndex >= numTimeRecords)
+		return false;
+
+	const TScopeRecord& record = scopeRecords[c*numTimeRecords + timeRecordIndex];
+	const mp_uint32 sequence = record.lock.beginRead();
+	playing = record.playing;
+	memcpy(data, record.data, sizeof(record.data));
+	return record.lock.endRead(sequence);
+}
+
 void ChannelMixer::hardwareOutChannel(MixerProxy * mixerProxy, mp_uint32 c)
 {
 	ProxyProcessor * processor = mixerProxy->getProcessor();
@@ -1139,7 +1674,7 @@ void ChannelMixer::directOut(MixerProxy * mixerProxy)
 
 			if (!disableMixing) {
 				for(c = 0; c < nChannels; c++) {
-					storeTimeRecordData(nb, &channel[c]);
+					storeTimeRecordData(timeRecordBase + nb, &channel[c]);
 					if(resamplerTable[MIXER_NORMAL] != NULL) {
 						resamplerTable[MIXER_NORMAL]->directOutChannel(this, c, mixerProxy->getBuffer<mp_sword>(c) + nb * beatLength * MP_NUMCHANNELS, nb, beatLength);
 					}
@@ -1160,7 +1695,7 @@ void ChannelMixer::directOut(MixerProxy * mixerProxy)
 
 			if (!disableMixing) {
 				for(c = 0; c < nChannels; c++) {
-					storeTimeRecordData(nb, &channel[c]);
+					storeTimeRecordData(timeRecordBase + nb, &channel[c]);
 					if(resamplerTable[MIXER_NORMAL] != NULL) {
 						resamplerTable[MIXER_NORMAL]->directOutChannel(this, c, mixbuffBeatPackets[c], nb, beatLength);
 					}
@@ -1173,14 +1708,101 @@ void ChannelMixer::directOut(MixerProxy * mixerProxy)
 					memcpy(mixerProxy->getBuffer<mp_sword>(c), mixbuffBeatPackets[c], todo * MP_NUMCHANNELS * sizeof(mp_sword));
 				}
 				lastBeatRemainder = beatLength - todo;
+				lastBeatLength = beatLength;
 			}
 		}
 	}
 }
 
+// Adds a part of the last beat packet(s) to the mix buffer(s)
+static inline void addBeatPacketRemainder(mp_sint32* buffer, const mp_sint32* beatPacket, mp_sint32 todo,
+										  mp_uint32 numBuffers, mp_uint32 bufferStride, mp_uint32 beatPacketStride)
+{
+	for (mp_uint32 b = 0; b < numBuffers; b++)
+	{
+		//memcpy(buffer, beatPacket, todo*MP_NUMCHANNELS*sizeof(mp_sint32));
+		const mp_sint32* src = beatPacket + b*beatPacketStride;
+		mp_sint32* dst = buffer + b*bufferStride;
+		for (mp_sint32 i = 0; i < todo*MP_NUMCHANNELS; i++, src++, dst++)
+			*dst += *src;
+	}
+}
+
 void ChannelMixer::mixDown(MixerProxy * mixerProxy)
 {
-	mp_sint32* buffer = mixerProxy->getBuffer<mp_sint32>(MixerProxyMixDown::MixBuffer);
+	mixDownBuffers(mixerProxy->getBuffer<mp_sint32>(MixerProxyMixDown::MixBuffer), mixbuffBeatPacket,
+				   mixerNumActiveChannels, 0, 0);
+}
+
+void ChannelMixer::mixDownStems(MixerProxy * mixerProxy)
+{
+	// happens only when channels were added since the last mix
+	MixerProxyMixDownStems* stemProxy = static_cast<MixerProxyMixDownStems*>(mixerProxy);
+	if (stemProxy->isGrowable() && stemProxy->getNumChannels() < mixerNumActiveChannels)
+		stemProxy->grow(mixerNumActiveChannels);
+
+	const mp_uint32 numStems = mixerProxy->getNumChannels() < mixerNumActiveChannels ? mixerProxy->getNumChannels() : mixerNumActiveChannels;
+
+	// every stem needs its own beat packet for the part which doesn't fit into the buffer
+	const mp_uint32 beatPacketStride = beatPacketSize*MP_NUMCHANNELS;
+	if (numStems*beatPacketStride > stemBeatPacketsSize)
+	{
+		delete[] stemBeatPackets;
+		stemBeatPacketsSize = numStems*beatPacketStride;
+		stemBeatPackets = new mp_sint32[stemBeatPacketsSize];
+		memset(stemBeatPackets, 0, stemBeatPacketsSize*sizeof(mp_sint32));
+	}
+
+	// MixerProxyMixDownStems keeps the stem buffers in one block
+	mixDownBuffers(mixerProxy->getBuffer<mp_sint32>(0), stemBeatPackets,
+				   numStems, mixerProxy->getBufferSize()*MP_NUMCHANNELS, beatPacketStride);
+}
+
+void ChannelMixer::storeRampingState()
+{
+	if (allowFilters)
+	{
+		// this is crucial for volume ramping, store current
+		// active sample rate (stored in the step values for each channel)
+		// and also filter coefficients	and last samples
+		for (mp_uint32 v = 0; v < numActiveVoices; v++)
+		{
+			const TMixerChannel* src = &channel[activeVoices[v]];
+			TMixerChannel* dst = &newChannel[activeVoices[v]];
+			dst->smpadd = src->smpadd;
+			dst->rsmpadd = src->rsmpadd;
+
+			dst->a = src->a;
+			dst->b = src->b;
+			dst->c = src->c;
+			dst->currsample = src->currsample;
+			dst->prevsample = src->prevsample;
+		}
+	}
+	else
+	{
+		// this is crucial for volume ramping, store current
+		// active sample rate (stored in the step values for each channel)
+		for (mp_uint32 v = 0; v < numActiveVoices; v++)
+		{
+			const TMixerChannel* src = &channel[activeVoices[v]];
+			TMixerChannel* dst = &newChannel[activeVoices[v]];
+			dst->smpadd = src->smpadd;
+			dst->rsmpadd = src->rsmpadd;
+		}
+	}
+}
+
+void ChannelMixer::mixDownBuffers(mp_sint32* buffer, mp_sint32* beatPacket, mp_uint32 numChannels,
+								  mp_uint32 bufferStride, mp_uint32 beatPacketStride)
+{
+	if (sampleAccurateTicks)
+	{
+		mixDownBuffersSampleAccurate(buffer, beatPacket, numChannels, bufferStride, beatPacketStride);
+		return;
+	}
+
+	const mp_uint32 numBuffers = bufferStride ? numChannels : 1;
 
 	mp_sint32 beatLength = beatPacketSize;
 	mp_sint32 mixSize = mixBufferSize;
@@ -1193,23 +1815,15 @@ void ChannelMixer::mixDown(MixerProxy * mixerProxy)
 		if (lastBeatRemainder > mixBufferSize)
 		{
 			todo = mixBufferSize;
-			mp_uint32 pos = beatLength - lastBeatRemainder;
-			//memcpy(buffer, mixbuffBeatPacket + pos*MP_NUMCHANNELS, todo*MP_NUMCHANNELS*sizeof(mp_sint32));
-			const mp_sint32* src = mixbuffBeatPacket + pos*MP_NUMCHANNELS;
-			mp_sint32* dst = buffer;
-			for (mp_sint32 i = 0; i < todo*MP_NUMCHANNELS; i++, src++, dst++)
-				*dst += *src;
+			mp_uint32 pos = lastBeatLength - lastBeatRemainder;
+			addBeatPacketRemainder(buffer, beatPacket + pos*MP_NUMCHANNELS, todo, numBuffers, bufferStride, beatPacketStride);
 			done = mixBufferSize;
 			lastBeatRemainder-=done;
 		}
 		else
 		{
-			mp_uint32 pos = beatLength - lastBeatRemainder;
-			//memcpy(buffer, mixbuffBeatPacket + pos*MP_NUMCHANNELS, todo*MP_NUMCHANNELS*sizeof(mp_sint32));
-			const mp_sint32* src = mixbuffBeatPacket + pos*MP_NUMCHANNELS;
-			mp_sint32* dst = buffer;
-			for (mp_sint32 i = 0; i < todo*MP_NUMCHANNELS; i++, src++, dst++)
-				*dst += *src;
+			mp_uint32 pos = lastBeatLength - lastBeatRemainder;
+			addBeatPacketRemainder(buffer, beatPacket + pos*MP_NUMCHANNELS, todo, numBuffers, bufferStride, beatPacketStride);
 			buffer+=lastBeatRemainder*MP_NUMCHANNELS;
 			mixSize-=lastBeatRemainder;
 			done = lastBeatRemainder;
@@ -1230,39 +1844,7 @@ void ChannelMixer::mixDown(MixerProxy * mixerProxy)
 		for (nb=0;nb<numbeats;nb++)
 		{
 			if (isRamping)
-			{
-				const TMixerChannel* src = channel;
-				TMixerChannel* dst = newChannel;
-				const mp_uint32 mixerNumActiveChannels = this->mixerNumActiveChannels;
-				if (allowFilters)
-				{
-					// this is crucial for volume ramping, store current
-					// active sample rate (stored in the step values for each channel)
-					// and also filter coefficients	and last samples
-					for (mp_uint32 c = 0; c < mixerNumActiveChannels; c++, src++, dst++)
-					{
-						dst->smpadd = src->smpadd;
-						dst->rsmpadd = src->rsmpadd;
-
-						dst->a = src->a;
-						dst->b = src->b;
-						dst->c = src->c;
-						dst->currsample = src->currsample;
-						dst->prevsample = src->prevsample;
-					}
-				}
-				else
-				{
-					// this is crucial for volume ramping, store current
-					// active sample rate (stored in the step values for each channel)
-					// and also filter coefficients	and last samples
-					for (mp_uint32 c = 0; c < mixerNumActiveChannels; c++, src++, dst++)
-					{
-						dst->smpadd = src->smpadd;
-						dst->rsmpadd = src->rsmpadd;
-					}
-				}
-			}
+				storeRampingState();
 
 			timer(nb);
 
@@ -1270,10 +1852,11 @@ void ChannelMixer::mixDown(MixerProxy * mixerProxy)
 			{
 				// do some in between state recording
 				// to be able to show smooth updates even if the buffer is large
-				for (mp_uint32 c=0;c<mixerNumActiveChannels;c++)
-					storeTimeRecordData(nb, &channel[c]);
+				recordVoices(timeRecordBase + nb);
+
+				mixBeatPacket(numChannels, buffer+nb*beatLength*MP_NUMCHANNELS, nb, beatLength, bufferStride);
 
-				mixBeatPacket(mixerNumActiveChannels, buffer+nb*beatLength*MP_NUMCHANNELS, nb, beatLength);
+				updateActiveVoices();
 			}
 		}
 
@@ -1281,42 +1864,11 @@ void ChannelMixer::mixDown(MixerProxy * mixerProxy)
 
 		if (done < (mp_sint32)mixBufferSize)
 		{
-			memset(mixbuffBeatPacket, 0, beatLength*MP_NUMCHANNELS*sizeof(mp_sint32));
+			for (mp_uint32 b = 0; b < numBuffers; b++)
+				memset(beatPacket + b*beatPacketStride, 0, beatLength*MP_NUMCHANNELS*sizeof(mp_sint32));
 
 			if (isRamping)
-			{
-				const TMixerChannel* src = channel;
-				TMixerChannel* dst = newChannel;
-				const mp_uint32 mixerNumActiveChannels = this->mixerNumActiveChannels;
-				if (allowFilters)
-				{
-					// this is crucial for volume ramping, store current
-					// active sample rate (stored in the step values for each channel)
-					// and also filter coefficients	and last samples
-					for (mp_uint32 c = 0; c < mixerNumActiveChannels; c++, src++, dst++)
-					{
-						dst->smpadd = src->smpadd;
-						dst->rsmpadd = src->rsmpadd;
-
-						dst->a = src->a;
-						dst->b = src->b;
-						dst->c = src->c;
-						dst->currsample = src->currsample;
-						dst->prevsample = src->prevsample;
-					}
-				}
-				else
-				{
-					// this is crucial for volume ramping, store current
-					// active sample rate (stored in the step values for each channel)
-					// and also filter coefficients	and last samples
-					for (mp_uint32 c = 0; c < mixerNumActiveChannels; c++, src++, dst++)
-					{
-						dst->smpadd = src->smpadd;
-						dst->rsmpadd = src->rsmpadd;
-					}
-				}
-			}
+				storeRampingState();
 
 			timer(numbeats);
 
@@ -1324,27 +1876,93 @@ void ChannelMixer::mixDown(MixerProxy * mixerProxy)
 			{
 				// do some in between state recording
 				// to be able to show smooth updates even if the buffer is large
-				for (mp_uint32 c=0;c<mixerNumActiveChannels;c++)
-					storeTimeRecordData(nb, &channel[c]);
+				recordVoices(timeRecordBase + nb);
+
+				mixBeatPacket(numChannels, beatPacket, numbeats, beatLength, beatPacketStride);
 
-				mixBeatPacket(mixerNumActiveChannels, mixbuffBeatPacket, numbeats, beatLength);
+				updateActiveVoices();
 			}
 
 			mp_sint32 todo = mixBufferSize - done;
 
 			if (todo)
 			{
-				//memcpy(buffer, mixbuffBeatPacket, todo*MP_NUMCHANNELS*sizeof(mp_sint32));
-				const mp_sint32* src = mixbuffBeatPacket;
-				mp_sint32* dst = buffer;
-				for (mp_sint32 i = 0; i < todo*MP_NUMCHANNELS; i++, src++, dst++)
-					*dst += *src;
+				addBeatPacketRemainder(buffer, beatPacket, todo, numBuffers, bufferStride, beatPacketStride);
 				lastBeatRemainder = beatLength - todo;
+				lastBeatLength = beatLength;
 			}
 		}
 	}
 }
 
+void ChannelMixer::mixDownBuffersSampleAccurate(mp_sint32* buffer, mp_sint32* beatPacket, mp_uint32 numChannels,
+												mp_uint32 bufferStride, mp_uint32 beatPacketStride)
+{
+	const mp_uint32 numBuffers = bufferStride ? numChannels : 1;
+
+	mp_uint32 done = 0;
+
+	if (lastBeatRemainder)
+	{
+		const mp_uint32 pos = lastBeatLength - lastBeatRemainder;
+		const mp_uint32 todo = lastBeatRemainder < mixBufferSize ? lastBeatRemainder : mixBufferSize;
+
+		addBeatPacketRemainder(buffer, beatPacket + pos*MP_NUMCHANNELS, todo, numBuffers, bufferStride, beatPacketStride);
+		buffer+=todo*MP_NUMCHANNELS;
+		lastBeatRemainder-=todo;
+		done = todo;
+	}
+
+	const bool isRamping = this->isRamping();
+
+	while (done < mixBufferSize)
+	{
+		if (isRamping)
+			storeRampingState();
+
+		// beat packets are shorter than usual now and then, the time
+		// records still go by the position on the 250Hz grid
+		const mp_uint32 nb = done / beatPacketSize;
+
+		timer(nb);
+
+		const mp_uint32 beatLength = advanceTimer(beatPacketSize);
+		const bool fits = done + beatLength <= mixBufferSize;
+
+		if (!fits)
+		{
+			for (mp_uint32 b = 0; b < numBuffers; b++)
+				memset(beatPacket + b*beatPacketStride, 0, beatLength*MP_NUMCHANNELS*sizeof(mp_sint32));
+		}
+
+		if (!disableMixing)
+		{
+			recordVoices(timeRecordBase + nb);
+
+			if (fits)
+				mixBeatPacket(numChannels, buffer, nb, beatLength, bufferStride);
+			else
+				mixBeatPacket(numChannels, beatPacket, nb, beatLength, beatPacketStride);
+
+			updateActiveVoices();
+		}
+
+		if (fits)
+		{
+			buffer+=beatLength*MP_NUMCHANNELS;
+			done+=beatLength;
+		}
+		else
+		{
+			const mp_uint32 todo = mixBufferSize - done;
+			addBeatPacketRemainder(buffer, beatPacket, todo, numBuffers, bufferStride, beatPacketStride);
+			lastBeatRemainder = beatLength - todo;
+			lastBeatLength = beatLength;
+			done = mixBufferSize;
+		}
+	}
+}
+
 void ChannelMixer::mix(MixerProxy * mixerProxy)
 {
 	updateSampleCounter(mixerProxy->getBufferSize());
@@ -1352,6 +1970,8 @@ void ChannelMixer::mix(MixerProxy * mixerProxy)
 	if (!isPlaying() || paused)
 		return;
 
+	timeRecordBase = (mixerProxy->getTimeRecordSlot() % numTimeRecordSlots) * (getNumBeatPackets()+1);
+
 	//
 	// For performance reasons, we choose a dedicated code path for the way of mixer processing here
 	//
@@ -1360,6 +1980,10 @@ void ChannelMixer::mix(MixerProxy * mixerProxy)
 		// Mix down channels into *one single* stereo mix buffer
 		mixDown(mixerProxy);
 		break;
+	case MixerProxy::MixDownStems:
+		// Mix down every channel into a stereo mix buffer of its own
+		mixDownStems(mixerProxy);
+		break;
 	case MixerProxy::DirectOut:
 		// Direct out to channels for machines with multi-channel hardware
 		directOut(mixerProxy);
@@ -1455,12 +2079,29 @@ mp_sint32 ChannelMixer::setBufferSize(mp_uint32 bufferSize)
 	return MP_OK;
 }
 
+mp_sint32 ChannelMixer::setNumTimeRecordSlots(mp_uint32 numSlots)
+{
+	if (numSlots == 0)
+		numSlots = 1;
+
+	if (numTimeRecordSlots == numSlots)
+		return MP_OK;
+
+	numTimeRecordSlots = numSlots;
+	timeRecordBase = 0;
+
+	reallocChannels();
+
+	return MP_OK;
+}
+
 mp_sint32 ChannelMixer::getNumActiveChannels()
 {
 	mp_sint32 i = 0;
 
-	for (mp_uint32 j = 0; j < mixerNumActiveChannels; j++)
-		if (channel[j].flags & 256)
+	// every playing channel is in the active voice list
+	for (mp_uint32 j = 0; j < numActiveVoices; j++)
+		if (activeVoices[j] < mixerNumActiveChannels && (channel[activeVoices[j]].flags & MP_SAMPLE_PLAY))
 			i++;
 
 	return i;
@@ -1468,6 +2109,15 @@ mp_sint32 ChannelMixer::getNumActiveChannels()
 
 mp_sint32 ChannelMixer::getBeatIndexFromSamplePos(mp_uint32 smpPos) const
 {
+	mp_uint32 slot = 0;
+	if ((signed)smpPos > 0 && mixBufferSize)
+	{
+		slot = smpPos / mixBufferSize;
+		if (slot >= numTimeRecordSlots)
+			slot = numTimeRecordSlots - 1;
+		smpPos -= slot * mixBufferSize;
+	}
+
 	mp_sint32 maxLen = (mixBufferSize/beatPacketSize)-1;
 	if (maxLen < 0)
 		maxLen = 0;
@@ -1482,7 +2132,7 @@ mp_sint32 ChannelMixer::getBeatIndexFromSamplePos(mp_uint32 smpPos) const
 	if (smpPos > (unsigned)maxSize)
 		smpPos = maxSize;
 
-	return smpPos / getBeatPacketSize();
+	return slot * (getNumBeatPackets()+1) + smpPos / getBeatPacketSize();
 }
 
 
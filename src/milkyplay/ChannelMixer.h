@@ -43,6 +43,8 @@
 #include "MilkyPlayCommon.h"
 #include "AudioDriverBase.h"
 #include "Mixable.h"
+#include "PlayerSnapshot.h"
+#include "MilkyPlayThread.h"
 
 #define MP_FP_CEIL(x)			(((x)+65535)>>16)
 #define MP_FP_MUL(a, b)			((mp_sint32)(((mp_int64)(a)*(mp_int64)(b))>>16))
@@ -57,6 +59,8 @@
 	}
 
 class ChannelMixer;
+class MixerThreadPool;
+class ChannelInsertChain;
 typedef void (ChannelMixer::*TSetFreq)(mp_sint32 c, mp_sint32 f, mp_sint32 per);
 
 class MixerSettings
@@ -148,13 +152,13 @@ class ChannelMixer : public MixerSettings, public Mixable
 	// even with large buffer sizes
 	struct TTimeRecord
 	{
+		const mp_sbyte*		sample;					// pointer to sample
 		mp_uint32			flags;					// bit 8 = sample played
 													// bit 9 = sample direction (0 = forward, 1 = backward)
 													// bit 10-11 = sample ticker used to represent ramping states
 													// bit 12 = scheduled to stop
 													// bit 13 = one shot looping
 													// bit 15 = mute channel
-		const mp_sbyte*		sample;					// pointer to sample
 		mp_sint32			smppos;					// 32 bit integer part of sample position
 		mp_sint32			volPan;					// 32 bits, upper 16 bits = pan, lower 16 bits = vol
 		mp_sint32			smplen;
@@ -166,8 +170,8 @@ class ChannelMixer : public MixerSettings, public Mixable
 		mp_sint32			fixedtimefrac;			// for sinc/amiga resamplers (running time fraction)
 
 		TTimeRecord() :
-			flags(0),
 			sample(NULL),
+			flags(0),
 			smppos(0),
 			volPan(0),
 			smplen(0),
@@ -181,47 +185,69 @@ class ChannelMixer : public MixerSettings, public Mixable
 		}
 	};
 
+	enum
+	{
+		// points per scope record, the scopes interpolate them to their width
+		SCOPESIZE = 64
+	};
+
+	// what a channel plays during one beat packet, decimated to SCOPESIZE
+	// points (volume applied, panning not) and published along with the
+	// time record of the beat packet, see setScopeRecording
+	struct TScopeRecord
+	{
+		MPSequenceLock		lock;
+		bool				playing;		// false if the channel was silent
+		mp_sword			data[SCOPESIZE];
+	};
+
+	// The fields are ordered by access frequency: the first group is what
+	// the block mixers read and write for every block and fits into one
+	// 64 byte cache line (channel arrays are allocated cache line aligned),
+	// the second one is touched once per beat packet or by the filtering
+	// and Amiga resamplers only, the rest is rarely used.
 	struct TMixerChannel
 	{
+		const mp_sbyte*		sample;					// pointer to sample
 		mp_uint32			flags;					// bit 8 = sample played
 													// bit 9 = sample direction (0 = forward, 1 = backward)
 													// bit 10-11 = sample ticker used to represent ramping states
 													// bit 12 = scheduled to stop
 													// bit 13 = one shot looping
 													// bit 15 = mute channel
-		const mp_sbyte*		sample;					// pointer to sample
-		mp_sint32			smplen;
 		mp_sint32			smppos;					// 32 bit integer part of sample position
 		mp_sint32			smpposfrac;				// 16 bit fractional part of sample position
 		mp_sint32			smpadd;					// 16:16 fixed point increment
 		mp_sint32			rsmpadd;				// fixed point reciprocal of the increment
-		mp_sint32			period;					// raw period which can be used for DMA playback on Amiga hardware
-		mp_sint32			loopend;				// loop end
-		mp_sint32			loopendcopy;			// Temporary placeholder for one-shot looping
+		mp_sint32			smplen;
 		mp_sint32			loopstart;				// loop start
+		mp_sint32			loopend;				// loop end
 
-		mp_sint32			finalvolr;
 		mp_sint32			finalvoll;
+		mp_sint32			finalvolr;
 
-		mp_sint32			vol;
-		mp_sint32			pan;
-
-		mp_sint32			rampFromVolStepR;
 		mp_sint32			rampFromVolStepL;
+		mp_sint32			rampFromVolStepR;
+
+		mp_sint32			fixedtime;				// for amiga resampler (running time)
+		mp_sint32			fixedtimefrac;			// for sinc/amiga resamplers (running time fraction)
 
 		mp_sint32			a,b,c;					// Filter coefficients
 		mp_sint32			currsample;				// sample history for filtering
 		mp_sint32			prevsample;				// see above
+		mp_sint32			index;					// For Amiga resampler
+
+		mp_sint32			vol;
+		mp_sint32			pan;
+
+		mp_sint32			period;					// raw period which can be used for DMA playback on Amiga hardware
+		mp_sint32			loopendcopy;			// Temporary placeholder for one-shot looping
 
 		mp_sint32			cutoff;
 		mp_sint32			resonance;
 
-		mp_sint32			fixedtime;				// for amiga resampler (running time)
-		mp_sint32			fixedtimefrac;			// for sinc/amiga resamplers (running time fraction)
-
 		mp_uint32			timeRecordSize;
 		TTimeRecord*		timeRecord;
-		mp_sint32			index;					// For Amiga resampler
 
 		TMixerChannel() :
 			timeRecordSize(0),
@@ -285,22 +311,29 @@ class ChannelMixer : public MixerSettings, public Mixable
 			timeRecordSize = size;
 			timeRecord = new TTimeRecord[size];
 		}
+
+		// cache line aligned array allocation, see above
+		static TMixerChannel* allocArray(mp_uint32 num);
+		static void freeArray(TMixerChannel* channels, mp_uint32 num);
 	};
 
 	class ResamplerBase
 	{
 	private:
 		// add channels without volume ramping
-		void addChannelsNormal(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength);
+		void addChannelsNormal(ChannelMixer* mixer, mp_uint32 firstVoice, mp_uint32 voiceStride, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength, mp_uint32 channelStride);
 		// add channels with volume ramping
-		void addChannelsRamping(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength);
+		void addChannelsRamping(ChannelMixer* mixer, mp_uint32 firstVoice, mp_uint32 voiceStride, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength, mp_uint32 channelStride);
 
 	public:
 		virtual ~ResamplerBase()
 		{
 		}
 
-		void addChannels(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength);
+		// channel c is added to buffer32 + c*channelStride, a stride of 0 mixes all channels into one buffer
+		void addChannels(ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength, mp_uint32 channelStride = 0);
+		// add every voiceStride-th active voice starting at firstVoice (used by the mixer thread pool)
+		void addChannelsPartial(ChannelMixer* mixer, mp_uint32 firstVoice, mp_uint32 voiceStride, mp_uint32 numChannels, mp_sint32* buffer32,mp_sint32 beatNum, mp_sint32 beatlength, mp_uint32 channelStride = 0);
 		void addChannel(TMixerChannel* chn, mp_sint32* buffer32, const mp_sint32 beatlength, const mp_sint32 beatSize);
 		void directOutChannel(ChannelMixer* mixer, mp_uint32 c, mp_sword* buffer, mp_sint32 beatNum, mp_sint32 beatlength);
 
@@ -347,6 +380,9 @@ class ChannelMixer : public MixerSettings, public Mixable
 
 		// in case the resampler needs to get hold of the current number of channels
 		virtual void setNumChannels(mp_sint32 num) { }
+
+		// false if the resampler keeps state of its own which ResamplerDryRun can't follow
+		virtual bool supportsDryRun() { return true; }
 	};
 
 	friend class ChannelMixer::ResamplerBase;
@@ -361,15 +397,28 @@ class ChannelMixer : public MixerSettings, public Mixable
 
 	mp_sint32* 	mixbuffBeatPacket;
 	mp_sword** 	mixbuffBeatPackets;
+	mp_sint32*	stemBeatPackets;			// one beat packet per channel for mixDownStems
+	mp_uint32	stemBeatPacketsSize;
 	mp_uint32	mixBufferSize;				// this is the resulting buffer size in 16 bit words
 
 	mp_uint32	beatPacketSize;				// size of 1/250 of a second in samples
 	mp_uint32	numBeatPackets;				// how many of these fit in our buffer size
 	mp_uint32 	lastBeatRemainder;			// used while filling the buffer, if the buffer is not an exact multiple of beatPacketSize
+	mp_uint32	lastBeatLength;				// length of the beat packet lastBeatRemainder refers to
+
+	mp_uint32	numTimeRecordSlots;			// buffers the time records are kept for, see setNumTimeRecordSlots
+	mp_uint32	timeRecordBase;				// first time record of the buffer being mixed
 
 	TMixerChannel*	channel;
 	TMixerChannel*  newChannel;
 
+	// channels which are playing or have stopped only recently, in order of
+	// activation. Only these are visited per beat packet, a channel is dropped
+	// once it has been silent long enough to have idle time records throughout
+	mp_uint32*		activeVoices;
+	mp_sint32*		activeVoiceIdleBeats;	// per channel, -1 if not in activeVoices
+	mp_uint32		numActiveVoices;
+
 	mp_sint32		masterVolume;			// mixer master volume
 	mp_sint32		panningSeparation;		// panning separation from 0 (mono) to 256 (full stereo)
 
@@ -377,28 +426,99 @@ class ChannelMixer : public MixerSettings, public Mixable
 	TSetFreq		setFreqFuncTable[NUMRESAMPLERTYPES];			// If different precisions are used, use other frequency calculation procedures
 	ResamplerBase*  resamplerTable[NUMRESAMPLERTYPES];
 
+	MixerThreadPool* threadPool;			// NULL if mixing is done serially
+	ChannelInsertChain** insertChains;		// per channel, NULL if there are none, see setInsertChain
+	mp_uint32		numInsertChains;
+	TScopeRecord*	scopeRecords;			// per channel and time record, NULL unless recording scopes
+	bool			scopeRecording;
+	ResamplerBase*	dryRunResampler;		// NULL unless dry running, see setDryRun
+
 	bool			paused;
 	bool			disableMixing;
 	bool			allowFilters;
+	bool			sampleAccurateTicks;
+
+	// IT filter coefficients: the inverse angle for each possible cutoff is
+	// computed on first use and forgotten when the mixing frequency changes
+	// (the table itself is allocated by setFrequency), the loss for each
+	// resonance never changes and is built with the panning table
+	enum
+	{
+		FILTER_NUMCUTOFFS = (127 << 8) + 1,
+		FILTER_NUMRESONANCES = 128
+	};
+
+	float*			filterInvAngleLUT;
+	static float	filterLossLUT[FILTER_NUMRESONANCES];
+
+	static float	calcFilterInvAngle(mp_uint32 mixFrequency, mp_sint32 cutoff);
+	static float	calcFilterLoss(mp_sint32 resonance);
+
+	static bool		staticTablesBuilt;
+	static bool		buildStaticTables();
 
 	void			setFrequency(mp_sint32 frequency);
 
 	void			mixBeatPacket(mp_uint32 numChannels,
 								  mp_sint32* buffer32,
 								  mp_sint32 beatPacketIndex,
-								  mp_sint32 beatPacketSize)
+								  mp_sint32 beatPacketSize,
+								  mp_uint32 channelStride)
 	{
-		resamplerTable[resamplerType]->addChannels(this, numChannels, buffer32, beatPacketIndex, beatPacketSize);
+		ResamplerBase* resampler = dryRunResampler ? dryRunResampler : resamplerTable[resamplerType];
+		resampler->addChannels(this, numChannels, buffer32, beatPacketIndex, beatPacketSize, channelStride);
 	}
 
+	// where the resampler puts channel c: its own stem buffer, the buffer of
+	// its insert chain or the mix
+	mp_sint32*		getChannelBuffer(mp_uint32 c, mp_sint32* buffer32, mp_uint32 channelStride) const
+	{
+		if (channelStride)
+			return buffer32 + c*channelStride;
+		if (numInsertChains && insertChains[c] && !dryRunResampler)
+			return insertChainBuffer(c);
+		return buffer32;
+	}
+
+	mp_sint32*		insertChainBuffer(mp_uint32 c) const;
+
+	// store the time records (and scope records) of the active voices
+	// before beat packet timeRecordIndex is mixed
+	void			recordVoices(mp_uint32 timeRecordIndex);
+	void			storeScopeData(TScopeRecord& record, const TMixerChannel* chn) const;
+
+	// run the insert chains of the voices a resampler call just mixed
+	void			processInsertChains(mp_uint32 firstVoice, mp_uint32 voiceStride, mp_uint32 numChannels,
+										mp_sint32* buffer32, mp_sint32 beatlength, mp_uint32 channelStride);
+
+	// mix numChannels channels into buffer or, if bufferStride is not 0,
+	// channel c into buffer + c*bufferStride
+	void			mixDownBuffers(mp_sint32* buffer, mp_sint32* beatPacket, mp_uint32 numChannels,
+								   mp_uint32 bufferStride, mp_uint32 beatPacketStride);
+	// same with beat packets ending where the ticks fall, see setSampleAccurateTicks
+	void			mixDownBuffersSampleAccurate(mp_sint32* buffer, mp_sint32* beatPacket, mp_uint32 numChannels,
+												 mp_uint32 bufferStride, mp_uint32 beatPacketStride);
+
+	// volume ramping needs the sample rate (and filter state) of the last beat packet
+	void			storeRampingState();
+
 	inline void		timer(mp_uint32 beatIndex)
 	{
-		timerHandler(beatIndex <= getNumBeatPackets() ? beatIndex : getNumBeatPackets());
+		timerHandler(timeRecordBase + (beatIndex <= getNumBeatPackets() ? beatIndex : getNumBeatPackets()));
 	}
 
 	void			reallocChannels();
 	void			clearChannels();
 
+	inline void		activateVoice(mp_uint32 c)
+	{
+		if (activeVoiceIdleBeats[c] < 0)
+			activeVoices[numActiveVoices++] = c;
+		activeVoiceIdleBeats[c] = 0;
+	}
+
+	void			updateActiveVoices();
+
 public:
 					ChannelMixer(mp_uint32 numChannels,
 								 mp_uint32 frequency);
@@ -408,6 +528,7 @@ class ChannelMixer : public MixerSettings, public Mixable
 	mp_uint32		getMixBufferSize() const { return mixBufferSize; }
 
 	void			mixDown(MixerProxy * mixerProxy);
+	void			mixDownStems(MixerProxy * mixerProxy);
 	void			directOut(MixerProxy * mixerProxy);
 	void			hardwareOutChannel(MixerProxy * mixerProxy, mp_uint32 c);
 	void			hardwareOut(MixerProxy * mixerProxy);
@@ -425,14 +546,47 @@ class ChannelMixer : public MixerSettings, public Mixable
 	mp_sint32		resume();
 
 	void			setDisableMixing(bool disableMixing) { this->disableMixing = disableMixing; }
+
+	// Usually the timer runs 250 times a second and a tick can only start
+	// at the beginning of a beat packet, so ticks are late by up to 4ms.
+	// With sample accurate ticks a beat packet is cut short where the next
+	// tick falls and the next one starts with the tick. Only used when
+	// mixing down, direct and hardware out keep the 250Hz timer.
+	void			setSampleAccurateTicks(bool sampleAccurateTicks) { this->sampleAccurateTicks = sampleAccurateTicks; }
+	bool			getSampleAccurateTicks() const { return sampleAccurateTicks; }
 	void			setAllowFilters(bool allowFilters) { this->allowFilters = allowFilters; }
 	bool			getAllowFilters() const { return allowFilters; }
 
+	// Unlike disableMixing a dry run still moves the channels along their
+	// samples exactly like mixing would, only nothing is added to the mix
+	// buffer. The player state after any number of dry run buffers is
+	// identical to really mixing them, so rendering can pick up from there.
+	// Beat packets reaching into the next buffer are only complete when
+	// the dry run ends at least one beat packet before the output is used.
+	// Not possible with the Amiga resamplers. The filter state of channels
+	// using filters can't be followed either, the caller has to care.
+	bool			supportsDryRun() const;
+	void			setDryRun(bool dryRun);
+	bool			isDryRun() const { return dryRunResampler != NULL; }
+
 	void			resetChannelsFull();
 	void			resetChannelsWithoutMuting();
 
 	void			setResamplerType(ResamplerTypes type);
 	ResamplerTypes	getResamplerType() const { return resamplerType; }
+
+	// mix the channels with num threads (including the calling thread), 0 or 1 mixes serially
+	// must not be called while the mixer is running
+	void			setNumMixerThreads(mp_uint32 num);
+	mp_uint32		getNumMixerThreads() const;
+
+	// Insert chain for channel c, NULL removes it. The channel is processed
+	// by the chain on its own before it is added to the mix (also when
+	// rendering stems, not with direct or hardware out). Runs on the mixer
+	// threads if there are several. The mixer doesn't own the chain,
+	// must not be called while the mixer is running
+	void			setInsertChain(mp_uint32 c, ChannelInsertChain* chain);
+	ChannelInsertChain* getInsertChain(mp_uint32 c) const;
 	bool			isRamping()  const { return resamplerTable[resamplerType]->isRamping(); }
 
 	virtual mp_sint32 adjustFrequency(mp_uint32 frequency);
@@ -444,6 +598,30 @@ class ChannelMixer : public MixerSettings, public Mixable
 	mp_uint32		getBeatPacketSize() const { return beatPacketSize; }
 	mp_uint32		getNumBeatPackets() const { return mixBufferSize / beatPacketSize; }
 
+	// Time records (the state at every beat packet, for scopes and the
+	// position display) are kept for this many buffers. A mixer which
+	// renders ahead of playback needs one slot per buffer in flight, the
+	// slot being mixed comes with the MixerProxy.
+	virtual mp_sint32 setNumTimeRecordSlots(mp_uint32 numSlots);
+	mp_uint32		getNumTimeRecordSlots() const { return numTimeRecordSlots; }
+	mp_uint32		getNumTimeRecords() const { return (getNumBeatPackets()+1) * numTimeRecordSlots; }
+	// Publish a scope record of every channel with each time record. The
+	// scopes copy it with getScopeData() instead of resampling the time
+	// records themselves, which raced with the mixer. Recording costs
+	// mixing time, turn it on only while scopes are shown. Must not be
+	// called while the mixer is running.
+	void			setScopeRecording(bool scopeRecording);
+	bool			isScopeRecording() const { return scopeRecording; }
+	// points per scope record, 0 unless recording scopes
+	mp_uint32		getScopeSize() const { return scopeRecords ? SCOPESIZE : 0; }
+	// getScopeSize() points of channel c at the time record index (see
+	// getBeatIndexFromSamplePos) and whether a sample was playing, false
+	// if there are none or the mixer was writing them while they were
+	// copied
+	bool			getScopeData(mp_uint32 c, mp_uint32 timeRecordIndex, mp_sword* data, bool& playing) const;
+	// no beat packet is partially mixed, snapshots can be taken
+	bool			isBetweenBeatPackets() const { return lastBeatRemainder == 0; }
+
 	// volume control
 	void			setMasterVolume(mp_sint32 vol) { masterVolume = vol; }
 	mp_sint32		getMasterVolume() const { return masterVolume; }
@@ -455,10 +633,13 @@ class ChannelMixer : public MixerSettings, public Mixable
 	bool			isPlaying() const { return startPlay; }
 
 	mp_sint32		getNumActiveChannels();
+	// number of channels the mixer currently visits, see activeVoices
+	mp_uint32		getNumActiveVoices() const { return numActiveVoices; }
 	mp_sint32		getNumAllocatedChannels() const { return mixerNumActiveChannels; }
 
 	mp_int64		getSampleCounter() const { return sampleCounter; }
 
+	// positions beyond the buffer size refer to the following time record slots
 	mp_sint32		getBeatIndexFromSamplePos(mp_uint32 smpPos) const;
 
 	ResamplerBase*  getCurrentResampler() const { return resamplerTable[resamplerType]; }
@@ -475,6 +656,11 @@ class ChannelMixer : public MixerSettings, public Mixable
 
 	void			setActiveChannels(mp_uint32 num);
 
+	// mixer part of the player snapshots (see PlayerBase::saveState),
+	// only possible between two beat packets
+	bool			saveChannelState(PlayerSnapshot& snapshot, const XModule* module) const;
+	bool			restoreChannelState(PlayerSnapshot::Reader& reader);
+
 public:
 	void			setVol(mp_sint32 c,mp_sint32 v) { channel[c].vol = v; }
 	mp_sint32		getVol(mp_sint32 c) { return channel[c].vol; }
@@ -545,6 +731,9 @@ class ChannelMixer : public MixerSettings, public Mixable
 protected:
 	// timer procedure for mixing
 	virtual void	timerHandler(mp_sint32 currentBeatPacket) = 0;
+	// sample accurate ticks: length of the beat packet following the timer call,
+	// at most maxLength, the timer is moved forward by that many samples
+	virtual mp_uint32 advanceTimer(mp_uint32 maxLength) { return maxLength; }
 	void		   	panToVol(ChannelMixer::TMixerChannel *chn, mp_sint32 &left, mp_sint32 &right);
 	static mp_sint32 panLUT[257];
 
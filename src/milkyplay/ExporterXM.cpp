@@ -1357,6 +1357,8 @@ mp_sint32 XModule::saveExtendedModule(const SYSCHAR* fileName, bool isMagic, con
 
 	// ------ prerequisites ---------------------------------
 
+	decodeLazySamples();
+
 	// step one, find last used pattern
 	mp_sint32 patNum = getNumUsedPatterns();
 	if (!patNum)
@@ -1912,6 +1914,8 @@ mp_sint32 XModule::saveProtrackerModule(const SYSCHAR* fileName, bool isMagic)
 
 	TWorkBuffers workBuffers;
 
+	decodeLazySamples();
+
 	XMFile f(fileName, true);
 
 	if (!f.isOpenForWriting())
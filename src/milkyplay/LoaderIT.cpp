@@ -618,6 +618,7 @@ mp_sint32 LoaderIT::load(XMFileBase& f, XModule* module)
 		
 		XModule::convertc4spd(itSmp.C5Speed, &smp[i].finetune, &smp[i].relnote);
 
+		// the samples are decoded after the patterns, all at once
 		f.seekWithBaseOffset(itSmp.SmpPoint);
 
 		if ((itSmp.Flg & 1))
@@ -633,12 +634,12 @@ mp_sint32 LoaderIT::load(XMFileBase& f, XModule* module)
 
 				if (itSmp.Flg & 8)
 				{
-					if (!module->loadSample(f, smp[i].sample, smp[i].samplen, smp[i].samplen, (itSmp.Cvt & 4) ? XModule::ST_PACKING_IT215 : XModule::ST_PACKING_IT))
+					if (!module->loadSampleDeferred(f, smp[i].sample, smp[i].samplen, smp[i].samplen, (itSmp.Cvt & 4) ? XModule::ST_PACKING_IT215 : XModule::ST_PACKING_IT))
 					{
 						return MP_OUT_OF_MEMORY;
 					}
 				}
-				else if (!module->loadSample(f,smp[i].sample,smp[i].samplen,smp[i].samplen, (itSmp.Cvt & 1) ? XModule::ST_DEFAULT : XModule::ST_UNSIGNED))
+				else if (!module->loadSampleDeferred(f,smp[i].sample,smp[i].samplen,smp[i].samplen, (itSmp.Cvt & 1) ? XModule::ST_DEFAULT : XModule::ST_UNSIGNED))
 				{
 					return MP_OUT_OF_MEMORY;
 				}					
@@ -654,12 +655,12 @@ mp_sint32 LoaderIT::load(XMFileBase& f, XModule* module)
 
 				if (itSmp.Flg & 8)
 				{
-					if (!module->loadSample(f, smp[i].sample, smp[i].samplen, smp[i].samplen, (itSmp.Cvt & 4) ? (XModule::ST_PACKING_IT215 | XModule::ST_16BIT) : (XModule::ST_PACKING_IT | XModule::ST_16BIT)))
+					if (!module->loadSampleDeferred(f, smp[i].sample, smp[i].samplen, smp[i].samplen, (itSmp.Cvt & 4) ? (XModule::ST_PACKING_IT215 | XModule::ST_16BIT) : (XModule::ST_PACKING_IT | XModule::ST_16BIT)))
 					{
 						return MP_OUT_OF_MEMORY;
 					}
 				}
-				else if (!module->loadSample(f,smp[i].sample,smp[i].samplen<<1,smp[i].samplen, XModule::ST_16BIT | ((itSmp.Cvt & 1) ? XModule::ST_DEFAULT : XModule::ST_UNSIGNED)))
+				else if (!module->loadSampleDeferred(f,smp[i].sample,smp[i].samplen<<1,smp[i].samplen, XModule::ST_16BIT | ((itSmp.Cvt & 1) ? XModule::ST_DEFAULT : XModule::ST_UNSIGNED)))
 				{
 					return MP_OUT_OF_MEMORY;
 				}					
@@ -700,9 +701,17 @@ mp_sint32 LoaderIT::load(XMFileBase& f, XModule* module)
 			
 			f.readDword();
 			
-			mp_ubyte* buffer = new mp_ubyte[length];
+			// files in memory are scanned in place, a slot reaches
+			// at most 6 bytes beyond the end of the pattern
+			const mp_ubyte* buffer = f.readInPlace(length, length + 6);
+			mp_ubyte* bufferCopy = NULL;
 			
-			f.read(buffer, 1, length);
+			if (buffer == NULL)
+			{
+				bufferCopy = new mp_ubyte[length];
+				f.read(bufferCopy, 1, length);
+				buffer = bufferCopy;
+			}
 			
 			j = 0;
 			mp_ubyte maskVariable = 0;
@@ -740,7 +749,7 @@ mp_sint32 LoaderIT::load(XMFileBase& f, XModule* module)
 				}
 			}
 			
-			delete[] buffer;
+			delete[] bufferCopy;
 		}
 	}
 	
@@ -775,9 +784,15 @@ mp_sint32 LoaderIT::load(XMFileBase& f, XModule* module)
 			
 			memset(phead[i].patternData, 0, phead[i].rows*header->channum*6);
 
-			mp_ubyte* buffer = new mp_ubyte[length];
+			const mp_ubyte* buffer = f.readInPlace(length, length + 6);
+			mp_ubyte* bufferCopy = NULL;
 
-			f.read(buffer, 1, length);
+			if (buffer == NULL)
+			{
+				bufferCopy = new mp_ubyte[length];
+				f.read(bufferCopy, 1, length);
+				buffer = bufferCopy;
+			}
 
 			j = 0;
 			mp_ubyte maskVariable = 0;
@@ -1159,7 +1174,7 @@ mp_sint32 LoaderIT::load(XMFileBase& f, XModule* module)
 					row++;
 			}
 
-			delete[] buffer;
+			delete[] bufferCopy;
 		}
 		else
 		{
@@ -1195,6 +1210,9 @@ mp_sint32 LoaderIT::load(XMFileBase& f, XModule* module)
 	for (i = 0; i < header->channum; i++)
 		header->pan[i] = (chnPan[i] <= 64) ? XModule::vol64to255(chnPan[i]) : 0x80;
 	
+	if (!module->decodeDeferredSamples())
+		return MP_OUT_OF_MEMORY;
+	
 	module->postProcessSamples();
 	
 	return MP_OK;	
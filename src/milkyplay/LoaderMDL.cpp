@@ -443,7 +443,7 @@ mp_sint32 LoaderMDL::load(XMFileBase& f, XModule* module)
 							return MP_OUT_OF_MEMORY;
 						}
 						
-						if (!module->loadSample(f,mdlsamp[s].smp,size,mdlsamp[s].samplen,XModule::ST_PACKING_MDL))
+						if (!module->loadSampleDeferred(f,mdlsamp[s].smp,size,mdlsamp[s].samplen,XModule::ST_PACKING_MDL,size))
 						{
 							if (mdlins) delete[] mdlins;
 							if (mdlsamp) delete[] mdlsamp;
@@ -474,7 +474,7 @@ mp_sint32 LoaderMDL::load(XMFileBase& f, XModule* module)
 						//mp_uint32 loopstart = mdlsamp[s].loopstart>>1;
 						//mp_uint32 looplen = mdlsamp[s].looplen>>1;
 						
-						if (!module->loadSample(f,mdlsamp[s].smp,size,samplen,XModule::ST_PACKING_MDL | XModule::ST_16BIT))
+						if (!module->loadSampleDeferred(f,mdlsamp[s].smp,size,samplen,XModule::ST_PACKING_MDL | XModule::ST_16BIT,size))
 						{
 							if (mdlins) delete[] mdlins;
 							if (mdlsamp) delete[] mdlsamp;
@@ -1171,6 +1171,9 @@ mp_sint32 LoaderMDL::load(XMFileBase& f, XModule* module)
 	delete[] mdlins;
 	delete[] mdlsamp;
 
+	if (!module->decodeDeferredSamples())
+		return MP_OUT_OF_MEMORY;
+
 	module->postProcessSamples();
 
 	return MP_OK;
@@ -352,15 +352,23 @@ mp_sint32 LoaderXM::load(XMFileBase& f, XModule* module)
 		memset(phead[y].patternData,0,phead[y].rows*header->channum*6);
 
 		if (phead[y].patdata) {
-			mp_ubyte *buffer = new mp_ubyte[phead[y].patdata];
+			// files in memory are decoded in place, broken pattern
+			// data can make the decoder read up to 6 bytes per slot
+			const mp_ubyte *buffer = f.readInPlace(phead[y].patdata, phead[y].rows*header->channum*6);
+			mp_ubyte *bufferCopy = NULL;
 
-			// out of memory?
-			if (buffer == NULL)
-			{
-				return MP_OUT_OF_MEMORY;
-			}
+			if (buffer == NULL) {
+				bufferCopy = new mp_ubyte[phead[y].patdata];
 
-			f.read(buffer,1,phead[y].patdata);
+				// out of memory?
+				if (bufferCopy == NULL)
+				{
+					return MP_OUT_OF_MEMORY;
+				}
+
+				f.read(bufferCopy,1,phead[y].patdata);
+				buffer = bufferCopy;
+			}
 
 			//printf("%i\n", phead[y].patdata);
 
@@ -462,7 +470,7 @@ mp_sint32 LoaderXM::load(XMFileBase& f, XModule* module)
 
 			} // for r
 
-			delete[] buffer;
+			delete[] bufferCopy;
 		}
 
 	}
@@ -737,11 +745,12 @@ mp_sint32 LoaderXM::load(XMFileBase& f, XModule* module)
 							delete[] data;
 							delete tmm;
 						} else {
+							// ADPCM and stereo samples are needed right away
 							mp_sint32 result = module->loadModuleSample(
 								f, s,
 								adpcm ? XModule::ST_PACKING_ADPCM : XModule::ST_DELTA,
 								adpcm ? (XModule::ST_PACKING_ADPCM | XModule::ST_16BIT) : (XModule::ST_DELTA | XModule::ST_16BIT),
-								oldSize);
+								oldSize, !adpcm && !(smp[s].type & 32));
 
 							if (result != MP_OK)
 								return result;
@@ -793,7 +802,7 @@ mp_sint32 LoaderXM::load(XMFileBase& f, XModule* module)
 						smp[s].looplen>>=1;
 					}
 
-					mp_sint32 result = module->loadModuleSample(f, s, XModule::ST_DELTA, XModule::ST_DELTA | XModule::ST_16BIT, oldSize);
+					mp_sint32 result = module->loadModuleSample(f, s, XModule::ST_DELTA, XModule::ST_DELTA | XModule::ST_16BIT, oldSize, !(smp[s].type & 32));
 					if (result != MP_OK)
 						return result;
 				}
@@ -910,6 +919,9 @@ mp_sint32 LoaderXM::load(XMFileBase& f, XModule* module)
 		}
 	}
 
+	if (!module->decodeDeferredSamples())
+		return MP_OUT_OF_MEMORY;
+
 	module->postProcessSamples();
 
 	return MP_OK;
@@ -39,12 +39,133 @@
 #include "MilkyPlayCommon.h"
 #include "AudioDriverBase.h"
 #include "AudioDriverManager.h"
+#include "MilkyPlayThread.h"
 
 enum
 {
 	BlockTimeOut = 5000
 };
 
+// Ring of mixed blocks between the render thread and the audio driver
+// callback. The slot being played is never written, so there is one slot
+// more than blocks rendered ahead. Slot numbers double as time record
+// slots of the players.
+class MasterMixer::RenderAhead : public MPThread
+{
+private:
+	MasterMixer& mixer;
+	const mp_uint32 numBlocks;
+	const mp_uint32 numSlots;
+	const mp_uint32 blockSamples;
+	const mp_uint32 blockBytes;
+	mp_ubyte* blocks;
+	mp_sint32* mixCopies;
+
+	MPAtomicIndex readIndex;
+	MPAtomicIndex writeIndex;
+
+	// only stop() signals the condition. The audio driver callback doesn't
+	// touch the mutex, the render thread polls for free slots instead
+	MPMutex mutex;
+	MPCondition quitRequested;
+	bool quit;
+	const mp_uint32 pollMillis;
+
+protected:
+	virtual void run()
+	{
+		for (;;)
+		{
+			mutex.lock();
+			while (!quit && isFull())
+				quitRequested.wait(mutex, pollMillis);
+			const bool done = quit;
+			mutex.unlock();
+
+			if (done)
+				break;
+
+			render();
+		}
+	}
+
+public:
+	const bool floatFormat;
+	volatile mp_sint32 playingSlot;
+	volatile mp_uint32 numUnderruns;
+
+	RenderAhead(MasterMixer& mixer, mp_uint32 numBlocks, mp_uint32 bufferSize, bool floatFormat) :
+		mixer(mixer),
+		numBlocks(numBlocks),
+		numSlots(numBlocks+1),
+		blockSamples(bufferSize*MP_NUMCHANNELS),
+		blockBytes(blockSamples * (floatFormat ? sizeof(float) : sizeof(mp_sword))),
+		blocks(new mp_ubyte[numSlots*blockBytes]),
+		mixCopies(new mp_sint32[numSlots*blockSamples]),
+		quit(false),
+		// a slot freed by the driver is refilled within a quarter block
+		pollMillis(bufferSize*250/mixer.getSampleRate() ? bufferSize*250/mixer.getSampleRate() : 1),
+		floatFormat(floatFormat),
+		playingSlot(-1),
+		numUnderruns(0)
+	{
+		memset(mixCopies, 0, numSlots*blockSamples*sizeof(mp_sint32));
+	}
+
+	virtual ~RenderAhead()
+	{
+		stop();
+		join();
+
+		delete[] blocks;
+		delete[] mixCopies;
+	}
+
+	mp_uint32 getNumSlots() const { return numSlots; }
+
+	const mp_sint32* getMixCopies() const { return mixCopies; }
+
+	bool isFull() const
+	{
+		return writeIndex.get() - readIndex.get() >= numBlocks;
+	}
+
+	// render thread (or the caller of start() for the prefill)
+	void render()
+	{
+		const mp_uint32 index = writeIndex.get();
+		const mp_uint32 slot = index % numSlots;
+		mixer.renderBlock(blocks + slot*blockBytes, mixCopies + slot*blockSamples, slot, floatFormat);
+		writeIndex.set(index + 1);
+	}
+
+	// audio driver callback, outputs silence when the render thread fell behind
+	void read(void* buffer)
+	{
+		const mp_uint32 index = readIndex.get();
+		if (index != writeIndex.get())
+		{
+			const mp_uint32 slot = index % numSlots;
+			memcpy(buffer, blocks + slot*blockBytes, blockBytes);
+			playingSlot = slot;
+			readIndex.set(index + 1);
+		}
+		else
+		{
+			memset(buffer, 0, blockBytes);
+			numUnderruns++;
+		}
+	}
+
+	void stop()
+	{
+		mutex.lock();
+		quit = true;
+		quitRequested.broadcast();
+		mutex.unlock();
+	}
+};
+
 MasterMixer::MasterMixer(mp_uint32 sampleRate,
 						 mp_uint32 bufferSize/* = 0*/,
 						 mp_uint32 numDevices/* = 1*/,
@@ -63,7 +184,12 @@ MasterMixer::MasterMixer(mp_uint32 sampleRate,
 	initialized(false),
 	started(false),
 	paused(false),
-	mixDownProxy(0)
+	mixDownProxy(0),
+	mixDownFloatProxy(0),
+	renderAheadBlocks(0),
+	renderAhead(0),
+	peaks(0),
+	numPeaks(0)
 {
 }
 
@@ -73,6 +199,7 @@ MasterMixer::~MasterMixer()
 
 	delete audioDriverManager;
 	delete[] devices;
+	delete[] peaks;
 }
 
 void MasterMixer::setMasterMixerNotificationListener(MasterMixerNotificationListener* listener)
@@ -163,9 +290,21 @@ mp_sint32 MasterMixer::start()
 			return res;
 	}
 
+	if (numPeaks != getNumTimeRecordSlots())
+	{
+		delete[] peaks;
+		numPeaks = getNumTimeRecordSlots();
+		peaks = new MPAtomicIndex[numPeaks];
+	}
+
+	startRenderAhead();
+
 	res = audioDriver->start();
 	if (res != 0)
+	{
+		stopRenderAhead();
 		return res;
+	}
 
 	started = true;
 	return 0;
@@ -178,7 +317,10 @@ mp_sint32 MasterMixer::stop()
 
 	mp_sint32 res = audioDriver->stop();
 	if (res == 0)
+	{
 		started = false;
+		stopRenderAhead();
+	}
 
 	return res;
 }
@@ -211,6 +353,24 @@ mp_sint32 MasterMixer::setBufferSize(mp_uint32 bufferSize)
 	return 0;
 }
 
+mp_sint32 MasterMixer::setRenderAhead(mp_uint32 numBlocks)
+{
+	if (numBlocks != renderAheadBlocks)
+	{
+		mp_sint32 res = closeAudioDevice();
+		if (res != 0)
+			return res;
+
+		renderAheadBlocks = numBlocks;
+	}
+	return 0;
+}
+
+mp_uint32 MasterMixer::getNumRenderAheadUnderruns() const
+{
+	return renderAhead ? renderAhead->numUnderruns : 0;
+}
+
 mp_sint32 MasterMixer::setSampleRate(mp_uint32 sampleRate)
 {
 	if (sampleRate != this->sampleRate)
@@ -259,29 +419,7 @@ bool MasterMixer::removeDevice(Mixable* device, bool blocking/* = true*/)
 			devices[i].markedForRemoval = true;
 
 			if (blocking)
-			{
-				// this is going to loop infinitely when the audio device is not running
-				double waitMillis = ((double)(bufferSize/2) / (double)sampleRate) * 1000.0 * 2.0;
-				if (waitMillis < 1.0)
-					waitMillis = 1.0;
-				if (waitMillis > (double)BlockTimeOut)
-					waitMillis = (double)BlockTimeOut;
-
-				mp_uint32 time = 0;
-				const mp_uint32 sleepTime = 10;
-				while (devices[i].mixable && time < (mp_uint32)waitMillis)
-				{
-					audioDriver->msleep(sleepTime);
-					time+=sleepTime;
-				}
-
-				// timeout
-				if (time >= waitMillis && devices[i].mixable)
-				{
-					devices[i].mixable = 0;
-					devices[i].markedForRemoval = false;
-				}
-			}
+				waitForAcknowledge(devices[i]);
 
 			return true;
 		}
@@ -319,29 +457,7 @@ bool MasterMixer::pauseDevice(Mixable* device, bool blocking/* = true*/)
 			devices[i].markedForPause = true;
 
 			if (blocking)
-			{
-				// this is going to loop infinitely when the audio device is not running
-				double waitMillis = ((double)(bufferSize/2) / (double)sampleRate) * 1000.0 * 2.0;
-				if (waitMillis < 1.0)
-					waitMillis = 1.0;
-				if (waitMillis > (double)BlockTimeOut)
-					waitMillis = (double)BlockTimeOut;
-
-				mp_uint32 time = 0;
-				const mp_uint32 sleepTime = 10;
-				while (!devices[i].paused && time < (mp_uint32)waitMillis)
-				{
-					audioDriver->msleep(sleepTime);
-					time+=sleepTime;
-				}
-
-				// timeout
-				if (time >= waitMillis && !devices[i].paused)
-				{
-					devices[i].paused = true;
-					devices[i].markedForPause = false;
-				}
-			}
+				waitForAcknowledge(devices[i]);
 
 			return true;
 		}
@@ -377,37 +493,135 @@ bool MasterMixer::isDevicePaused(Mixable* device)
 	return false;
 }
 
+bool MasterMixer::waitForDevice(Mixable* device)
+{
+	for (mp_uint32 i = 0; i < numDevices; i++)
+	{
+		if (devices[i].mixable == device)
+		{
+			if (devices[i].isPending())
+				waitForAcknowledge(devices[i]);
+			return true;
+		}
+	}
+
+	// already removed
+	return false;
+}
+
+void MasterMixer::waitForAcknowledge(DeviceDescriptor& device)
+{
+	// the time out only matters when the audio device is not running, allow
+	// for two buffers since the request may just miss a mix which started,
+	// when rendering ahead the mixer is up to the render ahead blocks behind
+	double waitMillis = ((double)bufferSize / (double)sampleRate) * 1000.0 * 2.0 * getNumTimeRecordSlots();
+	if (waitMillis < 1.0)
+		waitMillis = 1.0;
+	if (waitMillis > (double)BlockTimeOut)
+		waitMillis = (double)BlockTimeOut;
+
+	const mp_uint32 timeOut = (mp_uint32)waitMillis;
+	mp_uint32 time = 0;
+
+	handshakeMutex.lock();
+	while (device.isPending() && time < timeOut)
+	{
+		if (MPThread::isSupported())
+		{
+			if (!handshakeCondition.wait(handshakeMutex, timeOut - time))
+				time = timeOut;
+		}
+		else
+		{
+			// nothing to wait on, poll
+			const mp_uint32 sleepTime = 10;
+			audioDriver->msleep(sleepTime);
+			time+=sleepTime;
+		}
+	}
+	handshakeMutex.unlock();
+
+	// timeout
+	if (device.markedForRemoval)
+	{
+		device.mixable = 0;
+		device.markedForRemoval = false;
+	}
+	else if (device.markedForPause)
+	{
+		device.paused = true;
+		device.markedForPause = false;
+	}
+}
+
+MixerProxy* MasterMixer::getMixDownProxy(bool floatFormat)
+{
+	//
+	// The mix-down proxy initializes (in lock()) an internal mix buffer (slot 0)
+	// which ChannelMixer and its resamplers write its samples to.
+	//
+	// In unlock() we clip and bounce this mix buffer (slot 0) to the
+	// mix-down buffer (slot 1), the float proxy converts it instead
+	// of clipping it
+	//
+	MixerProxy*& proxy = floatFormat ? mixDownFloatProxy : mixDownProxy;
+	if(!proxy) {
+		if (floatFormat)
+			proxy = new MixerProxyMixDownFloat();
+		else
+			proxy = new MixerProxyMixDown();
+
+		// Lock initially to prepare mix buffer
+		proxy->lock(bufferSize, sampleShift);
+	}
+	return proxy;
+}
+
 void MasterMixer::mixerHandler(mp_sword* buffer, MixerProxy * mixerProxy)
 {
 	bool mixDown = buffer && !mixerProxy;
 
 	// Create mix-down proxy for compatibility reasons
 	if(mixDown) {
-		//
-		// The mix-down proxy initializes (in lock()) an internal mix buffer (slot 0)
-		// which ChannelMixer and its resamplers write its samples to.
-		//
-		// In unlock() we clip and bounce this mix buffer (slot 0) to the
-		// mix-down buffer (slot 1)
-		//
-		if(!mixDownProxy) {
-			mixDownProxy = new MixerProxyMixDown();
-
-            // Lock initially to prepare mix buffer
-            mixDownProxy->lock(bufferSize, sampleShift);
+		if (renderAhead && !renderAhead->floatFormat)
+		{
+			renderAhead->read(buffer);
+			return;
 		}
-		mixerProxy = mixDownProxy;
+
+		mixerProxy = getMixDownProxy(false);
 
 		// Set mix down buffer
         mixerProxy->setBuffer<mp_sword>(MixerProxyMixDown::MixDownBuffer, buffer);
 	}
 
+	mix(mixerProxy, mixDown);
+}
+
+void MasterMixer::mixerHandlerFloat(float* buffer)
+{
+	if (renderAhead && renderAhead->floatFormat)
+	{
+		renderAhead->read(buffer);
+		return;
+	}
+
+	MixerProxy* mixerProxy = getMixDownProxy(true);
+
+	mixerProxy->setBuffer<float>(MixerProxyMixDown::MixDownBuffer, buffer);
+
+	mix(mixerProxy, true);
+}
+
+void MasterMixer::mix(MixerProxy * mixerProxy, bool mixDown)
+{
 	// Lock the mix buffer(s)
 	if (!disableMixing)
 		mixerProxy->lock(bufferSize, sampleShift);
 
 	// Perform mixing
 	const mp_sint32 numDevices = this->numDevices;
+	bool acknowledged = false;
 
 	DeviceDescriptor* device = this->devices;
 	for (mp_sint32 i = 0; i < numDevices; i++, device++)
@@ -416,11 +630,13 @@ void MasterMixer::mixerHandler(mp_sword* buffer, MixerProxy * mixerProxy)
 		{
 			device->markedForRemoval = false;
 			device->mixable = 0;
+			acknowledged = true;
 		}
 		else if (device->mixable && device->markedForPause)
 		{
 			device->markedForPause = false;
 			device->paused = true;
+			acknowledged = true;
 		}
 		else if (device->mixable && !device->paused)
 		{
@@ -428,16 +644,98 @@ void MasterMixer::mixerHandler(mp_sword* buffer, MixerProxy * mixerProxy)
 		}
 	}
 
+	// wake up whoever waits in removeDevice() or pauseDevice(), the mutex
+	// is only held by a waiter until it sleeps on the condition
+	if (acknowledged)
+	{
+		handshakeMutex.lock();
+		handshakeCondition.broadcast();
+		handshakeMutex.unlock();
+	}
+
 	// Unlock and obtain mix buffer
 	if (!disableMixing) {
 		mixerProxy->unlock(filterHook);
 
 		if(mixDown) {
 			this->buffer = mixerProxy->getBuffer<mp_sint32>(MixerProxyMixDown::MixBuffer);
+			publishPeaks(mixerProxy);
 		}
 	}
 }
 
+void MasterMixer::publishPeaks(const MixerProxy* mixerProxy)
+{
+	if (!peaks)
+		return;
+
+	const mp_sint32* mixbuff32 = mixerProxy->getBuffer<mp_sint32>(MixerProxyMixDown::MixBuffer);
+
+	mp_sint32 peakLeft = 0, peakRight = 0;
+	for (mp_uint32 pos = 0; pos < bufferSize; pos++, mixbuff32+=MP_NUMCHANNELS)
+	{
+		const mp_sint32 left = abs(mixbuff32[0]);
+		const mp_sint32 right = abs(mixbuff32[1]);
+		if (left > peakLeft)
+			peakLeft = left;
+		if (right > peakRight)
+			peakRight = right;
+	}
+
+	if (peakLeft > 32767)
+		peakLeft = 32767;
+	if (peakRight > 32767)
+		peakRight = 32767;
+
+	peaks[mixerProxy->getTimeRecordSlot() % numPeaks].set(peakLeft | (peakRight << 16));
+}
+
+void MasterMixer::renderBlock(void* block, mp_sint32* mixCopy, mp_uint32 slot, bool floatFormat)
+{
+	MixerProxy* mixerProxy = getMixDownProxy(floatFormat);
+
+	if (floatFormat)
+		mixerProxy->setBuffer<float>(MixerProxyMixDown::MixDownBuffer, (float*)block);
+	else
+		mixerProxy->setBuffer<mp_sword>(MixerProxyMixDown::MixDownBuffer, (mp_sword*)block);
+
+	mixerProxy->setTimeRecordSlot(slot);
+
+	mix(mixerProxy, true);
+
+	// the mix buffer is reused for the next block, keep what the scopes need
+	const mp_uint32 size = bufferSize*MP_NUMCHANNELS;
+	if (!disableMixing)
+		memcpy(mixCopy, mixerProxy->getBuffer<mp_sint32>(MixerProxyMixDown::MixBuffer), size*sizeof(mp_sint32));
+	else
+	{
+		memset(block, 0, size * (floatFormat ? sizeof(float) : sizeof(mp_sword)));
+		memset(mixCopy, 0, size*sizeof(mp_sint32));
+	}
+}
+
+void MasterMixer::startRenderAhead()
+{
+	if (!renderAheadBlocks || renderAhead || audioDriver->isMultiChannel())
+		return;
+
+	renderAhead = new RenderAhead(*this, renderAheadBlocks, bufferSize, audioDriver->supportsFloat());
+
+	// the driver must not start on an empty ring
+	while (!renderAhead->isFull())
+		renderAhead->render();
+
+	// without a thread the callback mixes by itself
+	if (!renderAhead->start())
+		stopRenderAhead();
+}
+
+void MasterMixer::stopRenderAhead()
+{
+	delete renderAhead;
+	renderAhead = 0;
+}
+
 void MasterMixer::notifyListener(MasterMixerNotifications notification)
 {
 	if (listener)
@@ -454,6 +752,9 @@ void MasterMixer::cleanup()
 
 	delete mixDownProxy;
 	mixDownProxy = 0;
+
+	delete mixDownFloatProxy;
+	mixDownFloatProxy = 0;
 }
 
 const char*	MasterMixer::getCurrentAudioDriverName() const
@@ -501,21 +802,50 @@ const AudioDriverManager* MasterMixer::getAudioDriverManager() const
 	return audioDriverManager;
 }
 
+AudioDriverInterface* MasterMixer::getAudioDriverByName(const char* name)
+{
+	if (audioDriverManager == 0)
+		audioDriverManager = new AudioDriverManager();
+
+	return audioDriverManager->getAudioDriverByName(name);
+}
+
+mp_sint32 MasterMixer::getCurrentSamplePosition() const
+{
+	if (audioDriver == 0)
+		return 0;
+
+	mp_sint32 pos = audioDriver->getBufferPos();
+
+	if (renderAhead)
+	{
+		const mp_sint32 slot = renderAhead->playingSlot;
+		if (slot > 0)
+			pos += slot * bufferSize;
+	}
+
+	return pos;
+}
+
 mp_sint32 MasterMixer::getCurrentSample(mp_sint32 position, mp_sint32 channel)
 {
+	// when rendering ahead the slots are one big buffer
+	const mp_sint32* buffer = renderAhead ? renderAhead->getMixCopies() : this->buffer;
+	const mp_sint32 size = renderAhead ? bufferSize*renderAhead->getNumSlots() : bufferSize;
+
 	if (!buffer)
 		return 0;
 
 	if (position < 0)
 		position = abs(position);
 
-	if (position > (mp_sint32)bufferSize-1) {
-		position %= bufferSize*2;
-		position -= bufferSize;
-		position = bufferSize-1-position;
+	if (position > size-1) {
+		position %= size*2;
+		position -= size;
+		position = size-1-position;
 	}
 
-	mp_sint32 val = (mp_sword) this->buffer[position*MP_NUMCHANNELS+channel];
+	mp_sint32 val = (mp_sword) buffer[position*MP_NUMCHANNELS+channel];
 	if (val < -32768)
 		val = -32768;
 	if (val > 32767)
@@ -526,45 +856,17 @@ mp_sint32 MasterMixer::getCurrentSample(mp_sint32 position, mp_sint32 channel)
 
 mp_sint32 MasterMixer::getCurrentSamplePeak(mp_sint32 position, mp_sint32 channel)
 {
-	if (!buffer)
-		return 0;
-
-	if (audioDriver == 0)
+	if (!peaks || audioDriver == 0)
 		return 0;
 
-	const mp_uint32 mixBufferSize = bufferSize;
-	const mp_sint32* mixbuff32 = this->buffer;
-
-	if (audioDriver->supportsTimeQuery())
+	mp_sint32 slot = 0;
+	if (renderAhead)
 	{
-		mp_sword peak = 0;
-
-		for (mp_sint32 p = position-mixBufferSize; p <= position; p++)
-		{
-			mp_sword s = getCurrentSample(p, channel);
-			if (s > peak)
-				peak = s;
-			if (-s > peak)
-				peak = -s;
-		}
-		return peak;
+		slot = renderAhead->playingSlot;
+		if (slot < 0)
+			return 0;
 	}
-	else
-	{
-		mp_sword peak = 0;
-		for (mp_uint32 pos = 0; pos < mixBufferSize; pos++)
-		{
-			mp_sint32 s = mixbuff32[pos*MP_NUMCHANNELS+channel];
-			if (s < -32768)
-				s = -32768;
-			if (s > 32767)
-				s = 32767;
-			if (s > peak)
-				peak = s;
-			if (-s > peak)
-				peak = -s;
-		}
 
-		return peak;
-	}
+	const mp_uint32 peak = peaks[slot % numPeaks].get();
+	return channel ? (peak >> 16) : (peak & 0xFFFF);
 }
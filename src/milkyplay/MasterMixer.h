@@ -40,6 +40,7 @@
 
 #include "Mixable.h"
 #include "MixerProxy.h"
+#include "MilkyPlayThread.h"
 
 class MasterMixer
 {
@@ -88,6 +89,21 @@ class MasterMixer
 	mp_sint32 setSampleRate(mp_uint32 sampleRate);
 	mp_uint32 getSampleRate() const { return sampleRate; }
 
+	// Render ahead: a thread keeps up to numBlocks buffers mixed in advance
+	// and the audio driver callback only copies them out, 0 mixes in the
+	// callback. Closes the audio device when changed, like the buffer size.
+	// Ignored by multi channel drivers.
+	mp_sint32 setRenderAhead(mp_uint32 numBlocks);
+	mp_uint32 getRenderAhead() const { return renderAheadBlocks; }
+	// players attached to this mixer need that many time record slots,
+	// see ChannelMixer::setNumTimeRecordSlots
+	mp_uint32 getNumTimeRecordSlots() const { return renderAheadBlocks ? renderAheadBlocks+1 : 1; }
+	// buffers the driver wanted while none was rendered
+	mp_uint32 getNumRenderAheadUnderruns() const;
+
+	// Removing and pausing takes effect with the next mix. Blocking calls
+	// return as soon as it is done, otherwise poll isDeviceRemoved() and
+	// isDevicePaused() or wait with waitForDevice() later.
 	bool addDevice(Mixable* device, bool paused = false);
 	bool removeDevice(Mixable* device, bool blocking = true);
 	bool isDeviceRemoved(Mixable* device);
@@ -96,7 +112,12 @@ class MasterMixer
 	bool resumeDevice(Mixable* device);
 	bool isDevicePaused(Mixable* device);
 
+	// wait until a removal or pause requested without blocking took effect
+	bool waitForDevice(Mixable* device);
+
 	void mixerHandler(mp_sword* buffer, MixerProxy * mixerProxy = 0);
+	// mix into an interleaved 32 bit float buffer, no clipping is applied
+	void mixerHandlerFloat(float* buffer);
 
 	// allows to control the loudness of the resulting output stream
 	// by bit-shifting the output *right* (dividing by 2^shift)
@@ -116,8 +137,17 @@ class MasterMixer
 	bool setCurrentAudioDriverByName(const char* name);
 
 	const class AudioDriverManager* getAudioDriverManager() const;
+	// instance of a driver which isn't necessarily the current one,
+	// to pass on driver specific settings
+	class AudioDriverInterface* getAudioDriverByName(const char* name);
+
+	// sample position of the audio driver, when rendering ahead the slot
+	// of the buffer being played is added in buffer sizes
+	mp_sint32 getCurrentSamplePosition() const;
 
 	mp_sint32 getCurrentSample(mp_sint32 position, mp_sint32 channel);
+	// peak of the buffer being played, published by the mixing thread,
+	// position is not needed anymore
 	mp_sint32 getCurrentSamplePeak(mp_sint32 position, mp_sint32 channel);
 
 private:
@@ -130,6 +160,16 @@ class MasterMixer
 	mp_uint32 numDevices;
 	Mixable* filterHook;
 	MixerProxy * mixDownProxy;
+	MixerProxy * mixDownFloatProxy;
+	mp_uint32 renderAheadBlocks;
+
+	class RenderAhead;
+	friend class RenderAhead;
+	RenderAhead* renderAhead;
+
+	// per time record slot, left peak in the lower and right peak in the upper 16 bits
+	MPAtomicIndex* peaks;
+	mp_uint32 numPeaks;
 
 	struct DeviceDescriptor
 	{
@@ -145,6 +185,8 @@ class MasterMixer
 			paused(false)
 		{
 		}
+
+		bool isPending() const { return markedForRemoval || markedForPause; }
 	};
 
 	DeviceDescriptor* devices;
@@ -156,8 +198,23 @@ class MasterMixer
 	bool started;
 	bool paused;
 
+	// mix() broadcasts after it handled a removal or pause
+	MPMutex handshakeMutex;
+	MPCondition handshakeCondition;
+
 	void notifyListener(MasterMixerNotifications notification);
 
+	MixerProxy* getMixDownProxy(bool floatFormat);
+
+	void waitForAcknowledge(DeviceDescriptor& device);
+
+	void mix(MixerProxy * mixerProxy, bool mixDown);
+	void publishPeaks(const MixerProxy* mixerProxy);
+
+	void renderBlock(void* block, mp_sint32* mixCopy, mp_uint32 slot, bool floatFormat);
+	void startRenderAhead();
+	void stopRenderAhead();
+
 	void cleanup();
 };
 
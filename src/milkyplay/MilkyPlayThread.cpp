@@ -0,0 +1,421 @@
+/*
+ * Copyright (c) 2026, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  MilkyPlayThread.cpp
+ *  MilkyPlay
+ *
+ */
+
+#include "MilkyPlayThread.h"
+#include "MilkyPlayCommon.h"
+
+#if defined(WIN32) && !defined(_WIN32_WCE)
+	#define MP_THREADS_WIN32
+#elif (defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)) && !defined(__AMIGA__) && !defined(__PSP__)
+	#define MP_THREADS_PTHREAD
+	#include <pthread.h>
+	#include <unistd.h>
+	#include <sys/time.h>
+#endif
+
+struct MPThreadEntry
+{
+#if defined(MP_THREADS_WIN32)
+	static DWORD WINAPI run(LPVOID param)
+	{
+		MPThread::runThread((MPThread*)param);
+		return 0;
+	}
+#elif defined(MP_THREADS_PTHREAD)
+	static void* run(void* param)
+	{
+		MPThread::runThread((MPThread*)param);
+		return NULL;
+	}
+#endif
+};
+
+#if defined(MP_THREADS_WIN32)
+
+MPMutex::MPMutex()
+{
+	CRITICAL_SECTION* cs = new CRITICAL_SECTION;
+	InitializeCriticalSection(cs);
+	handle = cs;
+}
+
+MPMutex::~MPMutex()
+{
+	DeleteCriticalSection((CRITICAL_SECTION*)handle);
+	delete (CRITICAL_SECTION*)handle;
+}
+
+void MPMutex::lock()
+{
+	EnterCriticalSection((CRITICAL_SECTION*)handle);
+}
+
+void MPMutex::unlock()
+{
+	LeaveCriticalSection((CRITICAL_SECTION*)handle);
+}
+
+// Condition variables of the Windows API need Vista, this one runs on XP.
+// Every waiter sleeps on an auto-reset event of its own and is queued,
+// signal() wakes the first one and broadcast() all queued at that time,
+// so a thread which starts waiting later can't take their wake-up.
+struct MPConditionWaiter
+{
+	HANDLE event;
+	MPConditionWaiter* next;
+	bool queued;
+};
+
+struct MPConditionWin32
+{
+	CRITICAL_SECTION lock;
+	MPConditionWaiter* first;
+	MPConditionWaiter* last;
+	// events are reused, creating one per wait() would be a system call
+	MPConditionWaiter* unused;
+
+	MPConditionWaiter* dequeue()
+	{
+		MPConditionWaiter* waiter = first;
+		if (waiter)
+		{
+			first = waiter->next;
+			if (!first)
+				last = NULL;
+			waiter->queued = false;
+		}
+		return waiter;
+	}
+
+	void remove(MPConditionWaiter* waiter)
+	{
+		MPConditionWaiter* prev = NULL;
+		for (MPConditionWaiter* w = first; w; prev = w, w = w->next)
+		{
+			if (w != waiter)
+				continue;
+			if (prev)
+				prev->next = w->next;
+			else
+				first = w->next;
+			if (last == w)
+				last = prev;
+			w->queued = false;
+			break;
+		}
+	}
+};
+
+MPCondition::MPCondition()
+{
+	MPConditionWin32* cv = new MPConditionWin32;
+	InitializeCriticalSection(&cv->lock);
+	cv->first = cv->last = cv->unused = NULL;
+	handle = cv;
+}
+
+MPCondition::~MPCondition()
+{
+	MPConditionWin32* cv = (MPConditionWin32*)handle;
+	while (cv->unused)
+	{
+		MPConditionWaiter* waiter = cv->unused;
+		cv->unused = waiter->next;
+		CloseHandle(waiter->event);
+		delete waiter;
+	}
+	DeleteCriticalSection(&cv->lock);
+	delete cv;
+}
+
+void MPCondition::wait(MPMutex& mutex)
+{
+	wait(mutex, INFINITE);
+}
+
+bool MPCondition::wait(MPMutex& mutex, mp_uint32 timeOutMillis)
+{
+	MPConditionWin32* cv = (MPConditionWin32*)handle;
+
+	EnterCriticalSection(&cv->lock);
+	MPConditionWaiter* waiter = cv->unused;
+	if (waiter)
+	{
+		cv->unused = waiter->next;
+	}
+	else
+	{
+		waiter = new MPConditionWaiter;
+		waiter->event = CreateEvent(NULL, FALSE, FALSE, NULL);
+	}
+	waiter->next = NULL;
+	waiter->queued = true;
+	if (cv->last)
+		cv->last->next = waiter;
+	else
+		cv->first = waiter;
+	cv->last = waiter;
+	LeaveCriticalSection(&cv->lock);
+
+	mutex.unlock();
+	bool signaled = WaitForSingleObject(waiter->event, timeOutMillis) == WAIT_OBJECT_0;
+
+	EnterCriticalSection(&cv->lock);
+	if (!signaled)
+	{
+		if (waiter->queued)
+			cv->remove(waiter);
+		else
+		{
+			// signaled after the time out, reset the event for the next use
+			WaitForSingleObject(waiter->event, 0);
+			signaled = true;
+		}
+	}
+	waiter->next = cv->unused;
+	cv->unused = waiter;
+	LeaveCriticalSection(&cv->lock);
+
+	mutex.lock();
+	return signaled;
+}
+
+void MPCondition::signal()
+{
+	MPConditionWin32* cv = (MPConditionWin32*)handle;
+
+	EnterCriticalSection(&cv->lock);
+	MPConditionWaiter* waiter = cv->dequeue();
+	if (waiter)
+		SetEvent(waiter->event);
+	LeaveCriticalSection(&cv->lock);
+}
+
+void MPCondition::broadcast()
+{
+	MPConditionWin32* cv = (MPConditionWin32*)handle;
+
+	EnterCriticalSection(&cv->lock);
+	MPConditionWaiter* waiter;
+	while ((waiter = cv->dequeue()) != NULL)
+		SetEvent(waiter->event);
+	LeaveCriticalSection(&cv->lock);
+}
+
+bool MPThread::start()
+{
+	if (handle)
+		return false;
+
+	handle = CreateThread(NULL, 0, MPThreadEntry::run, this, 0, NULL);
+	return handle != 0;
+}
+
+void MPThread::join()
+{
+	if (!handle)
+		return;
+
+	WaitForSingleObject((HANDLE)handle, INFINITE);
+	CloseHandle((HANDLE)handle);
+	handle = 0;
+}
+
+mp_uint32 MPThread::getNumProcessors()
+{
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (mp_uint32)info.dwNumberOfProcessors : 1;
+}
+
+void MPThread::sleep(mp_uint32 millis)
+{
+	Sleep(millis);
+}
+
+bool MPThread::isSupported()
+{
+	return true;
+}
+
+#elif defined(MP_THREADS_PTHREAD)
+
+MPMutex::MPMutex()
+{
+	pthread_mutex_t* mutex = new pthread_mutex_t;
+	pthread_mutex_init(mutex, NULL);
+	handle = mutex;
+}
+
+MPMutex::~MPMutex()
+{
+	pthread_mutex_destroy((pthread_mutex_t*)handle);
+	delete (pthread_mutex_t*)handle;
+}
+
+void MPMutex::lock()
+{
+	pthread_mutex_lock((pthread_mutex_t*)handle);
+}
+
+void MPMutex::unlock()
+{
+	pthread_mutex_unlock((pthread_mutex_t*)handle);
+}
+
+MPCondition::MPCondition()
+{
+	pthread_cond_t* cond = new pthread_cond_t;
+	pthread_cond_init(cond, NULL);
+	handle = cond;
+}
+
+MPCondition::~MPCondition()
+{
+	pthread_cond_destroy((pthread_cond_t*)handle);
+	delete (pthread_cond_t*)handle;
+}
+
+void MPCondition::wait(MPMutex& mutex)
+{
+	pthread_cond_wait((pthread_cond_t*)handle, (pthread_mutex_t*)mutex.handle);
+}
+
+bool MPCondition::wait(MPMutex& mutex, mp_uint32 timeOutMillis)
+{
+	// pthread_cond_timedwait wants the absolute time of the default clock
+	struct timeval now;
+	gettimeofday(&now, NULL);
+
+	const long usecs = now.tv_usec + (long)(timeOutMillis % 1000) * 1000;
+
+	struct timespec timeOut;
+	timeOut.tv_sec = now.tv_sec + timeOutMillis / 1000 + usecs / 1000000;
+	timeOut.tv_nsec = (usecs % 1000000) * 1000;
+
+	return pthread_cond_timedwait((pthread_cond_t*)handle, (pthread_mutex_t*)mutex.handle, &timeOut) == 0;
+}
+
+void MPCondition::signal()
+{
+	pthread_cond_signal((pthread_cond_t*)handle);
+}
+
+void MPCondition::broadcast()
+{
+	pthread_cond_broadcast((pthread_cond_t*)handle);
+}
+
+bool MPThread::start()
+{
+	if (handle)
+		return false;
+
+	pthread_t* thread = new pthread_t;
+	if (pthread_create(thread, NULL, MPThreadEntry::run, this) != 0)
+	{
+		delete thread;
+		return false;
+	}
+
+	handle = thread;
+	return true;
+}
+
+void MPThread::join()
+{
+	if (!handle)
+		return;
+
+	pthread_join(*(pthread_t*)handle, NULL);
+	delete (pthread_t*)handle;
+	handle = 0;
+}
+
+mp_uint32 MPThread::getNumProcessors()
+{
+#ifdef _SC_NPROCESSORS_ONLN
+	long num = sysconf(_SC_NPROCESSORS_ONLN);
+	if (num > 0)
+		return (mp_uint32)num;
+#endif
+	return 1;
+}
+
+void MPThread::sleep(mp_uint32 millis)
+{
+	usleep(millis*1000);
+}
+
+bool MPThread::isSupported()
+{
+	return true;
+}
+
+#else
+
+// no thread support, the mutex and condition are never contended
+MPMutex::MPMutex() : handle(0) {}
+MPMutex::~MPMutex() {}
+void MPMutex::lock() {}
+void MPMutex::unlock() {}
+
+MPCondition::MPCondition() : handle(0) {}
+MPCondition::~MPCondition() {}
+void MPCondition::wait(MPMutex& mutex) {}
+bool MPCondition::wait(MPMutex& mutex, mp_uint32 timeOutMillis) { return false; }
+void MPCondition::signal() {}
+void MPCondition::broadcast() {}
+
+bool MPThread::start() { return false; }
+void MPThread::join() {}
+
+mp_uint32 MPThread::getNumProcessors() { return 1; }
+
+void MPThread::sleep(mp_uint32 millis) {}
+
+bool MPThread::isSupported() { return false; }
+
+#endif
+
+MPThread::MPThread() :
+	handle(0)
+{
+}
+
+MPThread::~MPThread()
+{
+	ASSERT(handle == 0);
+}
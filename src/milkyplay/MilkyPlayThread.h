@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2026, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  MilkyPlayThread.h
+ *  MilkyPlay
+ *
+ *  Minimal threading primitives for the mixer (pthreads or Win32)
+ *  plus an index and a sequence lock for lock-free data exchange
+ *  between one producer and one consumer.
+ *  On platforms without thread support MPThread::start() fails and the
+ *  caller has to do the work itself.
+ *
+ */
+#ifndef __MILKYPLAYTHREAD_H__
+#define __MILKYPLAYTHREAD_H__
+
+#include "MilkyPlayTypes.h"
+
+#if defined(_MSC_VER)
+	#include <intrin.h>
+#endif
+
+class MPMutex
+{
+private:
+	void* handle;
+
+	friend class MPCondition;
+
+	// not copyable
+	MPMutex(const MPMutex&);
+	MPMutex& operator=(const MPMutex&);
+
+public:
+	MPMutex();
+	~MPMutex();
+
+	void lock();
+	void unlock();
+};
+
+class MPCondition
+{
+private:
+	void* handle;
+
+	MPCondition(const MPCondition&);
+	MPCondition& operator=(const MPCondition&);
+
+public:
+	MPCondition();
+	~MPCondition();
+
+	// mutex must be locked by the caller
+	void wait(MPMutex& mutex);
+	// same with a time out, returns false when it elapsed
+	// (at once if threads are not supported)
+	bool wait(MPMutex& mutex, mp_uint32 timeOutMillis);
+	void signal();
+	void broadcast();
+};
+
+// Counter shared by one writing and one reading thread without locking.
+// Whatever the writer stored before set() is visible to the reader once
+// get() returns the new value.
+class MPAtomicIndex
+{
+private:
+	volatile mp_uint32 value;
+
+	MPAtomicIndex(const MPAtomicIndex&);
+	MPAtomicIndex& operator=(const MPAtomicIndex&);
+
+public:
+	MPAtomicIndex() : value(0) { }
+
+	mp_uint32 get() const
+	{
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+		return __atomic_load_n(&value, __ATOMIC_ACQUIRE);
+#elif defined(__GNUC__)
+		mp_uint32 result = value;
+		__sync_synchronize();
+		return result;
+#elif defined(_MSC_VER)
+		// volatile alone only orders accesses with /volatile:ms, which isn't
+		// the default on ARM, interlocked operations are full barriers
+		return (mp_uint32)_InterlockedCompareExchange((volatile long*)&value, 0, 0);
+#else
+		return value;
+#endif
+	}
+
+	void set(mp_uint32 newValue)
+	{
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+		__atomic_store_n(&value, newValue, __ATOMIC_RELEASE);
+#elif defined(__GNUC__)
+		__sync_synchronize();
+		value = newValue;
+#elif defined(_MSC_VER)
+		_InterlockedExchange((volatile long*)&value, (long)newValue);
+#else
+		value = newValue;
+#endif
+	}
+};
+
+// Lets one thread publish a block of data which another thread copies
+// without locking. The reader checks with endRead() whether the writer
+// touched the data while it was copying and drops the copy if it did.
+class MPSequenceLock
+{
+private:
+	MPAtomicIndex sequence;
+
+	MPSequenceLock(const MPSequenceLock&);
+	MPSequenceLock& operator=(const MPSequenceLock&);
+
+	// keeps the data accesses on the right side of the sequence updates
+	static void fence()
+	{
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+#elif defined(__GNUC__)
+		__sync_synchronize();
+#elif defined(_MSC_VER)
+		volatile long barrier = 0;
+		_InterlockedExchange(&barrier, 0);
+#endif
+	}
+
+public:
+	MPSequenceLock() { }
+
+	// writer
+	void beginWrite()
+	{
+		sequence.set(sequence.get() + 1);
+		fence();
+	}
+
+	void endWrite()
+	{
+		sequence.set(sequence.get() + 1);
+	}
+
+	// reader, pass the result of beginRead() to endRead()
+	mp_uint32 beginRead() const
+	{
+		return sequence.get();
+	}
+
+	bool endRead(mp_uint32 start) const
+	{
+		fence();
+		return !(start & 1) && sequence.get() == start;
+	}
+};
+
+class MPThread
+{
+private:
+	void* handle;
+
+	MPThread(const MPThread&);
+	MPThread& operator=(const MPThread&);
+
+	static void runThread(MPThread* thread) { thread->run(); }
+
+	friend struct MPThreadEntry;
+
+protected:
+	// thread body
+	virtual void run() = 0;
+
+public:
+	MPThread();
+	// derived classes must call join() in their destructor
+	virtual ~MPThread();
+
+	// returns false when no thread could be created
+	bool start();
+	// wait until run() has returned
+	void join();
+
+	bool isStarted() const { return handle != 0; }
+
+	// number of processors available, 1 if threads are not supported
+	static mp_uint32 getNumProcessors();
+	// false if start() always fails on this platform
+	static bool isSupported();
+	// suspend the calling thread, returns at once without thread support
+	static void sleep(mp_uint32 millis);
+};
+
+#endif
@@ -35,7 +35,7 @@
 #include <stdio.h>
 
 MixerProxy::MixerProxy(mp_uint32 numChannels, ProxyProcessor * processor)
-: numChannels(numChannels)
+: numChannels(numChannels), bufferSize(0), sampleShift(0), timeRecordSlot(0)
 {
     buffers = new void* [numChannels];
     memset(buffers, 0, numChannels * sizeof(void *));
@@ -70,18 +70,10 @@ bool MixerProxyMixDown::lock(mp_uint32 bufferSize, mp_uint32 sampleShift)
     return true;
 }
 
-void MixerProxyMixDown::unlock(Mixable * filterHook)
+static void clipToWords(const mp_sint32 * bufferIn, mp_sword * bufferOut, mp_sint32 bufferSize, mp_sint32 sampleShift)
 {
-	mp_sint32 * bufferIn = getBuffer<mp_sint32>(MixBuffer);
-    mp_sword * bufferOut = getBuffer<mp_sword>(MixDownBuffer);
-
-	if (filterHook)
-		filterHook->mix(this);
-
-	const mp_sint32 sampleShift = this->sampleShift;
 	const mp_sint32 lowerBound = -((128<<sampleShift)*256);
 	const mp_sint32 upperBound = ((128<<sampleShift)*256)-1;
-	const mp_sint32 bufferSize = this->bufferSize * MP_NUMCHANNELS;
 
 	for (mp_sint32 i = 0; i < bufferSize; i++) {
 		mp_sint32 b = *bufferIn++;
@@ -93,6 +85,84 @@ void MixerProxyMixDown::unlock(Mixable * filterHook)
 	}
 }
 
+static void convertToFloat(const mp_sint32 * bufferIn, float * bufferOut, mp_sint32 bufferSize, mp_sint32 sampleShift)
+{
+	const float scale = 1.0f / (float)(32768 << sampleShift);
+
+	for (mp_sint32 i = 0; i < bufferSize; i++)
+		*bufferOut++ = (float)(*bufferIn++) * scale;
+}
+
+void MixerProxyMixDown::unlock(Mixable * filterHook)
+{
+	if (filterHook)
+		filterHook->mix(this);
+
+	clipToWords(getBuffer<mp_sint32>(MixBuffer), getBuffer<mp_sword>(MixDownBuffer), bufferSize * MP_NUMCHANNELS, sampleShift);
+}
+
+void MixerProxyMixDownFloat::unlock(Mixable * filterHook)
+{
+	if (filterHook)
+		filterHook->mix(this);
+
+	convertToFloat(getBuffer<mp_sint32>(MixBuffer), getBuffer<float>(MixDownBuffer), bufferSize * MP_NUMCHANNELS, sampleShift);
+}
+
+MixerProxyMixDownStems::~MixerProxyMixDownStems()
+{
+	delete[] block;
+}
+
+bool MixerProxyMixDownStems::lock(mp_uint32 bufferSize, mp_uint32 sampleShift)
+{
+	const mp_uint32 stemSize = bufferSize * MP_NUMCHANNELS;
+
+	if(this->bufferSize != bufferSize || !block) {
+		delete[] block;
+		block = new mp_sint32[numChannels * stemSize];
+		for (mp_uint32 i = 0; i < numChannels; i++)
+			setBuffer<mp_sint32>(i, block + i * stemSize);
+	}
+
+	MixerProxy::lock(bufferSize, sampleShift);
+
+	memset(block, 0, numChannels * stemSize * sizeof(mp_sint32));
+
+	return true;
+}
+
+void MixerProxyMixDownStems::grow(mp_uint32 numStems)
+{
+	if (numStems <= numChannels)
+		return;
+
+	const mp_uint32 stemSize = bufferSize * MP_NUMCHANNELS;
+
+	mp_sint32* newBlock = new mp_sint32[numStems * stemSize];
+	if (block)
+		memcpy(newBlock, block, numChannels * stemSize * sizeof(mp_sint32));
+	memset(newBlock + numChannels * stemSize, 0, (numStems - numChannels) * stemSize * sizeof(mp_sint32));
+	delete[] block;
+	block = newBlock;
+
+	delete[] buffers;
+	buffers = new void* [numStems];
+	numChannels = numStems;
+	for (mp_uint32 i = 0; i < numChannels; i++)
+		setBuffer<mp_sint32>(i, block + i * stemSize);
+}
+
+void MixerProxyMixDownStems::bounce(mp_uint32 stem, mp_sword * dest) const
+{
+	clipToWords(getBuffer<mp_sint32>(stem), dest, bufferSize * MP_NUMCHANNELS, sampleShift);
+}
+
+void MixerProxyMixDownStems::bounce(mp_uint32 stem, float * dest) const
+{
+	convertToFloat(getBuffer<mp_sint32>(stem), dest, bufferSize * MP_NUMCHANNELS, sampleShift);
+}
+
 bool MixerProxyDirectOut::lock(mp_uint32 bufferSize, mp_uint32 sampleShift)
 {
     MixerProxy::lock(bufferSize, sampleShift);
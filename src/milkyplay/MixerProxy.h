@@ -49,6 +49,7 @@ class MixerProxy
 public:
 	enum ProcessingType {
 		MixDown,
+		MixDownStems,
 		DirectOut,
 		HardwareOut
 	};
@@ -59,6 +60,7 @@ class MixerProxy
 	void **				buffers;
 	mp_uint32 			bufferSize;
 	mp_uint32 			sampleShift;
+	mp_uint32			timeRecordSlot;
 
 public:
 	template <class SampleType>
@@ -101,6 +103,10 @@ class MixerProxy
 	mp_uint32 				getBufferSize() const { return bufferSize; }
 	mp_uint32 				getSampleShift() const { return sampleShift; }
 
+	// where the mixer keeps the time records of this buffer, see ChannelMixer::setNumTimeRecordSlots
+	void					setTimeRecordSlot(mp_uint32 slot) { timeRecordSlot = slot; }
+	mp_uint32				getTimeRecordSlot() const { return timeRecordSlot; }
+
 	MixerProxy(mp_uint32 numChannels, ProxyProcessor * processor);
 	virtual ~MixerProxy();
 };
@@ -121,6 +127,50 @@ class MixerProxyMixDown : public MixerProxy
 	virtual ~MixerProxyMixDown();
 };
 
+// Same as above, but bounces to a 32 bit float buffer (MixDownBuffer)
+// instead of clipping to 16 bit. Full scale (+-1.0) corresponds to the 16
+// bit range, sampleShift only attenuates and nothing is clipped here.
+class MixerProxyMixDownFloat : public MixerProxyMixDown
+{
+public:
+	virtual void 			unlock(Mixable * filterHook);
+
+	MixerProxyMixDownFloat(mp_uint32 numChannels = 2, ProxyProcessor * processor = 0) : MixerProxyMixDown(numChannels, processor) {}
+	virtual ~MixerProxyMixDownFloat() {}
+};
+
+// Offline rendering of one stereo stem per mixer channel in a single pass.
+// Every channel is mixed into a 32 bit buffer of its own (slot = channel),
+// the buffers are allocated as one block. Nothing is bounced in unlock(),
+// the owner converts the stems with bounce() exactly like the mix-down
+// proxies above would, so each stem matches a render with all other
+// channels muted.
+// Channels without a stem are not mixed, unless the proxy is growable: then
+// the mixer adds stems until every channel it has got one.
+class MixerProxyMixDownStems : public MixerProxy
+{
+private:
+	mp_sint32 *				block;
+	bool					growable;
+
+public:
+	virtual bool 			lock(mp_uint32 bufferSize, mp_uint32 sampleShift);
+	virtual ProcessingType	getProcessingType() const { return MixDownStems; }
+
+	void					setGrowable(bool growable) { this->growable = growable; }
+	bool					isGrowable() const { return growable; }
+	// adds stems after lock(), keeps what was mixed into the existing ones
+	void					grow(mp_uint32 numStems);
+
+	// clip to 16 bit like MixerProxyMixDown
+	void					bounce(mp_uint32 stem, mp_sword * dest) const;
+	// scale to float like MixerProxyMixDownFloat
+	void					bounce(mp_uint32 stem, float * dest) const;
+
+	MixerProxyMixDownStems(mp_uint32 numStems, ProxyProcessor * processor = 0) : MixerProxy(numStems, processor), block(0), growable(false) {}
+	virtual ~MixerProxyMixDownStems();
+};
+
 class MixerProxyDirectOut : public MixerProxy
 {
 public:
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2026, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  MixerThreadPool.cpp
+ *  MilkyPlay
+ *
+ */
+
+#include "MixerThreadPool.h"
+#include "ResamplerSIMD.h"
+
+MixerThreadPool::Worker::Worker(MixerThreadPool& pool, mp_uint32 index) :
+	pool(pool),
+	index(index),
+	buffer(NULL),
+	bufferSize(0)
+{
+}
+
+MixerThreadPool::Worker::~Worker()
+{
+	join();
+	delete[] buffer;
+}
+
+void MixerThreadPool::Worker::mixPartition()
+{
+	if (pool.channelStride)
+	{
+		pool.resampler->addChannelsPartial(pool.mixer, index, pool.numThreadsUsed, pool.numChannels, pool.buffer32, pool.beatNum, pool.beatLength, pool.channelStride);
+		return;
+	}
+
+	memset(buffer, 0, pool.beatLength*MP_NUMCHANNELS*sizeof(mp_sint32));
+	pool.resampler->addChannelsPartial(pool.mixer, index, pool.numThreadsUsed, pool.numChannels, buffer, pool.beatNum, pool.beatLength);
+}
+
+void MixerThreadPool::Worker::run()
+{
+	mp_uint32 lastGeneration = 0;
+
+	pool.mutex.lock();
+	for (;;)
+	{
+		while (pool.generation == lastGeneration && !pool.quit)
+			pool.startCondition.wait(pool.mutex);
+
+		if (pool.quit)
+			break;
+
+		lastGeneration = pool.generation;
+
+		// not needed for this packet
+		if (index >= pool.numThreadsUsed)
+			continue;
+
+		// the job can't change until every worker has reported back
+		pool.mutex.unlock();
+		mixPartition();
+		pool.mutex.lock();
+
+		if (--pool.numPending == 0)
+			pool.doneCondition.signal();
+	}
+	pool.mutex.unlock();
+}
+
+MixerThreadPool::MixerThreadPool(mp_uint32 numThreads) :
+	workers(NULL),
+	numWorkers(0),
+	generation(0),
+	numPending(0),
+	quit(false),
+	resampler(NULL),
+	mixer(NULL),
+	numChannels(0),
+	numThreadsUsed(0),
+	beatNum(0),
+	beatLength(0),
+	buffer32(NULL),
+	channelStride(0),
+	maxBeatLength(0)
+{
+	if (numThreads < 2)
+		return;
+
+	if (numThreads > MAX_THREADS)
+		numThreads = MAX_THREADS;
+
+	workers = new Worker*[numThreads - 1];
+
+	for (mp_uint32 i = 0; i < numThreads - 1; i++)
+	{
+		Worker* worker = new Worker(*this, i + 1);
+		if (!worker->start())
+		{
+			delete worker;
+			break;
+		}
+		workers[numWorkers++] = worker;
+	}
+}
+
+MixerThreadPool::~MixerThreadPool()
+{
+	mutex.lock();
+	quit = true;
+	startCondition.broadcast();
+	mutex.unlock();
+
+	// joins the thread
+	for (mp_uint32 i = 0; i < numWorkers; i++)
+		delete workers[i];
+
+	delete[] workers;
+}
+
+void MixerThreadPool::setMaxBeatLength(mp_uint32 beatLength)
+{
+	if (beatLength == maxBeatLength)
+		return;
+
+	maxBeatLength = beatLength;
+
+	// workers are idle when nobody is mixing
+	for (mp_uint32 i = 0; i < numWorkers; i++)
+	{
+		Worker* worker = workers[i];
+		delete[] worker->buffer;
+		worker->bufferSize = beatLength*MP_NUMCHANNELS;
+		worker->buffer = new mp_sint32[worker->bufferSize];
+	}
+}
+
+void MixerThreadPool::addBuffers(mp_sint32* dest, mp_sint32** src, mp_uint32 numSrc, mp_uint32 count)
+{
+	mp_uint32 i = 0;
+
+#if defined(MILKYPLAY_SIMD_SSE2)
+	for (; i + 4 <= count; i+=4)
+	{
+		__m128i sum = _mm_loadu_si128((const __m128i*)(dest + i));
+		for (mp_uint32 j = 0; j < numSrc; j++)
+			sum = _mm_add_epi32(sum, _mm_loadu_si128((const __m128i*)(src[j] + i)));
+		_mm_storeu_si128((__m128i*)(dest + i), sum);
+	}
+#elif defined(MILKYPLAY_SIMD_NEON)
+	for (; i + 4 <= count; i+=4)
+	{
+		int32x4_t sum = vld1q_s32(dest + i);
+		for (mp_uint32 j = 0; j < numSrc; j++)
+			sum = vaddq_s32(sum, vld1q_s32(src[j] + i));
+		vst1q_s32(dest + i, sum);
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		mp_sint32 sum = dest[i];
+		for (mp_uint32 j = 0; j < numSrc; j++)
+			sum += src[j][i];
+		dest[i] = sum;
+	}
+}
+
+void MixerThreadPool::addChannels(ChannelMixer::ResamplerBase* resampler, ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32, mp_sint32 beatNum, mp_sint32 beatLength, mp_uint32 channelStride)
+{
+	mp_uint32 numThreads = mixer->getNumActiveVoices() / MIN_VOICES_PER_THREAD;
+	if (numThreads > numWorkers + 1)
+		numThreads = numWorkers + 1;
+
+	// nothing is allocated while mixing, longer packets than the buffers hold are mixed serially
+	if (numThreads < 2 || (!channelStride && (mp_uint32)beatLength > maxBeatLength))
+	{
+		resampler->addChannelsPartial(mixer, 0, 1, numChannels, buffer32, beatNum, beatLength, channelStride);
+		return;
+	}
+
+	const mp_uint32 size = beatLength*MP_NUMCHANNELS;
+	mp_sint32* partialBuffers[MAX_THREADS];
+
+	for (mp_uint32 i = 0; i < numThreads - 1 && !channelStride; i++)
+		partialBuffers[i] = workers[i]->buffer;
+
+	mutex.lock();
+	this->resampler = resampler;
+	this->mixer = mixer;
+	this->numChannels = numChannels;
+	this->numThreadsUsed = numThreads;
+	this->beatNum = beatNum;
+	this->beatLength = beatLength;
+	this->buffer32 = buffer32;
+	this->channelStride = channelStride;
+	numPending = numThreads - 1;
+	generation++;
+	startCondition.broadcast();
+	mutex.unlock();
+
+	// our own share goes straight into the destination
+	resampler->addChannelsPartial(mixer, 0, numThreads, numChannels, buffer32, beatNum, beatLength, channelStride);
+
+	mutex.lock();
+	while (numPending)
+		doneCondition.wait(mutex);
+	mutex.unlock();
+
+	// the channels went to buffers of their own, nothing to add up
+	if (channelStride)
+		return;
+
+	// fixed order, although integer addition wouldn't care
+	addBuffers(buffer32, partialBuffers, numThreads - 1, size);
+}
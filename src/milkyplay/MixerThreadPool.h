@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2026, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  MixerThreadPool.h
+ *  MilkyPlay
+ *
+ *  Persistent worker pool for mixing the channels of a ChannelMixer in
+ *  parallel. The n-th active voice of a beat packet is mixed by thread
+ *  n % numThreads (the calling thread being number 0) into a private
+ *  accumulation buffer, the partial buffers are then added to the
+ *  destination in thread order. When every channel has a buffer of its
+ *  own (stem rendering) the threads write to the destination directly.
+ *  The mixer works in 32 bit integers and every channel goes through the
+ *  same code as in the serial mixer, so the result is bit-identical to it.
+ *
+ */
+#ifndef __MIXERTHREADPOOL_H__
+#define __MIXERTHREADPOOL_H__
+
+#include "ChannelMixer.h"
+#include "MilkyPlayThread.h"
+
+class MixerThreadPool
+{
+private:
+	enum
+	{
+		// below this number of voices per thread it's not worth waking the workers
+		MIN_VOICES_PER_THREAD = 4,
+		MAX_THREADS = 32
+	};
+
+	class Worker : public MPThread
+	{
+	private:
+		MixerThreadPool& pool;
+		const mp_uint32 index;
+
+	protected:
+		virtual void run();
+
+	public:
+		mp_sint32* buffer;
+		mp_uint32 bufferSize;
+
+		Worker(MixerThreadPool& pool, mp_uint32 index);
+		virtual ~Worker();
+
+		void mixPartition();
+	};
+
+	friend class Worker;
+
+	Worker** workers;
+	mp_uint32 numWorkers;
+
+	MPMutex mutex;
+	MPCondition startCondition;
+	MPCondition doneCondition;
+	mp_uint32 generation;
+	mp_uint32 numPending;
+	bool quit;
+
+	// the current job
+	ChannelMixer::ResamplerBase* resampler;
+	ChannelMixer* mixer;
+	mp_uint32 numChannels;
+	mp_uint32 numThreadsUsed;
+	mp_sint32 beatNum;
+	mp_sint32 beatLength;
+	mp_sint32* buffer32;			// only used by the workers if channelStride is set
+	mp_uint32 channelStride;
+
+	// the worker buffers hold beat packets up to this length
+	mp_uint32 maxBeatLength;
+
+	static void addBuffers(mp_sint32* dest, mp_sint32** src, mp_uint32 numSrc, mp_uint32 count);
+
+	MixerThreadPool(const MixerThreadPool&);
+	MixerThreadPool& operator=(const MixerThreadPool&);
+
+public:
+	// numThreads includes the calling thread
+	MixerThreadPool(mp_uint32 numThreads);
+	~MixerThreadPool();
+
+	// number of threads which could actually be started, including the caller
+	mp_uint32 getNumThreads() const { return numWorkers + 1; }
+
+	// sizes the worker buffers, not while mixing
+	void setMaxBeatLength(mp_uint32 beatLength);
+
+	// same contract as ChannelMixer::ResamplerBase::addChannels
+	void addChannels(ChannelMixer::ResamplerBase* resampler, ChannelMixer* mixer, mp_uint32 numChannels, mp_sint32* buffer32, mp_sint32 beatNum, mp_sint32 beatLength, mp_uint32 channelStride);
+};
+
+#endif
@@ -96,6 +96,8 @@ PlayerBase::PlayerBase(mp_uint32 frequency) :
 	resetMainVolumeOnStartPlayFlag	= true;
 
 	adder = BPMCounter = 0;
+	BPMCounterFrac = 0;
+	tickPending = false;
 
 	patternIndexToPlay = -1;
 
@@ -116,7 +118,7 @@ PlayerBase::~PlayerBase()
 
 mp_sint32 PlayerBase::adjustFrequency(mp_uint32 frequency)
 {
-	mp_uint32 lastNumBeatPackets = getNumBeatPackets()+1;
+	mp_uint32 lastNumTimeRecords = getNumTimeRecords();
 
 	mp_sint32 res = ChannelMixer::adjustFrequency(frequency);
 
@@ -124,7 +126,7 @@ mp_sint32 PlayerBase::adjustFrequency(mp_uint32 frequency)
 		return res;
 
 	// nothing has changed
-	if (lastNumBeatPackets == getNumBeatPackets()+1)
+	if (lastNumTimeRecords == getNumTimeRecords())
 		return MP_OK;
 
 	reallocTimeRecord();
@@ -134,7 +136,7 @@ mp_sint32 PlayerBase::adjustFrequency(mp_uint32 frequency)
 
 mp_sint32 PlayerBase::setBufferSize(mp_uint32 bufferSize)
 {
-	mp_uint32 lastNumBeatPackets = getNumBeatPackets()+1;
+	mp_uint32 lastNumTimeRecords = getNumTimeRecords();
 
 	mp_sint32 res = ChannelMixer::setBufferSize(bufferSize);
 
@@ -142,7 +144,25 @@ mp_sint32 PlayerBase::setBufferSize(mp_uint32 bufferSize)
 		return res;
 
 	// nothing has changed
-	if (lastNumBeatPackets == getNumBeatPackets()+1)
+	if (lastNumTimeRecords == getNumTimeRecords())
+		return MP_OK;
+
+	reallocTimeRecord();
+
+	return MP_OK;
+}
+
+mp_sint32 PlayerBase::setNumTimeRecordSlots(mp_uint32 numSlots)
+{
+	mp_uint32 lastNumTimeRecords = getNumTimeRecords();
+
+	mp_sint32 res = ChannelMixer::setNumTimeRecordSlots(numSlots);
+
+	if (res < 0)
+		return res;
+
+	// nothing has changed
+	if (lastNumTimeRecords == getNumTimeRecords())
 		return MP_OK;
 
 	reallocTimeRecord();
@@ -329,6 +349,126 @@ void PlayerBase::setPatternPos(mp_uint32 pos, mp_uint32 row/* = 0*/, bool resetC
 	}
 }
 
+mp_sint32 PlayerBase::storeState(PlayerSnapshot& snapshot, mp_sint32 numPlayerChannels) const
+{
+	if (!module || !startPlay)
+		return MP_UNSUPPORTED;
+
+	snapshot.clear();
+	snapshot.order = poscnt;
+	snapshot.row = rowcnt;
+
+	// checked first when restoring
+	snapshot.write((mp_sint32)getType());
+	snapshot.write(numPlayerChannels);
+	snapshot.write((mp_sint32)getNumAllocatedChannels());
+
+	snapshot.write(halted);
+	snapshot.write(mainVolume);
+	snapshot.write(tickSpeed);
+	snapshot.write(baseBpm);
+	snapshot.write(bpm);
+	snapshot.write(ticker);
+	snapshot.write(rowcnt);
+	snapshot.write(poscnt);
+	snapshot.write(synccnt);
+	snapshot.write(lastUnvisitedPos);
+	snapshot.write(adder);
+	snapshot.write(BPMCounter);
+	snapshot.write(BPMCounterFrac);
+	snapshot.write(tickPending);
+
+	return saveChannelState(snapshot, module) ? MP_OK : MP_UNSUPPORTED;
+}
+
+mp_sint32 PlayerBase::fetchState(PlayerSnapshot::Reader& reader, mp_sint32 numPlayerChannels)
+{
+	if (!module || !startPlay)
+		return MP_UNSUPPORTED;
+
+	mp_sint32 type, numChannels, numMixerChannels;
+	if (!reader.read(type) || !reader.read(numChannels) || !reader.read(numMixerChannels) ||
+		type != (mp_sint32)getType() ||
+		numChannels != numPlayerChannels ||
+		numMixerChannels <= 0)
+		return MP_UNSUPPORTED;
+
+	// the IT player changes the number of mixer channels with the number of voices
+	setActiveChannels(numMixerChannels);
+
+	bool res = reader.read(halted) &&
+		reader.read(mainVolume) &&
+		reader.read(tickSpeed) &&
+		reader.read(baseBpm) &&
+		reader.read(bpm) &&
+		reader.read(ticker) &&
+		reader.read(rowcnt) &&
+		reader.read(poscnt) &&
+		reader.read(synccnt) &&
+		reader.read(lastUnvisitedPos) &&
+		reader.read(adder) &&
+		reader.read(BPMCounter) &&
+		reader.read(BPMCounterFrac) &&
+		reader.read(tickPending) &&
+		restoreChannelState(reader);
+
+	updateTimeRecord();
+
+	return res ? MP_OK : MP_UNSUPPORTED;
+}
+
+bool PlayerBase::isRowStartDue(mp_sint32& order, mp_sint32& row) const
+{
+	if (!module || !startPlay || halted || paused || idle || ticker != 0 || !adder ||
+		patternIndexToPlay != -1)
+		return false;
+
+	if (poscnt < 0 || poscnt >= module->header.ordnum ||
+		rowcnt < 0 || rowcnt >= module->phead[module->header.ord[poscnt]].rows)
+		return false;
+
+	bool tickDue;
+	if (getSampleAccurateTicks())
+		tickDue = tickPending;
+	else
+		tickDue = (((mp_int64)BPMCounter + (mp_int64)adder) >> 32) != 0;
+
+	order = poscnt;
+	row = rowcnt;
+	return tickDue;
+}
+
+mp_uint32 PlayerBase::advanceTimer(mp_uint32 maxLength)
+{
+	if (!getSampleAccurateTicks() || paused || !adder)
+		return maxLength;
+
+	// adder is the BPM counter increment per beat packet, so per sample the
+	// counter scaled by beatPacketSize grows by adder
+	const mp_uint32 beatPacketSize = getBeatPacketSize();
+	const mp_int64 period = (mp_int64)beatPacketSize << 32;
+
+	if (BPMCounterFrac >= beatPacketSize)
+		BPMCounterFrac = 0;
+
+	mp_int64 counter = (mp_int64)BPMCounter * beatPacketSize + BPMCounterFrac;
+
+	mp_int64 length = (period - counter + adder - 1) / adder;
+	if (length > (mp_int64)maxLength)
+		length = maxLength;
+
+	counter+=(mp_int64)adder * length;
+	if (counter >= period)
+	{
+		counter-=period;
+		tickPending = true;
+	}
+
+	BPMCounter = (mp_uint32)(counter / beatPacketSize);
+	BPMCounterFrac = (mp_uint32)(counter % beatPacketSize);
+
+	return (mp_uint32)length;
+}
 
 void PlayerBase::timerHandler(mp_sint32 currentBeatPacket)
 {
@@ -126,14 +126,14 @@ class PlayerBase : public ChannelMixer, public PlayModeSettings
 	void reallocTimeRecord()
 	{
 		delete[] timeRecord;
-		timeRecord = new TimeRecord[getNumBeatPackets()+1];
+		timeRecord = new TimeRecord[getNumTimeRecords()];
 
 		updateTimeRecord();
 	}
 
 	void updateTimeRecord()
 	{
-		for (mp_uint32 i = 0; i < getNumBeatPackets()+1; i++)
+		for (mp_uint32 i = 0; i < getNumTimeRecords(); i++)
 		{
 			timeRecord[i] = TimeRecord(poscnt,
 									   rowcnt,
@@ -180,6 +180,32 @@ class PlayerBase : public ChannelMixer, public PlayModeSettings
 	mp_sint32		lastUnvisitedPos;		// the last order we visited before a new order has been set
 
 	mp_uint32		adder, BPMCounter;
+	mp_uint32		BPMCounterFrac;			// sample accurate ticks: BPMCounter fraction in 1/beatPacketSize
+	bool			tickPending;			// sample accurate ticks: BPMCounter wrapped at the end of the last beat packet
+
+	// advance the BPM counter by one beat packet, true if a tick is due
+	bool			updateBPMCounter()
+	{
+		if (getSampleAccurateTicks())
+		{
+			const bool tick = tickPending && adder;
+			tickPending = false;
+			return tick;
+		}
+
+		mp_int64 dummy = (mp_int64)BPMCounter;
+		dummy+=(mp_int64)adder;
+		BPMCounter=(mp_sint32)dummy;
+
+		// check overflow-carry
+		return (dummy>>32) != 0;
+	}
+
+	virtual mp_uint32 advanceTimer(mp_uint32 maxLength);
+
+	// the part of a snapshot PlayerBase and the mixer keep, stored in front of the state of the players
+	mp_sint32		storeState(PlayerSnapshot& snapshot, mp_sint32 numPlayerChannels) const;
+	mp_sint32		fetchState(PlayerSnapshot::Reader& reader, mp_sint32 numPlayerChannels);
 
 	mp_sint32		patternIndexToPlay;		// Play special pattern, -1 = Play entire song
 
@@ -196,6 +222,7 @@ class PlayerBase : public ChannelMixer, public PlayModeSettings
 
 	virtual mp_sint32 adjustFrequency(mp_uint32 frequency);
 	virtual mp_sint32 setBufferSize(mp_uint32 bufferSize);
+	virtual mp_sint32 setNumTimeRecordSlots(mp_uint32 numSlots);
 
 	void setPlayMode(PlayModes mode) { playMode = mode; }
 
@@ -216,6 +243,8 @@ class PlayerBase : public ChannelMixer, public PlayModeSettings
 	// runtime type identification
 	virtual PlayerTypes getType() const = 0;
 
+	XModule*		getModule() const { return module; }
+
 	// virtual from mixer class, perform playing here
 	virtual void timerHandler(mp_sint32 currentBeatPacket);
 
@@ -294,6 +323,19 @@ class PlayerBase : public ChannelMixer, public PlayModeSettings
 		ticker = (timeRecord[i].mainVolumeTicker >> TimeRecord::BITPOS_TICKER) & 255;
 	}
 
+	// Complete replay state including the mixer channels and effect memory, so
+	// playing continues exactly as if it had never stopped. A snapshot can
+	// only be taken between two beat packets and only be restored into a
+	// player of the same type which plays the same module with the same
+	// number of channels. The module must not have been edited in between.
+	// A failed restore leaves the player in an undefined state.
+	virtual mp_sint32		saveState(PlayerSnapshot& snapshot) const { return MP_UNSUPPORTED; }
+	virtual mp_sint32		restoreState(const PlayerSnapshot& snapshot) { return MP_UNSUPPORTED; }
+
+	// true if the next beat packet starts with the first tick of a row,
+	// snapshots taken now play the entire row
+	bool					isRowStartDue(mp_sint32& order, mp_sint32& row) const;
+
 	virtual mp_int64		getSyncCount() const { return synccnt; }
 	
 	virtual mp_uint32 		getSyncSampleCounter() const { return 0; }
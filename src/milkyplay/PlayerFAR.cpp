@@ -319,12 +319,7 @@ void PlayerFAR::timerHandler(mp_sint32 currentBeatPacket)
 
 	setActiveChannels(/*numChannels*/module->header.channum);	
 
-	mp_int64 dummy = (mp_int64)BPMCounter;
-	dummy+=(mp_int64)adder;
-	BPMCounter=(mp_sint32)dummy;
-	
-	// check overflow-carry 
-	if ((dummy>>32)) 
+	if (updateBPMCounter())
 	{
 		
 		mp_uword c,/*ov,*/m,q;
@@ -41,6 +41,7 @@
 #include "XModule.h"
 #include "AudioDriver_WAVWriter.h"
 #include "AudioDriverManager.h"
+#include "MilkyPlayThread.h"
 #include "PlayerBase.h"
 #include "PlayerSTD.h"
 #ifndef MILKYTRACKER
@@ -176,8 +177,13 @@ PlayerGeneric::PlayerGeneric(mp_sint32 frequency, AudioDriverInterface* audioDri
 	repeat = false;
 	resetOnStopFlag = false;
 	autoAdjustPeak = false;
+	exportFloatWAV = false;
 	disableMixing = false;
 	allowFilters = false;
+	sampleAccurateTicks = false;
+	numMixerThreads = 1;
+	numExportThreads = 1;
+	renderAheadBlocks = 0;
 #ifdef __FORCEPOWEROFTWOBUFFERSIZE__
 	compensateBufferFlag = true;
 #else
@@ -425,7 +431,7 @@ void PlayerGeneric::resetSampleCounter()
 mp_sint32 PlayerGeneric::getCurrentSamplePosition() const
 {
 	if (mixer && mixer->getAudioDriver())
-		return mixer->getAudioDriver()->getBufferPos();
+		return mixer->getCurrentSamplePosition();
 
 	return 0;
 }
@@ -552,6 +558,8 @@ mp_sint32 PlayerGeneric::startPlaying(XModule* module,
 			mixer->setCurrentAudioDriverByName(audioDriverName);
 	}
 
+	mixer->setRenderAhead(renderAheadBlocks);
+
 	if (!player || player->getType() != getPreferredPlayerType(module))
 	{
 		if (player)
@@ -579,6 +587,8 @@ mp_sint32 PlayerGeneric::startPlaying(XModule* module,
 
 			player->setDisableMixing(disableMixing);
 			player->setAllowFilters(allowFilters);
+			player->setSampleAccurateTicks(sampleAccurateTicks);
+			player->setNumMixerThreads(numMixerThreads);
 			//if (paused)
 			//	player->pausePlaying();
 
@@ -592,6 +602,7 @@ mp_sint32 PlayerGeneric::startPlaying(XModule* module,
 		if (!mixer->isDeviceRemoved(player))
 			mixer->removeDevice(player);
 
+		player->setNumTimeRecordSlots(mixer->getNumTimeRecordSlots());
 		player->startPlaying(module, repeat, startPosition, startRow, numChannels, customPanningTable, idle, patternIndex, playOneRowOnly);
 
 		mixer->addDevice(player);
@@ -705,6 +716,14 @@ void PlayerGeneric::setAllowFilters(bool b)
 		player->setAllowFilters(allowFilters);
 }
 
+void PlayerGeneric::setSampleAccurateTicks(bool b)
+{
+	sampleAccurateTicks = b;
+
+	if (player)
+		player->setSampleAccurateTicks(sampleAccurateTicks);
+}
+
 bool PlayerGeneric::getAllowFilters() const
 {
 	if (player)
@@ -713,6 +732,31 @@ bool PlayerGeneric::getAllowFilters() const
 	return allowFilters;
 }
 
+void PlayerGeneric::setNumMixerThreads(mp_uint32 num)
+{
+	numMixerThreads = num;
+
+	if (player)
+	{
+		// the thread pool can't be replaced while the player is being mixed
+		bool paused = mixer && mixer->isActive() && !mixer->isDeviceRemoved(player) &&
+					  !mixer->isDevicePaused(player) && mixer->pauseDevice(player);
+
+		player->setNumMixerThreads(numMixerThreads);
+
+		if (paused)
+			mixer->resumeDevice(player);
+	}
+}
+
+mp_uint32 PlayerGeneric::getNumMixerThreads() const
+{
+	if (player)
+		return player->getNumMixerThreads();
+
+	return numMixerThreads > 1 ? numMixerThreads : 1;
+}
+
 // volume control
 void PlayerGeneric::setMasterVolume(mp_sint32 vol)
 {
@@ -918,40 +962,11 @@ struct PeakAutoAdjustFilter : public Mixable
 	}
 };
 
-// export to 16bit stereo WAV
-mp_sint32 PlayerGeneric::exportToWAV(const SYSCHAR* fileName, XModule* module,
-									 mp_sint32 startOrder/* = 0*/, mp_sint32 endOrder/* = -1*/,
-									 const mp_ubyte* mutingArray/* = NULL*/, mp_uint32 mutingNumChannels/* = 0*/,
-									 const mp_ubyte* customPanningTable/* = NULL*/,
-									 AudioDriverBase* preferredDriver/* = NULL*/,
-									 mp_sint32* timingLUT/* = NULL*/)
+PlayerBase* PlayerGeneric::startExportPlayer(MasterMixer& mixer, XModule* module, mp_sint32 startOrder,
+											 const mp_ubyte* mutingArray, mp_uint32 mutingNumChannels,
+											 const mp_ubyte* customPanningTable, mp_uint32 numMixerThreads) const
 {
-	PlayerBase* player = NULL;
-
-	AudioDriverBase* wavWriter = preferredDriver;
-	bool isWAVWriterDriver = false;
-
-	if (wavWriter == NULL)
-	{
-		wavWriter = new WAVWriter(fileName);
-		isWAVWriterDriver = true;
-
-		if (!static_cast<WAVWriter*>(wavWriter)->isOpen())
-		{
-			delete wavWriter;
-			return MP_DEVICE_ERROR;
-		}
-	}
-
-	MasterMixer mixer(frequency, bufferSize, 1, wavWriter);
-	mixer.setSampleShift(sampleShift);
-	mixer.setDisableMixing(disableMixing);
-
-	player = getPreferredPlayer(module);
-
-	PeakAutoAdjustFilter filter;
-	if (autoAdjustPeak)
-		mixer.setFilterHook(&filter);
+	PlayerBase* player = getPreferredPlayer(module);
 
 	if (player)
 	{
@@ -963,6 +978,8 @@ mp_sint32 PlayerGeneric::exportToWAV(const SYSCHAR* fileName, XModule* module,
 		player->setPlayMode(playMode);
 		player->setDisableMixing(disableMixing);
 		player->setAllowFilters(allowFilters);
+		player->setSampleAccurateTicks(sampleAccurateTicks);
+		player->setNumMixerThreads(numMixerThreads);
 #ifndef MILKYTRACKER
 		if (player->getType() == PlayerBase::PlayerType_IT)
 		{
@@ -984,6 +1001,55 @@ mp_sint32 PlayerGeneric::exportToWAV(const SYSCHAR* fileName, XModule* module,
 		mixer.start();
 	}
 
+	return player;
+}
+
+bool PlayerGeneric::supportsDryRunExport(XModule* module) const
+{
+	// the filter state depends on the sample data, only the IT player uses filters
+	if (allowFilters && getPreferredPlayerType(module) == PlayerBase::PlayerType_IT)
+		return false;
+
+	PlayerBase* player = getPreferredPlayer(module);
+	if (player == NULL)
+		return false;
+
+	player->setResamplerType(resamplerType);
+
+	bool res = !disableMixing && player->supportsDryRun();
+
+	delete player;
+	return res;
+}
+
+mp_sint32 PlayerGeneric::exportToDriver(AudioDriverBase* driver, XModule* module,
+										mp_sint32 startOrder, mp_sint32 endOrder,
+										const mp_ubyte* mutingArray, mp_uint32 mutingNumChannels,
+										const mp_ubyte* customPanningTable,
+										mp_sint32* timingLUT, bool timingOnly,
+										PlayerSnapshotTable* snapshots/* = NULL*/)
+{
+	MasterMixer mixer(frequency, bufferSize, 1, driver);
+	mixer.setSampleShift(sampleShift);
+	mixer.setDisableMixing(disableMixing);
+
+	PeakAutoAdjustFilter filter;
+	if (autoAdjustPeak && !timingOnly)
+		mixer.setFilterHook(&filter);
+
+	PlayerBase* player = startExportPlayer(mixer, module, startOrder, mutingArray, mutingNumChannels, customPanningTable, numMixerThreads);
+
+	// nothing needs to be mixed for the timing if the player can do without
+	if (timingOnly)
+		player->setDryRun(true);
+
+	mp_uint32 nextSnapshotPos = 0;
+	if (snapshots)
+	{
+		snapshots->clear();
+		snapshots->setPlayerSettings(player->getType(), frequency);
+	}
+
 	if (endOrder == -1 || endOrder < startOrder || endOrder > module->header.ordnum - 1)
 		endOrder = module->header.ordnum - 1;
 
@@ -998,16 +1064,32 @@ mp_sint32 PlayerGeneric::exportToWAV(const SYSCHAR* fileName, XModule* module,
 
 	while (!player->hasSongHalted() && player->getOrder(0) <= endOrder)
 	{
-		wavWriter->advance();
+		driver->advance();
 
 		if (player->getOrder(0) != curOrderPos)
 		{
 #ifdef __VERBOSE__
-			printf("%f\n", (float)wavWriter->getNumPlayedSamples() / (float)getMixFrequency());
+			printf("%f\n", (float)driver->getNumPlayedSamples() / (float)getMixFrequency());
 #endif
 			curOrderPos = player->getOrder(0);
 			if (timingLUT && curOrderPos < module->header.ordnum && timingLUT[curOrderPos] == -1)
-				timingLUT[curOrderPos] = wavWriter->getNumPlayedSamples();
+				timingLUT[curOrderPos] = driver->getNumPlayedSamples();
+		}
+
+		if (snapshots && player->isBetweenBeatPackets() && driver->getNumPlayedSamples() >= nextSnapshotPos)
+		{
+			PlayerSnapshot* snapshot = snapshots->add();
+			if (player->saveState(*snapshot) == MP_OK)
+			{
+				snapshot->samplePos = driver->getNumPlayedSamples();
+				nextSnapshotPos = driver->getNumPlayedSamples() + frequency;
+			}
+			else
+			{
+				// the player can't take snapshots
+				snapshots->removeLast();
+				snapshots = NULL;
+			}
 		}
 	}
 
@@ -1019,15 +1101,321 @@ mp_sint32 PlayerGeneric::exportToWAV(const SYSCHAR* fileName, XModule* module,
 	// and trys to access the driver which is no longer existant
 	mixer.closeAudioDevice();
 
-	// Sync value
-	sampleShift = mixer.getSampleShift();
+	if (!timingOnly)
+	{
+		// Sync value
+		sampleShift = mixer.getSampleShift();
+		filter.mixerShift = sampleShift;
+		filter.calculateMasterVolume();
+		masterVolume = filter.masterVolume;
+	}
+
+	delete player;
+
+	return driver->getNumPlayedSamples();
+}
+
+/*
+ * Concurrent WAV export. The song is cut into parts at the order
+ * boundaries found by a dry run. Every worker plays the song with a
+ * player of its own: it dry runs up to the next unclaimed part (which
+ * leaves the player exactly where real mixing would), renders the part
+ * into memory and moves on. The calling thread writes the parts in order.
+ * The first dry run also takes player snapshots, a worker restores the
+ * last one in front of its part instead of dry running from where it is.
+ */
+struct ExportPart
+{
+	mp_uint32	start;		// in samples
+	mp_uint32	end;
+	mp_ubyte*	data;
+	bool		done;
+};
+
+struct ExportJob
+{
+	ExportPart*	parts;
+	mp_uint32	numParts;
+	mp_uint32	nextPart;		// next part to be claimed by a worker
+	mp_uint32	numWritten;
+	mp_uint32	maxPending;		// rendered but unwritten parts allowed in memory
+
+	const PlayerSnapshotTable* snapshots;
+
+	MPMutex		mutex;
+	MPCondition	doneCondition;
+	MPCondition	writtenCondition;
+};
+
+class ExportWorker : public MPThread
+{
+private:
+	ExportJob& job;
+
+protected:
+	virtual void run();
+
+public:
+	WAVMemoryWriter writer;
+	MasterMixer mixer;
+	PeakAutoAdjustFilter filter;
+	PlayerBase* player;
+
+	ExportWorker(ExportJob& job, mp_uint32 frequency, mp_uint32 bufferSize, bool floatFormat) :
+		job(job),
+		writer(floatFormat),
+		mixer(frequency, bufferSize, 1, &writer),
+		player(NULL)
+	{
+	}
+
+	virtual ~ExportWorker()
+	{
+		join();
+
+		if (player)
+			player->stopPlaying();
+
+		mixer.stop();
+		mixer.closeAudioDevice();
+
+		delete player;
+	}
+};
+
+void ExportWorker::run()
+{
+	for (;;)
+	{
+		job.mutex.lock();
+		while (job.nextPart < job.numParts && job.nextPart >= job.numWritten + job.maxPending)
+			job.writtenCondition.wait(job.mutex);
+
+		if (job.nextPart >= job.numParts)
+		{
+			job.mutex.unlock();
+			break;
+		}
+
+		ExportPart& part = job.parts[job.nextPart++];
+		job.mutex.unlock();
+
+		// beat packets are mixed as a whole and can reach into the next
+		// buffer, so stop dry running one beat packet ahead of the part
+		const mp_uint32 bufferSize = mixer.getBufferSize();
+		const mp_uint32 mixAhead = (player->getBeatPacketSize() + bufferSize - 1) / bufferSize * bufferSize;
+
+		if (part.start > mixAhead)
+		{
+			const mp_sint32 index = job.snapshots->findSnapshotBySamplePos(part.start - mixAhead);
+			if (index >= 0)
+			{
+				// snapshots are taken at buffer boundaries of the same size
+				const PlayerSnapshot& snapshot = *job.snapshots->getSnapshot(index);
+				if (snapshot.samplePos > writer.getNumPlayedSamples() && player->restoreState(snapshot) == MP_OK)
+					writer.setNumPlayedSamples((mp_uint32)snapshot.samplePos);
+			}
+		}
+
+		player->setDryRun(true);
+		while (writer.getNumPlayedSamples() + mixAhead < part.start)
+			writer.advance();
+		player->setDryRun(false);
+
+		while (writer.getNumPlayedSamples() < part.start)
+			writer.advance();
+
+		mp_ubyte* data = new mp_ubyte[(part.end - part.start) * writer.getBytesPerSample()];
+
+		writer.setOutput(data);
+		while (writer.getNumPlayedSamples() < part.end)
+			writer.advance();
+		writer.setOutput(NULL);
+
+		job.mutex.lock();
+		part.data = data;
+		part.done = true;
+		job.doneCondition.broadcast();
+		job.mutex.unlock();
+	}
+}
+
+static int compareSamplePositions(const void* a, const void* b)
+{
+	const mp_sint32 posA = *(const mp_sint32*)a;
+	const mp_sint32 posB = *(const mp_sint32*)b;
+
+	return posA < posB ? -1 : (posA > posB ? 1 : 0);
+}
+
+mp_sint32 PlayerGeneric::exportToWAVConcurrently(const SYSCHAR* fileName, XModule* module,
+												 mp_sint32 startOrder, mp_sint32 endOrder,
+												 const mp_ubyte* mutingArray, mp_uint32 mutingNumChannels,
+												 const mp_ubyte* customPanningTable,
+												 mp_sint32* timingLUT)
+{
+	const mp_sint32 numOrders = module->header.ordnum;
+
+	PlayerSnapshotTable snapshots;
+	AudioDriver_NULL nullDriver;
+
+	mp_sint32* orderTimes = new mp_sint32[numOrders];
+	const mp_sint32 numSamples = exportToDriver(&nullDriver, module, startOrder, endOrder, NULL, 0,
+												customPanningTable, orderTimes, true, &snapshots);
+
+	if (timingLUT)
+		memcpy(timingLUT, orderTimes, numOrders * sizeof(mp_sint32));
+
+	// the order boundaries are multiples of the buffer size, cut there
+	mp_sint32 numBoundaries = 0;
+	for (mp_sint32 i = 0; i < numOrders; i++)
+		if (orderTimes[i] > 0 && orderTimes[i] < numSamples)
+			orderTimes[numBoundaries++] = orderTimes[i];
+
+	qsort(orderTimes, numBoundaries, sizeof(mp_sint32), compareSamplePositions);
+
+	ExportJob job;
+	job.parts = new ExportPart[numBoundaries + 1];
+	job.numParts = 0;
+	job.nextPart = 0;
+	job.numWritten = 0;
+	job.maxPending = numExportThreads * 2;
+	job.snapshots = &snapshots;
+
+	mp_uint32 partStart = 0;
+	for (mp_sint32 i = 0; i <= numBoundaries; i++)
+	{
+		const mp_uint32 partEnd = i < numBoundaries ? orderTimes[i] : numSamples;
+		if (partEnd <= partStart)
+			continue;
+
+		ExportPart& part = job.parts[job.numParts++];
+		part.start = partStart;
+		part.end = partEnd;
+		part.data = NULL;
+		part.done = false;
+
+		partStart = partEnd;
+	}
+
+	delete[] orderTimes;
+
+	WAVWriter wavWriter(fileName, exportFloatWAV);
+	if (!wavWriter.isOpen())
+	{
+		delete[] job.parts;
+		return MP_DEVICE_ERROR;
+	}
+	// the header needs the sample rate
+	wavWriter.initDevice(bufferSize * MP_NUMCHANNELS, frequency, NULL);
+
+	ExportWorker** workers = new ExportWorker*[numExportThreads];
+	mp_uint32 numWorkers = 0;
+
+	for (mp_uint32 i = 0; i < numExportThreads; i++)
+	{
+		ExportWorker* worker = new ExportWorker(job, frequency, bufferSize, exportFloatWAV);
+		worker->mixer.setSampleShift(sampleShift);
+		worker->mixer.setDisableMixing(disableMixing);
+		if (autoAdjustPeak)
+			worker->mixer.setFilterHook(&worker->filter);
+
+		// players are set up here, the resamplers initialize shared tables
+		worker->player = startExportPlayer(worker->mixer, module, startOrder, mutingArray, mutingNumChannels, customPanningTable, 1);
+
+		if (worker->player == NULL || !worker->start())
+		{
+			delete worker;
+			break;
+		}
+		workers[numWorkers++] = worker;
+	}
+
+	// no threads on this platform
+	if (numWorkers == 0)
+	{
+		delete[] workers;
+		delete[] job.parts;
+		return MP_UNSUPPORTED;
+	}
+
+	for (mp_uint32 i = 0; i < job.numParts; i++)
+	{
+		ExportPart& part = job.parts[i];
+
+		job.mutex.lock();
+		while (!part.done)
+			job.doneCondition.wait(job.mutex);
+		job.mutex.unlock();
+
+		wavWriter.writeSamples(part.data, part.end - part.start);
+
+		delete[] part.data;
+		part.data = NULL;
+
+		job.mutex.lock();
+		job.numWritten++;
+		job.writtenCondition.broadcast();
+		job.mutex.unlock();
+	}
+
+	PeakAutoAdjustFilter filter;
+	for (mp_uint32 i = 0; i < numWorkers; i++)
+	{
+		if (workers[i]->filter.lastPeakValue > filter.lastPeakValue)
+			filter.lastPeakValue = workers[i]->filter.lastPeakValue;
+
+		// joins the thread
+		delete workers[i];
+	}
+	delete[] workers;
+	delete[] job.parts;
+
+	wavWriter.closeDevice();
+
+	// Sync value, like the sequential export
 	filter.mixerShift = sampleShift;
 	filter.calculateMasterVolume();
 	masterVolume = filter.masterVolume;
 
-	delete player;
+	return wavWriter.getNumPlayedSamples();
+}
 
-	mp_sint32 numWrittenSamples = wavWriter->getNumPlayedSamples();
+// export to 16bit (or 32bit float) stereo WAV
+mp_sint32 PlayerGeneric::exportToWAV(const SYSCHAR* fileName, XModule* module,
+									 mp_sint32 startOrder/* = 0*/, mp_sint32 endOrder/* = -1*/,
+									 const mp_ubyte* mutingArray/* = NULL*/, mp_uint32 mutingNumChannels/* = 0*/,
+									 const mp_ubyte* customPanningTable/* = NULL*/,
+									 AudioDriverBase* preferredDriver/* = NULL*/,
+									 mp_sint32* timingLUT/* = NULL*/)
+{
+	if (preferredDriver == NULL && numExportThreads > 1 && supportsDryRunExport(module))
+	{
+		mp_sint32 res = exportToWAVConcurrently(fileName, module, startOrder, endOrder,
+												mutingArray, mutingNumChannels, customPanningTable,
+												timingLUT);
+		if (res != MP_UNSUPPORTED)
+			return res;
+	}
+
+	AudioDriverBase* wavWriter = preferredDriver;
+	bool isWAVWriterDriver = false;
+
+	if (wavWriter == NULL)
+	{
+		wavWriter = new WAVWriter(fileName, exportFloatWAV);
+		isWAVWriterDriver = true;
+
+		if (!static_cast<WAVWriter*>(wavWriter)->isOpen())
+		{
+			delete wavWriter;
+			return MP_DEVICE_ERROR;
+		}
+	}
+
+	mp_sint32 numWrittenSamples = exportToDriver(wavWriter, module, startOrder, endOrder,
+												 mutingArray, mutingNumChannels, customPanningTable,
+												 timingLUT, false);
 
 	if (isWAVWriterDriver)
 		delete wavWriter;
@@ -1035,6 +1423,289 @@ mp_sint32 PlayerGeneric::exportToWAV(const SYSCHAR* fileName, XModule* module,
 	return numWrittenSamples;
 }
 
+mp_sint32 PlayerGeneric::calculateTimingLUT(XModule* module, mp_sint32* timingLUT,
+											mp_sint32 startOrder/* = 0*/, mp_sint32 endOrder/* = -1*/)
+{
+	AudioDriver_NULL nullDriver;
+
+	return exportToDriver(&nullDriver, module, startOrder, endOrder, NULL, 0, NULL, timingLUT, true);
+}
+
+mp_sint32 PlayerGeneric::calculateOrderTimings(XModule* module, OrderTiming* timings, mp_sint32 resumeOrder/* = -1*/)
+{
+	const mp_sint32 numOrders = module->header.ordnum;
+
+	if (resumeOrder >= numOrders || (resumeOrder >= 0 && timings[resumeOrder].samplePos < 0))
+		resumeOrder = -1;
+
+	// one beat packet per buffer, so a position is seen at the tick it is reached
+	const mp_uint32 timingBufferSize = ChannelMixer::beatPacketsToBufferSize(frequency, 1);
+
+	AudioDriver_NULL nullDriver;
+	MasterMixer mixer(frequency, timingBufferSize, 1, &nullDriver);
+	mixer.setDisableMixing(true);
+
+	PlayerBase* player = getPreferredPlayer(module);
+	if (player == NULL)
+		return MP_UNSUPPORTED;
+
+	player->adjustFrequency(frequency);
+	player->setBufferSize(timingBufferSize);
+	player->setPlayMode(playMode);
+	player->setDisableMixing(true);
+	mixer.addDevice(player);
+
+	mp_sint32 curOrderPos = 0;
+	mp_sint32 samplePosOffset = 0;
+
+	if (resumeOrder >= 0)
+	{
+		const OrderTiming& resume = timings[resumeOrder];
+
+		player->startPlaying(module, false, resumeOrder, resume.row, -1, NULL, false, -1);
+		player->setSpeed(resume.speed);
+		player->setTempo(resume.bpm);
+
+		curOrderPos = resumeOrder;
+		samplePosOffset = resume.samplePos - timingBufferSize;
+
+		for (mp_sint32 i = resumeOrder + 1; i < numOrders; i++)
+			timings[i].samplePos = -1;
+	}
+	else
+	{
+		player->startPlaying(module, false, 0, 0, -1, NULL, false, -1);
+
+		for (mp_sint32 i = 0; i < numOrders; i++)
+			timings[i].samplePos = -1;
+
+		timings[0].samplePos = 0;
+		timings[0].row = 0;
+		timings[0].speed = module->header.tempo;
+		timings[0].bpm = module->header.speed;
+	}
+
+	mixer.start();
+
+	while (!player->hasSongHalted() && player->getOrder(0) < numOrders)
+	{
+		nullDriver.advance();
+
+		if (player->getOrder(0) != curOrderPos)
+		{
+			curOrderPos = player->getOrder(0);
+			if (curOrderPos < numOrders && timings[curOrderPos].samplePos == -1)
+			{
+				OrderTiming& timing = timings[curOrderPos];
+
+				timing.samplePos = samplePosOffset + nullDriver.getNumPlayedSamples();
+				timing.row = player->getRow(0);
+				timing.speed = player->getSpeed(0);
+				timing.bpm = player->getTempo(0);
+			}
+		}
+	}
+
+	player->stopPlaying();
+
+	mixer.stop();
+	mixer.closeAudioDevice();
+
+	delete player;
+
+	return samplePosOffset + nullDriver.getNumPlayedSamples();
+}
+
+PlayerBase* PlayerGeneric::startSnapshotPlayer(MasterMixer& mixer, XModule* module,
+											   const mp_ubyte* customPanningTable) const
+{
+	PlayerBase* player = getPreferredPlayer(module);
+	if (player == NULL)
+		return NULL;
+
+	player->adjustFrequency(frequency);
+	player->resetMainVolumeOnStartPlay(resetMainVolumeOnStartPlayFlag);
+	player->setBufferSize(mixer.getBufferSize());
+	player->setResamplerType(resamplerType);
+	player->setMasterVolume(masterVolume);
+	player->setPanningSeparation(panningSeparation);
+	player->setPlayMode(playMode);
+
+	for (mp_sint32 i = PlayModeOptionFirst; i < PlayModeOptionLast; i++)
+		player->enable((PlayModeOptions)i, options[i]);
+
+	player->setAllowFilters(allowFilters);
+	player->setSampleAccurateTicks(sampleAccurateTicks);
+#ifndef MILKYTRACKER
+	if (player->getType() == PlayerBase::PlayerType_IT)
+	{
+		static_cast<PlayerIT*>(player)->setNumMaxVirChannels(numMaxVirChannels);
+	}
+#endif
+
+	// the filter state depends on the sample data, it must be mixed
+	if (!allowFilters || player->getType() != PlayerBase::PlayerType_IT)
+		player->setDryRun(true);
+
+	mixer.addDevice(player);
+	player->startPlaying(module, false, 0, 0, -1, customPanningTable, false, -1);
+	mixer.start();
+
+	return player;
+}
+
+mp_sint32 PlayerGeneric::captureSnapshots(XModule* module, PlayerSnapshotTable& table, mp_uint32 rowInterval/* = 16*/,
+										  const mp_ubyte* customPanningTable/* = NULL*/) const
+{
+	table.clear();
+
+	// ticks hardly ever end with a beat packet then
+	if (sampleAccurateTicks)
+		return MP_UNSUPPORTED;
+
+	if (rowInterval == 0)
+		rowInterval = 1;
+
+	AudioDriver_NULL nullDriver;
+	MasterMixer mixer(frequency, ChannelMixer::beatPacketsToBufferSize(frequency, 1), 1, &nullDriver);
+
+	PlayerBase* player = startSnapshotPlayer(mixer, module, customPanningTable);
+	if (player == NULL)
+		return MP_UNSUPPORTED;
+
+	table.setPlayerSettings(player->getType(), frequency);
+
+	const mp_sint32 numOrders = module->header.ordnum;
+
+	// one bit per order and row
+	mp_ubyte* visited = new mp_ubyte[(numOrders * 256 + 7) / 8];
+	memset(visited, 0, (numOrders * 256 + 7) / 8);
+
+	mp_sint32 res = MP_OK;
+	mp_sint32 lastOrder = -1, entryRow = 0;
+
+	while (!player->hasSongHalted() && player->getOrder(0) < numOrders)
+	{
+		mp_sint32 order, row;
+		if (player->isRowStartDue(order, row))
+		{
+			if (order != lastOrder)
+			{
+				lastOrder = order;
+				entryRow = row;
+			}
+
+			const mp_sint32 bit = order * 256 + row;
+			if (row >= entryRow && (row - entryRow) % rowInterval == 0 &&
+				!(visited[bit >> 3] & (1 << (bit & 7))))
+			{
+				visited[bit >> 3] |= 1 << (bit & 7);
+
+				PlayerSnapshot* snapshot = table.add();
+				res = player->saveState(*snapshot);
+				if (res != MP_OK)
+					break;
+
+				snapshot->samplePos = nullDriver.getNumPlayedSamples();
+			}
+		}
+
+		nullDriver.advance();
+	}
+
+	delete[] visited;
+
+	player->stopPlaying();
+
+	mixer.stop();
+	mixer.closeAudioDevice();
+
+	delete player;
+
+	if (res != MP_OK)
+		table.clear();
+
+	return res;
+}
+
+mp_sint32 PlayerGeneric::seek(const PlayerSnapshotTable& table, mp_uint32 pos, mp_uint32 row/* = 0*/)
+{
+	if (player == NULL)
+		return MP_UNSUPPORTED;
+
+	XModule* module = player->getModule();
+
+	mp_sint32 index = -1;
+	if (module && table.getPlayerType() == player->getType() && table.getFrequency() == frequency)
+		index = table.findSnapshot(pos, row);
+
+	if (index >= 0)
+	{
+		const PlayerSnapshot& snapshot = *table.getSnapshot(index);
+
+		if (snapshot.row == (mp_sint32)row && player->restoreState(snapshot) == MP_OK)
+			return MP_OK;
+
+		// play on from the snapshot in a player of its own until the row is reached
+		AudioDriver_NULL nullDriver;
+		MasterMixer mixer(frequency, ChannelMixer::beatPacketsToBufferSize(frequency, 1), 1, &nullDriver);
+
+		PlayerBase* seekPlayer = startSnapshotPlayer(mixer, module, NULL);
+
+		PlayerSnapshot target;
+		bool found = false;
+
+		if (seekPlayer && seekPlayer->restoreState(snapshot) == MP_OK)
+		{
+			// the row might never come, give up after a minute
+			for (mp_sint32 i = 0; i < 250*60 && !seekPlayer->hasSongHalted(); i++)
+			{
+				mp_sint32 curOrder, curRow;
+				if (seekPlayer->isRowStartDue(curOrder, curRow))
+				{
+					if (curOrder != (mp_sint32)pos)
+						break;
+
+					if (curRow == (mp_sint32)row)
+					{
+						found = seekPlayer->saveState(target) == MP_OK;
+						break;
+					}
+				}
+
+				nullDriver.advance();
+			}
+		}
+
+		if (seekPlayer)
+		{
+			seekPlayer->stopPlaying();
+			mixer.stop();
+			mixer.closeAudioDevice();
+			delete seekPlayer;
+		}
+
+		if (found && player->restoreState(target) == MP_OK)
+			return MP_OK;
+	}
+
+	player->setPatternPos(pos, row);
+
+	return MP_UNSUPPORTED;
+}
+
+mp_sint32 PlayerGeneric::exportToWAVStems(const SYSCHAR** fileNames, mp_uint32 numFileNames, XModule* module,
+										  mp_sint32 startOrder/* = 0*/, mp_sint32 endOrder/* = -1*/,
+										  const mp_ubyte* mutingArray/* = NULL*/, mp_uint32 mutingNumChannels/* = 0*/,
+										  const mp_ubyte* customPanningTable/* = NULL*/)
+{
+	WAVStemWriter stemWriter(fileNames, numFileNames, exportFloatWAV);
+	if (!stemWriter.isOpen())
+		return MP_DEVICE_ERROR;
+
+	return exportToWAV(NULL, module, startOrder, endOrder, mutingArray, mutingNumChannels, customPanningTable, &stemWriter);
+}
+
 bool PlayerGeneric::grabChannelInfo(mp_sint32 chn, TPlayerChannelInfo& channelInfo) const
 {
 	if (player)
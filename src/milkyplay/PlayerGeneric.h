@@ -85,6 +85,14 @@ class PlayerGeneric : public MixerSettings, public PlayModeSettings
 	bool				disableMixing;
 	// remember if filters are allowed
 	bool				allowFilters;
+	// remember if ticks start at the exact sample
+	bool				sampleAccurateTicks;
+	// remember number of mixer threads
+	mp_uint32			numMixerThreads;
+	// remember number of threads rendering WAV exports
+	mp_uint32			numExportThreads;
+	// remember number of buffers mixed ahead of the audio driver
+	mp_uint32			renderAheadBlocks;
 	// remember idle state
 	bool				idle;
 	// remember to play only one row
@@ -97,6 +105,8 @@ class PlayerGeneric : public MixerSettings, public PlayModeSettings
 	bool				resetMainVolumeOnStartPlayFlag;
 	// remember to auto adjust the peak
 	bool				autoAdjustPeak;
+	// remember to export 32 bit float WAVs
+	bool				exportFloatWAV;
 	// remember our mixer mastervolume
 	mp_sint32			masterVolume;
 	// remember our mixer panning separation
@@ -122,6 +132,49 @@ class PlayerGeneric : public MixerSettings, public PlayModeSettings
 	 */
 	PlayerBase*			getPreferredPlayer(XModule* module) const;
 
+	/**
+	 * Create a player for exporting a module and start it on a mixer
+	 * @return				the player instance which MUST be deleted after usage
+	 */
+	PlayerBase*			startExportPlayer(class MasterMixer& mixer, XModule* module, mp_sint32 startOrder,
+										  const mp_ubyte* mutingArray, mp_uint32 mutingNumChannels,
+										  const mp_ubyte* customPanningTable, mp_uint32 numMixerThreads) const;
+
+	/**
+	 * Tell if the module can be exported with dry runs, see ChannelMixer::setDryRun
+	 */
+	bool				supportsDryRunExport(XModule* module) const;
+
+	/**
+	 * Play the song through an audio driver, see exportToWAV
+	 * @param  timingOnly	dry run if possible and leave the settings alone
+	 * @param  snapshots	if not NULL, receives a snapshot about every second
+	 */
+	mp_sint32			exportToDriver(AudioDriverBase* driver, XModule* module,
+									   mp_sint32 startOrder, mp_sint32 endOrder,
+									   const mp_ubyte* mutingArray, mp_uint32 mutingNumChannels,
+									   const mp_ubyte* customPanningTable,
+									   mp_sint32* timingLUT, bool timingOnly,
+									   PlayerSnapshotTable* snapshots = NULL);
+
+	/**
+	 * Create a player which plays the song without output for taking and
+	 * replaying snapshots, it runs on a mixer with one beat packet per buffer
+	 * @return				the player instance which MUST be deleted after usage
+	 */
+	PlayerBase*			startSnapshotPlayer(class MasterMixer& mixer, XModule* module,
+											const mp_ubyte* customPanningTable) const;
+
+	/**
+	 * Export the song as WAV file with several threads, see setNumExportThreads
+	 * @return				MP_UNSUPPORTED if no threads could be started
+	 */
+	mp_sint32			exportToWAVConcurrently(const SYSCHAR* fileName, XModule* module,
+												mp_sint32 startOrder, mp_sint32 endOrder,
+												const mp_ubyte* mutingArray, mp_uint32 mutingNumChannels,
+												const mp_ubyte* customPanningTable,
+												mp_sint32* timingLUT);
+
 public:
 	/**
 	 * Construct a PlayerGeneric object for a given output frequency
@@ -178,6 +231,19 @@ class PlayerGeneric : public MixerSettings, public PlayModeSettings
 	 */
 	void				setPeakAutoAdjust(bool b);
 
+	/**
+	 * Write 32 bit float instead of 16 bit WAV files in exportToWAV.
+	 * Float output is taken from the mixer before clipping.
+	 * @param  b		true or false
+	 */
+	void				setExportFloatWAV(bool b) { exportFloatWAV = b; }
+
+	/**
+	 * Returns true if exportToWAV writes 32 bit float WAV files
+	 * @see				setExportFloatWAV
+	 */
+	bool				getExportFloatWAV() const { return exportFloatWAV; }
+
 	/**
 	 * Set the desired output frequency
 	 * It's up the the driver if the wanted frequency is possible or not
@@ -494,6 +560,70 @@ class PlayerGeneric : public MixerSettings, public PlayModeSettings
 	 */
 	bool				getAllowFilters() const;
 
+	/**
+	 * Start ticks at the exact sample instead of the next 1/250th of a second.
+	 * Off by default, which is how songs have always been played.
+	 * @param  b		true or false
+	 */
+	void				setSampleAccurateTicks(bool b);
+
+	/**
+	 * Query if ticks start at the exact sample
+	 * @return			true if ticks are sample accurate
+	 * @see				setSampleAccurateTicks
+	 */
+	bool				getSampleAccurateTicks() const { return sampleAccurateTicks; }
+
+	/**
+	 * Mix the channels with several threads.
+	 * The output is identical to mixing with a single thread,
+	 * this only pays off with many channels or expensive resamplers.
+	 * Also used by exportToWAV.
+	 * @param  num		number of threads, 0 or 1 mixes serially
+	 */
+	void				setNumMixerThreads(mp_uint32 num);
+
+	/**
+	 * Get the number of mixer threads.
+	 * @return			number of threads actually used, 1 when mixing serially
+	 * @see				setNumMixerThreads
+	 */
+	mp_uint32			getNumMixerThreads() const;
+
+	/**
+	 * Mix up to numBlocks buffers ahead in a thread of its own, the audio
+	 * driver callback then only copies them out.
+	 * Adds numBlocks buffers of latency, takes effect when playing starts.
+	 * @param  numBlocks	number of buffers, 0 mixes in the audio driver callback
+	 * @see				MasterMixer::setRenderAhead
+	 */
+	void				setRenderAhead(mp_uint32 numBlocks) { renderAheadBlocks = numBlocks; }
+
+	/**
+	 * Get the number of buffers mixed ahead.
+	 * @return			number of buffers, 0 when mixing in the audio driver callback
+	 * @see				setRenderAhead
+	 */
+	mp_uint32			getRenderAhead() const { return renderAheadBlocks; }
+
+	/**
+	 * Render WAV exports with several threads.
+	 * The song is cut into parts at order boundaries which are rendered
+	 * concurrently, the file is identical to a single threaded export.
+	 * Only used when exportToWAV writes the file itself and the
+	 * resampler and filter settings allow dry runs (see ChannelMixer::setDryRun),
+	 * otherwise the song is exported by a single thread.
+	 * @param  num		number of threads, 0 or 1 exports with a single thread
+	 */
+	void				setNumExportThreads(mp_uint32 num) { numExportThreads = num; }
+
+	/**
+	 * Get the number of threads used for exporting WAVs.
+	 * @return			number of threads
+	 * @see				setNumExportThreads
+	 */
+	mp_uint32			getNumExportThreads() const { return numExportThreads > 1 ? numExportThreads : 1; }
+
 	/**
 	 * Set master volume for the mixer
 	 * @param  vol		Master volume between 0 and 256
@@ -639,6 +769,95 @@ class PlayerGeneric : public MixerSettings, public PlayModeSettings
 									AudioDriverBase* preferredDriver = NULL,
 									mp_sint32* timingLUT = NULL);
 
+	/**
+	 * Play the song without mixing and fill in the timing LUT like exportToWAV
+	 * does. The channels still move along their samples, so the timing is exact
+	 * even when a song depends on samples running out.
+	 * @param  module				the module to play
+	 * @param  timingLUT			buffer with at least module->header.ordnum entries which will
+	 *										  hold the number of samples played up to each position
+	 *										  in the orderlist or -1 if it isn't reached
+	 * @param  startOrder			the start position within the order list of the song
+	 * @param  endOrder				the last order to be played
+	 * @return						number of samples exportToWAV would write
+	 */
+	mp_sint32			calculateTimingLUT(XModule* module, mp_sint32* timingLUT,
+										   mp_sint32 startOrder = 0, mp_sint32 endOrder = -1);
+
+	/**
+	 * Player state at the moment a position in the orderlist is reached first
+	 */
+	struct OrderTiming
+	{
+		mp_sint32		samplePos;		// samples played until then, -1 if it isn't reached
+		mp_sint32		row;			// row the position is entered at
+		mp_sint32		speed;			// ticks per row
+		mp_sint32		bpm;
+	};
+
+	/**
+	 * Play the song with mixing disabled and record when and how every position
+	 * in the orderlist is reached. Pattern loops don't survive a change of the
+	 * position, so an entry holds all it takes to play on from there. With a
+	 * resumeOrder playing starts at that position with the state of its entry,
+	 * the entries before are kept and the ones after are recalculated.
+	 * Resuming assumes every position before resumeOrder has been played and
+	 * none after it, the times after resuming can be off by a few milliseconds.
+	 * @param  module				the module to play
+	 * @param  timings				module->header.ordnum entries
+	 * @param  resumeOrder			the position to resume at or -1 to play the whole song
+	 * @return						number of samples until the song ends
+	 */
+	mp_sint32			calculateOrderTimings(XModule* module, OrderTiming* timings, mp_sint32 resumeOrder = -1);
+
+	/**
+	 * Play the song once without output and take a snapshot of the entire
+	 * player state (see PlayerBase::saveState) at the row an order position is
+	 * entered at and every rowInterval rows after it. Positions which are played
+	 * again are only recorded the first time. The song being played is left
+	 * alone, so this can run in a thread of its own. The snapshots can't be
+	 * used anymore once the module has been changed.
+	 * @param  module				the module
+	 * @param  table				receives the snapshots
+	 * @param  rowInterval			rows between two snapshots
+	 * @param  customPanningTable	the panning table the song is played with
+	 * @return						MP_OK or MP_UNSUPPORTED if the player can't take snapshots
+	 */
+	mp_sint32			captureSnapshots(XModule* module, PlayerSnapshotTable& table, mp_uint32 rowInterval = 16,
+										 const mp_ubyte* customPanningTable = NULL) const;
+
+	/**
+	 * Jump to a position like setPatternPos, but with everything the song did
+	 * until then (tempo, global volume, effect memory, envelopes, NNA voices):
+	 * the snapshot closest in front of the row is restored and the rows in
+	 * between are played without output. Without a fitting snapshot this
+	 * falls back to setPatternPos.
+	 * @param  table		snapshots of the song being played, see captureSnapshots
+	 * @param  pos			new order position
+	 * @param  row			new row
+	 * @return				MP_OK or MP_UNSUPPORTED if setPatternPos was used
+	 */
+	mp_sint32			seek(const PlayerSnapshotTable& table, mp_uint32 pos, mp_uint32 row = 0);
+
+	/**
+	 * Export every channel of the song as a WAV file of its own in a single pass.
+	 * Each file is identical to an exportToWAV with all other channels muted.
+	 * @param  fileNames			one file name per channel, NULL skips the channel
+	 * @param  numFileNames			number of entries in fileNames
+	 * @param  module				the module to export
+	 * @param  startOrder			the start position within the order list of the song
+	 * @param  endOrder				the last order to be played
+	 * @param  mutingArray			optional: an array telling which channels to mute
+	 * @param  mutingNumChannels	optional: many channels does the muting array contain?
+	 * @param  customPanningTable	When specifying a custom panning table the panning default from the module is ignored
+	 * @return						number of samples written to each file or MP_DEVICE_ERROR
+	 */
+	mp_sint32			exportToWAVStems(const SYSCHAR** fileNames, mp_uint32 numFileNames,
+										 XModule* module,
+										 mp_sint32 startOrder = 0, mp_sint32 endOrder = -1,
+										 const mp_ubyte* mutingArray = NULL, mp_uint32 mutingNumChannels = 0,
+										 const mp_ubyte* customPanningTable = NULL);
+
 	/**
 	 * Grab current channel data from a module channel
 	 * @param  chn					the channel index to grab the data from
@@ -324,12 +324,7 @@ void PlayerIT::timerHandler(mp_sint32 currentBeatPacket)
 	// get current maximum virtual channels
 	mp_sint32 oldMaxVirChannels = curMaxVirChannels;
 
-	mp_int64 dummy = (mp_int64)BPMCounter;
-	dummy+=(mp_int64)adder;
-	BPMCounter=(mp_sint32)dummy;
-	
-	// check overflow-carry 
-	if ((dummy>>32)) 
+	if (updateBPMCounter())
 	{
 		tickhandler();
 	}
@@ -466,6 +461,163 @@ void PlayerIT::freeMemory()
 	}
 }
 
+// envelopes are stored as references into the module
+static const mp_sint32 NUMENVELOPES = 5;
+
+#define GETENVELOPES(state) \
+	{&(state).venv, &(state).penv, &(state).fenv, &(state).vibenv, &(state).pitchenv}
+
+mp_sint32 PlayerIT::saveState(PlayerSnapshot& snapshot) const
+{
+	if (chninfo == NULL || vchninfo == NULL)
+		return MP_UNSUPPORTED;
+
+	mp_sint32 res = storeState(snapshot, numVirtualChannels);
+	if (res != MP_OK)
+		return res;
+
+	mp_sint32 i, j;
+	for (i = 0; i < numModuleChannels; i++)
+	{
+		TModuleChannel& src = chninfo[i];
+		TPrEnv* srcEnvs[NUMENVELOPES] = GETENVELOPES(src.getRealState());
+
+		TModuleChannel* chn = (TModuleChannel*)snapshot.writeStruct(&src, sizeof(TModuleChannel));
+		TPrEnv* envs[NUMENVELOPES] = GETENVELOPES(chn->getRealState());
+		for (j = 0; j < NUMENVELOPES; j++)
+			envs[j]->envstruc = NULL;
+		chn->setVchn(NULL);
+
+		for (j = 0; j < NUMENVELOPES; j++)
+			if (!snapshot.writeEnvelope(module, srcEnvs[j]->envstruc))
+				return MP_UNSUPPORTED;
+
+		// links between the channels are stored as indices
+		snapshot.write((mp_sint32)(src.hasVchn() ? src.getVchn() - vchninfo : -1));
+	}
+
+	for (i = 0; i < numVirtualChannels; i++)
+	{
+		TVirtualChannel& src = vchninfo[i];
+		TPrEnv* srcEnvs[NUMENVELOPES] = GETENVELOPES(src.getRealState());
+
+		TVirtualChannel* vchn = (TVirtualChannel*)snapshot.writeStruct(&src, sizeof(TVirtualChannel));
+		TPrEnv* envs[NUMENVELOPES] = GETENVELOPES(vchn->getRealState());
+		for (j = 0; j < NUMENVELOPES; j++)
+			envs[j]->envstruc = NULL;
+		vchn->setHost(NULL);
+		vchn->setOldHost(NULL);
+
+		for (j = 0; j < NUMENVELOPES; j++)
+			if (!snapshot.writeEnvelope(module, srcEnvs[j]->envstruc))
+				return MP_UNSUPPORTED;
+
+		snapshot.write((mp_sint32)(src.getHost() ? src.getHost() - chninfo : -1));
+		snapshot.write((mp_sint32)(src.getOldHost() ? src.getOldHost() - chninfo : -1));
+	}
+
+	snapshot.write(attick, sizeof(mp_ubyte)*numModuleChannels);
+
+	snapshot.write(patternIndex);
+	snapshot.write(numEffects);
+	snapshot.write(numChannels);
+	snapshot.write(curMaxVirChannels);
+	snapshot.write(pbreak);
+	snapshot.write(pbreakpos);
+	snapshot.write(pbreakPriority);
+	snapshot.write(pjump);
+	snapshot.write(pjumppos);
+	snapshot.write(pjumprow);
+	snapshot.write(pjumpPriority);
+	snapshot.write(patDelay);
+	snapshot.write(haltFlag);
+	snapshot.write(startNextRow);
+	snapshot.write(patDelayCount);
+	snapshot.write(rowHits, sizeof(rowHits));
+	snapshot.write(isLooping);
+
+	return MP_OK;
+}
+
+mp_sint32 PlayerIT::restoreState(const PlayerSnapshot& snapshot)
+{
+	if (chninfo == NULL || vchninfo == NULL)
+		return MP_UNSUPPORTED;
+
+	PlayerSnapshot::Reader reader(snapshot, module);
+
+	mp_sint32 res = fetchState(reader, numVirtualChannels);
+	if (res != MP_OK)
+		return res;
+
+	mp_sint32 i, j, index;
+	for (i = 0; i < numModuleChannels; i++)
+	{
+		const void* src = reader.readStruct(sizeof(TModuleChannel));
+		if (src == NULL)
+			return MP_UNSUPPORTED;
+
+		TModuleChannel& chn = chninfo[i];
+		memcpy((void*)&chn, src, sizeof(TModuleChannel));
+
+		TPrEnv* envs[NUMENVELOPES] = GETENVELOPES(chn.getRealState());
+		for (j = 0; j < NUMENVELOPES; j++)
+			if (!reader.readEnvelope(envs[j]->envstruc))
+				return MP_UNSUPPORTED;
+
+		if (!reader.read(index) || index >= numVirtualChannels)
+			return MP_UNSUPPORTED;
+		chn.setVchn(index >= 0 ? vchninfo + index : NULL);
+	}
+
+	for (i = 0; i < numVirtualChannels; i++)
+	{
+		const void* src = reader.readStruct(sizeof(TVirtualChannel));
+		if (src == NULL)
+			return MP_UNSUPPORTED;
+
+		TVirtualChannel& vchn = vchninfo[i];
+		memcpy((void*)&vchn, src, sizeof(TVirtualChannel));
+
+		TPrEnv* envs[NUMENVELOPES] = GETENVELOPES(vchn.getRealState());
+		for (j = 0; j < NUMENVELOPES; j++)
+			if (!reader.readEnvelope(envs[j]->envstruc))
+				return MP_UNSUPPORTED;
+
+		if (!reader.read(index) || index >= numModuleChannels)
+			return MP_UNSUPPORTED;
+		vchn.setHost(index >= 0 ? chninfo + index : NULL);
+
+		if (!reader.read(index) || index >= numModuleChannels)
+			return MP_UNSUPPORTED;
+		vchn.setOldHost(index >= 0 ? chninfo + index : NULL);
+	}
+
+	bool complete = reader.read(attick, sizeof(mp_ubyte)*numModuleChannels) &&
+		reader.read(patternIndex) &&
+		reader.read(numEffects) &&
+		reader.read(numChannels) &&
+		reader.read(curMaxVirChannels) &&
+		reader.read(pbreak) &&
+		reader.read(pbreakpos) &&
+		reader.read(pbreakPriority) &&
+		reader.read(pjump) &&
+		reader.read(pjumppos) &&
+		reader.read(pjumprow) &&
+		reader.read(pjumpPriority) &&
+		reader.read(patDelay) &&
+		reader.read(haltFlag) &&
+		reader.read(startNextRow) &&
+		reader.read(patDelayCount) &&
+		reader.read(rowHits, sizeof(rowHits)) &&
+		reader.read(isLooping) &&
+		reader.isComplete();
+
+	return complete ? MP_OK : MP_UNSUPPORTED;
+}
+
+#undef GETENVELOPES
+
 ///////////////////////////////////////////////////////////////////////////////////
 //					 controlling current song position                           //
 ///////////////////////////////////////////////////////////////////////////////////
@@ -1042,12 +1194,13 @@ void PlayerIT::playInstrument(TModuleChannel* chnInf, bool bNoRestart/* = false*
 	if (chn < 0 || !ins || ins > module->header.insnum)
 		return;
 
-	if (module->instr[ins-1].samp && smp != -1)
+	// a lazily loaded sample which isn't decoded yet stays silent
+	if (module->instr[ins-1].samp && smp != -1 && module->isSampleReady(smp))
 	{
 		chnInf->resetFlag(CHANNEL_FLAGS_UPDATE_IGNORE);
 		
 		const mp_sint32 i = smp;
-		
+
 		// start out with the flags for 16bit sample
 		mp_sint32 flags = ((module->smp[i].type&16)>>4)<<2;
 		// add looping + backward flags
@@ -2889,6 +3042,8 @@ void PlayerIT::triggerInstrumentFX(TModuleChannel* chnInf, bool triggerEnv/* = t
 
 void PlayerIT::progressRow()
 {
+	module->setPlayPosition(poscnt, patternIndex, rowcnt);
+
 	mp_sint32 slotsize = (numEffects*2)+2;
 
 	TXMPattern* pattern = &module->phead[patternIndex];
@@ -394,6 +394,9 @@ class PlayerIT : public PlayerBase
 			return result;
 		}
 
+		// restoring a snapshot only, see linkVchn for playing
+		void		setVchn(TVirtualChannel* vchn) { this->vchn = vchn; }
+
 		mp_sint32	getPlaybackChannelIndex() { return ((vchn == NULL) ? -1 : vchn->getChannelIndex()); }
 	
 		DEFINE_STATINTERFACE
@@ -748,6 +751,12 @@ class PlayerIT : public PlayerBase
 
 	virtual void	resetAllSpeed();
 
+	virtual mp_sint32 saveState(PlayerSnapshot& snapshot) const;
+	virtual mp_sint32 restoreState(const PlayerSnapshot& snapshot);
+
+	// the timer has to follow at once
+	virtual void	setTempo(mp_sint32 tempo) { PlayerBase::setTempo(tempo); adder = getbpmrate(tempo); }
+
 	virtual bool	grabChannelInfo(mp_sint32 chn, TPlayerChannelInfo& channelInfo) const;
 
 	mp_sint32		getCurMaxVirChannels() const { return curMaxVirChannels; }	
@@ -244,7 +244,7 @@ PlayerSTD::~PlayerSTD()
 
 mp_sint32 PlayerSTD::adjustFrequency(mp_uint32 frequency)
 {
-	mp_uint32 lastNumBeatPackets = getNumBeatPackets()+1;
+	mp_uint32 lastNumTimeRecords = getNumTimeRecords();
 
 	mp_sint32 res = PlayerBase::adjustFrequency(frequency);
 
@@ -252,7 +252,7 @@ mp_sint32 PlayerSTD::adjustFrequency(mp_uint32 frequency)
 		return res;
 
 	// nothing has changed
-	if (lastNumBeatPackets == getNumBeatPackets()+1)
+	if (lastNumTimeRecords == getNumTimeRecords())
 		return MP_OK;
 
 	res = allocateStructures();
@@ -262,7 +262,7 @@ mp_sint32 PlayerSTD::adjustFrequency(mp_uint32 frequency)
 
 mp_sint32 PlayerSTD::setBufferSize(mp_uint32 bufferSize)
 {
-	mp_uint32 lastNumBeatPackets = getNumBeatPackets()+1;
+	mp_uint32 lastNumTimeRecords = getNumTimeRecords();
 
 	mp_sint32 res = PlayerBase::setBufferSize(bufferSize);
 
@@ -270,7 +270,25 @@ mp_sint32 PlayerSTD::setBufferSize(mp_uint32 bufferSize)
 		return res;
 
 	// nothing has changed
-	if (lastNumBeatPackets == getNumBeatPackets()+1)
+	if (lastNumTimeRecords == getNumTimeRecords())
+		return MP_OK;
+
+	res = allocateStructures();
+
+	return res;
+}
+
+mp_sint32 PlayerSTD::setNumTimeRecordSlots(mp_uint32 numSlots)
+{
+	mp_uint32 lastNumTimeRecords = getNumTimeRecords();
+
+	mp_sint32 res = PlayerBase::setNumTimeRecordSlots(numSlots);
+
+	if (res < 0)
+		return res;
+
+	// nothing has changed
+	if (lastNumTimeRecords == getNumTimeRecords())
 		return MP_OK;
 
 	res = allocateStructures();
@@ -288,12 +306,7 @@ void PlayerSTD::timerHandler(mp_sint32 currentBeatPacket)
 	if (statusEventListener)
 		statusEventListener->timerTickStarted(*this, *module);
 
-	mp_int64 dummy = (mp_int64)BPMCounter;
-	dummy+=(mp_int64)adder;
-	BPMCounter=(mp_sint32)dummy;
-
-	// check overflow-carry
-	if ((dummy>>32))
+	if (updateBPMCounter())
 	{
 #ifdef MILKYTRACKER
 		setActiveChannels(initialNumChannels);
@@ -430,7 +443,7 @@ mp_sint32 PlayerSTD::allocateStructures()
 
 #ifdef MILKYTRACKER
 	for (mp_sint32 i = 0; i < initialNumChannels; i++)
-		chninfo[i].reallocTimeRecord(getNumBeatPackets()+1);
+		chninfo[i].reallocTimeRecord(getNumTimeRecords());
 #endif
 
 	return MP_OK;
@@ -456,6 +469,122 @@ void PlayerSTD::freeMemory()
 	}
 }
 
+mp_sint32 PlayerSTD::saveState(PlayerSnapshot& snapshot) const
+{
+	if (chninfo == NULL)
+		return MP_UNSUPPORTED;
+
+	mp_sint32 res = storeState(snapshot, initialNumChannels);
+	if (res != MP_OK)
+		return res;
+
+	for (mp_sint32 i = 0; i < initialNumChannels; i++)
+	{
+		TModuleChannel& src = chninfo[i];
+		TPrEnv* srcEnvs[4] = {&src.venv, &src.penv, &src.fenv, &src.vibenv};
+
+		// envelopes are stored as references into the module, the time records stay with the player
+		TModuleChannel* chn = (TModuleChannel*)snapshot.writeStruct(&src, sizeof(TModuleChannel));
+		TPrEnv* envs[4] = {&chn->venv, &chn->penv, &chn->fenv, &chn->vibenv};
+		for (mp_sint32 j = 0; j < 4; j++)
+		{
+			envs[j]->envstruc = NULL;
+			envs[j]->timeTrackSize = 0;
+			envs[j]->timeRecord = NULL;
+		}
+
+		for (mp_sint32 j = 0; j < 4; j++)
+			if (!snapshot.writeEnvelope(module, srcEnvs[j]->envstruc))
+				return MP_UNSUPPORTED;
+	}
+
+	snapshot.write(smpoffs, sizeof(mp_uint32)*initialNumChannels);
+	snapshot.write(attick, sizeof(mp_ubyte)*initialNumChannels);
+
+	snapshot.write(patternIndex);
+	snapshot.write(numEffects);
+	snapshot.write(numChannels);
+	snapshot.write(pbreak);
+	snapshot.write(pbreakpos);
+	snapshot.write(pbreakPriority);
+	snapshot.write(pjump);
+	snapshot.write(pjumppos);
+	snapshot.write(pjumprow);
+	snapshot.write(pjumpPriority);
+	snapshot.write(patDelay);
+	snapshot.write(haltFlag);
+	snapshot.write(startNextRow);
+	snapshot.write(patDelayCount);
+	snapshot.write(rowHits, sizeof(rowHits));
+	snapshot.write(isLooping);
+
+	return MP_OK;
+}
+
+mp_sint32 PlayerSTD::restoreState(const PlayerSnapshot& snapshot)
+{
+	if (chninfo == NULL)
+		return MP_UNSUPPORTED;
+
+	PlayerSnapshot::Reader reader(snapshot, module);
+
+	mp_sint32 res = fetchState(reader, initialNumChannels);
+	if (res != MP_OK)
+		return res;
+
+	for (mp_sint32 i = 0; i < initialNumChannels; i++)
+	{
+		const void* src = reader.readStruct(sizeof(TModuleChannel));
+		if (src == NULL)
+			return MP_UNSUPPORTED;
+
+		TModuleChannel& chn = chninfo[i];
+		TPrEnv* envs[4] = {&chn.venv, &chn.penv, &chn.fenv, &chn.vibenv};
+
+		mp_uint32 timeTrackSizes[4];
+		TPrEnv::TTimeRecord* timeRecords[4];
+		mp_sint32 j;
+		for (j = 0; j < 4; j++)
+		{
+			timeTrackSizes[j] = envs[j]->timeTrackSize;
+			timeRecords[j] = envs[j]->timeRecord;
+		}
+
+		memcpy((void*)&chn, src, sizeof(TModuleChannel));
+
+		for (j = 0; j < 4; j++)
+		{
+			envs[j]->timeTrackSize = timeTrackSizes[j];
+			envs[j]->timeRecord = timeRecords[j];
+
+			if (!reader.readEnvelope(envs[j]->envstruc))
+				return MP_UNSUPPORTED;
+		}
+	}
+
+	bool complete = reader.read(smpoffs, sizeof(mp_uint32)*initialNumChannels) &&
+		reader.read(attick, sizeof(mp_ubyte)*initialNumChannels) &&
+		reader.read(patternIndex) &&
+		reader.read(numEffects) &&
+		reader.read(numChannels) &&
+		reader.read(pbreak) &&
+		reader.read(pbreakpos) &&
+		reader.read(pbreakPriority) &&
+		reader.read(pjump) &&
+		reader.read(pjumppos) &&
+		reader.read(pjumprow) &&
+		reader.read(pjumpPriority) &&
+		reader.read(patDelay) &&
+		reader.read(haltFlag) &&
+		reader.read(startNextRow) &&
+		reader.read(patDelayCount) &&
+		reader.read(rowHits, sizeof(rowHits)) &&
+		reader.read(isLooping) &&
+		reader.isComplete();
+
+	return complete ? MP_OK : MP_UNSUPPORTED;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////
 //					 controlling current song position                           //
 ///////////////////////////////////////////////////////////////////////////////////
@@ -606,7 +735,8 @@ mp_sint32 PlayerSTD::getfinalperiod(mp_sint32 c,mp_sint32 p)
 void PlayerSTD::playInstrument(mp_sint32 chn, TModuleChannel* chnInf, bool bNoRestart/* = false*/)
 {
 	if (chnInf->ins && chnInf->ins <= module->header.insnum) {
-		if (module->instr[chnInf->ins-1].samp && chnInf->smp != -1)
+		// a lazily loaded sample which isn't decoded yet stays silent
+		if (module->instr[chnInf->ins-1].samp && chnInf->smp != -1 && module->isSampleReady(chnInf->smp))
 		{
 			chnInf->flags &= ~CHANNEL_FLAGS_UPDATE_IGNORE;
 
@@ -2234,6 +2364,8 @@ void PlayerSTD::triggerInstrumentFX(TModuleChannel* chnInf)
 
 void PlayerSTD::progressRow()
 {
+	module->setPlayPosition(poscnt, patternIndex, rowcnt);
+
 	mp_sint32 slotsize = (numEffects*2)+2;
 
 	TXMPattern* pattern = &module->phead[patternIndex];
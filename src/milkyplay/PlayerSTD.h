@@ -463,6 +463,7 @@ class PlayerSTD : public PlayerBase
 
 	virtual mp_sint32 adjustFrequency(mp_uint32 frequency);
 	virtual mp_sint32 setBufferSize(mp_uint32 bufferSize);
+	virtual mp_sint32 setNumTimeRecordSlots(mp_uint32 numSlots);
 
 	// virtual from mixer class, perform playing here
 	virtual void	timerHandler(mp_sint32 currentBeatPacket);
@@ -476,6 +477,12 @@ class PlayerSTD : public PlayerBase
 
 	virtual void	resetAllSpeed();
 
+	virtual mp_sint32 saveState(PlayerSnapshot& snapshot) const;
+	virtual mp_sint32 restoreState(const PlayerSnapshot& snapshot);
+
+	// the timer has to follow at once
+	virtual void	setTempo(mp_sint32 tempo) { PlayerBase::setTempo(tempo); adder = getbpmrate(tempo); }
+
 	virtual bool	grabChannelInfo(mp_sint32 chn, TPlayerChannelInfo& channelInfo) const;
 
 	// milkytracker
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2026, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  PlayerSnapshot.cpp
+ *  MilkyPlay
+ *
+ */
+#include "PlayerSnapshot.h"
+#include "XModule.h"
+
+// samples are stored as the sample index and the byte offset into it
+static mp_uint32 getSampleSizeInBytes(const TXMSample& smp)
+{
+	return (smp.type & 16) ? smp.samplen * 2 : smp.samplen;
+}
+
+// structures are stored at multiples of 8 bytes
+static inline mp_uint32 alignStruct(mp_uint32 pos)
+{
+	return (pos + 7) & ~7;
+}
+
+enum
+{
+	ENVELOPE_VOLUME,
+	ENVELOPE_PANNING,
+	ENVELOPE_FREQUENCY,
+	ENVELOPE_VIBRATO,
+	ENVELOPE_PITCH,
+	NUMENVELOPETYPES
+};
+
+static TEnvelope* getEnvelopes(const XModule* module, mp_sint32 type, mp_uint32& num)
+{
+	switch (type)
+	{
+		case ENVELOPE_VOLUME:
+			num = module->numVEnvs;
+			return module->venvs;
+		case ENVELOPE_PANNING:
+			num = module->numPEnvs;
+			return module->penvs;
+		case ENVELOPE_FREQUENCY:
+			num = module->numFEnvs;
+			return module->fenvs;
+		case ENVELOPE_VIBRATO:
+			num = module->numVibEnvs;
+			return module->vibenvs;
+		case ENVELOPE_PITCH:
+			num = module->numPitchEnvs;
+			return module->pitchenvs;
+	}
+
+	num = 0;
+	return NULL;
+}
+
+bool PlayerSnapshot::Reader::read(void* dst, mp_uint32 len)
+{
+	if (len > snapshot.size - pos)
+		return false;
+
+	memcpy(dst, snapshot.data + pos, len);
+	pos+=len;
+	return true;
+}
+
+const void* PlayerSnapshot::Reader::readStruct(mp_uint32 len)
+{
+	const mp_uint32 start = alignStruct(pos);
+	if (start > snapshot.size || len > snapshot.size - start)
+		return NULL;
+
+	pos = start + len;
+	return snapshot.data + start;
+}
+
+bool PlayerSnapshot::Reader::readSample(const mp_sbyte*& sample)
+{
+	mp_sint32 index;
+	mp_uint32 offset;
+	if (!read(index) || !read(offset))
+		return false;
+
+	if (index < 0)
+	{
+		sample = NULL;
+		return true;
+	}
+
+	if (index >= MP_MAXSAMPLES || module->smp[index].sample == NULL ||
+		offset >= getSampleSizeInBytes(module->smp[index]))
+		return false;
+
+	sample = module->smp[index].sample + offset;
+	return true;
+}
+
+bool PlayerSnapshot::Reader::readEnvelope(TEnvelope*& envelope)
+{
+	mp_sint32 type, index;
+	if (!read(type) || !read(index))
+		return false;
+
+	if (type < 0)
+	{
+		envelope = NULL;
+		return true;
+	}
+
+	mp_uint32 num;
+	TEnvelope* envs = getEnvelopes(module, type, num);
+	if (envs == NULL || index < 0 || (mp_uint32)index >= num)
+		return false;
+
+	envelope = envs + index;
+	return true;
+}
+
+PlayerSnapshot::PlayerSnapshot() :
+	data(NULL),
+	size(0),
+	capacity(0),
+	order(0),
+	row(0),
+	samplePos(0)
+{
+}
+
+PlayerSnapshot::~PlayerSnapshot()
+{
+	delete[] data;
+}
+
+void PlayerSnapshot::write(const void* src, mp_uint32 len)
+{
+	if (!len)
+		return;
+
+	if (size + len > capacity)
+	{
+		mp_uint32 newCapacity = capacity ? capacity * 2 : 4096;
+		while (newCapacity < size + len)
+			newCapacity*=2;
+
+		mp_ubyte* newData = new mp_ubyte[newCapacity];
+		if (size)
+			memcpy(newData, data, size);
+		delete[] data;
+
+		data = newData;
+		capacity = newCapacity;
+	}
+
+	memcpy(data + size, src, len);
+	size+=len;
+}
+
+void* PlayerSnapshot::writeStruct(const void* src, mp_uint32 len)
+{
+	static const mp_ubyte padding[8] = {0};
+
+	const mp_uint32 start = alignStruct(size);
+	write(padding, start - size);
+	write(src, len);
+
+	return data + start;
+}
+
+bool PlayerSnapshot::writeSample(const XModule* module, const mp_sbyte* sample)
+{
+	mp_sint32 index = -1;
+	mp_uint32 offset = 0;
+
+	if (sample)
+	{
+		for (mp_sint32 i = 0; i < MP_MAXSAMPLES; i++)
+		{
+			const TXMSample& smp = module->smp[i];
+			if (smp.sample && sample >= smp.sample && sample < smp.sample + getSampleSizeInBytes(smp))
+			{
+				index = i;
+				offset = (mp_uint32)(sample - smp.sample);
+				break;
+			}
+		}
+
+		if (index < 0)
+			return false;
+	}
+
+	write(index);
+	write(offset);
+	return true;
+}
+
+bool PlayerSnapshot::writeEnvelope(const XModule* module, const TEnvelope* envelope)
+{
+	mp_sint32 type = -1;
+	mp_sint32 index = 0;
+
+	if (envelope)
+	{
+		for (mp_sint32 i = 0; i < NUMENVELOPETYPES && type < 0; i++)
+		{
+			mp_uint32 num;
+			const TEnvelope* envs = getEnvelopes(module, i, num);
+			if (envs && envelope >= envs && envelope < envs + num)
+			{
+				type = i;
+				index = (mp_sint32)(envelope - envs);
+			}
+		}
+
+		if (type < 0)
+			return false;
+	}
+
+	write(type);
+	write(index);
+	return true;
+}
+
+void PlayerSnapshot::setData(const mp_ubyte* data, mp_uint32 size)
+{
+	clear();
+	write(data, size);
+}
+
+PlayerSnapshotTable::PlayerSnapshotTable() :
+	snapshots(NULL),
+	numSnapshots(0),
+	capacity(0),
+	playerType(-1),
+	frequency(0)
+{
+}
+
+PlayerSnapshotTable::~PlayerSnapshotTable()
+{
+	clear();
+	delete[] snapshots;
+}
+
+void PlayerSnapshotTable::clear()
+{
+	for (mp_uint32 i = 0; i < numSnapshots; i++)
+		delete snapshots[i];
+
+	numSnapshots = 0;
+	playerType = -1;
+	frequency = 0;
+}
+
+PlayerSnapshot* PlayerSnapshotTable::add()
+{
+	if (numSnapshots == capacity)
+	{
+		capacity = capacity ? capacity * 2 : 64;
+
+		PlayerSnapshot** newSnapshots = new PlayerSnapshot*[capacity];
+		if (numSnapshots)
+			memcpy(newSnapshots, snapshots, numSnapshots * sizeof(PlayerSnapshot*));
+		delete[] snapshots;
+
+		snapshots = newSnapshots;
+	}
+
+	return snapshots[numSnapshots++] = new PlayerSnapshot();
+}
+
+void PlayerSnapshotTable::removeLast()
+{
+	if (numSnapshots)
+		delete snapshots[--numSnapshots];
+}
+
+mp_sint32 PlayerSnapshotTable::findSnapshot(mp_sint32 order, mp_sint32 row) const
+{
+	mp_uint32 i = 0;
+	while (i < numSnapshots && snapshots[i]->order != order)
+		i++;
+
+	mp_sint32 res = -1;
+	for (; i < numSnapshots && snapshots[i]->order == order; i++)
+	{
+		if (snapshots[i]->row <= row)
+			res = i;
+	}
+
+	return res;
+}
+
+mp_sint32 PlayerSnapshotTable::findSnapshotBySamplePos(mp_int64 samplePos) const
+{
+	// snapshots are taken in playing order
+	mp_sint32 lo = 0;
+	mp_sint32 hi = (mp_sint32)numSnapshots - 1;
+	mp_sint32 res = -1;
+
+	while (lo <= hi)
+	{
+		const mp_sint32 mid = (lo + hi) >> 1;
+		if (snapshots[mid]->samplePos <= samplePos)
+		{
+			res = mid;
+			lo = mid + 1;
+		}
+		else
+			hi = mid - 1;
+	}
+
+	return res;
+}
+
+mp_uint32 PlayerSnapshotTable::getMemoryUsage() const
+{
+	mp_uint32 res = 0;
+	for (mp_uint32 i = 0; i < numSnapshots; i++)
+		res+=snapshots[i]->getSize();
+	return res;
+}
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2026, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  PlayerSnapshot.h
+ *  MilkyPlay
+ *
+ *  The complete replay state of a player and its mixer channels, see
+ *  PlayerBase::saveState. Samples and envelopes are stored as indices into
+ *  the module, so a snapshot can be kept as a plain block of bytes and
+ *  restored into any player of the same type playing the same module.
+ *  Everything else is stored as it is in memory, the data can't be moved
+ *  between different builds.
+ *
+ */
+#ifndef __PLAYERSNAPSHOT_H__
+#define __PLAYERSNAPSHOT_H__
+
+#include "MilkyPlayCommon.h"
+
+class XModule;
+struct TEnvelope;
+
+class PlayerSnapshot
+{
+private:
+	mp_ubyte*	data;
+	mp_uint32	size;
+	mp_uint32	capacity;
+
+	// not to be copied
+	PlayerSnapshot(const PlayerSnapshot& src);
+	PlayerSnapshot& operator=(const PlayerSnapshot& src);
+
+public:
+	// Restoring walks through the data with a reader of its own,
+	// so several players can restore the same snapshot at once
+	class Reader
+	{
+	private:
+		const PlayerSnapshot& snapshot;
+		const XModule* module;
+		mp_uint32 pos;
+
+	public:
+		Reader(const PlayerSnapshot& snapshot, const XModule* module) :
+			snapshot(snapshot),
+			module(module),
+			pos(0)
+		{
+		}
+
+		// false if the snapshot has less data left
+		bool read(void* dst, mp_uint32 len);
+
+		template<class T>
+		bool read(T& value) { return read(&value, sizeof(T)); }
+
+		// structure stored by writeStruct, NULL if the snapshot has less data left
+		const void* readStruct(mp_uint32 len);
+
+		bool readSample(const mp_sbyte*& sample);
+		bool readEnvelope(TEnvelope*& envelope);
+
+		bool isComplete() const { return pos == snapshot.size; }
+	};
+
+	// position of the row the snapshot was taken in front of
+	mp_sint32	order;
+	mp_sint32	row;
+	// number of samples played from the song start until the snapshot was taken
+	mp_int64	samplePos;
+
+	PlayerSnapshot();
+	~PlayerSnapshot();
+
+	void		clear() { size = 0; }
+
+	void		write(const void* src, mp_uint32 len);
+
+	template<class T>
+	void		write(const T& value) { write(&value, sizeof(T)); }
+
+	// Stores a structure as it is, aligned for reading it in place. The
+	// caller has to clear the pointers in the returned copy right away,
+	// it moves with the next write.
+	void*		writeStruct(const void* src, mp_uint32 len);
+
+	// false if the sample/envelope doesn't belong to the module
+	bool		writeSample(const XModule* module, const mp_sbyte* sample);
+	bool		writeEnvelope(const XModule* module, const TEnvelope* envelope);
+
+	// the serialized state
+	const mp_ubyte*	getData() const { return data; }
+	mp_uint32	getSize() const { return size; }
+	void		setData(const mp_ubyte* data, mp_uint32 size);
+};
+
+// Snapshots taken while playing a song once, see PlayerGeneric::captureSnapshots
+class PlayerSnapshotTable
+{
+private:
+	PlayerSnapshot** snapshots;
+	mp_uint32	numSnapshots;
+	mp_uint32	capacity;
+
+	mp_sint32	playerType;
+	mp_uint32	frequency;
+
+	// not to be copied
+	PlayerSnapshotTable(const PlayerSnapshotTable& src);
+	PlayerSnapshotTable& operator=(const PlayerSnapshotTable& src);
+
+public:
+	PlayerSnapshotTable();
+	~PlayerSnapshotTable();
+
+	void		clear();
+
+	// what the snapshots need from a player to be restored
+	void		setPlayerSettings(mp_sint32 playerType, mp_uint32 frequency)
+	{
+		this->playerType = playerType;
+		this->frequency = frequency;
+	}
+
+	mp_sint32	getPlayerType() const { return playerType; }
+	mp_uint32	getFrequency() const { return frequency; }
+
+	// empty snapshot appended to the table
+	PlayerSnapshot*	add();
+	void		removeLast();
+
+	mp_uint32	getNumSnapshots() const { return numSnapshots; }
+	const PlayerSnapshot* getSnapshot(mp_uint32 index) const { return snapshots[index]; }
+
+	// Snapshot to start from for getting to the given row: the one taken closest
+	// in front of it the first time its order was played, -1 if there is none
+	mp_sint32	findSnapshot(mp_sint32 order, mp_sint32 row) const;
+	// last snapshot taken at or before the given sample position, -1 if there is none
+	mp_sint32	findSnapshotBySamplePos(mp_int64 samplePos) const;
+
+	// bytes used by all snapshots
+	mp_uint32	getMemoryUsage() const;
+};
+
+#endif
@@ -208,6 +208,8 @@ class ResamplerAmiga : public ChannelMixer::ResamplerBase
 	virtual bool isRamping() { return false; }
 	virtual bool supportsFullChecking() { return false; }
 	virtual bool supportsNoChecking() { return true; }
+	// the BLEP state depends on the sample data
+	virtual bool supportsDryRun() { return false; }
 	
 	inline void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
 	{
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2026, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  ResamplerDryRun.h
+ *  MilkyPlay
+ *
+ *  Stand-in for another resampler that advances the channels exactly
+ *  like it but doesn't mix anything (see ChannelMixer::setDryRun).
+ *  It reports the same capabilities, so the mixer splits the blocks at
+ *  the same places, and then only updates what the real resampler would
+ *  write back into the channel: sample position, loop direction, play
+ *  flag, ramped volumes and the running time fraction of the sinc
+ *  resamplers. Resamplers with state of their own (Amiga) or depending
+ *  on the sample data (IT filter) can't be replaced this way.
+ *
+ */
+
+#ifndef __RESAMPLERDRYRUN_H__
+#define __RESAMPLERDRYRUN_H__
+
+#include "ResamplerMacros.h"
+
+#define FULLMIXER_DRYRUN(_RAMP_) \
+	if ((_RAMP_)) \
+	{ \
+		voll+=rampFromVolStepL; \
+		volr+=rampFromVolStepR; \
+	}
+
+class ResamplerDryRun : public ChannelMixer::ResamplerBase
+{
+private:
+	const bool ramping;
+	const bool fullChecking;
+	const bool noChecking;
+
+public:
+	ResamplerDryRun(ChannelMixer::ResamplerBase& resampler) :
+		ramping(resampler.isRamping()),
+		fullChecking(resampler.supportsFullChecking()),
+		noChecking(resampler.supportsNoChecking())
+	{
+	}
+
+	virtual bool isRamping() { return ramping; }
+	virtual bool supportsFullChecking() { return fullChecking; }
+	virtual bool supportsNoChecking() { return noChecking; }
+
+	virtual void addBlockFull(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		mp_sint32 voll = chn->finalvoll;
+		mp_sint32 volr = chn->finalvolr;
+
+		mp_sint32 rampFromVolStepL = chn->rampFromVolStepL;
+		mp_sint32 rampFromVolStepR = chn->rampFromVolStepR;
+
+		if (ramping && (rampFromVolStepL || rampFromVolStepR))
+		{
+			FULLMIXER_POSITION_TEMPLATE(FULLMIXER_DRYRUN(true), FULLMIXER_DRYRUN(true), 16, 0);
+		}
+		else
+		{
+			FULLMIXER_POSITION_TEMPLATE(FULLMIXER_DRYRUN(false), FULLMIXER_DRYRUN(false), 16, 1);
+		}
+
+		if (ramping)
+		{
+			chn->finalvoll = voll;
+			chn->finalvolr = volr;
+		}
+	}
+
+	virtual void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		const mp_sint32 smpadd = (chn->flags&ChannelMixer::MP_SAMPLE_BACKWARD) ? -chn->smpadd : chn->smpadd;
+
+		mp_sint32 fp = smpadd*count;
+		MP_INCREASESMPPOS(chn->smppos, chn->smpposfrac, fp, 16);
+
+		// unsigned, the per sample sums wrap around the same way
+		chn->fixedtimefrac = (mp_sint32)(((mp_uint32)chn->fixedtimefrac + (mp_uint32)chn->smpadd*count) & 65535);
+
+		if (ramping)
+		{
+			chn->finalvoll = (mp_sint32)((mp_uint32)chn->finalvoll + (mp_uint32)chn->rampFromVolStepL*count);
+			chn->finalvolr = (mp_sint32)((mp_uint32)chn->finalvolr + (mp_uint32)chn->rampFromVolStepR*count);
+		}
+	}
+};
+
+#endif
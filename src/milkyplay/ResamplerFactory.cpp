@@ -38,8 +38,12 @@
 #include "ResamplerFactory.h"
 #include "ResamplerCubic.h"
 #include "ResamplerFast.h"
+#include "ResamplerSIMD.h"
 #include "ResamplerSinc.h"
+#include "ResamplerSincPolyphase.h"
 #include "ResamplerAmiga.h"
+#include "ResamplerDryRun.h"
+#include "MilkyPlayThread.h"
 
 #ifdef __AMIGA__
 template<>
@@ -47,7 +51,94 @@ mp_sint32* ResamplerSincTableBase<16>::sinc_table = NULL;
 
 template<>
 bool ResamplerSincTableBase<16>::tableInit = false;
+
+template<>
+float* ResamplerSincPolyphaseBase<64, 12, float, SincPolyphaseWindows::WINDOW_KAISER>::coefficients = NULL;
+
+template<>
+bool ResamplerSincPolyphaseBase<64, 12, float, SincPolyphaseWindows::WINDOW_KAISER>::tableInit = false;
+#endif
+
+#if defined(MILKYPLAY_SIMD_AVX2) && defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+ResamplerFactory::SIMDLevels ResamplerFactory::maxSIMDLevel = ResamplerFactory::SIMD_AVX2;
+
+ResamplerFactory::SIMDLevels ResamplerFactory::getSIMDLevel()
+{
+	SIMDLevels level = SIMD_NONE;
+
+#if defined(MILKYPLAY_SIMD_NEON)
+	level = SIMD_NEON;
+#elif defined(MILKYPLAY_SIMD_SSE2)
+	level = SIMD_SSE2;
+#if defined(MILKYPLAY_SIMD_AVX2)
+#if defined(_MSC_VER)
+	// AVX2 needs CPU support (leaf 7) and the OS saving the YMM state (XCR0)
+	int info[4];
+	__cpuid(info, 1);
+	if ((info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6)
+	{
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5))
+			level = SIMD_AVX2;
+	}
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		level = SIMD_AVX2;
+#endif
+#endif
+#endif
+
+	// NEON is never restricted below SSE2, it's not on the same scale
+	if (level == SIMD_NEON)
+		return maxSIMDLevel == SIMD_NONE ? SIMD_NONE : level;
+
+	return level > maxSIMDLevel ? maxSIMDLevel : level;
+}
+
+/*
+ * Create the vectorized variant of a resampler matching the
+ * instruction set of the CPU, or the scalar one if there's none
+ */
+template<template<class> class VectorResampler, class ScalarResampler>
+static ChannelMixer::ResamplerBase* createVectorizedResampler()
+{
+	switch (ResamplerFactory::getSIMDLevel())
+	{
+#ifdef MILKYPLAY_SIMD_AVX2
+		case ResamplerFactory::SIMD_AVX2:
+			return new VectorResampler<SIMDKernelAVX2>();
 #endif
+#ifdef MILKYPLAY_SIMD_SSE2
+		case ResamplerFactory::SIMD_SSE2:
+			return new VectorResampler<SIMDKernelSSE2>();
+#endif
+#ifdef MILKYPLAY_SIMD_NEON
+		case ResamplerFactory::SIMD_NEON:
+			return new VectorResampler<SIMDKernelNEON>();
+#endif
+		default:
+			return new ScalarResampler();
+	}
+}
+
+// The sinc tables are built by the first resampler of a kind. Mixers are
+// set up on several threads at once when exporting, so only one resampler
+// with a table is created at a time.
+static MPMutex tableMutex;
+
+template<class Resampler>
+static ChannelMixer::ResamplerBase* createTableResampler()
+{
+	tableMutex.lock();
+	ChannelMixer::ResamplerBase* resampler = new Resampler();
+	tableMutex.unlock();
+
+	return resampler;
+}
 
 ChannelMixer::ResamplerBase* ResamplerFactory::createResampler(ResamplerTypes type)
 {
@@ -57,13 +148,13 @@ ChannelMixer::ResamplerBase* ResamplerFactory::createResampler(ResamplerTypes ty
 			return new ResamplerSimple();
 			
 		case MIXER_NORMAL_RAMPING:
-			return new ResamplerSimpleRamp();
+			return createVectorizedResampler<ResamplerSimpleRampSIMD, ResamplerSimpleRamp>();
 
 		case MIXER_LERPING:
-			return new ResamplerLerp();
+			return createVectorizedResampler<ResamplerLerpSIMD, ResamplerLerp>();
 
 		case MIXER_LERPING_RAMPING:
-			return new ResamplerLerpRampFilter();
+			return createVectorizedResampler<ResamplerLerpRampFilterSIMD, ResamplerLerpRampFilter>();
 
 		case MIXER_LAGRANGE:
 			return new ResamplerLagrange<false, CubicResamplerLagrange>();
@@ -78,16 +169,19 @@ ChannelMixer::ResamplerBase* ResamplerFactory::createResampler(ResamplerTypes ty
 			return new ResamplerLagrange<true, CubicResamplerSpline>();
 
 		case MIXER_SINCTABLE:
-			return new ResamplerSincTable<false, 16>();
+			return createTableResampler<ResamplerSincTable<false, 16> >();
 
 		case MIXER_SINCTABLE_RAMPING:
-			return new ResamplerSincTable<true, 16>();
+			return createTableResampler<ResamplerSincTable<true, 16> >();
 
+		// 64 taps, 4096 phases, Kaiser window. Replaces ResamplerSinc<128>
+		// which evaluated the sinc function for every single tap, and beats
+		// it in SNR and alias rejection (see tools/sincbench.cpp)
 		case MIXER_SINC:
-			return new ResamplerSinc<false, 128>();
+			return createTableResampler<ResamplerSincPolyphase<false, 64, 12, float, SincPolyphaseWindows::WINDOW_KAISER> >();
 
 		case MIXER_SINC_RAMPING:
-			return new ResamplerSinc<true, 128>();
+			return createTableResampler<ResamplerSincPolyphase<true, 64, 12, float, SincPolyphaseWindows::WINDOW_KAISER> >();
 
 		case MIXER_AMIGA500:
 			return new ResamplerAmiga<0>();
@@ -125,3 +219,8 @@ ChannelMixer::ResamplerBase* ResamplerFactory::createResampler(ResamplerTypes ty
 			return NULL;
 	}
 }
+
+ChannelMixer::ResamplerBase* ResamplerFactory::createDryRunResampler(ChannelMixer::ResamplerBase& resampler)
+{
+	return new ResamplerDryRun(resampler);
+}
@@ -43,7 +43,26 @@
 class ResamplerFactory : public MixerSettings
 {
 public:
+	enum SIMDLevels
+	{
+		SIMD_NONE,
+		SIMD_SSE2,
+		SIMD_AVX2,
+		SIMD_NEON
+	};
+
+private:
+	static SIMDLevels maxSIMDLevel;
+
+public:
+	// Best instruction set supported by both the build and the running CPU
+	static SIMDLevels getSIMDLevel();
+	// Restrict the instruction set used for resamplers created from now on
+	static void setMaxSIMDLevel(SIMDLevels level) { maxSIMDLevel = level; }
+
 	static ChannelMixer::ResamplerBase* createResampler(ResamplerTypes type);
+	// Position-only stand-in for resampler, see ResamplerDryRun.h
+	static ChannelMixer::ResamplerBase* createDryRunResampler(ChannelMixer::ResamplerBase& resampler);
 };
 
 #endif
@@ -259,14 +259,20 @@
 
 
 #define FULLMIXER_TEMPLATE(MIXER_8BIT, MIXER_16BIT, FRACBITS, LABELNO) \
+	const mp_sbyte* sample = chn->sample; \
+	mp_sint32 sd1,sd2; \
+	\
+	FULLMIXER_POSITION_TEMPLATE(MIXER_8BIT, MIXER_16BIT, FRACBITS, LABELNO)
+
+// sample position and loop handling of FULLMIXER_TEMPLATE, without the
+// locals for reading the sample data
+#define FULLMIXER_POSITION_TEMPLATE(MIXER_8BIT, MIXER_16BIT, FRACBITS, LABELNO) \
 	mp_sint32 smppos = chn->smppos; \
 	mp_sint32 smpposfrac = chn->smpposfrac; \
 	mp_sint32 smpadd = chn->smpadd; \
 	mp_sint32 loopstart = chn->loopstart; \
 	mp_sint32 loopend = chn->loopend; \
 	mp_sint32 flags = chn->flags; \
-	const mp_sbyte* sample = chn->sample; \
-	mp_sint32 sd1,sd2; \
 	\
 	/* 8 bit version */ \
 	if (!(flags&4)) \
@@ -0,0 +1,712 @@
+/*
+ * Copyright (c) 2026, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  ResamplerSIMD.h
+ *  MilkyPlay
+ *
+ *  Vectorized versions of the no-check block mixers in ResamplerFast.h.
+ *  Each iteration gathers the sample pairs for 4 (SSE2/NEON) or 8 (AVX2)
+ *  output frames, interpolates them and applies the channel volumes in
+ *  vector registers. All arithmetic is 32 bit integer and follows the
+ *  scalar macros step by step, so the output is bit-identical.
+ *
+ */
+
+#ifndef __RESAMPLERSIMD_H__
+#define __RESAMPLERSIMD_H__
+
+#include "ResamplerFast.h"
+#include <string.h>
+
+#ifndef MILKYPLAY_NO_SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#define MILKYPLAY_SIMD_SSE2
+	#include <emmintrin.h>
+	#if defined(__clang__) || defined(_MSC_VER) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)))
+		#define MILKYPLAY_SIMD_AVX2
+		#include <immintrin.h>
+		#ifdef _MSC_VER
+			#define MP_TARGET_AVX2
+		#else
+			#define MP_TARGET_AVX2 __attribute__((target("avx2")))
+		#endif
+	#endif
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(__ARM_BIG_ENDIAN)
+	#define MILKYPLAY_SIMD_NEON
+	#include <arm_neon.h>
+#endif
+#endif
+
+/*
+ * Sample fetching. For interpolation both neighbours are fetched with a
+ * single 32 bit load, the sample data is padded by 16 bytes on each side
+ * (see XModule::allocSampleMem) so reading past the second sample is safe.
+ * The pair is then split with shifts in vector registers, which assumes
+ * little endian byte order.
+ */
+template<class SampleType>
+static inline mp_sint32 fetchSamplePair(const SampleType* sample, mp_sint32 index)
+{
+	mp_sint32 pair;
+	memcpy(&pair, sample + index, sizeof(pair));
+	return pair;
+}
+
+template<bool interpolate, class SampleType>
+static inline mp_sint32 fetchSample(const SampleType* sample, mp_sint32 posfixed)
+{
+	return interpolate ? fetchSamplePair(sample, posfixed>>16) : (mp_sint32)sample[posfixed>>16];
+}
+
+/*
+ * Shift amounts to extract the first/second sample of a fetched pair,
+ * scaled to 16 bit (8 bit samples are shifted left by 8 like in the
+ * scalar mixers)
+ */
+template<class SampleType, mp_sint32 sampleShift>
+struct SIMDSampleLayout
+{
+	enum
+	{
+		BITS = sizeof(SampleType)*8,
+		FIRST_SHL = 32 - BITS,
+		FIRST_SHR = 32 - BITS - sampleShift,
+		SECOND_SHL = 32 - BITS*2,
+		SECOND_SHR = 32 - BITS
+	};
+};
+
+/*
+ * Scalar mixing of a run of frames, used for the frames which don't fill
+ * a whole vector. Identical to the NOCHECKMIXER_* macros.
+ */
+template<bool interpolate, bool ramp, class SampleType, mp_sint32 sampleShift>
+static inline void mixFramesScalar(mp_sint32*& buffer, const SampleType* sample, mp_sint32& posfixed, const mp_sint32 smpadd,
+								   mp_sint32& voll, mp_sint32& volr, const mp_sint32 rampFromVolStepL, const mp_sint32 rampFromVolStepR,
+								   mp_uint32 count)
+{
+	while (count)
+	{
+		mp_sint32 sd1 = (mp_sint32)sample[posfixed>>16] << sampleShift;
+		if (interpolate)
+		{
+			const mp_sint32 sd2 = (mp_sint32)sample[(posfixed>>16)+1] << sampleShift;
+			sd1 = ((sd1<<12)+((posfixed>>4)&0xfff)*(sd2-sd1))>>12;
+		}
+		(*buffer++)+=((sd1*(voll>>15))>>15);
+		(*buffer++)+=((sd1*(volr>>15))>>15);
+		if (ramp)
+		{
+			voll+=rampFromVolStepL;
+			volr+=rampFromVolStepR;
+		}
+		posfixed+=smpadd;
+		count--;
+	}
+}
+
+/*
+ * Scalar interpolation of a run of frames into a mono buffer, the tail of
+ * the kernels' interpolate()
+ */
+template<class SampleType, mp_sint32 sampleShift>
+static inline void interpolateFramesScalar(mp_sint32* dest, const SampleType* sample, mp_sint32 posfixed, const mp_sint32 smpadd,
+										   mp_uint32 count)
+{
+	while (count)
+	{
+		const mp_sint32 sd1 = (mp_sint32)sample[posfixed>>16] << sampleShift;
+		const mp_sint32 sd2 = (mp_sint32)sample[(posfixed>>16)+1] << sampleShift;
+		(*dest++) = ((sd1<<12)+((posfixed>>4)&0xfff)*(sd2-sd1))>>12;
+		posfixed+=smpadd;
+		count--;
+	}
+}
+
+/*
+ * Resonant filter and volume for a run of interpolated frames. The filter
+ * feeds back on itself so this part stays scalar, identical to the
+ * NOCHECKMIXER_*_LERP_RAMP_FILTER macros.
+ */
+template<bool ramp>
+static inline void filterFramesScalar(mp_sint32*& buffer, const mp_sint32* interpolated, mp_uint32 count,
+									  const mp_sint32 a, const mp_sint32 b, const mp_sint32 c,
+									  mp_sint32& currsample, mp_sint32& prevsample,
+									  mp_sint32& voll, mp_sint32& volr, const mp_sint32 rampFromVolStepL, const mp_sint32 rampFromVolStepR)
+{
+	while (count)
+	{
+		const mp_sint32 sd1 = (MP_FP_MUL(*interpolated++, a) + MP_FP_MUL(currsample, b) + MP_FP_MUL(prevsample, c)) >> ChannelMixer::MP_FILTERPRECISION;
+		prevsample = currsample;
+		currsample = sd1;
+
+		(*buffer++)+=MP_FP_MUL(sd1, voll>>14);
+		(*buffer++)+=MP_FP_MUL(sd1, volr>>14);
+		if (ramp)
+		{
+			voll+=rampFromVolStepL;
+			volr+=rampFromVolStepR;
+		}
+		count--;
+	}
+}
+
+#ifdef MILKYPLAY_SIMD_SSE2
+struct SIMDKernelSSE2
+{
+	// SSE2 has no 32 bit low multiply, build it from two 32x32->64 multiplies
+	static inline __m128i mullo(__m128i a, __m128i b)
+	{
+		const __m128i even = _mm_mul_epu32(a, b);
+		const __m128i odd = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+		return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0,0,2,0)),
+								  _mm_shuffle_epi32(odd, _MM_SHUFFLE(0,0,2,0)));
+	}
+
+	template<bool interpolate, bool ramp, class SampleType, mp_sint32 sampleShift>
+	static void mix(mp_sint32* buffer, const SampleType* sample, mp_sint32 posfixed, const mp_sint32 smpadd,
+					mp_sint32& voll, mp_sint32& volr, const mp_sint32 rampFromVolStepL, const mp_sint32 rampFromVolStepR,
+					mp_uint32 count)
+	{
+		typedef SIMDSampleLayout<SampleType, sampleShift> Layout;
+
+		const __m128i fracMask = _mm_set1_epi32(0xfff);
+		const __m128i posStep = _mm_set1_epi32(smpadd*4);
+		const __m128i stepL = _mm_set1_epi32(rampFromVolStepL*4);
+		const __m128i stepR = _mm_set1_epi32(rampFromVolStepR*4);
+
+		__m128i pos = _mm_setr_epi32(posfixed, posfixed+smpadd, posfixed+smpadd*2, posfixed+smpadd*3);
+
+		__m128i vl, vr;
+		if (ramp)
+		{
+			vl = _mm_setr_epi32(voll, voll+rampFromVolStepL, voll+rampFromVolStepL*2, voll+rampFromVolStepL*3);
+			vr = _mm_setr_epi32(volr, volr+rampFromVolStepR, volr+rampFromVolStepR*2, volr+rampFromVolStepR*3);
+		}
+		else
+		{
+			vl = _mm_set1_epi32(voll>>15);
+			vr = _mm_set1_epi32(volr>>15);
+		}
+
+		while (count >= 4)
+		{
+			const mp_sint32 p1 = posfixed + smpadd;
+			const mp_sint32 p2 = p1 + smpadd;
+			const mp_sint32 p3 = p2 + smpadd;
+
+			const __m128i smp = _mm_setr_epi32(fetchSample<interpolate>(sample, posfixed), fetchSample<interpolate>(sample, p1),
+											   fetchSample<interpolate>(sample, p2), fetchSample<interpolate>(sample, p3));
+
+			__m128i sd1;
+			if (interpolate)
+			{
+				sd1 = _mm_srai_epi32(_mm_slli_epi32(smp, Layout::FIRST_SHL), Layout::FIRST_SHR);
+				const __m128i sd2 = _mm_slli_epi32(_mm_srai_epi32(_mm_slli_epi32(smp, Layout::SECOND_SHL), Layout::SECOND_SHR), sampleShift);
+				const __m128i frac = _mm_and_si128(_mm_srai_epi32(pos, 4), fracMask);
+				sd1 = _mm_srai_epi32(_mm_add_epi32(_mm_slli_epi32(sd1, 12), mullo(frac, _mm_sub_epi32(sd2, sd1))), 12);
+			}
+			else
+			{
+				sd1 = _mm_slli_epi32(smp, sampleShift);
+			}
+
+			const __m128i gainL = ramp ? _mm_srai_epi32(vl, 15) : vl;
+			const __m128i gainR = ramp ? _mm_srai_epi32(vr, 15) : vr;
+			const __m128i left = _mm_srai_epi32(mullo(sd1, gainL), 15);
+			const __m128i right = _mm_srai_epi32(mullo(sd1, gainR), 15);
+
+			__m128i* dst = (__m128i*)buffer;
+			_mm_storeu_si128(dst, _mm_add_epi32(_mm_loadu_si128(dst), _mm_unpacklo_epi32(left, right)));
+			_mm_storeu_si128(dst+1, _mm_add_epi32(_mm_loadu_si128(dst+1), _mm_unpackhi_epi32(left, right)));
+
+			if (ramp)
+			{
+				vl = _mm_add_epi32(vl, stepL);
+				vr = _mm_add_epi32(vr, stepR);
+			}
+
+			pos = _mm_add_epi32(pos, posStep);
+			buffer+=8;
+			posfixed = p3 + smpadd;
+			count-=4;
+		}
+
+		if (ramp)
+		{
+			voll = _mm_cvtsi128_si32(vl);
+			volr = _mm_cvtsi128_si32(vr);
+		}
+
+		mixFramesScalar<interpolate, ramp, SampleType, sampleShift>(buffer, sample, posfixed, smpadd, voll, volr, rampFromVolStepL, rampFromVolStepR, count);
+	}
+	template<class SampleType, mp_sint32 sampleShift>
+	static void interpolate(mp_sint32* dest, const SampleType* sample, mp_sint32 posfixed, const mp_sint32 smpadd, mp_uint32 count)
+	{
+		typedef SIMDSampleLayout<SampleType, sampleShift> Layout;
+
+		const __m128i fracMask = _mm_set1_epi32(0xfff);
+		const __m128i posStep = _mm_set1_epi32(smpadd*4);
+
+		__m128i pos = _mm_setr_epi32(posfixed, posfixed+smpadd, posfixed+smpadd*2, posfixed+smpadd*3);
+
+		while (count >= 4)
+		{
+			const mp_sint32 p1 = posfixed + smpadd;
+			const mp_sint32 p2 = p1 + smpadd;
+			const mp_sint32 p3 = p2 + smpadd;
+
+			const __m128i smp = _mm_setr_epi32(fetchSample<true>(sample, posfixed), fetchSample<true>(sample, p1),
+											   fetchSample<true>(sample, p2), fetchSample<true>(sample, p3));
+
+			__m128i sd1 = _mm_srai_epi32(_mm_slli_epi32(smp, Layout::FIRST_SHL), Layout::FIRST_SHR);
+			const __m128i sd2 = _mm_slli_epi32(_mm_srai_epi32(_mm_slli_epi32(smp, Layout::SECOND_SHL), Layout::SECOND_SHR), sampleShift);
+			const __m128i frac = _mm_and_si128(_mm_srai_epi32(pos, 4), fracMask);
+			sd1 = _mm_srai_epi32(_mm_add_epi32(_mm_slli_epi32(sd1, 12), mullo(frac, _mm_sub_epi32(sd2, sd1))), 12);
+
+			_mm_storeu_si128((__m128i*)dest, sd1);
+
+			pos = _mm_add_epi32(pos, posStep);
+			dest+=4;
+			posfixed = p3 + smpadd;
+			count-=4;
+		}
+
+		interpolateFramesScalar<SampleType, sampleShift>(dest, sample, posfixed, smpadd, count);
+	}
+};
+#endif
+
+#ifdef MILKYPLAY_SIMD_AVX2
+struct SIMDKernelAVX2
+{
+	template<bool interpolate, bool ramp, class SampleType, mp_sint32 sampleShift>
+	MP_TARGET_AVX2 static void mix(mp_sint32* buffer, const SampleType* sample, mp_sint32 posfixed, const mp_sint32 smpadd,
+								   mp_sint32& voll, mp_sint32& volr, const mp_sint32 rampFromVolStepL, const mp_sint32 rampFromVolStepR,
+								   mp_uint32 count)
+	{
+		typedef SIMDSampleLayout<SampleType, sampleShift> Layout;
+
+		const __m256i fracMask = _mm256_set1_epi32(0xfff);
+		const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		const __m256i posStep = _mm256_set1_epi32(smpadd*8);
+		const __m256i stepL = _mm256_set1_epi32(rampFromVolStepL*8);
+		const __m256i stepR = _mm256_set1_epi32(rampFromVolStepR*8);
+
+		__m256i pos = _mm256_add_epi32(_mm256_set1_epi32(posfixed), _mm256_mullo_epi32(lane, _mm256_set1_epi32(smpadd)));
+
+		__m256i vl, vr;
+		if (ramp)
+		{
+			vl = _mm256_add_epi32(_mm256_set1_epi32(voll), _mm256_mullo_epi32(lane, _mm256_set1_epi32(rampFromVolStepL)));
+			vr = _mm256_add_epi32(_mm256_set1_epi32(volr), _mm256_mullo_epi32(lane, _mm256_set1_epi32(rampFromVolStepR)));
+		}
+		else
+		{
+			vl = _mm256_set1_epi32(voll>>15);
+			vr = _mm256_set1_epi32(volr>>15);
+		}
+
+		while (count >= 8)
+		{
+			// gather 32 bits at each sample position, the wanted sample(s) are in the low bits
+			const __m256i smp = _mm256_i32gather_epi32((const int*)sample, _mm256_srai_epi32(pos, 16), sizeof(SampleType));
+
+			__m256i sd1 = _mm256_srai_epi32(_mm256_slli_epi32(smp, Layout::FIRST_SHL), Layout::FIRST_SHR);
+			if (interpolate)
+			{
+				const __m256i sd2 = _mm256_slli_epi32(_mm256_srai_epi32(_mm256_slli_epi32(smp, Layout::SECOND_SHL), Layout::SECOND_SHR), sampleShift);
+				const __m256i frac = _mm256_and_si256(_mm256_srai_epi32(pos, 4), fracMask);
+				sd1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_slli_epi32(sd1, 12), _mm256_mullo_epi32(frac, _mm256_sub_epi32(sd2, sd1))), 12);
+			}
+
+			const __m256i gainL = ramp ? _mm256_srai_epi32(vl, 15) : vl;
+			const __m256i gainR = ramp ? _mm256_srai_epi32(vr, 15) : vr;
+			const __m256i left = _mm256_srai_epi32(_mm256_mullo_epi32(sd1, gainL), 15);
+			const __m256i right = _mm256_srai_epi32(_mm256_mullo_epi32(sd1, gainR), 15);
+
+			// unpack works per 128 bit lane: lo = frames 0,1,4,5 / hi = frames 2,3,6,7
+			const __m256i lo = _mm256_unpacklo_epi32(left, right);
+			const __m256i hi = _mm256_unpackhi_epi32(left, right);
+
+			__m256i* dst = (__m256i*)buffer;
+			_mm256_storeu_si256(dst, _mm256_add_epi32(_mm256_loadu_si256(dst), _mm256_permute2x128_si256(lo, hi, 0x20)));
+			_mm256_storeu_si256(dst+1, _mm256_add_epi32(_mm256_loadu_si256(dst+1), _mm256_permute2x128_si256(lo, hi, 0x31)));
+
+			if (ramp)
+			{
+				vl = _mm256_add_epi32(vl, stepL);
+				vr = _mm256_add_epi32(vr, stepR);
+			}
+
+			pos = _mm256_add_epi32(pos, posStep);
+			buffer+=16;
+			posfixed+=smpadd*8;
+			count-=8;
+		}
+
+		if (ramp)
+		{
+			voll = _mm_cvtsi128_si32(_mm256_castsi256_si128(vl));
+			volr = _mm_cvtsi128_si32(_mm256_castsi256_si128(vr));
+		}
+
+		mixFramesScalar<interpolate, ramp, SampleType, sampleShift>(buffer, sample, posfixed, smpadd, voll, volr, rampFromVolStepL, rampFromVolStepR, count);
+	}
+	template<class SampleType, mp_sint32 sampleShift>
+	MP_TARGET_AVX2 static void interpolate(mp_sint32* dest, const SampleType* sample, mp_sint32 posfixed, const mp_sint32 smpadd, mp_uint32 count)
+	{
+		typedef SIMDSampleLayout<SampleType, sampleShift> Layout;
+
+		const __m256i fracMask = _mm256_set1_epi32(0xfff);
+		const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+		const __m256i posStep = _mm256_set1_epi32(smpadd*8);
+
+		__m256i pos = _mm256_add_epi32(_mm256_set1_epi32(posfixed), _mm256_mullo_epi32(lane, _mm256_set1_epi32(smpadd)));
+
+		while (count >= 8)
+		{
+			const __m256i smp = _mm256_i32gather_epi32((const int*)sample, _mm256_srai_epi32(pos, 16), sizeof(SampleType));
+
+			__m256i sd1 = _mm256_srai_epi32(_mm256_slli_epi32(smp, Layout::FIRST_SHL), Layout::FIRST_SHR);
+			const __m256i sd2 = _mm256_slli_epi32(_mm256_srai_epi32(_mm256_slli_epi32(smp, Layout::SECOND_SHL), Layout::SECOND_SHR), sampleShift);
+			const __m256i frac = _mm256_and_si256(_mm256_srai_epi32(pos, 4), fracMask);
+			sd1 = _mm256_srai_epi32(_mm256_add_epi32(_mm256_slli_epi32(sd1, 12), _mm256_mullo_epi32(frac, _mm256_sub_epi32(sd2, sd1))), 12);
+
+			_mm256_storeu_si256((__m256i*)dest, sd1);
+
+			pos = _mm256_add_epi32(pos, posStep);
+			dest+=8;
+			posfixed+=smpadd*8;
+			count-=8;
+		}
+
+		interpolateFramesScalar<SampleType, sampleShift>(dest, sample, posfixed, smpadd, count);
+	}
+};
+#endif
+
+#ifdef MILKYPLAY_SIMD_NEON
+struct SIMDKernelNEON
+{
+	template<bool interpolate, bool ramp, class SampleType, mp_sint32 sampleShift>
+	static void mix(mp_sint32* buffer, const SampleType* sample, mp_sint32 posfixed, const mp_sint32 smpadd,
+					mp_sint32& voll, mp_sint32& volr, const mp_sint32 rampFromVolStepL, const mp_sint32 rampFromVolStepR,
+					mp_uint32 count)
+	{
+		typedef SIMDSampleLayout<SampleType, sampleShift> Layout;
+
+		const int32x4_t fracMask = vdupq_n_s32(0xfff);
+		const int32x4_t posStep = vdupq_n_s32(smpadd*4);
+		const int32x4_t stepL = vdupq_n_s32(rampFromVolStepL*4);
+		const int32x4_t stepR = vdupq_n_s32(rampFromVolStepR*4);
+
+		const mp_sint32 initPos[4] = {posfixed, posfixed+smpadd, posfixed+smpadd*2, posfixed+smpadd*3};
+		int32x4_t pos = vld1q_s32(initPos);
+
+		int32x4_t vl, vr;
+		if (ramp)
+		{
+			const mp_sint32 initL[4] = {voll, voll+rampFromVolStepL, voll+rampFromVolStepL*2, voll+rampFromVolStepL*3};
+			const mp_sint32 initR[4] = {volr, volr+rampFromVolStepR, volr+rampFromVolStepR*2, volr+rampFromVolStepR*3};
+			vl = vld1q_s32(initL);
+			vr = vld1q_s32(initR);
+		}
+		else
+		{
+			vl = vdupq_n_s32(voll>>15);
+			vr = vdupq_n_s32(volr>>15);
+		}
+
+		mp_sint32 fetched[4];
+		while (count >= 4)
+		{
+			fetched[0] = fetchSample<interpolate>(sample, posfixed);
+			posfixed+=smpadd;
+			fetched[1] = fetchSample<interpolate>(sample, posfixed);
+			posfixed+=smpadd;
+			fetched[2] = fetchSample<interpolate>(sample, posfixed);
+			posfixed+=smpadd;
+			fetched[3] = fetchSample<interpolate>(sample, posfixed);
+			posfixed+=smpadd;
+
+			const int32x4_t smp = vld1q_s32(fetched);
+
+			int32x4_t sd1;
+			if (interpolate)
+			{
+				sd1 = vshrq_n_s32(vshlq_n_s32(smp, Layout::FIRST_SHL), Layout::FIRST_SHR);
+				const int32x4_t sd2 = vshlq_n_s32(vshrq_n_s32(vshlq_n_s32(smp, Layout::SECOND_SHL), Layout::SECOND_SHR), sampleShift);
+				const int32x4_t frac = vandq_s32(vshrq_n_s32(pos, 4), fracMask);
+				sd1 = vshrq_n_s32(vaddq_s32(vshlq_n_s32(sd1, 12), vmulq_s32(frac, vsubq_s32(sd2, sd1))), 12);
+			}
+			else
+			{
+				sd1 = vshlq_n_s32(smp, sampleShift);
+			}
+
+			const int32x4_t gainL = ramp ? vshrq_n_s32(vl, 15) : vl;
+			const int32x4_t gainR = ramp ? vshrq_n_s32(vr, 15) : vr;
+			const int32x4x2_t frames = vzipq_s32(vshrq_n_s32(vmulq_s32(sd1, gainL), 15), vshrq_n_s32(vmulq_s32(sd1, gainR), 15));
+
+			vst1q_s32(buffer, vaddq_s32(vld1q_s32(buffer), frames.val[0]));
+			vst1q_s32(buffer+4, vaddq_s32(vld1q_s32(buffer+4), frames.val[1]));
+
+			if (ramp)
+			{
+				vl = vaddq_s32(vl, stepL);
+				vr = vaddq_s32(vr, stepR);
+			}
+
+			pos = vaddq_s32(pos, posStep);
+			buffer+=8;
+			count-=4;
+		}
+
+		if (ramp)
+		{
+			voll = vgetq_lane_s32(vl, 0);
+			volr = vgetq_lane_s32(vr, 0);
+		}
+
+		mixFramesScalar<interpolate, ramp, SampleType, sampleShift>(buffer, sample, posfixed, smpadd, voll, volr, rampFromVolStepL, rampFromVolStepR, count);
+	}
+	template<class SampleType, mp_sint32 sampleShift>
+	static void interpolate(mp_sint32* dest, const SampleType* sample, mp_sint32 posfixed, const mp_sint32 smpadd, mp_uint32 count)
+	{
+		typedef SIMDSampleLayout<SampleType, sampleShift> Layout;
+
+		const int32x4_t fracMask = vdupq_n_s32(0xfff);
+		const int32x4_t posStep = vdupq_n_s32(smpadd*4);
+
+		const mp_sint32 initPos[4] = {posfixed, posfixed+smpadd, posfixed+smpadd*2, posfixed+smpadd*3};
+		int32x4_t pos = vld1q_s32(initPos);
+
+		mp_sint32 fetched[4];
+		while (count >= 4)
+		{
+			fetched[0] = fetchSample<true>(sample, posfixed);
+			posfixed+=smpadd;
+			fetched[1] = fetchSample<true>(sample, posfixed);
+			posfixed+=smpadd;
+			fetched[2] = fetchSample<true>(sample, posfixed);
+			posfixed+=smpadd;
+			fetched[3] = fetchSample<true>(sample, posfixed);
+			posfixed+=smpadd;
+
+			const int32x4_t smp = vld1q_s32(fetched);
+
+			int32x4_t sd1 = vshrq_n_s32(vshlq_n_s32(smp, Layout::FIRST_SHL), Layout::FIRST_SHR);
+			const int32x4_t sd2 = vshlq_n_s32(vshrq_n_s32(vshlq_n_s32(smp, Layout::SECOND_SHL), Layout::SECOND_SHR), sampleShift);
+			const int32x4_t frac = vandq_s32(vshrq_n_s32(pos, 4), fracMask);
+			sd1 = vshrq_n_s32(vaddq_s32(vshlq_n_s32(sd1, 12), vmulq_s32(frac, vsubq_s32(sd2, sd1))), 12);
+
+			vst1q_s32(dest, sd1);
+
+			pos = vaddq_s32(pos, posStep);
+			dest+=4;
+			count-=4;
+		}
+
+		interpolateFramesScalar<SampleType, sampleShift>(dest, sample, posfixed, smpadd, count);
+	}
+};
+#endif
+
+/*
+ * Dispatch a block to the kernel, picking the 8 or 16 bit variant
+ */
+#define SIMDMIXER_TEMPLATE(KERNEL, INTERPOLATE, RAMP) \
+	if (!(chn->flags&4)) \
+		KERNEL::template mix<INTERPOLATE, RAMP, mp_sbyte, 8>(buffer, chn->sample + basepos, posfixed, smpadd, voll, volr, rampFromVolStepL, rampFromVolStepR, count); \
+	else \
+		KERNEL::template mix<INTERPOLATE, RAMP, mp_sword, 0>(buffer, (const mp_sword*)chn->sample + basepos, posfixed, smpadd, voll, volr, rampFromVolStepL, rampFromVolStepR, count);
+
+/*
+ * Vectorized resampler without interpolation but with ramping.
+ */
+template<class Kernel>
+class ResamplerSimpleRampSIMD : public ResamplerSimpleRamp
+{
+public:
+	virtual void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		mp_sint32 voll = chn->finalvoll;
+		mp_sint32 volr = chn->finalvolr;
+
+		const mp_sint32 rampFromVolStepL = chn->rampFromVolStepL;
+		const mp_sint32 rampFromVolStepR = chn->rampFromVolStepR;
+
+		mp_sint32 smppos = chn->smppos;
+		const mp_sint32 smpadd = (chn->flags&ChannelMixer::MP_SAMPLE_BACKWARD) ? -chn->smpadd : chn->smpadd;
+		const mp_sint32 basepos = smppos;
+		mp_sint32 posfixed = chn->smpposfrac;
+
+		mp_sint32 fp = smpadd*count;
+		MP_INCREASESMPPOS(chn->smppos,chn->smpposfrac, fp, 16);
+
+		if ((voll == 0 && rampFromVolStepL == 0) && (volr == 0 && rampFromVolStepR == 0)) return;
+
+		if (rampFromVolStepL || rampFromVolStepR)
+		{
+			SIMDMIXER_TEMPLATE(Kernel, false, true);
+		}
+		else
+		{
+			SIMDMIXER_TEMPLATE(Kernel, false, false);
+		}
+
+		chn->finalvoll = voll;
+		chn->finalvolr = volr;
+	}
+};
+
+/*
+ * Vectorized resampler using linear interpolation but without ramping.
+ */
+template<class Kernel>
+class ResamplerLerpSIMD : public ResamplerLerp
+{
+public:
+	virtual void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		mp_sint32 voll = chn->finalvoll;
+		mp_sint32 volr = chn->finalvolr;
+
+		const mp_sint32 rampFromVolStepL = 0;
+		const mp_sint32 rampFromVolStepR = 0;
+
+		mp_sint32 smppos = chn->smppos;
+		const mp_sint32 smpadd = (chn->flags&ChannelMixer::MP_SAMPLE_BACKWARD) ? -chn->smpadd : chn->smpadd;
+		const mp_sint32 basepos = smppos;
+		mp_sint32 posfixed = chn->smpposfrac;
+
+		mp_sint32 fp = smpadd*count;
+		MP_INCREASESMPPOS(chn->smppos, chn->smpposfrac, fp, 16);
+
+		if ((voll == 0) && (volr == 0)) return;
+
+		SIMDMIXER_TEMPLATE(Kernel, true, false);
+	}
+};
+
+/*
+ * Vectorized resampler using linear interpolation and ramping.
+ * The resonant filter is a recursive per-frame computation, for channels
+ * which have it enabled only the interpolation is vectorized: it is done
+ * in chunks into a stack buffer which is then filtered frame by frame.
+ */
+template<class Kernel>
+class ResamplerLerpRampFilterSIMD : public ResamplerLerpRampFilter
+{
+	enum
+	{
+		FILTER_CHUNKSIZE = 64
+	};
+
+	template<bool ramp>
+	static void addBlockFiltered(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_sint32 basepos, mp_sint32 posfixed, const mp_sint32 smpadd,
+								 mp_sint32& voll, mp_sint32& volr, const mp_sint32 rampFromVolStepL, const mp_sint32 rampFromVolStepR,
+								 mp_uint32 count)
+	{
+		const mp_sint32 a = chn->a;
+		const mp_sint32 b = chn->b;
+		const mp_sint32 c = chn->c;
+
+		mp_sint32 currsample = chn->currsample;
+		mp_sint32 prevsample = chn->prevsample;
+
+		mp_sint32 interpolated[FILTER_CHUNKSIZE];
+		while (count)
+		{
+			const mp_uint32 todo = count < FILTER_CHUNKSIZE ? count : FILTER_CHUNKSIZE;
+
+			if (!(chn->flags&4))
+				Kernel::template interpolate<mp_sbyte, 8>(interpolated, chn->sample + basepos, posfixed, smpadd, todo);
+			else
+				Kernel::template interpolate<mp_sword, 0>(interpolated, (const mp_sword*)chn->sample + basepos, posfixed, smpadd, todo);
+
+			filterFramesScalar<ramp>(buffer, interpolated, todo, a, b, c, currsample, prevsample, voll, volr, rampFromVolStepL, rampFromVolStepR);
+
+			posfixed+=smpadd*todo;
+			count-=todo;
+		}
+
+		chn->currsample = currsample;
+		chn->prevsample = prevsample;
+	}
+
+public:
+	virtual void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		mp_sint32 voll = chn->finalvoll;
+		mp_sint32 volr = chn->finalvolr;
+
+		const mp_sint32 rampFromVolStepL = chn->rampFromVolStepL;
+		const mp_sint32 rampFromVolStepR = chn->rampFromVolStepR;
+
+		mp_sint32 smppos = chn->smppos;
+		const mp_sint32 smpadd = (chn->flags&ChannelMixer::MP_SAMPLE_BACKWARD) ? -chn->smpadd : chn->smpadd;
+		const mp_sint32 basepos = smppos;
+		mp_sint32 posfixed = chn->smpposfrac;
+
+		mp_sint32 fp = smpadd*count;
+		MP_INCREASESMPPOS(chn->smppos, chn->smpposfrac, fp, 16);
+
+		// filter in use?
+		if (chn->cutoff != ChannelMixer::MP_INVALID_VALUE && chn->resonance != ChannelMixer::MP_INVALID_VALUE)
+		{
+			if (rampFromVolStepL || rampFromVolStepR)
+				addBlockFiltered<true>(buffer, chn, basepos, posfixed, smpadd, voll, volr, rampFromVolStepL, rampFromVolStepR, count);
+			else
+				addBlockFiltered<false>(buffer, chn, basepos, posfixed, smpadd, voll, volr, rampFromVolStepL, rampFromVolStepR, count);
+
+			chn->finalvoll = voll;
+			chn->finalvolr = volr;
+			return;
+		}
+
+		if ((voll == 0 && rampFromVolStepL == 0) && (volr == 0 && rampFromVolStepR == 0)) return;
+
+		if (rampFromVolStepL || rampFromVolStepR)
+		{
+			SIMDMIXER_TEMPLATE(Kernel, true, true);
+		}
+		else
+		{
+			SIMDMIXER_TEMPLATE(Kernel, true, false);
+		}
+
+		chn->finalvoll = voll;
+		chn->finalvolr = volr;
+	}
+};
+
+#endif
@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) 2026, The MilkyTracker Team.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * - Redistributions of source code must retain the above copyright notice,
+ *   this list of conditions and the following disclaimer.
+ * - Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * - Neither the name of the <ORGANIZATION> nor the names of its contributors
+ *   may be used to endorse or promote products derived from this software
+ *   without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  ResamplerSincPolyphase.h
+ *  MilkyPlay
+ *
+ *  Windowed sinc resampler driven by a precomputed polyphase table.
+ *
+ *  The kernel is sampled at (1 << phaseShift) fractional positions
+ *  ("phases") between two input samples, each phase holding windowSize
+ *  taps. Rendering an output sample then only needs a table row and a
+ *  dot product, no trigonometry. Coefficients can be stored as float
+ *  or as 16.16 fixed point, the window is selectable.
+ *
+ *  Neighbouring samples are collected with the same advancePos() walk
+ *  the other sinc resamplers use, so loops and ping-pong loops behave
+ *  identically. Windows which don't touch a loop point or the sample
+ *  boundaries are read directly from the sample data.
+ *
+ */
+
+#ifndef __RESAMPLERSINCPOLYPHASE_H__
+#define __RESAMPLERSINCPOLYPHASE_H__
+
+#include "ResamplerSinc.h"
+
+class SincPolyphaseWindows
+{
+public:
+	enum Windows
+	{
+		WINDOW_NONE,		// plain truncated sinc
+		WINDOW_HANN,		// same window as ResamplerSincTable
+		WINDOW_BLACKMAN,
+		WINDOW_KAISER		// beta = KAISER_BETA
+	};
+};
+
+/*
+ * Coefficient type specific operations
+ */
+template<class CoefficientType>
+struct SincPolyphaseCoefficient;
+
+template<>
+struct SincPolyphaseCoefficient<float>
+{
+	typedef float AccumulatorType;
+
+	static inline float make(double value) { return (float)value; }
+
+	// scale by a 16.16 fixed point factor
+	static inline float scale(float coeff, mp_sint32 factor) { return coeff * (factor * (1.0f / 65536.0f)); }
+
+	static inline void accumulate(float& acc, mp_sint32 sample, float coeff, mp_uint32 /*shift*/) { acc += sample * coeff; }
+
+	static inline mp_sint32 result(float acc, mp_uint32 shift) { return (mp_sint32)(acc * (1 << (16-shift))); }
+};
+
+template<>
+struct SincPolyphaseCoefficient<mp_sint32>
+{
+	typedef mp_sint32 AccumulatorType;
+
+	static inline mp_sint32 make(double value) { return (mp_sint32)floor(value * 65536.0 + 0.5); }
+
+	static inline mp_sint32 scale(mp_sint32 coeff, mp_sint32 factor) { return MP_FP_MUL(coeff, factor); }
+
+	static inline void accumulate(mp_sint32& acc, mp_sint32 sample, mp_sint32 coeff, mp_uint32 shift) { acc += (sample * coeff) >> shift; }
+
+	static inline mp_sint32 result(mp_sint32 acc, mp_uint32 /*shift*/) { return acc; }
+};
+
+// shared coefficient table per configuration
+template<mp_sint32 windowSize, mp_sint32 phaseShift, class CoefficientType, mp_sint32 windowType>
+class ResamplerSincPolyphaseBase : public ChannelMixer::ResamplerBase
+{
+protected:
+	enum
+	{
+		TAPS = windowSize, // must be even
+		WIDTH = (TAPS / 2),
+		PHASE_SHIFT = phaseShift,
+		PHASES = (1 << PHASE_SHIFT),
+		// for rounding a 16 bit fraction to the nearest phase
+		PHASE_ROUND = (1 << (15 - PHASE_SHIFT)),
+		// one extra row for a fractional position of 1.0
+		TABLESIZE = (PHASES + 1) * TAPS
+	};
+
+	static CoefficientType* coefficients;
+	static bool tableInit;
+
+	static double besselI0(double x)
+	{
+		// power series, converges quickly for the betas we're using
+		double sum = 1.0, term = 1.0;
+		const double halfx = x * 0.5;
+		for (mp_sint32 k = 1; k < 64; k++)
+		{
+			term *= (halfx / k) * (halfx / k);
+			sum += term;
+			if (term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+
+	// window function over x = -1..1
+	static double window(double x)
+	{
+		const double KAISER_BETA = 8.0;
+
+		if (x <= -1.0 || x >= 1.0)
+			return 0.0;
+
+		switch (windowType)
+		{
+			case SincPolyphaseWindows::WINDOW_HANN:
+				return 0.5 + 0.5 * cos(M_PI * x);
+			case SincPolyphaseWindows::WINDOW_BLACKMAN:
+				return 0.42 + 0.5 * cos(M_PI * x) + 0.08 * cos(2.0 * M_PI * x);
+			case SincPolyphaseWindows::WINDOW_KAISER:
+				return besselI0(KAISER_BETA * sqrt(1.0 - x*x)) / besselI0(KAISER_BETA);
+			default:
+				return 1.0;
+		}
+	}
+
+	/*
+	 * Row p holds the kernel for the fractional position t = p / PHASES,
+	 * tap i belongs to the sample at offset d = i - (WIDTH-1) from the
+	 * current position (in playback direction), so coefficient (p,i)
+	 * equals h(t - d).
+	 * Each row is normalized to unity DC gain.
+	 */
+	static void makeTable()
+	{
+		double row[TAPS];
+
+		for (mp_sint32 p = 0; p <= PHASES; p++)
+		{
+			const double t = (double)p / PHASES;
+			double sum = 0.0;
+
+			for (mp_sint32 i = 0; i < TAPS; i++)
+			{
+				const double x = t - (i - (WIDTH - 1));
+				const double sinc = (x == 0.0) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+				row[i] = sinc * window(x / WIDTH);
+				sum += row[i];
+			}
+
+			for (mp_sint32 i = 0; i < TAPS; i++)
+				coefficients[p*TAPS + i] = SincPolyphaseCoefficient<CoefficientType>::make(row[i] / sum);
+		}
+	}
+
+	// not thread safe, ResamplerFactory creates one at a time
+	ResamplerSincPolyphaseBase()
+	{
+		if (!tableInit)
+		{
+			coefficients = new CoefficientType[TABLESIZE];
+			makeTable();
+			tableInit = true;
+		}
+	}
+
+public:
+	/*
+	 * Kernel value at an arbitrary 16.16 position, taken from the
+	 * nearest phase. Used when the kernel has to be stretched.
+	 */
+	static inline CoefficientType kernel(mp_sint32 x)
+	{
+		const mp_sint32 n = x >> 16;
+		if (n < -WIDTH || n >= WIDTH)
+			return 0;
+
+		return coefficients[(((x & 65535) + PHASE_ROUND) >> (16 - PHASE_SHIFT)) * TAPS + (WIDTH - 1) - n];
+	}
+};
+
+template<mp_sint32 windowSize, mp_sint32 phaseShift, class CoefficientType, mp_sint32 windowType>
+bool ResamplerSincPolyphaseBase<windowSize, phaseShift, CoefficientType, windowType>::tableInit = false;
+template<mp_sint32 windowSize, mp_sint32 phaseShift, class CoefficientType, mp_sint32 windowType>
+CoefficientType* ResamplerSincPolyphaseBase<windowSize, phaseShift, CoefficientType, windowType>::coefficients = NULL;
+
+template<bool ramping, mp_sint32 windowSize, mp_sint32 phaseShift, class CoefficientType, mp_sint32 windowType, class bufferType, mp_uint32 shift>
+class SincPolyphaseResamplerDummy : public ResamplerSincPolyphaseBase<windowSize, phaseShift, CoefficientType, windowType>
+{
+private:
+	typedef ResamplerSincPolyphaseBase<windowSize, phaseShift, CoefficientType, windowType> Base;
+	typedef SincPolyphaseCoefficient<CoefficientType> Coefficient;
+	typedef typename Coefficient::AccumulatorType AccumulatorType;
+
+	enum
+	{
+		TAPS = Base::TAPS,
+		WIDTH = Base::WIDTH,
+		PHASE_SHIFT = Base::PHASE_SHIFT
+	};
+
+public:
+	static inline void addBlock(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		const bufferType* sample = (const bufferType*)chn->sample;
+
+		mp_sint32 voll = chn->finalvoll;
+		mp_sint32 volr = chn->finalvolr;
+
+		const mp_sint32 rampFromVolStepL = ramping ? chn->rampFromVolStepL : 0;
+		const mp_sint32 rampFromVolStepR = ramping ? chn->rampFromVolStepR : 0;
+
+		mp_sint32 smppos = chn->smppos;
+		mp_sint32 smpposfrac = chn->smpposfrac;
+		const mp_sint32 smpadd = (chn->flags&ChannelMixer::MP_SAMPLE_BACKWARD) ? -chn->smpadd : chn->smpadd;
+		const mp_sint32 rsmpadd = chn->rsmpadd;
+
+		const mp_sint32 flags = chn->flags;
+		const mp_sint32 loopstart = chn->loopstart;
+		const mp_sint32 loopend = chn->loopend;
+		const mp_sint32 loopendcopy = chn->loopendcopy;
+		const mp_sint32 smplen = chn->smplen;
+
+		mp_sint32 fixedtimefrac = chn->fixedtimefrac;
+		const mp_sint32 timeadd = chn->smpadd;
+
+		const mp_sint32 negflags = smpadd < 0 ? (flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) : ((flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) | ChannelMixer::MP_SAMPLE_BACKWARD);
+		const mp_sint32 posflags = smpadd > 0 ? (flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) : ((flags & ~ChannelMixer::MP_SAMPLE_BACKWARD) | ChannelMixer::MP_SAMPLE_BACKWARD);
+
+		// direction of the sample data in playback order
+		const mp_sint32 dir = (flags & ChannelMixer::MP_SAMPLE_BACKWARD) ? -1 : 1;
+
+		// downsampling: stretch the kernel to lower the cutoff
+		const bool stretch = timeadd >= 65536;
+
+		mp_sint32 taps[TAPS];
+		CoefficientType stretched[TAPS];
+
+		mp_sint32 tmpsmppos;
+		mp_sint32 tmpflags;
+		mp_sint32 tmploopstart;
+		mp_sint32 tmploopend;
+
+		while (count--)
+		{
+			// check whether we are outside loop points
+			// if that's the case we're treating the sample as a normal finite signal
+			const bool outSideLoop = !(((flags & 3) && smppos >= loopstart && smppos < loopend));
+			const mp_sint32 rangeStart = outSideLoop ? 0 : loopstart;
+			const mp_sint32 rangeEnd = outSideLoop ? smplen : loopend;
+
+			// first and last sample touched by the window
+			const mp_sint32 first = smppos - (WIDTH - 1) * dir;
+			const mp_sint32 last = smppos + WIDTH * dir;
+
+			const bufferType* src;
+			mp_sint32 stride;
+
+			if (first >= rangeStart && first < rangeEnd && last >= rangeStart && last < rangeEnd)
+			{
+				src = sample + first;
+				stride = dir;
+			}
+			else
+			{
+				// collect the window by walking through the sample, this
+				// wraps around loop points and stops at the sample ends
+				tmpsmppos = smppos;
+				tmploopstart = outSideLoop ? 0 : loopstart;
+				tmploopend = outSideLoop ? smplen : loopend;
+				tmpflags = outSideLoop ? (negflags & ~3) : negflags;
+
+				mp_sint32 j;
+				for (j = WIDTH - 1; j >= 0; j--)
+				{
+					taps[j] = sample[tmpsmppos];
+					advancePos(tmpsmppos, tmpflags, tmploopstart, tmploopend, loopendcopy);
+					if (!(tmpflags & ChannelMixer::MP_SAMPLE_PLAY))
+						break;
+				}
+				for (j--; j >= 0; j--)
+					taps[j] = 0;
+
+				tmpsmppos = smppos;
+				tmpflags = outSideLoop ? (posflags & ~3) : posflags;
+
+				for (j = WIDTH; j < TAPS; j++)
+				{
+					advancePos(tmpsmppos, tmpflags, tmploopstart, tmploopend, loopendcopy);
+					if (!(tmpflags & ChannelMixer::MP_SAMPLE_PLAY))
+						break;
+					taps[j] = sample[tmpsmppos];
+				}
+				for (; j < TAPS; j++)
+					taps[j] = 0;
+
+				src = NULL;
+				stride = 1;
+			}
+
+			mp_sint32 time = fixedtimefrac;
+			if (!time && (flags & ChannelMixer::MP_SAMPLE_BACKWARD))
+				time = 65536;
+
+			const CoefficientType* coeffs;
+			if (!stretch)
+			{
+				coeffs = Base::coefficients + ((time + Base::PHASE_ROUND) >> (16 - PHASE_SHIFT)) * TAPS;
+			}
+			else
+			{
+				for (mp_sint32 i = 0; i < TAPS; i++)
+					stretched[i] = Coefficient::scale(Base::kernel(MP_FP_MUL(time - ((i - (WIDTH - 1)) << 16), rsmpadd)), rsmpadd);
+				coeffs = stretched;
+			}
+
+			AccumulatorType result = 0;
+			if (src)
+			{
+				for (mp_sint32 i = 0; i < TAPS; i++)
+					Coefficient::accumulate(result, src[i*stride], coeffs[i], shift);
+			}
+			else
+			{
+				for (mp_sint32 i = 0; i < TAPS; i++)
+					Coefficient::accumulate(result, taps[i], coeffs[i], shift);
+			}
+
+			const mp_sint32 final = Coefficient::result(result, shift);
+
+			(*buffer++)+=((final*(voll>>15))>>15);
+			(*buffer++)+=((final*(volr>>15))>>15);
+
+			if (ramping)
+			{
+				voll+=rampFromVolStepL;
+				volr+=rampFromVolStepR;
+			}
+
+			MP_INCREASESMPPOS(smppos, smpposfrac, smpadd, 16);
+			fixedtimefrac=(fixedtimefrac+timeadd) & 65535;
+		}
+
+		chn->smppos = smppos;
+		chn->smpposfrac = smpposfrac;
+
+		chn->fixedtimefrac = fixedtimefrac;
+
+		if (ramping)
+		{
+			chn->finalvoll = voll;
+			chn->finalvolr = volr;
+		}
+	}
+};
+
+template<bool ramping, mp_sint32 windowSize, mp_sint32 phaseShift, class CoefficientType, mp_sint32 windowType>
+class ResamplerSincPolyphase : public ResamplerSincPolyphaseBase<windowSize, phaseShift, CoefficientType, windowType>
+{
+public:
+	ResamplerSincPolyphase() :
+		ResamplerSincPolyphaseBase<windowSize, phaseShift, CoefficientType, windowType>()
+	{
+	}
+
+	virtual bool isRamping() { return ramping; }
+	virtual bool supportsFullChecking() { return false; }
+	virtual bool supportsNoChecking() { return true; }
+
+	virtual void addBlockNoCheck(mp_sint32* buffer, ChannelMixer::TMixerChannel* chn, mp_uint32 count)
+	{
+		if (chn->flags & 4)
+			SincPolyphaseResamplerDummy<ramping, windowSize, phaseShift, CoefficientType, windowType, mp_sword, 16>::addBlock(buffer, chn, count);
+		else
+			SincPolyphaseResamplerDummy<ramping, windowSize, phaseShift, CoefficientType, windowType, mp_sbyte, 8>::addBlock(buffer, chn, count);
+	}
+};
+
+#endif
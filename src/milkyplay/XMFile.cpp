@@ -34,7 +34,10 @@
 #include "XMFile.h"
 
 XMFileBase::XMFileBase() :
-	baseOffset(0)
+	baseOffset(0),
+	memory(NULL),
+	memorySize(0),
+	memoryPos(0)
 {
 }
 
@@ -60,8 +63,25 @@ mp_uint32 XMFileBase::posWithBaseOffset()
 //////////////////////////////////////////////////////////////////////////
 // Reading/writing of little endian stuff								//
 //////////////////////////////////////////////////////////////////////////
+const mp_ubyte* XMFileBase::readInPlace(mp_uint32 numBytes, mp_uint32 numBytesAccessed/* = 0*/)
+{
+	if (memory == NULL || memoryPos > memorySize)
+		return NULL;
+
+	const mp_uint32 bytesLeft = memorySize - memoryPos;
+	if (numBytes > bytesLeft || numBytesAccessed > bytesLeft)
+		return NULL;
+
+	const mp_ubyte* ptr = memory + memoryPos;
+	memoryPos+=numBytes;
+	return ptr;
+}
+
 mp_ubyte XMFileBase::readByte()
 {
+	if (memory)
+		return memoryPos < memorySize ? memory[memoryPos++] : 0;
+
 	mp_ubyte c;
 	mp_sint32 bytesRead = read(&c,1,1);
 	//ASSERT(bytesRead == 1);
@@ -74,6 +94,19 @@ mp_ubyte XMFileBase::readByte()
 
 mp_uword XMFileBase::readWord()
 {
+	if (memory)
+	{
+		const mp_ubyte* c = readInPlace(2);
+		if (c == NULL)
+		{
+			// like read(), a truncated word is consumed anyway
+			if (memoryPos < memorySize)
+				memoryPos = memorySize;
+			return 0;
+		}
+		return (mp_uword)((mp_uword)c[0]+((mp_uword)c[1]<<8));
+	}
+
 	mp_ubyte c[2];
 	mp_sint32 bytesRead = read(&c,1,2);
 	//ASSERT(bytesRead == 2);
@@ -86,6 +119,21 @@ mp_uword XMFileBase::readWord()
 
 mp_dword XMFileBase::readDword()
 {
+	if (memory)
+	{
+		const mp_ubyte* c = readInPlace(4);
+		if (c == NULL)
+		{
+			if (memoryPos < memorySize)
+				memoryPos = memorySize;
+			return 0;
+		}
+		return (mp_dword)((mp_uint32)c[0]+
+						  ((mp_uint32)c[1]<<8)+
+						  ((mp_uint32)c[2]<<16)+
+						  ((mp_uint32)c[3]<<24));
+	}
+
 	mp_ubyte c[4];
 	mp_sint32 bytesRead = read(&c,1,4);
 	//ASSERT(bytesRead == 4);
@@ -514,3 +562,229 @@ const char* XMFile::getFileNameASCII()
 }
 
 #endif
+
+//////////////////////////////////////////////////////////////////////////
+// Files in memory														//
+//////////////////////////////////////////////////////////////////////////
+XMMemoryFile::XMMemoryFile(const void* data, mp_uint32 size, const SYSCHAR* fileName/* = NULL*/) :
+	XMFileBase(),
+	fileName(fileName),
+	fileNameASCII(NULL)
+{
+	memory = (const mp_ubyte*)data;
+	memorySize = size;
+}
+
+XMMemoryFile::~XMMemoryFile()
+{
+	delete[] fileNameASCII;
+}
+
+mp_sint32 XMMemoryFile::read(void* ptr, mp_sint32 size, mp_sint32 count)
+{
+	if (size <= 0 || count <= 0 || memoryPos >= memorySize)
+		return 0;
+
+	mp_uint32 numBytes = size*count;
+	if (numBytes > memorySize - memoryPos)
+		numBytes = memorySize - memoryPos;
+
+	memcpy(ptr, memory + memoryPos, numBytes);
+	memoryPos+=numBytes;
+
+	// like fread, a partial element is consumed but not counted
+	return (mp_sint32)(numBytes / size * size);
+}
+
+void XMMemoryFile::seek(mp_uint32 pos, SeekOffsetTypes seekOffsetType/* = SeekOffsetTypeStart*/)
+{
+	if (seekOffsetType == SeekOffsetTypeCurrent)
+		memoryPos+=pos;
+	else if (seekOffsetType == SeekOffsetTypeEnd)
+		memoryPos = memorySize + pos;
+	else
+		memoryPos = pos;
+}
+
+const char* XMMemoryFile::getFileNameASCII()
+{
+	if (fileNameASCII)
+		return fileNameASCII;
+
+	const SYSCHAR* name = fileName;
+	mp_uint32 length = 0;
+
+	if (name)
+	{
+		for (const SYSCHAR* ptr = fileName; *ptr; ptr++)
+		{
+			if (*ptr == '/' || *ptr == '\\')
+				name = ptr + 1;
+		}
+
+		while (name[length])
+			length++;
+	}
+
+	fileNameASCII = new char[length+1];
+
+	for (mp_uint32 i = 0; i < length; i++)
+		fileNameASCII[i] = (char)name[i];
+	fileNameASCII[length] = 0;
+
+	return fileNameASCII;
+}
+
+XMBufferFile::XMBufferFile(const SYSCHAR* fileName/* = NULL*/) :
+	XMMemoryFile(NULL, 0, fileName),
+	buffer(NULL),
+	capacity(0)
+{
+}
+
+XMBufferFile::~XMBufferFile()
+{
+	delete[] buffer;
+}
+
+mp_sint32 XMBufferFile::write(const void* ptr, mp_sint32 size, mp_sint32 count)
+{
+	if (size <= 0 || count <= 0)
+		return 0;
+
+	const mp_uint32 numBytes = size*count;
+	const mp_uint32 end = memoryPos + numBytes;
+
+	if (end > capacity)
+	{
+		// grow by at least half of what we have to keep appending linear
+		mp_uint32 newCapacity = capacity + (capacity >> 1);
+		if (newCapacity < end)
+			newCapacity = end;
+		if (newCapacity < 4096)
+			newCapacity = 4096;
+
+		mp_ubyte* newBuffer = new mp_ubyte[newCapacity];
+		if (memorySize)
+			memcpy(newBuffer, buffer, memorySize);
+
+		delete[] buffer;
+		buffer = newBuffer;
+		capacity = newCapacity;
+		memory = buffer;
+	}
+
+	// seeking past the end leaves a gap which reads as zeros
+	if (memoryPos > memorySize)
+		memset(buffer + memorySize, 0, memoryPos - memorySize);
+
+	memcpy(buffer + memoryPos, ptr, numBytes);
+	memoryPos = end;
+
+	if (end > memorySize)
+		memorySize = end;
+
+	return count;
+}
+
+void XMBufferFile::clear()
+{
+	memorySize = memoryPos = 0;
+}
+
+#if defined(WIN32) && !defined(_WIN32_WCE)
+#define XMFILE_MAPPING_WIN32
+#elif defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
+#define XMFILE_MAPPING_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+XMMappedFile::XMMappedFile(const SYSCHAR* fileName) :
+	XMMemoryFile(NULL, 0, fileName),
+	mapping(NULL),
+	copy(NULL)
+{
+#if defined(XMFILE_MAPPING_WIN32)
+	HANDLE handle = CreateFile(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+							   OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+	if (handle != INVALID_HANDLE_VALUE)
+	{
+		const DWORD size = GetFileSize(handle, NULL);
+
+		// empty files can't be mapped
+		if (size != INVALID_FILE_SIZE && size)
+		{
+			mapping = CreateFileMapping(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+			if (mapping)
+			{
+				memory = (const mp_ubyte*)MapViewOfFile((HANDLE)mapping, FILE_MAP_READ, 0, 0, 0);
+				if (memory)
+				{
+					memorySize = size;
+				}
+				else
+				{
+					CloseHandle((HANDLE)mapping);
+					mapping = NULL;
+				}
+			}
+		}
+
+		CloseHandle(handle);
+	}
+#elif defined(XMFILE_MAPPING_POSIX)
+	int fd = open(fileName, O_RDONLY);
+
+	if (fd >= 0)
+	{
+		struct stat st;
+
+		// empty files can't be mapped
+		if (fstat(fd, &st) == 0 && st.st_size > 0)
+		{
+			void* ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (ptr != MAP_FAILED)
+			{
+				mapping = ptr;
+				memory = (const mp_ubyte*)ptr;
+				memorySize = (mp_uint32)st.st_size;
+			}
+		}
+
+		close(fd);
+	}
+#endif
+
+	if (memory == NULL)
+	{
+		XMFile f(fileName);
+
+		if (f.isOpen())
+		{
+			const mp_uint32 size = f.size();
+
+			copy = new mp_ubyte[size ? size : 1];
+			memorySize = f.read(copy, 1, size);
+			memory = copy;
+		}
+	}
+}
+
+XMMappedFile::~XMMappedFile()
+{
+#if defined(XMFILE_MAPPING_WIN32)
+	if (mapping)
+	{
+		UnmapViewOfFile(memory);
+		CloseHandle((HANDLE)mapping);
+	}
+#elif defined(XMFILE_MAPPING_POSIX)
+	if (mapping)
+		munmap(mapping, memorySize);
+#endif
+
+	delete[] copy;
+}
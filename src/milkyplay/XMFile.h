@@ -43,6 +43,13 @@ class XMFileBase
 {
 private:
 	mp_dword				baseOffset;
+
+protected:
+	// Files which are entirely in memory set these, the little endian
+	// helpers then read straight from memory without a virtual call
+	const mp_ubyte*			memory;
+	mp_uint32				memorySize;
+	mp_uint32				memoryPos;
 	
 public:
 							XMFileBase();
@@ -76,6 +83,12 @@ class XMFileBase
 	void					readWords(mp_uword* buffer,mp_sint32 count);
 	void					readDwords(mp_dword* buffer,mp_sint32 count);
 
+	// Memory backed files only: returns the next numBytes bytes and skips them.
+	// NULL if the file isn't in memory or less than numBytes or numBytesAccessed
+	// bytes are left, the caller then falls back to read().
+	// numBytesAccessed is for decoders which may run past the data they got.
+	const mp_ubyte*			readInPlace(mp_uint32 numBytes, mp_uint32 numBytesAccessed = 0);
+
 	void					writeByte(mp_ubyte b);
 	void					writeWord(mp_uword w);
 	void					writeDword(mp_dword dw);
@@ -130,4 +143,66 @@ class XMFile : public XMFileBase
 	static bool				remove(const SYSCHAR* file);
 };
 
+// Read only file on a buffer in memory, the buffer isn't copied
+class XMMemoryFile : public XMFileBase
+{
+private:
+	const SYSCHAR*  fileName;
+
+	char*			fileNameASCII;
+
+public:
+							XMMemoryFile(const void* data, mp_uint32 size, const SYSCHAR* fileName = NULL);
+	virtual					~XMMemoryFile();
+	
+	virtual mp_sint32		read(void* ptr,mp_sint32 size,mp_sint32 count);
+	virtual mp_sint32		write(const void* ptr,mp_sint32 size,mp_sint32 count) { return 0; }
+	
+	virtual void			seek(mp_uint32 pos, SeekOffsetTypes seekOffsetType = SeekOffsetTypeStart);
+	virtual mp_uint32		pos() { return memoryPos; }
+	virtual mp_uint32		size() { return memorySize; }
+	
+	virtual const SYSCHAR*  getFileName() { return fileName; }
+	
+	virtual const char*		getFileNameASCII();
+	
+	virtual bool			isOpen() { return memory != NULL; }
+	virtual bool			isOpenForWriting() { return false; }
+
+	const mp_ubyte*			getData() const { return memory; }
+};
+
+// Writable file on a buffer of its own which grows when written past the
+// end, what has been written can be read back like from an XMMemoryFile
+class XMBufferFile : public XMMemoryFile
+{
+private:
+	mp_ubyte*		buffer;
+	mp_uint32		capacity;
+
+public:
+							XMBufferFile(const SYSCHAR* fileName = NULL);
+	virtual					~XMBufferFile();
+	
+	virtual mp_sint32		write(const void* ptr,mp_sint32 size,mp_sint32 count);
+
+	virtual bool			isOpen() { return true; }
+	virtual bool			isOpenForWriting() { return true; }
+	
+	void					clear();
+};
+
+// Read only file mapped into memory. Where files can't be mapped
+// the file is read into memory as a whole.
+class XMMappedFile : public XMMemoryFile
+{
+private:
+	void*			mapping;
+	mp_ubyte*		copy;
+
+public:
+							XMMappedFile(const SYSCHAR* fileName);
+	virtual					~XMMappedFile();
+};
+
 #endif
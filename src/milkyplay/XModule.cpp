@@ -35,6 +35,7 @@
  */
 #include "XModule.h"
 #include "Loaders.h"
+#include "MilkyPlayThread.h"
 
 #undef VERBOSE
 
@@ -1476,24 +1477,37 @@ bool XModule::loadSample(XMFileBase& f,void* buffer,mp_uint32 size,mp_uint32 len
 
 		return true;
 	}
+
+	// 16 bit data of files in memory is converted straight from there,
+	// PTM deltas are applied to the raw bytes and need a copy
+	const mp_ubyte* srcPtr = NULL;
+	if ((flags & (ST_16BIT | ST_DELTA_PTM)) == ST_16BIT)
+		srcPtr = f.readInPlace(length*2);
+
+	if (srcPtr)
+	{
+		if (size > length*2)
+			memset((mp_ubyte*)buffer + length*2, 0, size - length*2);
+	}
 	else
 	{
 		memset(buffer, 0, size);
 		f.read(buffer,flags & ST_16BIT ? 2 : 1, length);
+		srcPtr = (const mp_ubyte*)buffer;
 	}
 
 	// 16 bit sample
 	if (flags & ST_16BIT)
 	{
 		mp_sword* dstPtr = (mp_sword*)buffer;
-		mp_ubyte* srcPtr = (mp_ubyte*)buffer;
 
 		// PTM delta storing
 		if (flags & ST_DELTA_PTM)
 		{
+			mp_ubyte* deltaPtr = (mp_ubyte*)buffer;
 			mp_sbyte b1=0;
 			for (mp_uint32 i = 0; i < length*2; i++)
-				srcPtr[i] = b1+=srcPtr[i];
+				deltaPtr[i] = b1+=deltaPtr[i];
 		}
 
 		mp_uint32 i;
@@ -1555,7 +1569,7 @@ bool XModule::loadSample(XMFileBase& f,void* buffer,mp_uint32 size,mp_uint32 len
 
 mp_sint32 XModule::loadModuleSample(XMFileBase& f, mp_sint32 index,
 									mp_sint32 flags8/* = ST_DEFAULT*/, mp_sint32 flags16/* = ST_16BIT*/,
-									mp_uint32 alternateSize/* = 0*/)
+									mp_uint32 alternateSize/* = 0*/, bool deferred/* = false*/)
 {
 	if (smp[index].type & 16)
 	{
@@ -1569,7 +1583,11 @@ mp_sint32 XModule::loadModuleSample(XMFileBase& f, mp_sint32 index,
 			return MP_OUT_OF_MEMORY;
 		}
 
-		if (!loadSample(f,smp[index].sample, finalSize, smp[index].samplen, flags16))
+		bool res = deferred ?
+			loadSampleDeferred(f, smp[index].sample, finalSize, smp[index].samplen, flags16, smp[index].samplen*2) :
+			loadSample(f, smp[index].sample, finalSize, smp[index].samplen, flags16);
+
+		if (!res)
 		{
 			return MP_OUT_OF_MEMORY;
 		}
@@ -1586,7 +1604,11 @@ mp_sint32 XModule::loadModuleSample(XMFileBase& f, mp_sint32 index,
 			return MP_OUT_OF_MEMORY;
 		}
 
-		if (!loadSample(f,smp[index].sample, finalSize, smp[index].samplen, flags8))
+		bool res = deferred ?
+			loadSampleDeferred(f, smp[index].sample, finalSize, smp[index].samplen, flags8, smp[index].samplen) :
+			loadSample(f, smp[index].sample, finalSize, smp[index].samplen, flags8);
+
+		if (!res)
 		{
 			return MP_OUT_OF_MEMORY;
 		}
@@ -1606,6 +1628,596 @@ mp_sint32 XModule::loadModuleSamples(XMFileBase& f, mp_sint32 flags8/* = ST_DEFA
 	return MP_OK;
 }
 
+struct XModule::TDeferredSample
+{
+	// the file from the start of the sample to its end
+	const mp_ubyte*	data;
+	mp_uint32		dataSize;
+
+	void*			buffer;
+	mp_uint32		size;
+	mp_uint32		length;
+	mp_sint32		flags;
+};
+
+bool XModule::loadSampleDeferred(XMFileBase& f, void* buffer, mp_uint32 size, mp_uint32 length,
+								 mp_sint32 flags/* = ST_DEFAULT*/, mp_uint32 storedSize/* = 0*/)
+{
+	const mp_ubyte* data = f.readInPlace(0);
+
+	if (data == NULL)
+		return loadSample(f, buffer, size, length, flags);
+
+	if (numDeferredSamples == numDeferredSamplesAlloc)
+	{
+		numDeferredSamplesAlloc = numDeferredSamplesAlloc ? numDeferredSamplesAlloc*2 : 64;
+
+		TDeferredSample* samples = new TDeferredSample[numDeferredSamplesAlloc];
+		if (numDeferredSamples)
+			memcpy(samples, deferredSamples, numDeferredSamples*sizeof(TDeferredSample));
+
+		delete[] deferredSamples;
+		deferredSamples = samples;
+	}
+
+	TDeferredSample& sample = deferredSamples[numDeferredSamples++];
+
+	sample.data = data;
+	sample.dataSize = f.size() - f.pos();
+	sample.buffer = buffer;
+	sample.size = size;
+	sample.length = length;
+	sample.flags = flags;
+
+	// like reading the sample, which stops at the end of the file
+	if (storedSize)
+		f.seek(storedSize < sample.dataSize ? storedSize : sample.dataSize, XMFileBase::SeekOffsetTypeCurrent);
+
+	return true;
+}
+
+/*
+ * Deferred samples are handed out one by one to a couple of workers,
+ * every sample reads from a memory file of its own.
+ */
+struct DeferredSampleJob
+{
+	XModule::TDeferredSample*	samples;
+	mp_uint32					numSamples;
+	mp_uint32					nextSample;
+	bool						result;
+
+	MPMutex						mutex;
+
+	void work();
+};
+
+void DeferredSampleJob::work()
+{
+	for (;;)
+	{
+		mutex.lock();
+		if (nextSample >= numSamples)
+		{
+			mutex.unlock();
+			break;
+		}
+
+		XModule::TDeferredSample& sample = samples[nextSample++];
+		mutex.unlock();
+
+		XMMemoryFile f(sample.data, sample.dataSize);
+
+		if (!XModule::loadSample(f, sample.buffer, sample.size, sample.length, sample.flags))
+		{
+			mutex.lock();
+			result = false;
+			mutex.unlock();
+		}
+	}
+}
+
+class DeferredSampleWorker : public MPThread
+{
+private:
+	DeferredSampleJob& job;
+
+protected:
+	virtual void run()
+	{
+		job.work();
+	}
+
+public:
+	DeferredSampleWorker(DeferredSampleJob& job) :
+		job(job)
+	{
+	}
+
+	virtual ~DeferredSampleWorker()
+	{
+		join();
+	}
+};
+
+/*
+ * Samples of a lazily loaded module stay in the mapped file until a thread
+ * has decoded them. It decodes first what a player asked for, then what the
+ * song plays within the next LookAheadRows rows of the player's position,
+ * then the samples in the order the song plays them and last everything
+ * else. The players never wait for it, a note of a sample which isn't
+ * decoded yet is not played. Samples are decoded with the mutex held, which
+ * only the thread and decodeAll() take.
+ */
+class LazySampleLoader : public MPThread
+{
+private:
+	enum
+	{
+		LookAheadRows = 64
+	};
+
+	// the deferred samples a pattern plays, with the row each one is
+	// played first
+	struct TPatternSamples
+	{
+		mp_uint32					numRows;
+		mp_uint32					first;
+		mp_uint32					num;
+	};
+
+	XModule&					module;
+	XMFileBase*					file;
+
+	XModule::TDeferredSample*	samples;
+	mp_uint32					numSamples;
+	MPAtomicIndex*				decoded;
+
+	// the deferred sample of every module sample, -1 for none
+	mp_sint32*					sampleIndices;
+	mp_uint32					numModuleSamples;
+
+	// a copy of the order list and of what the patterns play, so the
+	// thread doesn't read the patterns while they're being edited
+	mp_ubyte					orders[MP_MAXORDERS];
+	mp_uint32					numOrders;
+	TPatternSamples				patternSamples[256];
+	mp_uint32*					patternSampleRows;
+	mp_sint32*					patternSampleIndices;
+
+	// deferred samples in the order the song plays them
+	mp_sint32*					playOrder;
+	mp_uint32					numPlayOrder;
+	mp_uint32					nextPlayOrder;
+	mp_uint32					nextSample;
+
+	MPAtomicIndex				numPending;
+	// deferred sample + 1 a player asked for, written by the player only
+	MPAtomicIndex				requested;
+	// (order * 256 + pattern) * 512 + row + 1, written by the player only
+	MPAtomicIndex				position;
+
+	bool						stopped;
+	bool						result;
+
+	MPMutex						mutex;
+
+	bool isDecoded(mp_sint32 index) const
+	{
+		return decoded[index].get() != 0;
+	}
+
+	// with the mutex held
+	void decode(mp_sint32 index)
+	{
+		if (isDecoded(index))
+			return;
+
+		XModule::TDeferredSample& sample = samples[index];
+		XMMemoryFile f(sample.data, sample.dataSize);
+
+		if (!XModule::loadSample(f, sample.buffer, sample.size, sample.length, sample.flags))
+		{
+			memset(sample.buffer, 0, sample.size);
+			result = false;
+		}
+
+		// the loader skipped the post processing of the module samples
+		// playing it, MDL lets several of them share one
+		for (mp_uint32 i = 0; i < numModuleSamples; i++)
+		{
+			if (sampleIndices[i] == index)
+				module.smp[i].postProcessSamples();
+		}
+
+		decoded[index].set(1);
+		numPending.set(numPending.get() - 1);
+	}
+
+	mp_sint32 findLookAheadSample() const
+	{
+		const mp_uint32 pos = position.get();
+		if (pos == 0)
+			return -1;
+
+		mp_uint32 order = (pos - 1) >> 17;
+		mp_uint32 pattern = ((pos - 1) >> 9) & 255;
+		mp_uint32 row = (pos - 1) & 511;
+
+		mp_sint32 rowsLeft = LookAheadRows;
+		while (rowsLeft > 0)
+		{
+			const TPatternSamples& uses = patternSamples[pattern];
+			for (mp_uint32 i = uses.first; i < uses.first + uses.num; i++)
+			{
+				if (patternSampleRows[i] >= row && patternSampleRows[i] < row + (mp_uint32)rowsLeft &&
+					!isDecoded(patternSampleIndices[i]))
+					return patternSampleIndices[i];
+			}
+
+			if (uses.numRows > row)
+				rowsLeft -= uses.numRows - row;
+			if (++order >= numOrders)
+				break;
+			pattern = orders[order];
+			row = 0;
+		}
+
+		return -1;
+	}
+
+	// the deferred sample to decode next, -1 if there is none left
+	mp_sint32 findNextSample()
+	{
+		const mp_uint32 req = requested.get();
+		if (req && !isDecoded(req - 1))
+			return req - 1;
+
+		const mp_sint32 index = findLookAheadSample();
+		if (index >= 0)
+			return index;
+
+		for (; nextPlayOrder < numPlayOrder; nextPlayOrder++)
+		{
+			if (!isDecoded(playOrder[nextPlayOrder]))
+				return playOrder[nextPlayOrder];
+		}
+
+		for (; nextSample < numSamples; nextSample++)
+		{
+			if (!isDecoded(nextSample))
+				return nextSample;
+		}
+
+		return -1;
+	}
+
+	// the deferred sample module sample sampleIndex plays, -1 for none
+	mp_sint32 getSampleIndex(mp_sint32 sampleIndex) const
+	{
+		return sampleIndex >= 0 && sampleIndex < (signed)numModuleSamples ? sampleIndices[sampleIndex] : -1;
+	}
+
+	// the deferred sample played by a pattern slot, -1 for none
+	mp_sint32 getSlotSample(const mp_ubyte* slot) const
+	{
+		const mp_sint32 note = slot[0];
+		const mp_sint32 ins = slot[1];
+
+		if (!ins || ins > module.header.insnum || note < 1 || note > 120)
+			return -1;
+
+		return getSampleIndex(module.instr[ins-1].snum[note-1]);
+	}
+
+	void scanPatterns()
+	{
+		const TXMHeader& header = module.header;
+
+		memset(patternSamples, 0, sizeof(patternSamples));
+
+		numOrders = header.ordnum < MP_MAXORDERS ? header.ordnum : MP_MAXORDERS;
+		memcpy(orders, header.ord, numOrders);
+
+		// the pattern that listed a sample last + 1
+		mp_uint32* listed = new mp_uint32[numSamples];
+
+		mp_uint32 numUses = 0;
+		mp_uint32 p, i, j;
+		for (int pass = 0; pass < 2; pass++)
+		{
+			memset(listed, 0, numSamples*sizeof(mp_uint32));
+			numUses = 0;
+
+			for (p = 0; p < header.patnum && p < 256; p++)
+			{
+				const TXMPattern& pattern = module.phead[p];
+				if (pattern.patternData == NULL)
+					continue;
+
+				patternSamples[p].numRows = pattern.rows;
+				patternSamples[p].first = numUses;
+
+				const mp_sint32 slotSize = pattern.effnum*2+2;
+				const mp_ubyte* slot = pattern.patternData;
+
+				for (j = 0; j < (mp_uint32)pattern.rows*pattern.channum; j++, slot+=slotSize)
+				{
+					const mp_sint32 index = getSlotSample(slot);
+					if (index < 0 || listed[index] == p + 1)
+						continue;
+
+					listed[index] = p + 1;
+					if (pass)
+					{
+						patternSampleRows[numUses] = j / pattern.channum;
+						patternSampleIndices[numUses] = index;
+					}
+					numUses++;
+				}
+
+				patternSamples[p].num = numUses - patternSamples[p].first;
+			}
+
+			if (!pass)
+			{
+				patternSampleRows = new mp_uint32[numUses ? numUses : 1];
+				patternSampleIndices = new mp_sint32[numUses ? numUses : 1];
+			}
+		}
+
+		// the song order, every sample once
+		memset(listed, 0, numSamples*sizeof(mp_uint32));
+		playOrder = new mp_sint32[numSamples];
+		numPlayOrder = 0;
+
+		for (i = 0; i < numOrders; i++)
+		{
+			const TPatternSamples& uses = patternSamples[orders[i]];
+			for (j = uses.first; j < uses.first + uses.num; j++)
+			{
+				const mp_sint32 index = patternSampleIndices[j];
+				if (!listed[index])
+				{
+					listed[index] = 1;
+					playOrder[numPlayOrder++] = index;
+				}
+			}
+		}
+
+		delete[] listed;
+	}
+
+protected:
+	virtual void run()
+	{
+		for (;;)
+		{
+			const mp_sint32 index = findNextSample();
+			if (index < 0)
+				return;
+
+			mutex.lock();
+			if (stopped)
+			{
+				mutex.unlock();
+				return;
+			}
+			decode(index);
+			mutex.unlock();
+		}
+	}
+
+public:
+	LazySampleLoader(XModule& module, XMFileBase* file,
+					 XModule::TDeferredSample* samples, mp_uint32 numSamples,
+					 mp_sint32* sampleIndices, mp_uint32 numModuleSamples) :
+		module(module),
+		file(file),
+		samples(samples),
+		numSamples(numSamples),
+		decoded(new MPAtomicIndex[numSamples]),
+		sampleIndices(sampleIndices),
+		numModuleSamples(numModuleSamples),
+		numOrders(0),
+		patternSampleRows(NULL),
+		patternSampleIndices(NULL),
+		playOrder(NULL),
+		numPlayOrder(0),
+		nextPlayOrder(0),
+		nextSample(0),
+		stopped(false),
+		result(true)
+	{
+		numPending.set(numSamples);
+
+		scanPatterns();
+
+		// samples nobody plays are decoded right away, so the
+		// post processing may free the empty ones
+		bool* played = new bool[numSamples];
+		memset(played, 0, numSamples*sizeof(bool));
+
+		mp_uint32 i;
+		for (i = 0; i < numModuleSamples; i++)
+		{
+			if (sampleIndices[i] >= 0 && module.smp[i].samplen)
+				played[sampleIndices[i]] = true;
+		}
+
+		for (i = 0; i < numSamples; i++)
+		{
+			if (!played[i])
+				decode(i);
+		}
+
+		delete[] played;
+	}
+
+	virtual ~LazySampleLoader()
+	{
+		mutex.lock();
+		stopped = true;
+		mutex.unlock();
+
+		join();
+
+		delete[] playOrder;
+		delete[] patternSampleIndices;
+		delete[] patternSampleRows;
+		delete[] sampleIndices;
+		delete[] decoded;
+		delete[] samples;
+		delete file;
+	}
+
+	// any thread
+	bool isPending(mp_sint32 sampleIndex) const
+	{
+		const mp_sint32 index = getSampleIndex(sampleIndex);
+		return index >= 0 && !isDecoded(index);
+	}
+
+	// the player's thread, never blocks. If the sample isn't decoded yet
+	// the thread is asked to do that next
+	bool isReady(mp_sint32 sampleIndex)
+	{
+		if (numPending.get() == 0)
+			return true;
+
+		const mp_sint32 index = getSampleIndex(sampleIndex);
+		if (index < 0 || isDecoded(index))
+			return true;
+
+		requested.set(index + 1);
+		return false;
+	}
+
+	// the player's thread
+	void setPosition(mp_uint32 order, mp_uint32 pattern, mp_uint32 row)
+	{
+		if (numPending.get())
+			position.set((((order & 511) << 8 | (pattern & 255)) << 9 | (row & 511)) + 1);
+	}
+
+	bool decodeAll()
+	{
+		mutex.lock();
+		for (mp_uint32 i = 0; i < numSamples; i++)
+			decode(i);
+		bool res = result;
+		mutex.unlock();
+
+		return res;
+	}
+};
+
+bool XModule::decodeDeferredSamples()
+{
+	if (numDeferredSamples == 0)
+		return true;
+
+	// the samples are decoded when they're needed, see LazySampleLoader
+	if (lazySampleFile)
+	{
+		// module sample => deferred sample
+		mp_sint32* slotSamples = new mp_sint32[samplePointerIndex];
+		mp_sint32* sampleIndices = new mp_sint32[header.smpnum];
+
+		mp_uint32 i;
+		for (i = 0; i < samplePointerIndex; i++)
+			slotSamples[i] = -1;
+
+		for (i = 0; i < numDeferredSamples; i++)
+		{
+			mp_sint32 slot = findSampleSlot((mp_ubyte*)deferredSamples[i].buffer);
+			if (slot >= 0)
+				slotSamples[slot] = i;
+		}
+
+		for (i = 0; i < header.smpnum; i++)
+		{
+			mp_sint32 slot = smp[i].sample ? findSampleSlot((mp_ubyte*)smp[i].sample) : -1;
+			sampleIndices[i] = slot >= 0 ? slotSamples[slot] : -1;
+		}
+
+		delete[] slotSamples;
+
+		delete lazySampleLoader;
+		lazySampleLoader = new LazySampleLoader(*this, lazySampleFile,
+												deferredSamples, numDeferredSamples,
+												sampleIndices, header.smpnum);
+
+		// the loader owns them now
+		lazySampleFile = NULL;
+		deferredSamples = NULL;
+		numDeferredSamples = numDeferredSamplesAlloc = 0;
+
+		return true;
+	}
+
+	DeferredSampleJob job;
+	job.samples = deferredSamples;
+	job.numSamples = numDeferredSamples;
+	job.nextSample = 0;
+	job.result = true;
+
+	// starting threads doesn't pay off for a few short samples
+	mp_uint32 totalLength = 0;
+	for (mp_uint32 i = 0; i < numDeferredSamples && totalLength < 0x40000; i++)
+		totalLength+=deferredSamples[i].length;
+
+	mp_uint32 numWorkers = totalLength < 0x40000 ? 1 : MPThread::getNumProcessors();
+	if (numWorkers > numDeferredSamples)
+		numWorkers = numDeferredSamples;
+
+	// the calling thread is one of the workers
+	DeferredSampleWorker** workers = NULL;
+	mp_uint32 numThreads = 0;
+
+	if (numWorkers > 1)
+	{
+		workers = new DeferredSampleWorker*[numWorkers - 1];
+
+		for (mp_uint32 i = 0; i < numWorkers - 1; i++)
+		{
+			workers[numThreads] = new DeferredSampleWorker(job);
+			if (!workers[numThreads]->start())
+			{
+				delete workers[numThreads];
+				break;
+			}
+			numThreads++;
+		}
+	}
+
+	job.work();
+
+	for (mp_uint32 i = 0; i < numThreads; i++)
+		delete workers[i];
+
+	delete[] workers;
+
+	numDeferredSamples = 0;
+
+	return job.result;
+}
+
+bool XModule::isLazySampleReady(mp_sint32 index)
+{
+	return lazySampleLoader->isReady(index);
+}
+
+void XModule::setLazySamplePosition(mp_sint32 order, mp_sint32 pattern, mp_sint32 row)
+{
+	lazySampleLoader->setPosition(order, pattern, row);
+}
+
+bool XModule::decodeLazySamples()
+{
+	return lazySampleLoader ? lazySampleLoader->decodeAll() : true;
+}
+
 ////////////////////////////////////////////
 // Before using the sample postprocessing //
 // please make sure that the memory       //
@@ -1630,6 +2242,10 @@ void XModule::postProcessSamples(bool heavy/* = false*/)
 			continue;
 		}
 
+		// done when it's decoded
+		if (lazySampleLoader && lazySampleLoader->isPending(i))
+			continue;
+
 		if (heavy)
 			smp->smoothLooping();
 
@@ -1649,72 +2265,123 @@ void XModule::setDefaultPanning()
 	}
 }
 
-mp_ubyte* XModule::allocSampleMem(mp_uint32 size)
+mp_sint32 XModule::findSampleSlot(mp_ubyte* mem) const
 {
-	// sample is always padded at start and end with 16 bytes
+	// the sample remembers its slot, unless it has been copied over from somewhere else
+	mp_uint32 slot = TXMSample::getPoolIndex(mem);
+	if (slot < samplePointerIndex && samplePool[slot] == mem)
+		return slot;
+
 	for (mp_sint32 i = 0; i < (signed)samplePointerIndex; i++)
 	{
-		if (samplePool[i] == NULL)
-		{
-			samplePool[i] = TXMSample::allocPaddedMem(size);
-			return samplePool[i];
-		}
+		if (samplePool[i] == mem)
+			return i;
 	}
 
-	samplePool[samplePointerIndex] = TXMSample::allocPaddedMem(size);
-	return samplePool[samplePointerIndex++];
+	return -1;
 }
 
-void XModule::freeSampleMem(mp_ubyte* mem, bool assertCheck/* = true*/)
+void XModule::addSampleToPool(mp_ubyte* mem)
 {
-	bool found = false;
-	for (mp_sint32 i = 0; i < (signed)samplePointerIndex; i++)
+	mp_uint32 slot = numFreeSampleSlots ? freeSampleSlots[--numFreeSampleSlots] : samplePointerIndex++;
+
+	samplePool[slot] = mem;
+	TXMSample::setPoolIndex(mem, slot);
+
+	sampleBytesInUse+=TXMSample::getPaddedSize(TXMSample::getSampleSizeInBytes(mem));
+	if (sampleBytesInUse > peakSampleBytesInUse)
+		peakSampleBytesInUse = sampleBytesInUse;
+}
+
+void XModule::removeSampleFromPool(mp_uint32 slot)
+{
+	sampleBytesInUse-=TXMSample::getPaddedSize(TXMSample::getSampleSizeInBytes(samplePool[slot]));
+
+	samplePool[slot] = NULL;
+	freeSampleSlots[numFreeSampleSlots++] = (mp_uword)slot;
+}
+
+void XModule::releaseSampleMem()
+{
+	// the loader may still be decoding into them
+	delete lazySampleLoader;
+	lazySampleLoader = NULL;
+
+	for (mp_uint32 i = 0; i < samplePointerIndex; i++)
 	{
-		if (samplePool[i] == mem)
+		if (samplePool[i])
 		{
-			found = true;
 			TXMSample::freePaddedMem(samplePool[i]);
 			samplePool[i] = NULL;
-			if (i == (signed)samplePointerIndex - 1)
-			{
-				samplePointerIndex--;
-				break;
-			}
 		}
 	}
 
+	samplePointerIndex = 0;
+	numFreeSampleSlots = 0;
+	sampleBytesInUse = peakSampleBytesInUse = 0;
+}
+
+mp_ubyte* XModule::allocSampleMem(mp_uint32 size)
+{
+	if (numFreeSampleSlots == 0 && samplePointerIndex >= MP_MAXSAMPLES)
+		return NULL;
+
+	// sample is always padded, at the start with the loop properties and the
+	// loop area backup (TXMSample::LeadingPadding), at the end with
+	// TXMSample::TrailingPadding bytes
+	mp_ubyte* mem = TXMSample::allocPaddedMem(size);
+	if (mem == NULL)
+		return NULL;
+
+	addSampleToPool(mem);
+	return mem;
+}
+
+void XModule::freeSampleMem(mp_ubyte* mem, bool assertCheck/* = true*/)
+{
+	if (mem == NULL)
+		return;
+
+	mp_sint32 slot = findSampleSlot(mem);
+	if (slot >= 0)
+	{
+		removeSampleFromPool(slot);
+		TXMSample::freePaddedMem(mem);
+	}
+
 	if (assertCheck)
 	{
-		ASSERT(found);
+		ASSERT(slot >= 0);
 	}
 }
 
 #ifdef MILKYTRACKER
 void XModule::insertSamplePtr(mp_ubyte* ptr)
 {
-	for (mp_sint32 i = 0; i < (signed)samplePointerIndex; i++)
-	{
-		if (samplePool[i] == NULL)
-		{
-			samplePool[i] = ptr;
-			return;
-		}
-	}
+	if (ptr == NULL || (numFreeSampleSlots == 0 && samplePointerIndex >= MP_MAXSAMPLES))
+		return;
 
-	samplePool[samplePointerIndex++] = ptr;
+	addSampleToPool(ptr);
 }
 void XModule::removeSamplePtr(mp_ubyte* ptr)
 {
-	for (mp_sint32 i = 0; i < (signed)samplePointerIndex; i++)
-	{
-		if (samplePool[i] == ptr)
-		{
-			samplePool[i] = NULL;
-		}
-	}
+	if (ptr == NULL)
+		return;
+
+	mp_sint32 slot = findSampleSlot(ptr);
+	if (slot >= 0)
+		removeSampleFromPool(slot);
 }
 #endif
 
+void XModule::getSampleMemoryStats(TSampleMemoryStats& stats) const
+{
+	stats.numSamples = samplePointerIndex - numFreeSampleSlots;
+	stats.numFreeSlots = numFreeSampleSlots;
+	stats.bytesInUse = sampleBytesInUse;
+	stats.peakBytesInUse = peakSampleBytesInUse;
+}
+
 bool XModule::addEnvelope(TEnvelope*& envs,
 						  const TEnvelope& env,
 						  mp_uint32& numEnvsAlloc,
@@ -1839,15 +2506,7 @@ bool XModule::cleanUp()
 	}
 
 	// release sample-memory
-	for (i = 0; i < samplePointerIndex; i++)
-	{
-		if (samplePool[i])
-		{
-			TXMSample::freePaddedMem(samplePool[i]);
-			samplePool[i] = NULL;
-		}
-	}
-	samplePointerIndex = 0;
+	releaseSampleMem();
 
 	memset(&header,0,sizeof(TXMHeader));
 
@@ -1916,6 +2575,14 @@ XModule::XModule()
 	memset(samplePool,0,sizeof(samplePool));
 	// reset current sample index
 	samplePointerIndex = 0;
+	numFreeSampleSlots = 0;
+	sampleBytesInUse = peakSampleBytesInUse = 0;
+
+	deferredSamples = NULL;
+	numDeferredSamples = numDeferredSamplesAlloc = 0;
+
+	lazySampleFile = NULL;
+	lazySampleLoader = NULL;
 
 	memset(&header,0,sizeof(TXMHeader));
 
@@ -1989,6 +2656,7 @@ XModule::~XModule()
 	delete[] phead;
 	delete[] instr;
 	delete[] smp;
+	delete[] deferredSamples;
 }
 
 const char* XModule::identifyModule(const mp_ubyte* buffer)
@@ -2011,10 +2679,33 @@ const char* XModule::identifyModule(const mp_ubyte* buffer)
 	return NULL;
 }
 
-mp_sint32 XModule::loadModule(const SYSCHAR* fileName, bool scanForSubSongs/* = false*/)
+mp_sint32 XModule::loadModule(const SYSCHAR* fileName, bool scanForSubSongs/* = false*/, bool lazySamples/* = false*/)
 {
-	XMFile f(fileName);
-	return f.isOpen() ? loadModule(f, scanForSubSongs) : -8;
+	if (!lazySamples)
+	{
+		XMMappedFile f(fileName);
+		return f.isOpen() ? loadModule(f, scanForSubSongs) : -8;
+	}
+
+	XMMappedFile* f = new XMMappedFile(fileName);
+	if (!f->isOpen())
+	{
+		delete f;
+		return -8;
+	}
+
+	// decodeDeferredSamples hands the file over to a LazySampleLoader
+	lazySampleFile = f;
+	mp_sint32 res = loadModule(*f, scanForSubSongs);
+
+	delete lazySampleFile;
+	lazySampleFile = NULL;
+
+	// without threads everything is decoded right here
+	if (res == MP_OK && lazySampleLoader && !lazySampleLoader->start())
+		lazySampleLoader->decodeAll();
+
+	return res;
 }
 
 mp_sint32 XModule::loadModule(XMFileBase& f, bool scanForSubSongs/* = false*/)
@@ -2037,7 +2728,14 @@ mp_sint32 XModule::loadModule(XMFileBase& f, bool scanForSubSongs/* = false*/)
 			// try to load module
 			f.seekWithBaseOffset(0);
 			mp_sint32 err = loaderInfo->loader->load(f, this);
-			if (err == MP_OK)
+			// a loader which failed may have left samples undecoded
+			numDeferredSamples = 0;
+			if (err != MP_OK)
+			{
+				delete lazySampleLoader;
+				lazySampleLoader = NULL;
+			}
+			else
 			{
 				moduleLoaded = true;
 
@@ -2734,16 +3432,7 @@ void XModule::createEmptySong(bool clearPatterns/* = true*/, bool clearInstrumen
 		}
 
 		// release sample-memory
-		for (i = 0; i < samplePointerIndex; i++)
-		{
-			if (samplePool[i])
-			{
-				TXMSample::freePaddedMem(samplePool[i]);
-				samplePool[i] = NULL;
-			}
-		}
-
-		samplePointerIndex = 0;
+		releaseSampleMem();
 
 		if (instr)
 		{
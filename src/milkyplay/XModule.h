@@ -147,6 +147,8 @@ struct TXMSample
 		mp_uint32 samplesize;
 		mp_ubyte state[4];
 		mp_uint32 lastloopend;
+		// slot in the sample pool of the owning module, see XModule::allocSampleMem
+		mp_uint32 poolIndex;
 	};
 
 	enum
@@ -247,6 +249,18 @@ struct TXMSample
 		return loopBufferProps->samplesize;
 	}
 
+	static mp_uint32 getPoolIndex(mp_ubyte* mem)
+	{
+		TLoopDoubleBuffProps* loopBufferProps = (TLoopDoubleBuffProps*)getPadStartAddr(mem);
+		return loopBufferProps->poolIndex;
+	}
+
+	static void setPoolIndex(mp_ubyte* mem, mp_uint32 poolIndex)
+	{
+		TLoopDoubleBuffProps* loopBufferProps = (TLoopDoubleBuffProps*)getPadStartAddr(mem);
+		loopBufferProps->poolIndex = poolIndex;
+	}
+
 	static mp_uint32 getSampleSizeInSamples(mp_ubyte* mem)
 	{
 		TLoopDoubleBuffProps* loopBufferProps = (TLoopDoubleBuffProps*)getPadStartAddr(mem);
@@ -309,6 +323,8 @@ struct TXMPattern
 #endif
 };
 
+class LazySampleLoader;
+
 //////////////////////////////////////////////////////////////////////////
 // This is the class which handles a MilkyPlay module					//
 //////////////////////////////////////////////////////////////////////////
@@ -445,14 +461,63 @@ class XModule
 
 	///////////////////////////////////////////////////////
 	// load a bunch of samples into memory				 //
+	// deferred samples go through loadSampleDeferred    //
 	///////////////////////////////////////////////////////
 	mp_sint32			loadModuleSample(XMFileBase& f, mp_sint32 index,
 										 mp_sint32 flags8 = ST_DEFAULT, mp_sint32 flags16 = ST_16BIT,
-										 mp_uint32 alternateSize = 0);
+										 mp_uint32 alternateSize = 0, bool deferred = false);
 
 	mp_sint32			loadModuleSamples(XMFileBase& f,
 										  mp_sint32 flags8 = ST_DEFAULT, mp_sint32 flags16 = ST_16BIT);
 
+	///////////////////////////////////////////////////////
+	// Like loadSample, but samples of files in memory   //
+	// are only recorded and decoded later on several    //
+	// threads by decodeDeferredSamples. The file is     //
+	// advanced by storedSize, loaders which seek to     //
+	// every sample themselves pass 0.                   //
+	///////////////////////////////////////////////////////
+	struct				TDeferredSample;
+
+	bool				loadSampleDeferred(XMFileBase& f, void* buffer,
+										   mp_uint32 size, mp_uint32 length,
+										   mp_sint32 flags = ST_DEFAULT, mp_uint32 storedSize = 0);
+
+	///////////////////////////////////////////////////////
+	// decode all deferred samples, must be called       //
+	// before postProcessSamples, false if one failed    //
+	// When loading lazily they are left to the          //
+	// LazySampleLoader instead.                         //
+	///////////////////////////////////////////////////////
+	bool				decodeDeferredSamples();
+
+	///////////////////////////////////////////////////////
+	// A lazily loaded sample might not be decoded yet,  //
+	// the players skip notes of samples which aren't.   //
+	// Never blocks, the decoding thread is asked to     //
+	// decode the sample next instead.                   //
+	///////////////////////////////////////////////////////
+	bool				isSampleReady(mp_sint32 index)
+	{
+		return lazySampleLoader == NULL || isLazySampleReady(index);
+	}
+
+	///////////////////////////////////////////////////////
+	// The players tell where they are, so the decoding  //
+	// thread can decode the samples coming up first     //
+	///////////////////////////////////////////////////////
+	void				setPlayPosition(mp_sint32 order, mp_sint32 pattern, mp_sint32 row)
+	{
+		if (lazySampleLoader)
+			setLazySamplePosition(order, pattern, row);
+	}
+
+	///////////////////////////////////////////////////////
+	// decode every sample of a lazily loaded module,    //
+	// before editing or saving it                       //
+	///////////////////////////////////////////////////////
+	bool				decodeLazySamples();
+
 	static void			convertXMVolumeEffects(mp_ubyte volume, mp_ubyte& eff, mp_ubyte& op);
 
 	///////////////////////////////////////////////////////
@@ -472,6 +537,24 @@ class XModule
 	void			removeSamplePtr(mp_ubyte* ptr);
 #endif
 
+	struct TSampleMemoryStats
+	{
+		// samples in the pool
+		mp_uint32	numSamples;
+		// slots of freed samples waiting to be reused. The pool only shrinks
+		// in cleanUp(), until then numSamples + numFreeSlots is the most
+		// samples it held at once
+		mp_uint32	numFreeSlots;
+		// sample memory including the padding
+		mp_uint32	bytesInUse;
+		mp_uint32	peakBytesInUse;
+	};
+
+	///////////////////////////////////////////////////////
+	// Statistics of the sample memory					 //
+	///////////////////////////////////////////////////////
+	void			getSampleMemoryStats(TSampleMemoryStats& stats) const;
+
 	///////////////////////////////////////////////////////
 	//    Clean up! (Is called before loading a song)    //
 	///////////////////////////////////////////////////////
@@ -498,6 +581,30 @@ class XModule
 	// each module comes with it's own sample-memory management (MILKYPLAY_MAXSAMPLES samples max.)
 	mp_ubyte*		samplePool[MP_MAXSAMPLES];
 	mp_uint32		samplePointerIndex;
+	// unused slots below samplePointerIndex, the last one freed is reused first
+	mp_uword		freeSampleSlots[MP_MAXSAMPLES];
+	mp_uint32		numFreeSampleSlots;
+	mp_uint32		sampleBytesInUse;
+	mp_uint32		peakSampleBytesInUse;
+
+	// slot of a sample in the pool, -1 if it's not in there
+	mp_sint32		findSampleSlot(mp_ubyte* mem) const;
+	void			addSampleToPool(mp_ubyte* mem);
+	void			removeSampleFromPool(mp_uint32 slot);
+	// frees all samples at once and starts over with the statistics
+	void			releaseSampleMem();
+
+	// samples recorded by loadSampleDeferred
+	TDeferredSample* deferredSamples;
+	mp_uint32		numDeferredSamples;
+	mp_uint32		numDeferredSamplesAlloc;
+
+	// the mapped file while loading lazily, owned by the loader afterwards
+	XMFileBase*		lazySampleFile;
+	LazySampleLoader* lazySampleLoader;
+
+	bool			isLazySampleReady(mp_sint32 index);
+	void			setLazySamplePosition(mp_sint32 order, mp_sint32 pattern, mp_sint32 row);
 
 	// song message retrieving
 	char*			messagePtr;
@@ -651,9 +758,16 @@ class XModule
 
 	///////////////////////////////////////////////////
 	// generic module loader						 //
+	// lazySamples keeps the file mapped and leaves  //
+	// the samples of IT, MDL and XM files to a      //
+	// background thread, which decodes them ahead   //
+	// of the player. Notes of samples it hasn't got //
+	// to yet are skipped. Meant for previewing and  //
+	// playing, the samples aren't there before      //
+	// they're decoded.                              //
 	///////////////////////////////////////////////////
 	mp_sint32		loadModule(XMFileBase& f, bool scanForSubSongs = false);
-	mp_sint32		loadModule(const SYSCHAR* fileName, bool scanForSubSongs = false);
+	mp_sint32		loadModule(const SYSCHAR* fileName, bool scanForSubSongs = false, bool lazySamples = false);
 
 	///////////////////////////////////////////////////
 	// Module exporters								 //
@@ -42,92 +42,134 @@
 // Hack to simplify build scripts
 #ifdef HAVE_LIBASOUND
 #include "AudioDriver_ALSA.h"
+#include "MilkyPlayThread.h"
+#include <pthread.h>
+#include <sched.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
 
-void AudioDriver_ALSA::async_direct_callback(snd_async_handler_t *ahandler)
+class AudioDriver_ALSA::MixerThread : public MPThread
 {
-	snd_pcm_t *handle = snd_async_handler_get_pcm(ahandler);
-	AudioDriver_ALSA* audioDriver = (AudioDriver_ALSA*) snd_async_handler_get_callback_private(ahandler);
-	const snd_pcm_channel_area_t *my_areas;
-	snd_pcm_uframes_t offset, frames, size;
-	snd_pcm_sframes_t avail, commitres;
-	snd_pcm_state_t state;
-	int first = 0, err;
-
-	while (1) {
-		state = snd_pcm_state(handle);
-		if (state == SND_PCM_STATE_XRUN) {
-			err = snd_pcm_recover(handle, -EPIPE, 0);
-			if (err < 0) {
-				fprintf(stderr, "ALSA: XRUN recovery failed: %s\n", snd_strerror(err));
-			}
-			first = 1;
-		} else if (state == SND_PCM_STATE_SUSPENDED) {
-			err = snd_pcm_recover(handle, ESTRPIPE, 0);
-			if (err < 0) {
-				fprintf(stderr, "ALSA: SUSPEND recovery failed: %s\n", snd_strerror(err));
-			}
+private:
+	AudioDriver_ALSA& driver;
+
+protected:
+	virtual void run()
+	{
+		driver.mixerLoop();
+	}
+
+public:
+	MixerThread(AudioDriver_ALSA& driver) :
+		driver(driver)
+	{
+	}
+
+	virtual ~MixerThread()
+	{
+		join();
+	}
+};
+
+void AudioDriver_ALSA::recover(int err)
+{
+	if (err == -EPIPE)
+		numXRuns++;
+
+	err = snd_pcm_recover(pcm, err, 1);
+	if (err < 0)
+	{
+		fprintf(stderr, "ALSA: Recovery failed: %s\n", snd_strerror(err));
+		// don't spin on a device which is gone
+		msleep(10);
+	}
+}
+
+void AudioDriver_ALSA::mixerLoop()
+{
+	if (rtPriority > 0)
+	{
+		sched_param param;
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = rtPriority;
+
+		int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (err != 0)
+			fprintf(stderr, "ALSA: Could not set realtime priority %i (%s), check your rtprio limit\n", rtPriority, strerror(err));
+	}
+
+	// frames of the current period already written
+	snd_pcm_uframes_t written = period_size;
+
+	while (!quit)
+	{
+		if (written == period_size)
+		{
+			if (paused)
+				memset(stream, 0, period_size * MP_NUMCHANNELS * sizeof(mp_sword));
+			else
+				fillAudioWithCompensation(reinterpret_cast<char*>(stream), period_size * MP_NUMCHANNELS * sizeof(mp_sword));
+			written = 0;
 		}
-		avail = snd_pcm_avail_update(handle);
-		if (avail < 0) {
-			err = snd_pcm_recover(handle, avail, 0);
-			if (err < 0) {
-				fprintf(stderr, "ALSA: avail update failed: %s\n", snd_strerror(err));
-			}
-			first = 1;
+
+		// the device starts by itself once the buffer is full
+		snd_pcm_sframes_t res = mmapAccess ?
+			snd_pcm_mmap_writei(pcm, stream + written * MP_NUMCHANNELS, period_size - written) :
+			snd_pcm_writei(pcm, stream + written * MP_NUMCHANNELS, period_size - written);
+
+		if (res == -EAGAIN)
+		{
+			// wait for a period to be played, the timeout lets stop() get through
+			int err = snd_pcm_wait(pcm, 100);
+			if (err < 0)
+				recover(err);
 			continue;
 		}
-		if (avail < audioDriver->period_size) {
-			if (first) {
-				first = 0;
-				err = snd_pcm_start(handle);
-				if (err < 0) {
-					fprintf(stderr, "ALSA: Start error: %s\n", snd_strerror(err));
-				}
-			} else {
-				break;
-			}
+
+		if (res < 0)
+		{
+			recover(res);
 			continue;
 		}
 
-		frames = audioDriver->period_size;
-		err = snd_pcm_mmap_begin(handle, &my_areas, &offset, &frames);
-		if (err < 0) {
-			if ((err = snd_pcm_recover(handle, err, 0)) < 0) {
-				fprintf(stderr, "ALSA: MMAP begin avail error: %s\n", snd_strerror(err));
-			}
-			first = 1;
-		}
+		written += res;
 
-		if(frames != audioDriver->period_size)
-			fprintf(stderr, "ALSA: Invalid buffer size: %lu (should be %lu), skipping..\n", frames, audioDriver->period_size);
-			// Certain audio drivers will periodically request buffers of less than one period when
-			// soft-resampling (ie, not running at native frequency).  Milkytracker can't handle this,
-			// and bad things happen - so best to warn the user and not process.
-			// PS - I've disabled soft-resampling for now (see below) so this shouldn't happen.
-			// PPS - The downside is that if the user has the wrong mixer rate, they will get an error
-			//       dialog - hopefully they'll read the message on stderr...
-		else
-			audioDriver->fillAudioWithCompensation(static_cast<char*> (my_areas->addr) + offset*4, frames * 2);
-
-		commitres = snd_pcm_mmap_commit(handle, offset, frames);
-		if (commitres < 0 || (snd_pcm_uframes_t)commitres != frames) {
-			if ((err = snd_pcm_recover(handle, commitres >= 0 ? -EPIPE : commitres, 0)) < 0) {
-				fprintf(stderr, "ALSA: MMAP commit error: %s\n", snd_strerror(err));
-				// What now?
-//				exit(1);
-			}
-			first = 1;
+		snd_pcm_sframes_t delay;
+		if (snd_pcm_delay(pcm, &delay) == 0 && delay >= 0)
+		{
+			latency = (mp_sint32)((mp_int64)delay * 1000000 / mixFrequency);
+			if (latency > maxLatency)
+				maxLatency = latency;
 		}
 	}
 }
 
 AudioDriver_ALSA::AudioDriver_ALSA() :
-	AudioDriver_COMPENSATE()
+	AudioDriver_COMPENSATE(),
+	pcm(NULL),
+	mmapAccess(false),
+	stream(NULL),
+	period_size(0),
+	buffer_size(0),
+	numPeriods(2),
+	rtPriority(0),
+	thread(NULL),
+	quit(false),
+	paused(false),
+	numXRuns(0),
+	latency(0),
+	maxLatency(0)
 {
+	const char* value = getenv("MILKYTRACKER_ALSA_RTPRIO");
+	if (value)
+		setRealtimePriority(atoi(value));
 }
 
 AudioDriver_ALSA::~AudioDriver_ALSA()
 {
+	if (pcm)
+		closeDevice();
 }
 
 // On error return a negative value
@@ -135,49 +177,76 @@ AudioDriver_ALSA::~AudioDriver_ALSA()
 // otherwise return the number of 16 bit words contained in the obtained buffer
 mp_sint32 AudioDriver_ALSA::initDevice(mp_sint32 periodSizeAsSamples, const mp_uint32 mixFrequency, MasterMixer* mixer)
 {
+	snd_pcm_hw_params_t *hwparams;
 	snd_pcm_sw_params_t *swparams;
-	snd_pcm_uframes_t buffer_size;
 	int err;
 
+	snd_pcm_hw_params_alloca(&hwparams);
 	snd_pcm_sw_params_alloca(&swparams);
 
-	if ((err = snd_pcm_open(&pcm, "default", SND_PCM_STREAM_PLAYBACK, 0)) < 0) {
+	if ((err = snd_pcm_open(&pcm, "default", SND_PCM_STREAM_PLAYBACK, SND_PCM_NONBLOCK)) < 0) {
 		fprintf(stderr, "ALSA: Failed to open device 'default' (%s)\n", snd_strerror(err));
+		pcm = NULL;
 		return -1;
 	}
 
-	if ((err = snd_pcm_set_params(pcm,
-		SND_PCM_FORMAT_S16,
-		SND_PCM_ACCESS_MMAP_INTERLEAVED,
-		2, // channels
-		mixFrequency,
-		0, // disallow soft resampling
-		(2000000 * static_cast<unsigned long long> (periodSizeAsSamples)) / mixFrequency)) < 0)
-			// period size in uS
+	snd_pcm_hw_params_any(pcm, hwparams);
+
+	// writing into the mmapped buffer saves a copy inside ALSA, not every device can do it
+	mmapAccess = snd_pcm_hw_params_set_access(pcm, hwparams, SND_PCM_ACCESS_MMAP_INTERLEAVED) == 0;
+
+	unsigned int rate = mixFrequency;
+	unsigned int periods = numPeriods;
+	snd_pcm_uframes_t requestedPeriodSize = periodSizeAsSamples / MP_NUMCHANNELS;
+	period_size = requestedPeriodSize;
+
+	if ((!mmapAccess && (err = snd_pcm_hw_params_set_access(pcm, hwparams, SND_PCM_ACCESS_RW_INTERLEAVED)) < 0) ||
+		(err = snd_pcm_hw_params_set_format(pcm, hwparams, SND_PCM_FORMAT_S16)) < 0 ||
+		(err = snd_pcm_hw_params_set_channels(pcm, hwparams, MP_NUMCHANNELS)) < 0 ||
+		// disallow soft resampling, the mixer takes the rate the device offers
+		(err = snd_pcm_hw_params_set_rate_resample(pcm, hwparams, 0)) < 0 ||
+		(err = snd_pcm_hw_params_set_rate_near(pcm, hwparams, &rate, NULL)) < 0 ||
+		(err = snd_pcm_hw_params_set_period_size_near(pcm, hwparams, &period_size, NULL)) < 0 ||
+		(err = snd_pcm_hw_params_set_periods_near(pcm, hwparams, &periods, NULL)) < 0 ||
+		(err = snd_pcm_hw_params(pcm, hwparams)) < 0)
 	{
-		fprintf(stderr, "ALSA: Playback open error (%s)\nALSA: Is your mixer frequency correct? Try 48000Hz\nALSA: If you are seeing \"Access type not available for PLAYBACK\" then your audio driver does not support MMAP access, and will not work with this version of MilkyTracker using the ALSA driver (try SDL instead).\n", snd_strerror(err));
+		fprintf(stderr, "ALSA: Playback open error (%s)\n", snd_strerror(err));
+		snd_pcm_close(pcm);
+		pcm = NULL;
 		return -1;
 	}
 
-	snd_pcm_prepare(pcm);
-	period_size = periodSizeAsSamples * 2;
-	snd_pcm_get_params(pcm, &buffer_size, &period_size);
-	stream = new char[period_size * 2];
-	printf("ALSA: Period size = %lu frames (requested %i), buffer size = %lu frames\n", period_size, periodSizeAsSamples / 2, buffer_size);
+	snd_pcm_hw_params_get_period_size(hwparams, &period_size, NULL);
+	snd_pcm_hw_params_get_periods(hwparams, &periods, NULL);
+	snd_pcm_hw_params_get_buffer_size(hwparams, &buffer_size);
 
-	/* get the current swparams */
-	err = snd_pcm_sw_params_current(pcm, swparams);
-	if (err < 0) {
-		fprintf(stderr, "ALSA: Unable to determine current swparams for playback: %s\n", snd_strerror(err));
+	// start playing as soon as all periods are written, wake up for every period
+	snd_pcm_sw_params_current(pcm, swparams);
+	if ((err = snd_pcm_sw_params_set_start_threshold(pcm, swparams, buffer_size / period_size * period_size)) < 0 ||
+		(err = snd_pcm_sw_params_set_avail_min(pcm, swparams, period_size)) < 0 ||
+		(err = snd_pcm_sw_params(pcm, swparams)) < 0)
+	{
+		fprintf(stderr, "ALSA: Unable to set swparams for playback: %s\n", snd_strerror(err));
+		snd_pcm_close(pcm);
+		pcm = NULL;
 		return -1;
 	}
 
-	AudioDriverBase::initDevice(period_size * 2, mixFrequency, mixer);
-	return period_size * 2;		// 2 = number of channels
+	stream = new mp_sword[period_size * MP_NUMCHANNELS];
+	printf("ALSA: Period size = %lu frames (requested %lu), %u periods, buffer size = %lu frames, %s access\n",
+		   period_size, requestedPeriodSize, periods, buffer_size, mmapAccess ? "mmap" : "read/write");
+
+	AudioDriverBase::initDevice(period_size * MP_NUMCHANNELS, rate, mixer);
+	return period_size * MP_NUMCHANNELS;
 }
 
 mp_sint32 AudioDriver_ALSA::stop()
 {
+	quit = true;
+	// joins the thread
+	delete thread;
+	thread = NULL;
+
 	snd_pcm_drop(pcm);
 	deviceHasStarted = false;
 	return 0;
@@ -185,7 +254,11 @@ mp_sint32 AudioDriver_ALSA::stop()
 
 mp_sint32 AudioDriver_ALSA::closeDevice()
 {
+	if (thread)
+		stop();
+
 	snd_pcm_close(pcm);
+	pcm = NULL;
 	delete[] stream;
 	stream = NULL;
 	deviceHasStarted = false;
@@ -194,61 +267,62 @@ mp_sint32 AudioDriver_ALSA::closeDevice()
 
 mp_sint32 AudioDriver_ALSA::start()
 {
-	const snd_pcm_channel_area_t *my_areas;
-	snd_pcm_uframes_t offset, frames, size;
-	snd_async_handler_t *ahandler;
-	int err;
-	err = snd_async_add_pcm_handler(&ahandler, pcm, async_direct_callback, this);
-	if (err < 0) {
-		fprintf(stderr, "ALSA: Unable to register async handler (%s)\n", snd_strerror(err));
+	int err = snd_pcm_prepare(pcm);
+	if (err < 0)
+	{
+		fprintf(stderr, "ALSA: Could not prepare PCM device (%s)\n", snd_strerror(err));
+		return -1;
 	}
 
-	for (int count = 0; count < 2; count++) {
-		size = period_size;
-		while (size > 0) {
-			frames = size;
-			err = snd_pcm_mmap_begin(pcm, &my_areas, &offset, &frames);
-			if (err < 0) {
-				if ((err = snd_pcm_recover(pcm, err, 0)) < 0) {
-					fprintf(stderr, "ALSA: MMAP begin error: %s\n", snd_strerror(err));
-				}
-			}
-			// Sanity check
-			if (my_areas->step != 32 && my_areas->first != 0)
-				fprintf(stderr, "ALSA: Unsupported audio format.\n");
-
-			memset(static_cast<char*> (my_areas->addr) + offset*4, 0, frames * 4);
-			int commitres = snd_pcm_mmap_commit(pcm, offset, frames);
-			if (err < 0 || (snd_pcm_uframes_t)commitres != frames) {
-				if ((err = snd_pcm_recover(pcm, commitres >= 0 ? -EPIPE : commitres, 0)) < 0) {
-					fprintf(stderr, "ALSA: MMAP commit error: %s\n", snd_strerror(err));
-				}
-			}
-			size -= frames;
-		}
-	}
+	quit = false;
+	paused = false;
+	numXRuns = 0;
+	latency = maxLatency = 0;
 
-\
-	err = snd_pcm_start(pcm);
-	if (err < 0)
+	deviceHasStarted = true;
+
+	thread = new MixerThread(*this);
+	if (!thread->start())
 	{
-		fprintf(stderr, "ALSA: Could not start PCM device (%s)\n", snd_strerror(err));
+		fprintf(stderr, "ALSA: Could not start the mixing thread\n");
+		delete thread;
+		thread = NULL;
+		deviceHasStarted = false;
 		return -1;
 	}
 
-	deviceHasStarted = true;
 	return 0;
 }
 
+// the thread keeps the device running and writes silence
 mp_sint32 AudioDriver_ALSA::pause()
 {
-	snd_pcm_pause(pcm, true);
+	paused = true;
 	return 0;
 }
 
 mp_sint32 AudioDriver_ALSA::resume()
 {
-	snd_pcm_pause(pcm, false);
+	paused = false;
+	return 0;
+}
+
+mp_sint32 AudioDriver_ALSA::getStatValue(mp_uint32 key)
+{
+	switch (key)
+	{
+		case StatXRuns:
+			return numXRuns;
+		case StatLatency:
+			return latency;
+		case StatMaxLatency:
+			return maxLatency;
+		case StatPeriodSize:
+			return period_size;
+		case StatNumPeriods:
+			return period_size ? buffer_size / period_size : 0;
+	}
+
 	return 0;
 }
 
@@ -40,14 +40,45 @@
 #include "AudioDriver_COMPENSATE.h"
 #include <alsa/asoundlib.h>
 
+// Mixes in a thread of its own which writes one period at a time and
+// waits for the device in between. A realtime priority for the thread
+// can be requested with the environment variable MILKYTRACKER_ALSA_RTPRIO.
 class AudioDriver_ALSA : public AudioDriver_COMPENSATE
 {
+public:
+	// see getStatValue
+	enum StatKeys
+	{
+		StatXRuns = 0,			// buffer underruns since start
+		StatLatency,			// output latency after the last write in microseconds
+		StatMaxLatency,			// highest output latency since start in microseconds
+		StatPeriodSize,			// in frames
+		StatNumPeriods
+	};
+
 private:
+	class MixerThread;
+	friend class MixerThread;
+
 	snd_pcm_t *pcm;
-	char *stream;
+	bool mmapAccess;
+	mp_sword *stream;
 	snd_pcm_uframes_t period_size;
+	snd_pcm_uframes_t buffer_size;
+
+	mp_uint32 numPeriods;
+	mp_sint32 rtPriority;
 
-	static void async_direct_callback(snd_async_handler_t *ahandler);
+	MixerThread* thread;
+	volatile bool quit;
+	volatile bool paused;
+
+	volatile mp_sint32 numXRuns;
+	volatile mp_sint32 latency;
+	volatile mp_sint32 maxLatency;
+
+	void mixerLoop();
+	void recover(int err);
 
 public:
 				AudioDriver_ALSA();
@@ -65,6 +96,14 @@ class AudioDriver_ALSA : public AudioDriver_COMPENSATE
 	
 	virtual		const char* getDriverID() { return "ALSA"; }
 	virtual		mp_sint32	getPreferredBufferSize() const { return 2048; }
+
+	virtual     mp_sint32   getStatValue(mp_uint32 key);
+
+	// take effect with the next initDevice
+	void		setNumPeriods(mp_uint32 numPeriods) { this->numPeriods = numPeriods < 2 ? 2 : numPeriods; }
+	mp_uint32	getNumPeriods() const { return numPeriods; }
+	// SCHED_FIFO priority of the mixing thread, 0 = normal scheduling
+	void		setRealtimePriority(mp_sint32 priority) { rtPriority = priority; }
 };
 
 #endif
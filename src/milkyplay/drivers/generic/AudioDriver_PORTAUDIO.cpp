@@ -54,12 +54,10 @@ int AudioDriver_PORTAUDIO::patestCallback( const void *inputBuffer, void *output
                             PaStreamCallbackFlags statusFlags,
                             void *userData )
 {
-	framesPerBuffer<<=2;
-	
 	AudioDriver_PORTAUDIO* audioDriver = (AudioDriver_PORTAUDIO*)userData;
 	
 	// Base class can handle this
-	audioDriver->fillAudioWithCompensation((char*)outputBuffer, framesPerBuffer);	
+	audioDriver->fillAudioWithCompensationFloat((float*)outputBuffer, framesPerBuffer);
 	return paContinue;
 }
 
@@ -104,7 +102,7 @@ mp_sint32 AudioDriver_PORTAUDIO::initDevice(mp_sint32 bufferSizeInWords, mp_uint
 
     outputParameters.device = Pa_GetDefaultOutputDevice(); /* default output device */
     outputParameters.channelCount = channels;       /* stereo output */
-    outputParameters.sampleFormat = paInt16; /* 32 bit floating point output */
+    outputParameters.sampleFormat = paFloat32; /* 32 bit floating point output */
     outputParameters.suggestedLatency = Pa_GetDeviceInfo( outputParameters.device )->defaultLowOutputLatency;
     outputParameters.hostApiSpecificStreamInfo = NULL;
 
@@ -114,7 +112,7 @@ mp_sint32 AudioDriver_PORTAUDIO::initDevice(mp_sint32 bufferSizeInWords, mp_uint
               &outputParameters,
               sampleRate,
 			  bufferSize,
-              paClipOff,      /* we won't output out of range samples so don't bother clipping them */
+              paNoFlag,       /* the float mix bus isn't clipped, let PortAudio do it */
               patestCallback,
               this);
 
@@ -69,6 +69,8 @@ class AudioDriver_PORTAUDIO : public AudioDriver_COMPENSATE
 	virtual     mp_sint32   pause();
 	virtual     mp_sint32   resume();
 	
+	virtual		bool		supportsFloat() const { return true; }
+
 	virtual		const char* getDriverID() { return driverNames[0]; }
 };
 
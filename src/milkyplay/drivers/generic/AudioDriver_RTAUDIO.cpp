@@ -106,6 +106,11 @@ bool		AudioDriver_RTAUDIO::supportsTimeQuery() const
 	return impl->supportsTimeQuery();
 }
 
+bool		AudioDriver_RTAUDIO::supportsFloat() const
+{
+	return impl->supportsFloat();
+}
+
 const char* AudioDriver_RTAUDIO::getDriverID()
 {
 	return impl->getDriverID();
@@ -73,6 +73,7 @@ class AudioDriver_RTAUDIO : public AudioDriverInterface
 	virtual		mp_uint32	getNumPlayedSamples() const;
 	virtual		mp_uint32	getBufferPos() const;
 	virtual		bool		supportsTimeQuery() const;
+	virtual		bool		supportsFloat() const;
 	virtual		const char* getDriverID();
 	virtual		void		advance();
 	virtual		mp_sint32	getPreferredSampleRate() const;
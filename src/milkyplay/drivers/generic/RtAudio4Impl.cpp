@@ -55,13 +55,18 @@ class Rt4AudioDriverImpl : public AudioDriver_COMPENSATE
 
     static int fill_audio(void* stream, void*, unsigned int length,  double streamTime, RtAudioStreamStatus status, void *udata)
     {
-        // upgrade to reflect number of bytes, instead number of samples
-        length<<=2;
-
         Rt4AudioDriverImpl* audioDriver = (Rt4AudioDriverImpl*)udata;
 
         // Base class can handle this
-        audioDriver->fillAudioWithCompensation((char *) stream, length);
+        audioDriver->fillAudioWithCompensationFloat((float *) stream, length);
+
+        // RtAudio doesn't clip when converting to the device format
+        float* buffer = (float *) stream;
+        for (unsigned int i = 0; i < length * MP_NUMCHANNELS; i++)
+        {
+            if (buffer[i] > 1.0f) buffer[i] = 1.0f;
+            else if (buffer[i] < -1.0f) buffer[i] = -1.0f;
+        }
         return 0;
     }
 
@@ -146,7 +151,7 @@ class Rt4AudioDriverImpl : public AudioDriver_COMPENSATE
         // Open a stream during RtAudio instantiation
         try
         {
-            audio->openStream(&sStreamParams, NULL, RTAUDIO_SINT16,
+            audio->openStream(&sStreamParams, NULL, RTAUDIO_FLOAT32,
                               sampleRate, &bufferSize, &fill_audio, (void *)this,
                               &sStreamOptions);
         }
@@ -161,7 +166,7 @@ class Rt4AudioDriverImpl : public AudioDriver_COMPENSATE
         // Open a stream during RtAudio instantiation
         try
         {
-            audio->openStream(&sStreamParams, NULL, RTAUDIO_SINT16,
+            audio->openStream(&sStreamParams, NULL, RTAUDIO_FLOAT32,
                               sampleRate, &bufferSize, &fill_audio, (void *)this);
         }
 #endif
@@ -278,6 +283,8 @@ class Rt4AudioDriverImpl : public AudioDriver_COMPENSATE
         return MP_DEVICE_ERROR;
     }
 
+    virtual		bool		supportsFloat() const { return true; }
+
     virtual		const char* getDriverID()
     {
 		// Needs to be kept synchronised with RtAudio.h
@@ -59,31 +59,96 @@ int AudioDriver_JACK::jackProcess(jack_nframes_t nframes, void *arg)
 	// This could change, we need to setup a callback to deal with it
 	// But for now, just panic
 	assert(nframes == audioDriver->jackFrames);
+
+	if(audioDriver->numOutputs)
+	{
+		audioDriver->processOutputs(nframes);
+		return 0;
+	}
 	
 	leftBuffer = (jack_default_audio_sample_t*) audioDriver->jack_port_get_buffer(audioDriver->leftPort, nframes);
 	rightBuffer = (jack_default_audio_sample_t*) audioDriver->jack_port_get_buffer(audioDriver->rightPort, nframes);
 
-	audioDriver->fillAudioWithCompensation((char*)audioDriver->rawStream, nframes * 4);
+	audioDriver->fillAudioWithCompensationFloat(audioDriver->rawStream, nframes);
 
-	// JACK uses non-interleaved floating-point samples, we need to convert
+	// JACK uses non-interleaved floating-point samples, we only need to deinterleave
 	for(int out = 0, in = 0; in < nframes; in++)
 	{
-		leftBuffer[in] = audioDriver->rawStream[out++] * (1.0/32768.0);
-		rightBuffer[in] = audioDriver->rawStream[out++] * (1.0/32768.0);
+		leftBuffer[in] = audioDriver->rawStream[out++];
+		rightBuffer[in] = audioDriver->rawStream[out++];
 	}
 	return 0;
 }
 
-AudioDriver_JACK::AudioDriver_JACK() :
+// Channels are mixed straight into stem buffers of their own and converted
+// to float right into the port buffers, there is no stereo mix in between.
+// The channels after the last output (preview and virtual channels, modules
+// with more channels) are summed into the master pair.
+void AudioDriver_JACK::processOutputs(jack_nframes_t nframes)
+{
+	if (!deviceHasStarted)
+		return;
+
+	sampleCounter+=nframes;
+
+	const bool active = isMixerActive();
+	if (active)
+		mixer->mixerHandler(NULL, stemProxy);
+
+	const float scale = 1.0f / (float)(32768 << stemProxy->getSampleShift());
+	// the mixer adds stems when it has more channels than we have outputs
+	const mp_uint32 numStems = stemProxy->getNumChannels();
+
+	for (mp_uint32 o = 0; o <= numOutputs; o++)
+	{
+		jack_default_audio_sample_t* leftBuffer = (jack_default_audio_sample_t*) jack_port_get_buffer(outputPorts[o*2], nframes);
+		jack_default_audio_sample_t* rightBuffer = (jack_default_audio_sample_t*) jack_port_get_buffer(outputPorts[o*2+1], nframes);
+
+		const mp_uint32 first = o*channelsPerOutput;
+		const mp_uint32 last = o < numOutputs ? first + channelsPerOutput : numStems;
+
+		if (!active || first >= last)
+		{
+			memset(leftBuffer, 0, nframes*sizeof(jack_default_audio_sample_t));
+			memset(rightBuffer, 0, nframes*sizeof(jack_default_audio_sample_t));
+			continue;
+		}
+
+		const mp_sint32* stem = stemProxy->getBuffer<mp_sint32>(first);
+		for (jack_nframes_t i = 0; i < nframes; i++, stem+=2)
+		{
+			leftBuffer[i] = (float)stem[0] * scale;
+			rightBuffer[i] = (float)stem[1] * scale;
+		}
+
+		for (mp_uint32 c = first + 1; c < last; c++)
+		{
+			stem = stemProxy->getBuffer<mp_sint32>(c);
+			for (jack_nframes_t i = 0; i < nframes; i++, stem+=2)
+			{
+				leftBuffer[i]+=(float)stem[0] * scale;
+				rightBuffer[i]+=(float)stem[1] * scale;
+			}
+		}
+	}
+}
+
+AudioDriver_JACK::AudioDriver_JACK(mp_uint32 numOutputs/* = 0*/, mp_uint32 channelsPerOutput/* = 1*/) :
 	AudioDriver_COMPENSATE(),
 	paused(false),
-	rawStream(NULL)
+	rawStream(NULL),
+	numOutputs(numOutputs),
+	channelsPerOutput(channelsPerOutput ? channelsPerOutput : 1),
+	outputPorts(NULL),
+	stemProxy(NULL)
 {
 }
 
 AudioDriver_JACK::~AudioDriver_JACK()
 {
 	if(rawStream) delete[] rawStream;
+	delete[] outputPorts;
+	delete stemProxy;
 }
 
 // On error return a negative value
@@ -148,12 +213,35 @@ mp_sint32 AudioDriver_JACK::initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mi
 	}
 
 	// Register ports
-	leftPort = jack_port_register(hJack, "Left", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
-	rightPort = jack_port_register(hJack, "Right", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
-	if(!leftPort || !rightPort)
+	if(numOutputs)
 	{
-		fprintf(stderr, "JACK: Failed to register ports\n");
-		return -1;
+		// the last pair is the master
+		delete[] outputPorts;
+		outputPorts = new jack_port_t*[numOutputs*2+2];
+		for(mp_uint32 i = 0; i < numOutputs*2+2; i++)
+		{
+			char name[32];
+			if(i < numOutputs*2)
+				sprintf(name, "Out %i %s", i/2 + 1, (i & 1) ? "Right" : "Left");
+			else
+				sprintf(name, "Master %s", (i & 1) ? "Right" : "Left");
+			outputPorts[i] = jack_port_register(hJack, name, JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+			if(!outputPorts[i])
+			{
+				fprintf(stderr, "JACK: Failed to register ports\n");
+				return -1;
+			}
+		}
+	}
+	else
+	{
+		leftPort = jack_port_register(hJack, "Left", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+		rightPort = jack_port_register(hJack, "Right", JACK_DEFAULT_AUDIO_TYPE, JackPortIsOutput, 0);
+		if(!leftPort || !rightPort)
+		{
+			fprintf(stderr, "JACK: Failed to register ports\n");
+			return -1;
+		}
 	}
 	
 	// Set callback
@@ -166,7 +254,16 @@ mp_sint32 AudioDriver_JACK::initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mi
 	printf("JACK: Mixer frequency: %i\n", this->mixFrequency);
 	//delete[] rawStream; // pailes: make sure this isn't allocated yet
 	assert(!rawStream);		// If it is allocated, something went wrong and we need to know about it
-	rawStream = new mp_sword[bufferSize];
+	rawStream = new float[bufferSize];
+	if(numOutputs)
+	{
+		// allocate the stems here rather than in the process callback
+		delete stemProxy;
+		stemProxy = new MixerProxyMixDownStems(numOutputs*channelsPerOutput);
+		stemProxy->setGrowable(true);
+		stemProxy->lock(jackFrames, 0);
+		printf("JACK: %i outputs, %i channels each\n", numOutputs, channelsPerOutput);
+	}
 	printf("JACK: Latency = %i frames\n", jackFrames);
 	return bufferSize;
 }
@@ -184,6 +281,10 @@ mp_sint32 AudioDriver_JACK::closeDevice()
 	jack_client_close(hJack);
 	if(rawStream) delete[] rawStream;
 	rawStream = NULL;
+	delete[] outputPorts;
+	outputPorts = NULL;
+	delete stemProxy;
+	stemProxy = NULL;
 	dlclose(libJack);
 	libJack = NULL;
 	return 0;
@@ -39,6 +39,7 @@
 #define __AUDIODRIVER_JACK_H__
 
 #include "AudioDriver_COMPENSATE.h"
+#include "MixerProxy.h"
 #include <jack/jack.h>
 
 class AudioDriver_JACK : public AudioDriver_COMPENSATE
@@ -46,12 +47,20 @@ class AudioDriver_JACK : public AudioDriver_COMPENSATE
 private:
 	jack_client_t *hJack;
 	jack_port_t *leftPort, *rightPort;
-	mp_sword *rawStream;
+	float *rawStream;
 	int jackFrames;
 	bool paused;
 	void *libJack;
 
+	// multi-channel output, one stereo pair of ports per output and the
+	// master pair, see the constructor
+	mp_uint32 numOutputs;
+	mp_uint32 channelsPerOutput;
+	jack_port_t **outputPorts;
+	MixerProxyMixDownStems *stemProxy;
+
 	static int jackProcess(jack_nframes_t nframes, void *arg);
+	void processOutputs(jack_nframes_t nframes);
 
 	// Jack library functions
 	jack_client_t *(*jack_client_new) (const char *client_name);
@@ -80,7 +89,18 @@ class AudioDriver_JACK : public AudioDriver_COMPENSATE
 
 
 public:
-				AudioDriver_JACK();
+	enum
+	{
+		// stereo pairs registered by the multi-channel variant
+		MultiChannelOutputs = 32
+	};
+
+				// numOutputs = 0 registers one stereo pair of ports for the
+				// mix, otherwise channels 0 to numOutputs*channelsPerOutput-1
+				// are rendered separately and every channelsPerOutput of them
+				// are summed into a stereo pair of their own, the channels
+				// after them into a master pair
+				AudioDriver_JACK(mp_uint32 numOutputs = 0, mp_uint32 channelsPerOutput = 1);
 
 	virtual		~AudioDriver_JACK();
 			
@@ -94,9 +114,13 @@ class AudioDriver_JACK : public AudioDriver_COMPENSATE
 	virtual     mp_sint32   resume();
 	
 	virtual		bool		supportsPowerOfTwoCompensation() { return true; }
+	virtual		bool		supportsFloat() const { return true; }
 
-	virtual		const char* getDriverID() { return "JACK"; }
+	virtual		const char* getDriverID() { return numOutputs ? "JACK (multi-channel)" : "JACK"; }
 	virtual		mp_sint32	getPreferredBufferSize() const { return 2048; }
+
+	// no getChannels(), every channel is heard, at least on the master pair
+	virtual		bool		isMultiChannel() const { return numOutputs != 0; }
 	
 };
 
@@ -0,0 +1,380 @@
+/*
+ *  render/MilkyRender.cpp
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  MilkyRender.cpp
+ *  MilkyRender
+ *
+ *  Command line renderer: renders modules to WAV or raw files with the
+ *  settings of the tracker's HD recorder, several modules at once.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "RenderQueue.h"
+
+static const char* resamplerNames[] =
+{
+	"No interpolation",
+	"Linear interpolation",
+	"Cubic Lagrange",
+	"Cubic Spline",
+	"Fast Sinc",
+	"Precise Sinc",
+	"Amiga 500",
+	"Amiga 500 LED",
+	"Amiga 1200",
+	"Amiga 1200 LED"
+};
+
+static const mp_sint32 numResamplers = sizeof(resamplerNames) / sizeof(const char*);
+
+static const char* playModeNames[] =
+{
+	"auto",
+	"pt2",
+	"pt3",
+	"st3",
+	"ft2"
+};
+
+static const mp_sint32 numPlayModes = sizeof(playModeNames) / sizeof(const char*);
+
+static void printUsage(const char* name)
+{
+	printf("usage: %s [options] module...\n\n", name);
+	printf("  -o dir        write the files to dir instead of next to the modules\n");
+	printf("  -f rate       sample rate (default 44100)\n");
+	printf("  -r n          resampler (default 1):\n");
+	for (mp_sint32 i = 0; i < numResamplers; i++)
+		printf("                  %d: %s\n", i, resamplerNames[i]);
+	printf("  -n            no volume ramping\n");
+	printf("  -p mode       play mode: auto, pt2, pt3, st3 or ft2 (default auto)\n");
+	printf("  -s shift      mixer shift 0-2, amplifies by 100%%, 50%% or 25%% (default 1)\n");
+	printf("  -v volume     mixer volume 0-256 or auto (default 256)\n");
+	printf("  -b from[-to]  render only this range of the order list\n");
+	printf("  -m channels   mute channels, like 1,4-6\n");
+	printf("  -t            multi track, one file per channel\n");
+	printf("  -w            write raw little endian samples without a WAV header\n");
+	printf("  -F            write 32 bit float samples\n");
+	printf("  -j jobs       modules rendered at the same time (default: number of cores)\n");
+	printf("  -x threads    threads rendering parts of one module (default: cores / jobs)\n");
+	printf("  -q            only report errors and totals\n");
+}
+
+static bool parseNumber(const char* str, mp_sint32 minValue, mp_sint32 maxValue, mp_sint32& value)
+{
+	char* end;
+	const long number = strtol(str, &end, 10);
+
+	if (end == str || *end != '\0' || number < minValue || number > maxValue)
+		return false;
+
+	value = (mp_sint32)number;
+	return true;
+}
+
+// a number or a range of numbers, the end of the string or the next comma ends it
+static const char* parseRange(const char* str, mp_sint32& first, mp_sint32& last)
+{
+	char* end;
+	first = last = (mp_sint32)strtol(str, &end, 10);
+	if (end == str)
+		return NULL;
+
+	if (*end == '-')
+	{
+		str = end + 1;
+		last = (mp_sint32)strtol(str, &end, 10);
+		if (end == str)
+			return NULL;
+	}
+
+	if (*end != '\0' && *end != ',')
+		return NULL;
+
+	return end;
+}
+
+static bool parseMuting(const char* str, mp_ubyte* muting)
+{
+	while (*str)
+	{
+		mp_sint32 first, last;
+		str = parseRange(str, first, last);
+		if (str == NULL || first < 1 || last < first || last > RenderQueue::MaxMuteChannels)
+			return false;
+
+		for (mp_sint32 i = first; i <= last; i++)
+			muting[i-1] = 1;
+
+		if (*str == ',')
+			str++;
+	}
+
+	return true;
+}
+
+static void formatTime(char* str, double seconds)
+{
+	const mp_sint32 minutes = (mp_sint32)(seconds / 60.0);
+	sprintf(str, "%d:%04.1f", minutes, seconds - minutes * 60.0);
+}
+
+class RenderReport : public RenderQueue::Listener
+{
+private:
+	mp_uint32 sampleRate;
+	bool quiet;
+
+public:
+	mp_uint32 numFailed;
+	double numSeconds;
+
+	RenderReport(mp_uint32 sampleRate, bool quiet) :
+		sampleRate(sampleRate),
+		quiet(quiet),
+		numFailed(0),
+		numSeconds(0.0)
+	{
+	}
+
+	virtual void jobFinished(const RenderQueue::Job& job, mp_uint32 numFinished, mp_uint32 numJobs)
+	{
+		if (job.result != MP_OK)
+		{
+			numFailed++;
+			fprintf(stderr, "[%d/%d] %s: %s (error %d)\n", numFinished, numJobs,
+					(const char*)job.inFileName, job.errorText, job.result);
+			return;
+		}
+
+		const double seconds = (double)job.numSamples / sampleRate;
+		numSeconds += seconds;
+
+		if (quiet)
+			return;
+
+		char length[32];
+		formatTime(length, seconds);
+
+		if (job.numFiles == 1)
+			printf("[%d/%d] %s -> %s\n", numFinished, numJobs, (const char*)job.inFileName, (const char*)job.outFileName);
+		else
+			printf("[%d/%d] %s -> %d files\n", numFinished, numJobs, (const char*)job.inFileName, job.numFiles);
+
+		printf("        %s in %.2f s, %.1fx realtime, volume %d\n", length,
+			   job.seconds, job.seconds > 0.0 ? seconds / job.seconds : 0.0, job.mixerVolume);
+
+		fflush(stdout);
+	}
+};
+
+int main(int argc, const char* argv[])
+{
+	RenderQueue::Parameters parameters;
+	mp_sint32 resampler = 1;
+	bool ramping = true;
+	const char* outputPath = NULL;
+	mp_sint32 numJobs = 0;
+	mp_sint32 numExportThreads = 0;
+	bool quiet = false;
+
+	mp_sint32 i = 1;
+	for (; i < argc && argv[i][0] == '-' && argv[i][1] != '\0'; i++)
+	{
+		const char* option = argv[i];
+
+		if (option[2] != '\0')
+		{
+			fprintf(stderr, "unknown option %s\n", option);
+			return 1;
+		}
+
+		// options without an argument
+		switch (option[1])
+		{
+			case 'n':
+				ramping = false;
+				continue;
+			case 't':
+				parameters.multiTrack = true;
+				continue;
+			case 'w':
+				parameters.raw = true;
+				continue;
+			case 'F':
+				parameters.floatFormat = true;
+				continue;
+			case 'q':
+				quiet = true;
+				continue;
+			case 'h':
+				printUsage(argv[0]);
+				return 0;
+		}
+
+		if (i + 1 >= argc)
+		{
+			fprintf(stderr, "option %s needs an argument\n", option);
+			return 1;
+		}
+
+		const char* value = argv[++i];
+		bool valid = true;
+		mp_sint32 number = 0;
+
+		switch (option[1])
+		{
+			case 'o':
+				outputPath = value;
+				break;
+			case 'f':
+				valid = parseNumber(value, 8000, 192000, number);
+				parameters.sampleRate = number;
+				break;
+			case 'r':
+				valid = parseNumber(value, 0, numResamplers - 1, resampler);
+				break;
+			case 'p':
+				valid = false;
+				for (mp_sint32 j = 0; j < numPlayModes; j++)
+				{
+					if (strcmp(value, playModeNames[j]) == 0)
+					{
+						parameters.playMode = (PlayerBase::PlayModes)j;
+						valid = true;
+					}
+				}
+				break;
+			case 's':
+				valid = parseNumber(value, 0, 2, parameters.mixerShift);
+				break;
+			case 'v':
+				if (strcmp(value, "auto") == 0)
+					parameters.mixerVolume = -1;
+				else
+					valid = parseNumber(value, 0, 256, parameters.mixerVolume);
+				break;
+			case 'b':
+			{
+				const char* end = parseRange(value, parameters.fromOrder, parameters.toOrder);
+				valid = end != NULL && *end == '\0' && parameters.fromOrder >= 0 &&
+						parameters.toOrder >= parameters.fromOrder;
+				// a single position renders until the song ends
+				if (valid && strchr(value, '-') == NULL)
+					parameters.toOrder = -1;
+				break;
+			}
+			case 'm':
+				valid = parseMuting(value, parameters.muting);
+				break;
+			case 'j':
+				valid = parseNumber(value, 1, 256, numJobs);
+				break;
+			case 'x':
+				valid = parseNumber(value, 1, 256, numExportThreads);
+				break;
+			default:
+				fprintf(stderr, "unknown option %s\n", option);
+				return 1;
+		}
+
+		if (!valid)
+		{
+			fprintf(stderr, "invalid argument %s for option %s\n", value, option);
+			return 1;
+		}
+	}
+
+	if (i >= argc)
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	if (parameters.multiTrack && parameters.raw)
+	{
+		fprintf(stderr, "multi track files are always written as WAV files\n");
+		return 1;
+	}
+
+	parameters.resamplerType = (ChannelMixer::ResamplerTypes)((resampler << 1) | (ramping ? 1 : 0));
+
+	const mp_sint32 numModules = argc - i;
+	const mp_sint32 numProcessors = MPThread::getNumProcessors();
+
+	if (numJobs == 0)
+		numJobs = numProcessors;
+	if (numJobs > numModules)
+		numJobs = numModules;
+
+	// cores which aren't busy with a module of their own render parts of one
+	if (numExportThreads == 0)
+		numExportThreads = numProcessors > numJobs ? numProcessors / numJobs : 1;
+
+	parameters.numExportThreads = numExportThreads;
+
+	RenderQueue queue(parameters);
+
+	for (; i < argc; i++)
+	{
+		PPSystemString inFileName(argv[i]);
+		PPSystemString outFileName;
+
+		if (outputPath)
+		{
+			outFileName = outputPath;
+			outFileName.ensureTrailingCharacter('/');
+			outFileName.append(inFileName.stripPath().stripExtension());
+		}
+		else
+		{
+			outFileName = inFileName.stripExtension();
+		}
+
+		outFileName.append(parameters.raw ? ".raw" : ".wav");
+
+		queue.add(inFileName, outFileName);
+	}
+
+	if (!quiet)
+		printf("rendering %d modules with %d jobs, %d threads each\n", numModules, numJobs, numExportThreads);
+
+	RenderReport report(parameters.sampleRate, quiet);
+
+	const double startTime = RenderQueue::getTime();
+	queue.run(numJobs, &report);
+	const double seconds = RenderQueue::getTime() - startTime;
+
+	char length[32];
+	formatTime(length, report.numSeconds);
+
+	printf("%d modules, %d failed, %s rendered in %.2f s: %.1fx realtime, %.2f modules/s\n",
+		   numModules, report.numFailed, length, seconds,
+		   seconds > 0.0 ? report.numSeconds / seconds : 0.0,
+		   seconds > 0.0 ? numModules / seconds : 0.0);
+
+	return report.numFailed ? 1 : 0;
+}
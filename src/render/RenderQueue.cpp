@@ -0,0 +1,391 @@
+/*
+ *  render/RenderQueue.cpp
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  RenderQueue.cpp
+ *  MilkyRender
+ *
+ */
+
+#include "RenderQueue.h"
+#include "AudioDriver_NULL.h"
+#include "Decompressor.h"
+#include "XMFile.h"
+#include <stdio.h>
+
+#if defined(WIN32) && !defined(_WIN32_WCE)
+#include <windows.h>
+#else
+#include <sys/time.h>
+#endif
+
+// Writes the mixer output without a header, see WAVWriter
+class RawWriter : public AudioDriver_NULL
+{
+private:
+	XMFile*		f;
+	bool		floatFormat;
+	float*		floatBuffer;
+
+public:
+	RawWriter(const SYSCHAR* fileName, bool floatFormat) :
+		AudioDriver_NULL(),
+		f(new XMFile(fileName, true)),
+		floatFormat(floatFormat),
+		floatBuffer(NULL)
+	{
+		if (!f->isOpenForWriting())
+		{
+			delete f;
+			f = NULL;
+		}
+	}
+
+	virtual ~RawWriter()
+	{
+		delete f;
+		delete[] floatBuffer;
+	}
+
+	virtual mp_sint32 initDevice(mp_sint32 bufferSizeInWords, mp_uint32 mixFrequency, MasterMixer* mixer)
+	{
+		mp_sint32 res = AudioDriver_NULL::initDevice(bufferSizeInWords, mixFrequency, mixer);
+		if (res < 0)
+			return res;
+
+		if (floatFormat)
+		{
+			delete[] floatBuffer;
+			floatBuffer = new float[bufferSizeInWords];
+			memset(floatBuffer, 0, bufferSizeInWords * sizeof(float));
+		}
+
+		return MP_OK;
+	}
+
+	virtual const char* getDriverID() { return "RawWriter"; }
+	virtual bool supportsFloat() const { return floatFormat; }
+
+	virtual void advance()
+	{
+		if (!floatFormat)
+		{
+			AudioDriver_NULL::advance();
+			f->writeWords((mp_uword*)compensateBuffer, bufferSize);
+		}
+		else
+		{
+			numSamplesWritten+=bufferSize / MP_NUMCHANNELS;
+
+			if (mixer->isPlaying())
+				mixer->mixerHandlerFloat(floatBuffer);
+
+			f->writeDwords((mp_dword*)floatBuffer, bufferSize);
+		}
+	}
+
+	bool isOpen() { return f != NULL; }
+};
+
+class RenderQueue::Worker : public MPThread
+{
+private:
+	RenderQueue& queue;
+
+protected:
+	virtual void run()
+	{
+		RenderQueue::Job* job;
+		while ((job = queue.claimJob()) != NULL)
+		{
+			const double startTime = RenderQueue::getTime();
+			queue.render(*job);
+			job->seconds = RenderQueue::getTime() - startTime;
+			queue.finishJob(*job);
+		}
+	}
+
+public:
+	Worker(RenderQueue& queue) :
+		queue(queue)
+	{
+	}
+
+	virtual ~Worker()
+	{
+		join();
+	}
+
+	// render on the calling thread
+	void work()
+	{
+		run();
+	}
+};
+
+RenderQueue::RenderQueue(const Parameters& parameters) :
+	parameters(parameters),
+	listener(NULL),
+	nextJob(0),
+	numFinished(0)
+{
+}
+
+void RenderQueue::add(const PPSystemString& inFileName, const PPSystemString& outFileName)
+{
+	jobs.add(new Job(inFileName, outFileName));
+}
+
+RenderQueue::Job* RenderQueue::claimJob()
+{
+	Job* job = NULL;
+
+	mutex.lock();
+	if (nextJob < (unsigned)jobs.size())
+		job = jobs.get(nextJob++);
+	mutex.unlock();
+
+	return job;
+}
+
+void RenderQueue::finishJob(Job& job)
+{
+	mutex.lock();
+	numFinished++;
+	if (listener)
+		listener->jobFinished(job, numFinished, jobs.size());
+	mutex.unlock();
+}
+
+void RenderQueue::render(Job& job)
+{
+	Decompressor decompressor(job.inFileName);
+	bool packed = false;
+	{
+		XMFile f(job.inFileName);
+		packed = f.isOpen() && decompressor.identify(f);
+	}
+
+	XModule* module = new XModule();
+
+	if (packed)
+	{
+		// packed modules are unpacked into memory and loaded from there
+		XMBufferFile unpacked(job.inFileName);
+
+		if (!decompressor.decompress(unpacked, DecompressorBase::HintModules))
+		{
+			delete module;
+			job.result = MP_LOADER_FAILED;
+			job.errorText = "can't unpack";
+			return;
+		}
+
+		unpacked.seek(0);
+		job.result = module->loadModule(unpacked);
+	}
+	else
+	{
+		job.result = module->loadModule(job.inFileName);
+	}
+
+	if (job.result != MP_OK)
+	{
+		delete module;
+		job.errorText = "can't load";
+		return;
+	}
+
+	const mp_uint32 numChannels = module->header.channum;
+	const mp_uint32 mutingNumChannels = numChannels < MaxMuteChannels ? numChannels : MaxMuteChannels;
+
+	job.mixerVolume = parameters.mixerVolume;
+
+	if (job.mixerVolume < 0)
+	{
+		// play the song once and take the volume which takes the loudest peak to full scale
+		PlayerGeneric player(parameters.sampleRate);
+
+		player.setBufferSize(1024);
+		player.setPlayMode(parameters.playMode);
+		player.setResamplerType(parameters.resamplerType);
+		player.setSampleShift(parameters.mixerShift);
+		player.setMasterVolume(256);
+		player.setPeakAutoAdjust(true);
+
+		AudioDriver_NULL audioDriver;
+
+		player.exportToWAV(NULL, module,
+						   parameters.fromOrder, parameters.toOrder,
+						   parameters.muting, mutingNumChannels,
+						   NULL,
+						   &audioDriver);
+
+		job.mixerVolume = player.getMasterVolume();
+	}
+
+	PlayerGeneric player(parameters.sampleRate);
+
+	player.setBufferSize(1024);
+	player.setPlayMode(parameters.playMode);
+	player.setResamplerType(parameters.resamplerType);
+	player.setSampleShift(parameters.mixerShift);
+	player.setMasterVolume(job.mixerVolume);
+	player.setExportFloatWAV(parameters.floatFormat);
+	player.setNumExportThreads(parameters.numExportThreads);
+
+	mp_sint32 res = 0;
+
+	if (parameters.multiTrack)
+	{
+		// all channels are rendered in one pass, each into its own file
+		PPSystemString* fileNames = new PPSystemString[numChannels];
+		const SYSCHAR** stemFileNames = new const SYSCHAR*[numChannels];
+
+		PPSystemString baseName = job.outFileName.stripExtension();
+		PPSystemString extension = job.outFileName.getExtension();
+
+		for (mp_uint32 i = 0; i < numChannels; i++)
+		{
+			stemFileNames[i] = NULL;
+
+			if (i < mutingNumChannels && parameters.muting[i])
+				continue;
+
+			fileNames[i] = baseName;
+
+			char infix[80];
+			sprintf(infix, "_%02d", i+1);
+
+			fileNames[i].append(infix);
+			fileNames[i].append(extension);
+
+			stemFileNames[i] = fileNames[i];
+			job.numFiles++;
+		}
+
+		res = player.exportToWAVStems(stemFileNames, numChannels, module,
+									  parameters.fromOrder, parameters.toOrder,
+									  parameters.muting, mutingNumChannels);
+
+		delete[] stemFileNames;
+		delete[] fileNames;
+	}
+	else if (parameters.raw)
+	{
+		RawWriter rawWriter(job.outFileName, parameters.floatFormat);
+
+		if (rawWriter.isOpen())
+		{
+			res = player.exportToWAV(NULL, module,
+									 parameters.fromOrder, parameters.toOrder,
+									 parameters.muting, mutingNumChannels,
+									 NULL,
+									 &rawWriter);
+			job.numFiles = 1;
+		}
+		else
+		{
+			res = MP_DEVICE_ERROR;
+		}
+	}
+	else
+	{
+		res = player.exportToWAV(job.outFileName, module,
+								 parameters.fromOrder, parameters.toOrder,
+								 parameters.muting, mutingNumChannels);
+		job.numFiles = 1;
+	}
+
+	delete module;
+
+	if (res < 0)
+	{
+		job.result = res;
+		job.errorText = "can't write";
+		job.numFiles = 0;
+		return;
+	}
+
+	job.numSamples = res;
+}
+
+void RenderQueue::run(mp_uint32 numWorkers, Listener* listener/* = NULL*/)
+{
+	this->listener = listener;
+	nextJob = 0;
+	numFinished = 0;
+
+	// lookup tables are built by the first mixer and resampler of a kind,
+	// build them before the workers race for them
+	{
+		PlayerSTD player(parameters.sampleRate);
+		player.setResamplerType(parameters.resamplerType);
+	}
+
+	if (numWorkers > (unsigned)jobs.size())
+		numWorkers = jobs.size();
+
+	// the calling thread is one of the workers
+	Worker** workers = NULL;
+	mp_uint32 numThreads = 0;
+
+	if (numWorkers > 1 && MPThread::isSupported())
+	{
+		workers = new Worker*[numWorkers - 1];
+
+		for (mp_uint32 i = 0; i < numWorkers - 1; i++)
+		{
+			workers[numThreads] = new Worker(*this);
+			if (!workers[numThreads]->start())
+			{
+				delete workers[numThreads];
+				break;
+			}
+			numThreads++;
+		}
+	}
+
+	Worker worker(*this);
+	worker.work();
+
+	for (mp_uint32 i = 0; i < numThreads; i++)
+		delete workers[i];
+
+	delete[] workers;
+
+	this->listener = NULL;
+}
+
+double RenderQueue::getTime()
+{
+#if defined(WIN32) && !defined(_WIN32_WCE)
+	LARGE_INTEGER frequency, counter;
+	QueryPerformanceFrequency(&frequency);
+	QueryPerformanceCounter(&counter);
+	return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+	struct timeval now;
+	gettimeofday(&now, NULL);
+	return now.tv_sec + now.tv_usec / 1000000.0;
+#endif
+}
@@ -0,0 +1,169 @@
+/*
+ *  render/RenderQueue.h
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  RenderQueue.h
+ *  MilkyRender
+ *
+ *  Renders a list of modules to WAV or raw files. Each module is a job,
+ *  the jobs are handed out to a number of worker threads and every worker
+ *  renders one module at a time with PlayerGeneric, so many small files
+ *  keep all cores busy just like one long song cut into parts does.
+ *
+ */
+
+#ifndef __RENDERQUEUE_H__
+#define __RENDERQUEUE_H__
+
+#include "MilkyPlay.h"
+#include "MilkyPlayThread.h"
+#include "BasicTypes.h"
+#include "SimpleVector.h"
+#include <string.h>
+
+class RenderQueue
+{
+public:
+	enum
+	{
+		// channels which can be muted
+		MaxMuteChannels = 256
+	};
+
+	// the settings of the tracker's HD recorder (see ModuleServices::WAVWriterParameters)
+	struct Parameters
+	{
+		mp_uint32 sampleRate;
+		ChannelMixer::ResamplerTypes resamplerType;
+		PlayerBase::PlayModes playMode;
+		mp_sint32 mixerShift;
+		// between 0 and 256, -1 estimates the loudest volume which doesn't clip
+		mp_sint32 mixerVolume;
+
+		mp_sint32 fromOrder;
+		// -1 plays until the song ends
+		mp_sint32 toOrder;
+		mp_ubyte muting[MaxMuteChannels];
+
+		// one file per channel, named like the tracker names them
+		bool multiTrack;
+		// headerless little endian samples instead of a WAV file
+		bool raw;
+		bool floatFormat;
+
+		// threads rendering parts of a single module concurrently
+		mp_uint32 numExportThreads;
+
+		Parameters() :
+			sampleRate(44100),
+			resamplerType(ChannelMixer::MIXER_LERPING_RAMPING),
+			playMode(PlayerBase::PlayMode_Auto),
+			mixerShift(1),
+			mixerVolume(256),
+			fromOrder(0),
+			toOrder(-1),
+			multiTrack(false),
+			raw(false),
+			floatFormat(false),
+			numExportThreads(1)
+		{
+			memset(muting, 0, sizeof(muting));
+		}
+	};
+
+	struct Job
+	{
+		PPSystemString inFileName;
+		// for multi track rendering the channel number is inserted in front of the extension
+		PPSystemString outFileName;
+
+		// MP_OK, error code of the step given by errorText otherwise
+		mp_sint32 result;
+		const char* errorText;
+
+		// stereo samples written to every file
+		mp_uint32 numSamples;
+		mp_uint32 numFiles;
+		// the volume the song was rendered with
+		mp_sint32 mixerVolume;
+		// wall clock time taken by loading and rendering
+		double seconds;
+
+		Job(const PPSystemString& inFileName, const PPSystemString& outFileName) :
+			inFileName(inFileName),
+			outFileName(outFileName),
+			result(MP_OK),
+			errorText(NULL),
+			numSamples(0),
+			numFiles(0),
+			mixerVolume(0),
+			seconds(0.0)
+		{
+		}
+	};
+
+	// notified from the worker threads, but never concurrently
+	class Listener
+	{
+	public:
+		virtual ~Listener()
+		{
+		}
+
+		virtual void jobFinished(const Job& job, mp_uint32 numFinished, mp_uint32 numJobs) = 0;
+	};
+
+private:
+	class Worker;
+	friend class Worker;
+
+	Parameters parameters;
+	PPSimpleVector<Job> jobs;
+
+	Listener* listener;
+	mp_uint32 nextJob;
+	mp_uint32 numFinished;
+	MPMutex mutex;
+
+	// the next job nobody has claimed yet, NULL if there is none left
+	Job* claimJob();
+	void finishJob(Job& job);
+
+	void render(Job& job);
+
+public:
+	RenderQueue(const Parameters& parameters);
+
+	void add(const PPSystemString& inFileName, const PPSystemString& outFileName);
+
+	mp_uint32 getNumJobs() const { return jobs.size(); }
+	const Job& getJob(mp_uint32 index) const { return *jobs.get(index); }
+
+	// Renders all jobs and returns when they are done.
+	// numWorkers = 0 renders them one after another on the calling thread.
+	void run(mp_uint32 numWorkers, Listener* listener = NULL);
+
+	// wall clock in seconds
+	static double getTime();
+};
+
+#endif
@@ -0,0 +1,240 @@
+/*
+ *  tools/commandqueuestress.cpp
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  Stress test for the UI to audio command queue.
+ *
+ *  A thread posts mute and speed commands as fast as the queue takes them
+ *  while the main thread renders the module and applies them from the
+ *  player callback, the way the tracker does. Every command carries a
+ *  sequence number and a checksum, a lost, duplicated, reordered or torn
+ *  command fails the test.
+ *
+ *  Now and then the main thread stops rendering for a while, so the queue
+ *  fills up. The producer then does what PlayerController does: it pauses
+ *  the player and applies the queued commands itself. The test fails if
+ *  that never happened.
+ *
+ *  Build (from src/):
+ *  g++ -O2 -DMILKYTRACKER -DDRIVER_UNIX -Imilkyplay -Imilkyplay/drivers/sdl -Itmm -Itracker tools/commandqueuestress.cpp milkyplay/*.cpp milkyplay/drivers/sdl/AudioDriver_SDL.cpp tmm/*.cpp tmm/kiss_fft.c `sdl2-config --cflags --libs` -lpthread -o commandqueuestress
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "MilkyPlay.h"
+#include "MilkyPlayThread.h"
+#include "AudioDriver_NULL.h"
+#include "PlayerCommandQueue.h"
+
+const mp_uint32 sampleRate = 44100;
+const mp_uint32 bufferSize = 512;
+const mp_sint32 numCommands = 200000;
+// how long and how often the consumer stalls
+const mp_uint32 stallMillis = 5;
+const mp_sint32 stallInterval = 64;
+
+static mp_sint32 checksum(const PlayerCommandQueue::Command& command)
+{
+	return command.channel * 31 + command.params[0] * 17 + command.params[1] * 7 + command.params[2];
+}
+
+class Consumer : public PlayerSTD::StatusEventListener
+{
+private:
+	PlayerCommandQueue& queue;
+
+public:
+	mp_sint32 numReceived;
+	mp_sint32 numErrors;
+	mp_sint32 maxBatch;
+
+	Consumer(PlayerCommandQueue& queue) :
+		queue(queue),
+		numReceived(0),
+		numErrors(0),
+		maxBatch(0)
+	{
+	}
+
+	virtual void timerTickStarted(PlayerSTD& player, XModule& module)
+	{
+		processCommands(player);
+	}
+
+	void processCommands(PlayerSTD& player)
+	{
+		mp_sint32 batch = 0;
+		const PlayerCommandQueue::Command* command;
+		while ((command = queue.peek()) != NULL)
+		{
+			if (command->params[2] != numReceived || command->params[3] != checksum(*command))
+				numErrors++;
+
+			switch (command->code)
+			{
+				case PlayerCommandQueue::CodeMuteChannel:
+					player.muteChannel(command->channel, command->params[0] != 0);
+					break;
+				case PlayerCommandQueue::CodeSpeed:
+					player.setTempo(command->params[0]);
+					player.setSpeed(command->params[1]);
+					break;
+				default:
+					numErrors++;
+			}
+
+			queue.remove();
+			numReceived++;
+			batch++;
+		}
+
+		if (batch > maxBatch)
+			maxBatch = batch;
+	}
+};
+
+class Producer : public MPThread
+{
+private:
+	PlayerCommandQueue& queue;
+	MasterMixer& mixer;
+	PlayerSTD& player;
+	Consumer& consumer;
+	mp_sint32 numChannels;
+
+protected:
+	virtual void run()
+	{
+		for (mp_sint32 i = 0; i < numCommands; i++)
+		{
+			PlayerCommandQueue::Command* command = queue.prepare();
+			if (command == NULL)
+			{
+				numFull++;
+				mixer.pauseDevice(&player);
+				consumer.processCommands(player);
+				mixer.resumeDevice(&player);
+				command = queue.prepare();
+			}
+
+			command->channel = i % numChannels;
+			if (i & 1)
+			{
+				command->code = PlayerCommandQueue::CodeMuteChannel;
+				command->params[0] = (i >> 1) & 1;
+			}
+			else
+			{
+				command->code = PlayerCommandQueue::CodeSpeed;
+				command->params[0] = 125 + (i % 64);
+				command->params[1] = 3 + (i % 4);
+			}
+			command->params[2] = i;
+			command->params[3] = checksum(*command);
+			queue.post();
+		}
+	}
+
+public:
+	mp_sint32 numFull;
+
+	Producer(PlayerCommandQueue& queue, MasterMixer& mixer, PlayerSTD& player, Consumer& consumer, mp_sint32 numChannels) :
+		queue(queue),
+		mixer(mixer),
+		player(player),
+		consumer(consumer),
+		numChannels(numChannels),
+		numFull(0)
+	{
+	}
+
+	virtual ~Producer()
+	{
+		join();
+	}
+};
+
+int main(int argc, const char* argv[])
+{
+	if (argc < 2)
+	{
+		printf("usage: %s module\n", argv[0]);
+		return 1;
+	}
+
+	XModule module;
+	if (module.loadModule(argv[1]) != MP_OK)
+	{
+		printf("can't load %s\n", argv[1]);
+		return 1;
+	}
+
+	PlayerCommandQueue queue;
+	Consumer consumer(queue);
+
+	AudioDriver_NULL driver;
+	MasterMixer mixer(sampleRate, bufferSize, 1, &driver);
+	PlayerSTD player(sampleRate, &consumer);
+	player.setBufferSize(bufferSize);
+	mixer.addDevice(&player);
+	player.startPlaying(&module, true);
+	mixer.start();
+
+	Producer producer(queue, mixer, player, consumer, module.header.channum);
+	if (!producer.start())
+	{
+		printf("can't start the producer thread\n");
+		return 1;
+	}
+
+	const clock_t start = clock();
+	mp_sint32 numBuffers = 0;
+	mp_sint32 numStalls = 0;
+	while (consumer.numReceived < numCommands)
+	{
+		driver.advance();
+		numBuffers++;
+
+		if (numBuffers % stallInterval == 0)
+		{
+			MPThread::sleep(stallMillis);
+			numStalls++;
+		}
+	}
+	const double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	mixer.stop();
+	mixer.closeAudioDevice();
+
+	printf("%d commands in %d buffers (%.2f s), at most %d per beat packet, %d errors\n",
+		   consumer.numReceived, numBuffers, seconds, consumer.maxBatch, consumer.numErrors);
+	printf("queue full %d times in %d stalls\n", producer.numFull, numStalls);
+
+	if (!producer.numFull)
+	{
+		printf("the queue never filled up\n");
+		return 1;
+	}
+
+	return consumer.numErrors ? 1 : 0;
+}
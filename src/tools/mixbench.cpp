@@ -0,0 +1,143 @@
+/*
+ *  tools/mixbench.cpp
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  Mixer throughput benchmark for many channels.
+ *
+ *  Looping 16 bit samples are started on 32, 64 and 256 channels with
+ *  different pitches and mixed through ChannelMixer::mix, which includes
+ *  the per beat packet work (ramping state, time records). The filtered
+ *  run enables the IT resonant filter on every channel. Reported is the
+ *  mixing time per channel and output frame in nanoseconds, best of
+ *  three runs.
+ *
+ *  Build (from src/):
+ *  g++ -O2 -DMILKYTRACKER -Imilkyplay -Itmm tools/mixbench.cpp milkyplay/ChannelMixer.cpp milkyplay/ResamplerFactory.cpp milkyplay/MixerProxy.cpp milkyplay/MixerThreadPool.cpp milkyplay/MilkyPlayThread.cpp milkyplay/ChannelInsert.cpp milkyplay/PlayerSnapshot.cpp -lpthread -o mixbench
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "ChannelMixer.h"
+#include "MixerProxy.h"
+
+const int sampleLength = 65536;
+const int sampleMargin = 16;
+const int benchFrequency = 44100;
+const int bufferSize = 1024;
+const int benchFrames = 1 << 21;
+
+static mp_sword sampleData[sampleLength + sampleMargin*2];
+
+class BenchMixer : public ChannelMixer
+{
+protected:
+	virtual void timerHandler(mp_sint32 currentBeatPacket)
+	{
+	}
+
+public:
+	BenchMixer(mp_uint32 numChannels, bool filtered) :
+		ChannelMixer(numChannels, benchFrequency)
+	{
+		setAllowFilters(filtered);
+
+		setNumChannels(numChannels);
+		setBufferSize(bufferSize);
+		initDevice();
+		startMixer();
+		startPlay = true;
+
+		for (mp_uint32 c = 0; c < numChannels; c++)
+		{
+			// forward loop, 16 bit
+			playSample(c, (mp_sbyte*)(sampleData + sampleMargin), sampleLength, (c * 997) % sampleLength, 0, false, 0, sampleLength, 1 | 4);
+			setVol(c, 255);
+			setPan(c, (c * 37) & 255);
+			setFreq(c, 8363 + c * 311);
+			setFilterAttributes(c, 64 * 256 + c * 16, 32);
+		}
+	}
+};
+
+static double benchmark(ChannelMixer::ResamplerTypes type, bool filtered, mp_uint32 numChannels)
+{
+	BenchMixer mixer(numChannels, filtered);
+	mixer.setResamplerType(type);
+
+	MixerProxyMixDown proxy;
+
+	// warm up
+	proxy.lock(bufferSize, 0);
+	mixer.mix(&proxy);
+
+	// best of a few runs
+	double seconds = 0.0;
+	for (int run = 0; run < 3; run++)
+	{
+		const clock_t start = clock();
+		for (int frames = 0; frames < benchFrames; frames += bufferSize)
+		{
+			proxy.lock(bufferSize, 0);
+			mixer.mix(&proxy);
+		}
+		const double runSeconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+		if (run == 0 || runSeconds < seconds)
+			seconds = runSeconds;
+	}
+
+	return seconds * 1e9 / ((double)benchFrames * numChannels);
+}
+
+int main(int argc, const char* argv[])
+{
+	for (int i = 0; i < sampleLength + sampleMargin*2; i++)
+		sampleData[i] = (mp_sword)floor(sin(i * 0.01) * 16384.0 + 0.5);
+
+	const struct
+	{
+		ChannelMixer::ResamplerTypes type;
+		bool filtered;
+		const char* name;
+	} resamplers[] =
+	{
+		{ ChannelMixer::MIXER_NORMAL, false, "no interpolation" },
+		{ ChannelMixer::MIXER_LERPING_RAMPING, false, "linear + ramping" },
+		{ ChannelMixer::MIXER_LERPING_RAMPING, true, "linear + ramping + filter" },
+		{ ChannelMixer::MIXER_SINCTABLE_RAMPING, false, "sinc table + ramping" }
+	};
+
+	const mp_uint32 numChannels[] = { 32, 64, 256 };
+
+	printf("%-26s %10s %10s %10s\n", "ns per channel & frame", "32", "64", "256");
+
+	for (unsigned int i = 0; i < sizeof(resamplers) / sizeof(resamplers[0]); i++)
+	{
+		printf("%-26s", resamplers[i].name);
+		for (unsigned int j = 0; j < sizeof(numChannels) / sizeof(numChannels[0]); j++)
+			printf(" %10.2f", benchmark(resamplers[i].type, resamplers[i].filtered, numChannels[j]));
+		printf("\n");
+	}
+
+	return 0;
+}
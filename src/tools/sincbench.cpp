@@ -0,0 +1,162 @@
+/*
+ *  tools/sincbench.cpp
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  Quality vs. throughput benchmark for the sinc resamplers.
+ *
+ *  Quality: a 16 bit sine is resampled and compared against the ideal
+ *  output, giving the signal to noise ratio in dB. For downsampling the
+ *  sine lies above the new nyquist frequency, so everything that comes
+ *  out is aliasing and the rejection in dB is reported instead.
+ *  Throughput: million output frames per second for a single channel.
+ *
+ *  Build (from src/):
+ *  g++ -O2 -DMILKYTRACKER -Imilkyplay -Itmm tools/sincbench.cpp milkyplay/ChannelMixer.cpp milkyplay/ResamplerFactory.cpp milkyplay/MixerThreadPool.cpp milkyplay/MilkyPlayThread.cpp milkyplay/ChannelInsert.cpp milkyplay/PlayerSnapshot.cpp -lpthread -o sincbench
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "ChannelMixer.h"
+#include "ResamplerFast.h"
+#include "ResamplerSinc.h"
+#include "ResamplerSincPolyphase.h"
+
+const int sampleLength = 1 << 18;
+const int sampleMargin = 256;
+const int blockSize = 256;
+const int outputFrames = 1 << 16;
+const int throughputFrames = 1 << 20;
+
+static mp_sword sampleData[sampleLength + sampleMargin*2];
+static mp_sint32 mixBuffer[blockSize*2];
+static double output[outputFrames];
+
+static void makeSine(double freq)
+{
+	for (int i = 0; i < sampleLength + sampleMargin*2; i++)
+		sampleData[i] = (mp_sword)floor(sin(2.0 * M_PI * freq * (i - sampleMargin)) * 16384.0 + 0.5);
+}
+
+static void setupChannel(ChannelMixer::TMixerChannel& chn, double step)
+{
+	memset(&chn, 0, sizeof(chn));
+	chn.sample = (mp_sbyte*)(sampleData + sampleMargin);
+	chn.smplen = sampleLength;
+	chn.loopstart = 0;
+	chn.loopend = chn.loopendcopy = sampleLength;
+	chn.flags = ChannelMixer::MP_SAMPLE_PLAY | 4;
+	chn.smppos = sampleMargin;
+	chn.smpadd = (mp_sint32)(step * 65536.0);
+	chn.rsmpadd = 0xFFFFFFFF / chn.smpadd;
+	// (x * (finalvol>>15)) >> 15 with a gain of 1.0
+	chn.finalvoll = chn.finalvolr = 1 << 30;
+	chn.cutoff = chn.resonance = ChannelMixer::MP_INVALID_VALUE;
+}
+
+static void render(ChannelMixer::ResamplerBase* resampler, ChannelMixer::TMixerChannel& chn, int frames, double* dest)
+{
+	for (int i = 0; i < frames; i += blockSize)
+	{
+		memset(mixBuffer, 0, sizeof(mixBuffer));
+		resampler->addBlockNoCheck(mixBuffer, &chn, blockSize);
+		if (dest)
+			for (int j = 0; j < blockSize; j++)
+				dest[i + j] = mixBuffer[j*2];
+	}
+}
+
+// signal to noise ratio of resampling a sine, or alias rejection if the sine can't pass
+static double measureQuality(ChannelMixer::ResamplerBase* resampler, double freq, double step)
+{
+	makeSine(freq);
+
+	ChannelMixer::TMixerChannel chn(true);
+	setupChannel(chn, step);
+	render(resampler, chn, outputFrames, output);
+
+	const bool aliasing = freq * step > 0.5;
+	const double realStep = chn.smpadd / 65536.0;
+	double signal = 0.0, noise = 0.0;
+
+	// skip the start to let the ramping settle
+	for (int i = 256; i < outputFrames; i++)
+	{
+		const double ideal = aliasing ? 0.0 : sin(2.0 * M_PI * freq * (i * realStep + sampleMargin)) * 16384.0;
+		const double error = output[i] - ideal;
+		signal += aliasing ? 16384.0 * 16384.0 * 0.5 : ideal * ideal;
+		noise += error * error;
+	}
+
+	return noise > 0.0 ? 10.0 * log10(signal / noise) : 999.0;
+}
+
+static double measureThroughput(ChannelMixer::ResamplerBase* resampler, double step)
+{
+	makeSine(0.1);
+
+	ChannelMixer::TMixerChannel chn(true);
+	setupChannel(chn, step);
+
+	const clock_t start = clock();
+	int frames = 0;
+	while (frames < throughputFrames)
+	{
+		// stay away from the sample end
+		chn.smppos = sampleMargin;
+		render(resampler, chn, outputFrames / 2, NULL);
+		frames += outputFrames / 2;
+	}
+	const double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	return seconds > 0.0 ? frames / seconds / 1000000.0 : 0.0;
+}
+
+static void benchmark(const char* name, ChannelMixer::ResamplerBase* resampler)
+{
+	printf("%-36s %8.1f %8.1f %8.1f %8.1f %10.2f\n", name,
+		   measureQuality(resampler, 0.05, 0.73),
+		   measureQuality(resampler, 0.3, 0.73),
+		   measureQuality(resampler, 0.45, 0.5),
+		   measureQuality(resampler, 0.4, 1.5),
+		   measureThroughput(resampler, 0.73));
+
+	delete resampler;
+}
+
+int main(int argc, const char* argv[])
+{
+	printf("%-36s %8s %8s %8s %8s %10s\n", "resampler", "snr.05", "snr.30", "snr.45", "alias", "Mframes/s");
+
+	benchmark("linear", new ResamplerLerp());
+	benchmark("ResamplerSincTable<16>", new ResamplerSincTable<false, 16>());
+	benchmark("ResamplerSinc<128>", new ResamplerSinc<false, 128>());
+	benchmark("polyphase 16 taps/256 int hann", new ResamplerSincPolyphase<false, 16, 8, mp_sint32, SincPolyphaseWindows::WINDOW_HANN>());
+	benchmark("polyphase 16 taps/1024 float kaiser", new ResamplerSincPolyphase<false, 16, 10, float, SincPolyphaseWindows::WINDOW_KAISER>());
+	benchmark("polyphase 32 taps/1024 int kaiser", new ResamplerSincPolyphase<false, 32, 10, mp_sint32, SincPolyphaseWindows::WINDOW_KAISER>());
+	benchmark("polyphase 32 taps/1024 float kaiser", new ResamplerSincPolyphase<false, 32, 10, float, SincPolyphaseWindows::WINDOW_KAISER>());
+	benchmark("polyphase 32 taps/1024 float blackman", new ResamplerSincPolyphase<false, 32, 10, float, SincPolyphaseWindows::WINDOW_BLACKMAN>());
+	benchmark("polyphase 64 taps/4096 float kaiser", new ResamplerSincPolyphase<false, 64, 12, float, SincPolyphaseWindows::WINDOW_KAISER>());
+
+	return 0;
+}
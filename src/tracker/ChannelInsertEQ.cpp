@@ -0,0 +1,106 @@
+/*
+ *  tracker/ChannelInsertEQ.cpp
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  ChannelInsertEQ.cpp
+ *  MilkyTracker
+ *
+ */
+
+#include "ChannelInsertEQ.h"
+#include "Equalizer.h"
+#include "EQConstants.h"
+
+ChannelInsertEQ::ChannelInsertEQ(pp_uint32 numBands) :
+	numBands(numBands == 10 ? 10 : 3),
+	sampleRate(44100)
+{
+	bands = new Equalizer[this->numBands];
+	values = new float[this->numBands];
+
+	centres = this->numBands == 10 ? EQConstants::EQ10bands : EQConstants::EQ3bands;
+	widths = this->numBands == 10 ? EQConstants::EQ10bandwidths : EQConstants::EQ3bandwidths;
+
+	for (pp_uint32 i = 0; i < this->numBands; i++)
+	{
+		values[i] = 0.5f;
+		updateBand(i);
+	}
+}
+
+ChannelInsertEQ::~ChannelInsertEQ()
+{
+	delete[] values;
+	delete[] bands;
+}
+
+void ChannelInsertEQ::updateBand(pp_uint32 band)
+{
+	bands[band].CalcCoeffs(centres[band], widths[band], (float)sampleRate, Equalizer::CalcGain(values[band]));
+}
+
+void ChannelInsertEQ::setBandValue(pp_uint32 band, float value)
+{
+	if (band >= numBands)
+		return;
+
+	values[band] = value;
+	updateBand(band);
+}
+
+void ChannelInsertEQ::process(mp_sint32* buffer, mp_uint32 numSamples)
+{
+	for (pp_uint32 j = 0; j < numBands; j++)
+	{
+		// flat bands leave the signal alone
+		if (values[j] == 0.5f)
+			continue;
+
+		Equalizer& band = bands[j];
+		mp_sint32* sample = buffer;
+		for (mp_uint32 i = 0; i < numSamples; i++)
+		{
+			double yL, yR;
+			band.Filter((double)sample[0], (double)sample[1], yL, yR);
+			sample[0] = (mp_sint32)yL;
+			sample[1] = (mp_sint32)yR;
+			sample+=2;
+		}
+	}
+}
+
+void ChannelInsertEQ::setSampleRate(mp_uint32 sampleRate)
+{
+	this->sampleRate = sampleRate;
+	for (pp_uint32 i = 0; i < numBands; i++)
+		updateBand(i);
+}
+
+void ChannelInsertEQ::reset()
+{
+	// a fresh filter has no history
+	for (pp_uint32 i = 0; i < numBands; i++)
+	{
+		bands[i] = Equalizer();
+		updateBand(i);
+	}
+}
@@ -0,0 +1,69 @@
+/*
+ *  tracker/ChannelInsertEQ.h
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  ChannelInsertEQ.h
+ *  MilkyTracker
+ *
+ *  Channel insert running the sample editor equalizer bands in series,
+ *  see ChannelInsert.h
+ *
+ */
+
+#ifndef __CHANNELINSERTEQ_H__
+#define __CHANNELINSERTEQ_H__
+
+#include "BasicTypes.h"
+#include "ChannelInsert.h"
+
+class Equalizer;
+
+class ChannelInsertEQ : public ChannelInsert
+{
+private:
+	pp_uint32 numBands;
+	Equalizer* bands;
+	// 0 to 1 like Equalizer::CalcGain, 0.5 is flat
+	float* values;
+	const float* centres;
+	const float* widths;
+	mp_uint32 sampleRate;
+
+	void updateBand(pp_uint32 band);
+
+public:
+	// numBands must be 3 or 10, the band layout is the one from EQConstants
+	ChannelInsertEQ(pp_uint32 numBands);
+	virtual ~ChannelInsertEQ();
+
+	pp_uint32 getNumBands() const { return numBands; }
+
+	// value from 0 to 1, that is -12dB to +12dB
+	void setBandValue(pp_uint32 band, float value);
+	float getBandValue(pp_uint32 band) const { return values[band]; }
+
+	virtual void process(mp_sint32* buffer, mp_uint32 numSamples);
+	virtual void setSampleRate(mp_uint32 sampleRate);
+	virtual void reset();
+};
+
+#endif
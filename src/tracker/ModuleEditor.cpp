@@ -684,7 +684,16 @@ bool ModuleEditor::openSong(const SYSCHAR* fileName, const SYSCHAR* preferredFil
 	if (!XMFile::exists(fileName))
 		return false;
 
-	mp_sint32 nRes = module->loadModule(fileName);
+	XMMappedFile f(fileName);
+	if (!f.isOpen())
+		return false;
+
+	return openSong(f, preferredFileName);
+}
+
+bool ModuleEditor::openSong(XMFileBase& f, const SYSCHAR* preferredFileName/* = NULL*/)
+{
+	mp_sint32 nRes = module->loadModule(f);
 
 	// unknown format
 	if (nRes == MP_UNKNOWN_FORMAT)
@@ -694,7 +703,7 @@ bool ModuleEditor::openSong(const SYSCHAR* fileName, const SYSCHAR* preferredFil
 
 	bool res = (nRes == MP_OK);
 
-	XMFile f(fileName);
+	f.seek(0);
 	bool isMagicMOD = f.readByte() == 232;
 
 	XModule::ModuleTypes type = XModule::ModuleType_NONE;
@@ -769,7 +778,7 @@ bool ModuleEditor::openSong(const SYSCHAR* fileName, const SYSCHAR* preferredFil
 		for (mp_sint32 i = 0; i < module->header.patnum; i++)
 			getPattern(i);
 
-		PPSystemString strFileName = preferredFileName ? preferredFileName : fileName;
+		PPSystemString strFileName = preferredFileName ? preferredFileName : f.getFileName();
 
 		moduleFileName = strFileName.stripExtension();
 
@@ -246,6 +246,8 @@ class ModuleEditor
 	bool isEmpty() const;
 
 	bool openSong(const SYSCHAR* fileName, const SYSCHAR* preferredFileName = NULL);
+	// e.g. a module unpacked into memory, files without a name need a preferred file name
+	bool openSong(XMFileBase& f, const SYSCHAR* preferredFileName = NULL);
 	bool saveSong(const SYSCHAR* fileName, ModSaveTypes saveType = ModSaveTypeXM);
 	mp_sint32 saveBackup(const SYSCHAR* fileName);
 
@@ -32,12 +32,35 @@
 #include "SongLengthEstimator.h"
 #include "PlayerGeneric.h"
 #include "AudioDriver_NULL.h"
+#include "MilkyPlayThread.h"
 #include "XModule.h"
 
+ModuleServices::ModuleServices(XModule& module) :
+	module(module),
+	songLengthEstimator(new SongLengthEstimator(&module)),
+	estimatedSongLength(-1)
+{
+}
+
+ModuleServices::~ModuleServices()
+{
+	delete songLengthEstimator;
+}
+
 void ModuleServices::estimateSongLength()
 {
-	SongLengthEstimator estimator(&module);
-	estimatedSongLength = estimator.estimateSongLengthInSeconds();
+	estimatedSongLength = songLengthEstimator->estimateSongLengthInSeconds();
+}
+
+void ModuleServices::resetEstimatedSongLength()
+{
+	songLengthEstimator->invalidate();
+	estimatedSongLength = -1;
+}
+
+pp_int32 ModuleServices::getEstimatedOrderTime(pp_int32 index)
+{
+	return songLengthEstimator->getOrderTimeInMillis(index);
 }
 
 pp_int32 ModuleServices::estimateMixerVolume(WAVWriterParameters& parameters,
@@ -113,37 +136,45 @@ pp_int32 ModuleServices::exportToWAV(const PPSystemString& fileName, WAVWriterPa
 
 	if (parameters.multiTrack)
 	{
-		mp_ubyte* muting = new mp_ubyte[module.header.channum];
+		// all channels are rendered in one pass, each into its own file
+		PPSystemString* fileNames = new PPSystemString[module.header.channum];
+		const SYSCHAR** stemFileNames = new const SYSCHAR*[module.header.channum];
 
 		PPSystemString baseName = fileName.stripExtension();
 		PPSystemString extension = fileName.getExtension();
 
 		for (pp_uint32 i = 0; i < module.header.channum; i++)
 		{
-			PPSystemString fileName = baseName;
+			stemFileNames[i] = NULL;
+
+			if (parameters.muting[i])
+				continue;
+
+			fileNames[i] = baseName;
 
 			char infix[80];
 			sprintf(infix, "_%02d", i+1);
 
-			fileName.append(infix);
-			fileName.append(extension);
+			fileNames[i].append(infix);
+			fileNames[i].append(extension);
 
-			if (!parameters.muting[i])
-			{
-				memset(muting, 1, module.header.channum);
-				muting[i] = 0;
-				res = player->exportToWAV(fileName, &module,
-										  parameters.fromOrder, parameters.toOrder,
-										  muting,
-										  module.header.channum,
-										  parameters.panning);
-			}
+			stemFileNames[i] = fileNames[i];
 		}
 
-		delete[] muting;
+		res = player->exportToWAVStems(stemFileNames, module.header.channum, &module,
+									   parameters.fromOrder, parameters.toOrder,
+									   parameters.muting,
+									   module.header.channum,
+									   parameters.panning);
+
+		delete[] stemFileNames;
+		delete[] fileNames;
 	}
 	else
 	{
+		// song parts are rendered concurrently, the file stays the same
+		player->setNumExportThreads(MPThread::getNumProcessors());
+
 		res = player->exportToWAV(fileName, &module,
 								  parameters.fromOrder, parameters.toOrder,
 								  parameters.muting,
@@ -39,18 +39,19 @@ class ModuleServices
 private:
 	class XModule& module;
 
+	class SongLengthEstimator* songLengthEstimator;
 	pp_int32 estimatedSongLength;
 
 public:
-	ModuleServices(XModule& module) :
-		module(module),
-		estimatedSongLength(-1)
-	{
-	}
+	ModuleServices(XModule& module);
+	~ModuleServices();
 	
+	// only plays the part of the song which has changed since the last call
 	void estimateSongLength();
 	pp_int32 getEstimatedSongLength() const { return estimatedSongLength; }
-	void resetEstimatedSongLength() { estimatedSongLength = -1; }
+	void resetEstimatedSongLength();
+	// time an order is reached in milliseconds, -1 if it's never played
+	pp_int32 getEstimatedOrderTime(pp_int32 index);
 	
 	struct WAVWriterParameters
 	{
@@ -306,14 +306,16 @@ bool PatternEditor::revoke(const PatternUndoStackEntry* stackEntry)
 {
 	const TXMPattern& stackPattern = stackEntry->GetPattern();
 
-	enterCriticalSection();
-
 	bool res = false;
 
+	// the player only needs to be kept away if the pattern data is reallocated,
+	// restoring the contents is no different from editing them
 	if (stackPattern.rows != pattern->rows ||
 		stackPattern.channum != pattern->channum ||
 		stackPattern.effnum != pattern->effnum)
 	{
+		enterCriticalSection();
+
 		pattern->rows = stackPattern.rows;
 		pattern->channum = stackPattern.channum;
 		pattern->effnum = stackPattern.effnum;
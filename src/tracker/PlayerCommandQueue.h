@@ -0,0 +1,115 @@
+/*
+ *  tracker/PlayerCommandQueue.h
+ *
+ *  Copyright 2026 The MilkyTracker Team
+ *
+ *  This file is part of Milkytracker.
+ *
+ *  Milkytracker is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Milkytracker is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Milkytracker.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ *  PlayerCommandQueue.h
+ *  MilkyTracker
+ *
+ *  Ring buffer carrying commands from the UI thread to the audio callback.
+ *  There must be exactly one thread posting and one thread fetching at a
+ *  time, neither of them ever blocks. When the queue is full PlayerController
+ *  pauses the player, so the callback can't fetch, and applies the queued
+ *  commands from the UI thread itself.
+ *
+ */
+
+#ifndef __PLAYERCOMMANDQUEUE_H__
+#define __PLAYERCOMMANDQUEUE_H__
+
+#include "MilkyPlayThread.h"
+#include <string.h>
+
+struct TXMSample;
+
+class PlayerCommandQueue
+{
+public:
+	enum Codes
+	{
+		CodeInvalid = 0,
+		CodeNote,
+		CodeSample,
+		CodeStopSample,
+		CodeStopInstrument,
+		CodeMuteChannel,
+		CodeSpeed
+	};
+
+	struct Command
+	{
+		mp_ubyte code;
+		mp_sint32 channel;
+		// meaning depends on the code
+		mp_sint32 params[4];
+		const TXMSample* smp;
+	};
+
+private:
+	enum
+	{
+		// must be 2^n
+		QUEUESIZE = 256
+	};
+
+	Command commands[QUEUESIZE];
+
+	MPAtomicIndex readIndex;
+	MPAtomicIndex writeIndex;
+
+public:
+	PlayerCommandQueue()
+	{
+		memset(commands, 0, sizeof(commands));
+	}
+
+	// producer: slot for the next command, NULL if the queue is full
+	Command* prepare()
+	{
+		const mp_uint32 index = writeIndex.get();
+		if (index - readIndex.get() >= QUEUESIZE)
+			return NULL;
+		return &commands[index & (QUEUESIZE-1)];
+	}
+
+	// producer: make the prepared command visible to the consumer
+	void post()
+	{
+		writeIndex.set(writeIndex.get() + 1);
+	}
+
+	// consumer: oldest command which has not been removed yet, NULL if there is none
+	const Command* peek() const
+	{
+		const mp_uint32 index = readIndex.get();
+		if (index == writeIndex.get())
+			return NULL;
+		return &commands[index & (QUEUESIZE-1)];
+	}
+
+	// consumer: done with the command returned by peek()
+	void remove()
+	{
+		readIndex.set(readIndex.get() + 1);
+	}
+};
+
+#endif
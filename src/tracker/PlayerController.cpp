@@ -31,9 +31,9 @@
 #include "PlayerController.h"
 #include "PlayerMaster.h"
 #include "MilkyPlay.h"
-#include "ResamplerMacros.h"
 #include "PPSystem.h"
 #include "PlayerCriticalSection.h"
+#include "PlayerCommandQueue.h"
 #include "ModuleEditor.h"
 
 class PlayerStatusTracker : public PlayerSTD::StatusEventListener
@@ -42,90 +42,186 @@ class PlayerStatusTracker : public PlayerSTD::StatusEventListener
 	PlayerStatusTracker(PlayerController& playerController) :
 		playerController(playerController)
 	{
-		clearUpdateCommandBuff();
 	}
 
-	// this is being called from the player callback in a serialized fashion
+	// these are being called from the player callback in a serialized fashion
+	virtual void timerTickStarted(PlayerSTD& player, XModule& module)
+	{
+		processCommands(player, false);
+	}
+
 	virtual void playerTickStarted(PlayerSTD& player, XModule& module)
 	{
-		while (rbReadIndex < rbWriteIndex)
+		processCommands(player, true);
+	}
+
+	virtual void patternEndReached(PlayerSTD& player, XModule& module, mp_sint32& newOrderIndex)
+	{
+		handleQueuedPositions(player, newOrderIndex);
+	}
+
+	// Apply the queued commands, notes and samples are started with a tick
+	// only. Commands must stay in order, so everything queued behind a note
+	// waits for the tick as well.
+	// Outside the player callback this may only be called while the player
+	// is not being mixed.
+	void processCommands(PlayerSTD& player, bool tickStarted)
+	{
+		const PlayerCommandQueue::Command* command;
+		while ((command = commandQueue.peek()) != NULL)
 		{
-			mp_sint32 idx = rbReadIndex & (UPDATEBUFFSIZE-1);
+			if (!tickStarted &&
+				(command->code == PlayerCommandQueue::CodeNote || command->code == PlayerCommandQueue::CodeSample))
+				break;
 
-			// handle notes that are played from external source
-			// i.e. keyboard playback
-			switch (updateCommandBuff[idx].code)
+			switch (command->code)
 			{
-				case UpdateCommandCodeNote:
-				{
-					UpdateCommandNote* command = reinterpret_cast<UpdateCommandNote*>(&updateCommandBuff[idx]);
-					mp_sint32 note = command->note;
-					if (note)
-					{
-						player.playNote(command->channel, note,
-										command->ins,
-										command->volume);
-						command->note = 0;
-					}
+				// handle notes that are played from external source
+				// i.e. keyboard playback
+				case PlayerCommandQueue::CodeNote:
+					if (command->params[0])
+						player.playNote(command->channel, command->params[0], command->params[1], command->params[2]);
+					break;
+
+				case PlayerCommandQueue::CodeSample:
+					if (command->smp)
+						playSampleInternal(player, command->channel, command->smp, command->params[0],
+										   command->params[1], command->params[2]);
+					break;
+
+				case PlayerCommandQueue::CodeStopSample:
+					stopSampleInternal(player, command->channel);
 					break;
-				}
 
-				case UpdateCommandCodeSample:
-				{
-					UpdateCommandSample* command = reinterpret_cast<UpdateCommandSample*>(&updateCommandBuff[idx]);
-					const TXMSample* smp = command->smp;
-					if (smp)
+				case PlayerCommandQueue::CodeStopInstrument:
+					for (mp_sint32 i = 0; i < command->params[1]; i++)
 					{
-						playSampleInternal(player, command->channel, smp, command->currentSamplePlayNote,
-										   command->rangeStart,  command->rangeEnd);
-						command->smp = NULL;
+						if (player.chninfo[i].ins == command->params[0])
+							stopSampleInternal(player, i);
 					}
+					break;
 
+				case PlayerCommandQueue::CodeMuteChannel:
+					player.muteChannel(command->channel, command->params[0] != 0);
 					break;
-				}
 
+				case PlayerCommandQueue::CodeSpeed:
+					if (player.isPlaying())
+					{
+						player.setTempo(command->params[0]);
+						player.setSpeed(command->params[1]);
+					}
+					break;
 			}
-			rbReadIndex++;
+
+			commandQueue.remove();
 		}
 	}
 
-	virtual void patternEndReached(PlayerSTD& player, XModule& module, mp_sint32& newOrderIndex)
+	bool playNote(mp_ubyte chn, mp_sint32 note, mp_sint32 ins, mp_sint32 vol/* = -1*/)
 	{
-		handleQueuedPositions(player, newOrderIndex);
+		// the callback will query these notes and play them
+		PlayerCommandQueue::Command* command = prepareCommand();
+		if (command == NULL)
+			return false;
+		command->code = PlayerCommandQueue::CodeNote;
+		command->channel = chn;
+		command->params[0] = note;
+		command->params[1] = ins;
+		command->params[2] = vol;
+		commandQueue.post();
+		return true;
 	}
 
-	void playNote(mp_ubyte chn, mp_sint32 note, mp_sint32 ins, mp_sint32 vol/* = -1*/)
+	bool playSample(mp_ubyte chn, const TXMSample& smp, mp_sint32 currentSamplePlayNote, mp_sint32 rangeStart, mp_sint32 rangeEnd)
 	{
-		// fill ring buffer with note entries
-		// the callback will query these notes and play them
-		mp_sint32 idx = rbWriteIndex & (UPDATEBUFFSIZE-1);
-		UpdateCommandNote* command = reinterpret_cast<UpdateCommandNote*>(&updateCommandBuff[idx]);
+		PlayerCommandQueue::Command* command = prepareCommand();
+		if (command == NULL)
+			return false;
+		command->code = PlayerCommandQueue::CodeSample;
 		command->channel = chn;
-		command->ins = ins;
-		command->volume = vol;
-		command->note = note;
-		// code needs to be filled in last
-		command->code = UpdateCommandCodeNote;
-		rbWriteIndex++;
+		command->params[0] = currentSamplePlayNote;
+		command->params[1] = rangeStart;
+		command->params[2] = rangeEnd;
+		command->smp = &smp;
+		commandQueue.post();
+		return true;
 	}
 
-	void playSample(mp_ubyte chn, const TXMSample& smp, mp_sint32 currentSamplePlayNote, mp_sint32 rangeStart, mp_sint32 rangeEnd)
+	bool stopSample(mp_sint32 chn)
 	{
-		// fill ring buffer with sample playback entries
-		mp_sint32 idx = rbWriteIndex & (UPDATEBUFFSIZE-1);
-		UpdateCommandSample* command = reinterpret_cast<UpdateCommandSample*>(&updateCommandBuff[idx]);
+		PlayerCommandQueue::Command* command = prepareCommand();
+		if (command == NULL)
+			return false;
+		command->code = PlayerCommandQueue::CodeStopSample;
 		command->channel = chn;
-		command->currentSamplePlayNote = currentSamplePlayNote;
-		command->rangeStart = rangeStart;
-		command->rangeEnd = rangeEnd;
-		command->smp = &smp;
-		command->code = UpdateCommandCodeSample;
-		rbWriteIndex++;
+		commandQueue.post();
+		return true;
+	}
+
+	bool stopInstrument(mp_sint32 insIndex, mp_sint32 numChannels)
+	{
+		PlayerCommandQueue::Command* command = prepareCommand();
+		if (command == NULL)
+			return false;
+		command->code = PlayerCommandQueue::CodeStopInstrument;
+		command->params[0] = insIndex;
+		command->params[1] = numChannels;
+		commandQueue.post();
+		return true;
+	}
+
+	bool muteChannel(mp_sint32 chn, bool mute)
+	{
+		PlayerCommandQueue::Command* command = prepareCommand();
+		if (command == NULL)
+			return false;
+		command->code = PlayerCommandQueue::CodeMuteChannel;
+		command->channel = chn;
+		command->params[0] = mute ? 1 : 0;
+		commandQueue.post();
+		return true;
+	}
+
+	bool setSpeed(mp_sint32 BPM, mp_sint32 speed)
+	{
+		PlayerCommandQueue::Command* command = prepareCommand();
+		if (command == NULL)
+			return false;
+		command->code = PlayerCommandQueue::CodeSpeed;
+		command->params[0] = BPM;
+		command->params[1] = speed;
+		commandQueue.post();
+		return true;
 	}
 
 private:
 	PlayerController& playerController;
 
+	PlayerCommandQueue commandQueue;
+
+	// The queue only fills up when the callback falls behind. Rather than
+	// waiting for it to make room, pause the player the way the critical
+	// section does for every other edit and apply what's queued right here.
+	// The commands keep their order and the new one gets a free slot.
+	PlayerCommandQueue::Command* prepareCommand()
+	{
+		PlayerCommandQueue::Command* command = commandQueue.prepare();
+		if (command)
+			return command;
+
+		const bool pause = !playerController.suspended;
+		if (pause)
+			playerController.criticalSection->enter(false);
+
+		processCommands(*playerController.player, true);
+
+		if (pause)
+			playerController.criticalSection->leave(false);
+
+		return commandQueue.prepare();
+	}
+
 	void handleQueuedPositions(PlayerSTD& player, mp_sint32& poscnt)
 	{
 		// there is a queued position
@@ -190,59 +286,11 @@ class PlayerStatusTracker : public PlayerSTD::StatusEventListener
 		}
 	}
 
-	void clearUpdateCommandBuff()
+	void stopSampleInternal(PlayerSTD& player, mp_sint32 chn)
 	{
-		memset(updateCommandBuff, 0, sizeof(updateCommandBuff));
-		rbReadIndex = rbWriteIndex = 0;
+		player.stopSample(chn);
+		player.chninfo[chn].flags &= ~0x100; // CHANNEL_FLAGS_UPDATE_IGNORE
 	}
-
-	enum
-	{
-		// must be 2^n
-		UPDATEBUFFSIZE = 128
-	};
-
-	enum UpdateCommandCodes
-	{
-		UpdateCommandCodeInvalid = 0,
-		UpdateCommandCodeNote,
-		UpdateCommandCodeSample,
-	};
-
-	struct UpdateCommand
-	{
-		mp_ubyte code;
-		mp_uint32 data[8];
-		void* pdata[8];
-	};
-
-	struct UpdateCommandNote
-	{
-		mp_ubyte code;
-		mp_sint32 note;
-		mp_sint32 channel;
-		mp_sint32 ins;
-		mp_sint32 volume;
-		mp_uint32 data[4];
-		void* pdata[8];
-	};
-
-	struct UpdateCommandSample
-	{
-		mp_ubyte code;
-		mp_uint32 currentSamplePlayNote;
-		mp_uint32 rangeStart;
-		mp_uint32 rangeEnd;
-		mp_sint32 channel;
-		mp_uint32 data[4];
-		const TXMSample* smp;
-		void* pdata[7];
-	};
-
-	UpdateCommand updateCommandBuff[UPDATEBUFFSIZE];
-
-	mp_sint32 rbReadIndex;
-	mp_sint32 rbWriteIndex;
 };
 
 void PlayerController::assureNotSuspended()
@@ -255,6 +303,17 @@ void PlayerController::assureNotSuspended()
 	}
 }
 
+bool PlayerController::postCommands()
+{
+	// the callback applies the queued commands in order, if it's not running
+	// they are applied right here before the new one goes to the player directly
+	if (mixer->isActive() && !mixer->isDeviceRemoved(player) && !mixer->isDevicePaused(player) && !player->isPaused())
+		return true;
+
+	playerStatusTracker->processCommands(*player, true);
+	return false;
+}
+
 void PlayerController::reset()
 {
 	if (!player)
@@ -276,7 +335,7 @@ bool PlayerController::detachDevice()
 	return false;
 }
 
-PlayerController::PlayerController(MasterMixer* mixer, bool fakeScopes) :
+PlayerController::PlayerController(MasterMixer* mixer) :
 	mixer(mixer),
 	player(NULL),
 	module(NULL),
@@ -289,14 +348,14 @@ PlayerController::PlayerController(MasterMixer* mixer, bool fakeScopes) :
 	lastPosition(-1), lastRow(-1),
 	suspended(false),
 	firstRecordChannelCall(true),
+	scopeFrames(NULL),
+	scopeFrameSize(0),
 	numPlayerChannels(TrackerConfig::numPlayerChannels),
 	numVirtualChannels(TrackerConfig::numVirtualChannels),
 	totalPlayerChannels(numPlayerChannels + numVirtualChannels + 2),
 	useVirtualChannels(TrackerConfig::useVirtualChannels),
 	multiChannelKeyJazz(true),
-	multiChannelRecord(true),
-	mixerDataCacheSize(fakeScopes ? 0 : 512*2),
-	mixerDataCache(fakeScopes ? NULL : new mp_sint32[mixerDataCacheSize])
+	multiChannelRecord(true)
 {
 	criticalSection = new PlayerCriticalSection(*this);
 
@@ -304,6 +363,7 @@ PlayerController::PlayerController(MasterMixer* mixer, bool fakeScopes) :
 	player->setPlayMode(PlayerBase::PlayMode_FastTracker2);
 	player->resetMainVolumeOnStartPlay(false);
 	player->setBufferSize(mixer->getBufferSize());
+	player->setNumTimeRecordSlots(mixer->getNumTimeRecordSlots());
 
 	currentPlayingChannel = useVirtualChannels ? numPlayerChannels : 0;
 
@@ -337,8 +397,6 @@ PlayerController::PlayerController(MasterMixer* mixer, bool fakeScopes) :
 
 PlayerController::~PlayerController()
 {
-	delete[] mixerDataCache;
-
 	if (player)
 	{
 		detachDevice();
@@ -348,6 +406,8 @@ PlayerController::~PlayerController()
 	delete playerStatusTracker;
 
 	delete criticalSection;
+
+	delete[] scopeFrames;
 }
 
 void PlayerController::attachModuleEditor(ModuleEditor* moduleEditor)
@@ -686,10 +746,10 @@ void PlayerController::getSpeed(mp_sint32& BPM, mp_sint32& speed)
 	}
 }
 
-void PlayerController::setSpeed(mp_sint32 BPM, mp_sint32 speed, bool adjustModuleHeader/* = true*/)
+bool PlayerController::setSpeed(mp_sint32 BPM, mp_sint32 speed, bool adjustModuleHeader/* = true*/)
 {
 	if (!player)
-		return;
+		return true;
 
 	if (BPM < 32)
 		BPM = 32;
@@ -701,13 +761,16 @@ void PlayerController::setSpeed(mp_sint32 BPM, mp_sint32 speed, bool adjustModul
 	if (speed > 31)
 		speed = 31;
 
+	bool posted = true;
 	if (player->isPlaying())
 	{
-		player->setTempo(BPM);
-		player->setSpeed(speed);
-		// this is a MUST!!!
-		pp_uint32 bpmRate = player->getbpmrate(BPM);
-		player->adder = bpmRate;
+		if (postCommands())
+			posted = playerStatusTracker->setSpeed(BPM, speed);
+		else
+		{
+			player->setTempo(BPM);
+			player->setSpeed(speed);
+		}
 	}
 
 	if (module && adjustModuleHeader)
@@ -715,6 +778,8 @@ void PlayerController::setSpeed(mp_sint32 BPM, mp_sint32 speed, bool adjustModul
 		module->header.speed = BPM;
 		module->header.tempo = speed;
 	}
+
+	return posted;
 }
 
 void PlayerController::readjustSpeed(bool adjustModuleHeader/* = true*/)
@@ -724,10 +789,10 @@ void PlayerController::readjustSpeed(bool adjustModuleHeader/* = true*/)
 	setSpeed(bpm, speed, adjustModuleHeader);
 }
 
-void PlayerController::playSample(const TXMSample& smp, mp_sint32 currentSamplePlayNote, mp_sint32 rangeStart/* = -1*/, mp_sint32 rangeEnd/* = -1*/)
+bool PlayerController::playSample(const TXMSample& smp, mp_sint32 currentSamplePlayNote, mp_sint32 rangeStart/* = -1*/, mp_sint32 rangeEnd/* = -1*/)
 {
 	if (!player)
-		return;
+		return true;
 
 	assureNotSuspended();
 
@@ -735,36 +800,41 @@ void PlayerController::playSample(const TXMSample& smp, mp_sint32 currentSampleP
 	{
 		pp_int32 i = numPlayerChannels + numVirtualChannels + 1;
 
-		playerStatusTracker->playSample(i, smp, currentSamplePlayNote, rangeStart, rangeEnd);
+		return playerStatusTracker->playSample(i, smp, currentSamplePlayNote, rangeStart, rangeEnd);
 	}
 
+	return true;
 }
 
-void PlayerController::stopSample()
+bool PlayerController::stopSample()
 {
 	if (!player)
-		return;
+		return true;
 
 	if (player->isPlaying())
 	{
-		// doesn't seem to be a critical race condition
 		pp_int32 i = numPlayerChannels + numVirtualChannels + 1;
 
-		player->stopSample(i);
+		if (postCommands())
+			return playerStatusTracker->stopSample(i);
 
+		player->stopSample(i);
 		player->chninfo[i].flags &= ~0x100; // CHANNEL_FLAGS_UPDATE_IGNORE
 	}
 
+	return true;
 }
 
-void PlayerController::stopInstrument(mp_sint32 insIndex)
+bool PlayerController::stopInstrument(mp_sint32 insIndex)
 {
 	if (!player)
-		return;
+		return true;
 
 	if (player->isPlaying())
 	{
-		// doesn't seem to be a critical race condition
+		if (postCommands())
+			return playerStatusTracker->stopInstrument(insIndex, numPlayerChannels + numVirtualChannels);
+
 		for (pp_int32 i = 0; i < numPlayerChannels + numVirtualChannels; i++)
 		{
 			if (player->chninfo[i].ins == insIndex)
@@ -774,17 +844,19 @@ void PlayerController::stopInstrument(mp_sint32 insIndex)
 			}
 		}
 	}
+
+	return true;
 }
 
-void PlayerController::playNote(mp_ubyte chn, mp_sint32 note, mp_sint32 i, mp_sint32 vol/* = -1*/)
+bool PlayerController::playNote(mp_ubyte chn, mp_sint32 note, mp_sint32 i, mp_sint32 vol/* = -1*/)
 {
 	if (!player)
-		return;
+		return true;
 
 	assureNotSuspended();
 
 	// note playing goes synchronized in the playback callback
-	playerStatusTracker->playNote(chn, note, i, vol);
+	return playerStatusTracker->playNote(chn, note, i, vol);
 }
 
 void PlayerController::suspendPlayer(bool bResetMainVolume/* = true*/, bool stopPlaying/* = true*/)
@@ -817,12 +889,18 @@ void PlayerController::resumePlayer(bool continuePlaying)
 	}
 }
 
-void PlayerController::muteChannel(mp_sint32 c, bool m)
+bool PlayerController::muteChannel(mp_sint32 c, bool m)
 {
 	muteChannels[c] = m;
 
-	if (player)
-		player->muteChannel(c, m);
+	if (!player)
+		return true;
+
+	if (postCommands())
+		return playerStatusTracker->muteChannel(c, m);
+
+	player->muteChannel(c, m);
+	return true;
 }
 
 bool PlayerController::isChannelMuted(mp_sint32 c)
@@ -851,6 +929,26 @@ bool PlayerController::isChannelRecording(mp_sint32 c)
 	return recordChannels[c];
 }
 
+void PlayerController::setInsertChain(mp_sint32 c, ChannelInsertChain* chain)
+{
+	if (!player)
+		return;
+
+	// the chain can't be swapped while the player is being mixed
+	bool paused = mixer->isActive() && !mixer->isDeviceRemoved(player) &&
+				  !mixer->isDevicePaused(player) && mixer->pauseDevice(player);
+
+	player->setInsertChain(c, chain);
+
+	if (paused)
+		mixer->resumeDevice(player);
+}
+
+ChannelInsertChain* PlayerController::getInsertChain(mp_sint32 c)
+{
+	return player ? player->getInsertChain(c) : NULL;
+}
+
 void PlayerController::reallocateChannels(mp_sint32 moduleChannels/* = 32*/, mp_sint32 virtualChannels/* = 0*/)
 {
 
@@ -1148,7 +1246,7 @@ mp_sint32 PlayerController::getPlayerNumPlayingChannels()
 mp_sint32 PlayerController::getCurrentSamplePosition()
 {
 	if (mixer && mixer->getAudioDriver())
-		return mixer->getAudioDriver()->getBufferPos();
+		return mixer->getCurrentSamplePosition();
 
 	return 0;
 }
@@ -1245,112 +1343,77 @@ bool PlayerController::isNotePlaying(mp_sint32 ins, mp_sint32 channel, mp_sint32
 	return false;
 }
 
-#define FULLMIXER_8BIT_NORMAL_TEMP \
-	if (sample) { \
-		sd1 = ((mp_sbyte)sample[smppos])<<8; \
-		sd2 = ((mp_sbyte)sample[smppos+1])<<8; \
-		sd1 =((sd1<<12)+(smpposfrac>>4)*(sd2-sd1))>>12; \
-		y = (sd1*vol)>>9; \
-	} \
-	else { \
-		y = 0; \
- 	} \
-	fetcher.fetchSampleData(y);
-
-#define FULLMIXER_16BIT_NORMAL_TEMP \
-	if (sample) { \
-		sd1 = ((mp_sword*)(sample))[smppos]; \
-		sd2 = ((mp_sword*)(sample))[smppos+1]; \
-		sd1 =((sd1<<12)+(smpposfrac>>4)*(sd2-sd1))>>12; \
-		y = (sd1*vol)>>9; \
-	} \
-	else { \
-		y = 0; \
- 	} \
-	fetcher.fetchSampleData(y);
-
-void PlayerController::grabSampleData(mp_uint32 chnIndex, mp_sint32 count, mp_sint32 fMul, SampleDataFetcher& fetcher)
+void PlayerController::setScopeRecording(bool scopeRecording)
 {
-	if (!player)
+	if (!player || player->isScopeRecording() == scopeRecording)
 		return;
 
-	if (mixerDataCache && (count * 2 > mixerDataCacheSize))
-	{
-		delete[] mixerDataCache;
-		mixerDataCacheSize = count * 2 * 2;
-		mixerDataCache = new mp_sint32[mixerDataCacheSize];
-	}
+	// the scope records are reallocated, the mixer must not use them meanwhile
+	if (!suspended)
+		criticalSection->enter(false);
 
-	ChannelMixer* mixer = player;
+	player->setScopeRecording(scopeRecording);
 
-	ChannelMixer::TMixerChannel* chn = &mixer->channel[chnIndex];
+	criticalSection->leave(false);
+}
 
-	pp_int32 j = getCurrentBeatIndex();
+void PlayerController::grabSampleData(mp_uint32 chnIndex, mp_sint32 count, SampleDataFetcher& fetcher)
+{
+	if (!player)
+		return;
 
-	if (chn->flags & ChannelMixer::MP_SAMPLE_PLAY)
+	const mp_uint32 scopeSize = player->getScopeSize();
+	if (scopeSize != scopeFrameSize)
 	{
-		// this is critical
-		// it might be that the audio thread modifies the data as we are
-		// accessing it... So in the worst case we're getting a sample
-		// but the channel state data does belong to another sample already
-		// in that case we're displaying garbage...
-		// BUT it's important that we only access sample data
-		// within the range of the current sample we have
-		ChannelMixer::TMixerChannel channel;
-		channel.sample = chn->timeRecord[j].sample;
-
-		if (channel.sample == NULL)
-			goto resort;
-
-		channel.smplen = TXMSample::getSampleSizeInSamples((mp_ubyte*)channel.sample);
-		channel.flags = chn->timeRecord[j].flags;
-		channel.smppos = chn->timeRecord[j].smppos % channel.smplen;
-		channel.smpposfrac = chn->timeRecord[j].smpposfrac;
-		channel.smpadd = chn->timeRecord[j].smpadd;
-		channel.loopend = channel.loopendcopy = chn->timeRecord[j].loopend % (channel.smplen+1);
-		channel.loopstart = chn->timeRecord[j].loopstart % (channel.smplen+1);
-		if (channel.loopstart >= channel.loopend)
-			channel.flags &= ~3;
-		channel.vol = chn->timeRecord[j].volPan & 0xFFFF;
-		channel.pan = chn->timeRecord[j].volPan >> 16;
-		channel.fixedtimefrac = chn->timeRecord[j].fixedtimefrac;
-		channel.cutoff = ChannelMixer::MP_INVALID_VALUE;
-		channel.resonance = ChannelMixer::MP_INVALID_VALUE;
-//		channel.index = chnIndex; Uncomment this if you like crackly audio
-		// The scopes (which I assume is what this function is for) are currently
-		// using channel 33, to avoid interfering with playback
-
-		channel.smpadd = (channel.smpadd*fMul) / (!count ? 1 : count);
-		chn = &channel;
-
-		if (mixerDataCache && channel.smpadd <= 65536)
-		{
-			memset(mixerDataCache, 0, count*2*sizeof(mp_sint32));
-
-			channel.rsmpadd = (mp_sint32)((1.0 / channel.smpadd) * 65536.0);
-
-			// we only need the left channel as no panning is involved
-			channel.finalvoll = (channel.vol*128*256)<<6;
-			channel.finalvolr = 0;
-			channel.rampFromVolStepL = channel.rampFromVolStepR = 0;
+		delete[] scopeFrames;
+		scopeFrames = NULL;
+		scopeFrameSize = scopeSize;
+		if (scopeSize)
+			scopeFrames = new mp_sword[(TrackerConfig::MAXCHANNELS + 1) * scopeSize];
+		memset(scopeFramePlaying, 0, sizeof(scopeFramePlaying));
+	}
 
-			player->getCurrentResampler()->addChannel(chn, mixerDataCache, count, count);
+	if (scopeFrames == NULL || chnIndex >= TrackerConfig::MAXCHANNELS)
+	{
+		for (mp_sint32 i = 0; i < count; i++)
+			fetcher.fetchSampleData(0);
+		return;
+	}
 
-			for (mp_sint32 i = 0; i < count; i++)
-				fetcher.fetchSampleData(mixerDataCache[i*2]);
-		}
-		else
+	// the mixer publishes what the channel plays in every beat packet. A copy
+	// it tore by rewriting the record is retried, if it keeps doing that the
+	// last frame is shown once more
+	mp_sword* frame = scopeFrames + chnIndex * scopeSize;
+	mp_sword* copy = scopeFrames + TrackerConfig::MAXCHANNELS * scopeSize;
+	const mp_uint32 beatIndex = getCurrentBeatIndex();
+	for (mp_sint32 retry = 0; retry < 4; retry++)
+	{
+		bool playing;
+		if (player->getScopeData(chnIndex, beatIndex, copy, playing))
 		{
-			pp_int32 vol = chn->vol;
-			mp_sint32 y;
-			FULLMIXER_TEMPLATE(FULLMIXER_8BIT_NORMAL_TEMP, FULLMIXER_16BIT_NORMAL_TEMP, 16, 0);
+			scopeFramePlaying[chnIndex] = playing;
+			memcpy(frame, copy, scopeSize * sizeof(mp_sword));
+			break;
 		}
 	}
-	else
+
+	if (!scopeFramePlaying[chnIndex])
 	{
-resort:
 		for (mp_sint32 i = 0; i < count; i++)
 			fetcher.fetchSampleData(0);
+		return;
+	}
+
+	// stretch the frame to the width of the scope, interpolating linearly
+	const mp_int64 step = count > 1 ? ((mp_int64)(scopeSize - 1) << 16) / (count - 1) : 0;
+	mp_int64 pos = 0;
+	for (mp_sint32 i = 0; i < count; i++, pos += step)
+	{
+		const mp_uint32 index = (mp_uint32)(pos >> 16);
+		const mp_sint32 frac = (mp_sint32)(pos & 65535);
+		const mp_sint32 y1 = frame[index];
+		const mp_sint32 y2 = index + 1 < scopeSize ? frame[index + 1] : y1;
+		fetcher.fetchSampleData(y1 + (((y2 - y1) * (frac >> 1)) >> 15));
 	}
 }
 
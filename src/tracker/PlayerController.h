@@ -82,6 +82,11 @@ class PlayerController
 	bool muteChannels[TrackerConfig::MAXCHANNELS];
 	bool recordChannels[TrackerConfig::MAXCHANNELS];
 	bool firstRecordChannelCall;
+
+	// last scope frame of every channel and one to copy into, see grabSampleData
+	mp_sword* scopeFrames;
+	mp_uint32 scopeFrameSize;
+	bool scopeFramePlaying[TrackerConfig::MAXCHANNELS];
 	
 	mp_sint32 currentPlayingChannel;
 
@@ -92,14 +97,13 @@ class PlayerController
 	bool multiChannelKeyJazz;
 	bool multiChannelRecord;
 
-	mp_sint32 mixerDataCacheSize;
-	mp_sint32* mixerDataCache;
-
 	void assureNotSuspended();
+	// true if changes to the player have to go through the command queue
+	bool postCommands();
 	void continuePlaying(bool assureNotSuspended);
 	
 	// no construction outside
-	PlayerController(class MasterMixer* mixer, bool fakeScopes);
+	PlayerController(class MasterMixer* mixer);
 
 	bool detachDevice();
 
@@ -140,28 +144,37 @@ class PlayerController
 	bool isPaused() const;
 
 	void getSpeed(mp_sint32& BPM, mp_sint32& speed);
-	void setSpeed(mp_sint32 BPM, mp_sint32 speed, bool adjustModuleHeader = true);
+	// false if the command queue didn't take the change, see below
+	bool setSpeed(mp_sint32 BPM, mp_sint32 speed, bool adjustModuleHeader = true);
 	
 	void readjustSpeed(bool adjustModuleHeader = true);
 	
-	void playSample(const TXMSample& sample, mp_sint32 currentSamplePlayNote, 
+	// These go through the command queue while the player is being mixed.
+	// False if the callback didn't make room in the queue in time, the
+	// command is lost then and the player left alone.
+	bool playSample(const TXMSample& sample, mp_sint32 currentSamplePlayNote, 
 					mp_sint32 rangeStart = -1, mp_sint32 rangeEnd = -1);
-	void stopSample();
+	bool stopSample();
 	
-	void stopInstrument(mp_sint32 insIndex);
+	bool stopInstrument(mp_sint32 insIndex);
 
-	void playNote(mp_ubyte chn, 
+	bool playNote(mp_ubyte chn, 
 				  mp_sint32 note, mp_sint32 i, mp_sint32 vol = -1);
 
 	void suspendPlayer(bool bResetMainVolume = true, bool stopPlaying = true);	
 	void resumePlayer(bool continuePlaying);
 
-	void muteChannel(mp_sint32 c, bool m);
+	// false if the command queue didn't take it, see above
+	bool muteChannel(mp_sint32 c, bool m);
 	bool isChannelMuted(mp_sint32 c);
 
 	void recordChannel(mp_sint32 c, bool m);
 	bool isChannelRecording(mp_sint32 c);
 
+	// see ChannelMixer::setInsertChain, the chain is not owned by the player
+	void setInsertChain(mp_sint32 c, class ChannelInsertChain* chain);
+	class ChannelInsertChain* getInsertChain(mp_sint32 c);
+
 private:
 	void reallocateChannels(mp_sint32 moduleChannels = 32, mp_sint32 virtualChannels = 0);
 	void setUseVirtualChannels(bool bUseVirtualChannels);
@@ -217,7 +230,10 @@ class PlayerController
 	public:
 		virtual void fetchSampleData(mp_sint32 sample) = 0;
 	};
-	void grabSampleData(mp_uint32 chnIndex, mp_sint32 count, mp_sint32 fMul, SampleDataFetcher& fetcher);
+	// the mixer records what the channels play only while scopes are shown
+	void setScopeRecording(bool scopeRecording);
+	// count points of what channel chnIndex plays at the moment
+	void grabSampleData(mp_uint32 chnIndex, mp_sint32 count, SampleDataFetcher& fetcher);
 	
 	bool hasSampleData(mp_uint32 chnIndex);
 	
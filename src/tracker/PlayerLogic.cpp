@@ -271,10 +271,10 @@ void PlayerLogic::finishTraceAndRowPlay()
 	}
 }
 
-void PlayerLogic::playNote(class PlayerController& playerController,
+bool PlayerLogic::playNote(class PlayerController& playerController,
 						   pp_uint8 chn,
 						   pp_int32 note, pp_int32 i, pp_int32 vol/* = -1*/)
 {
-	playerController.playNote(chn, note, i, vol);
+	return playerController.playNote(chn, note, i, vol);
 }
 
@@ -76,7 +76,8 @@ class PlayerLogic
 	
 	void finishTraceAndRowPlay();
 	
-	static void playNote(class PlayerController& playerController, 
+	// false if the note couldn't be queued, see PlayerController::playNote
+	static bool playNote(class PlayerController& playerController, 
 						 pp_uint8 chn, 
 						 pp_int32 note, pp_int32 i, pp_int32 vol = -1);
 	
@@ -36,6 +36,9 @@
 #include "AudioDriverManager.h"
 #include "PlayerSTD.h"
 #include "ResamplerHelper.h"
+#ifdef HAVE_LIBASOUND
+#include "drivers/alsa/AudioDriver_ALSA.h"
+#endif
 
 class MasterMixerNotificationListener : public MasterMixer::MasterMixerNotificationListener
 {
@@ -65,6 +68,7 @@ void PlayerMaster::adjustSettings()
 
 		player->setBufferSize(bufferSize);
 		player->adjustFrequency(sampleRate);
+		player->setNumTimeRecordSlots(mixer->getNumTimeRecordSlots());
 
 		if (!player->isPlaying())
 			player->resumePlaying(false);
@@ -197,12 +201,12 @@ PlayerMaster::~PlayerMaster()
 	delete listener;
 }
 
-PlayerController* PlayerMaster::createPlayerController(bool fakeScopes)
+PlayerController* PlayerMaster::createPlayerController()
 {
 	if (playerControllers->size() >= DefaultMaxDevices)
 		return NULL;
 
-	PlayerController* playerController = new PlayerController(mixer, fakeScopes);
+	PlayerController* playerController = new PlayerController(mixer);
 
 	applySettingsToPlayerController(*playerController, currentSettings);
 
@@ -309,6 +313,34 @@ bool PlayerMaster::applyNewMixerSettings(const TMixerSettings& settings, bool al
 		restart = true;
 	}
 
+	if (settings.renderAhead >= 0)
+	{
+		currentSettings.renderAhead = settings.renderAhead;
+		if ((mp_uint32)settings.renderAhead != mixer->getRenderAhead())
+		{
+			mixer->setRenderAhead(settings.renderAhead);
+			restart = true;
+		}
+	}
+
+#ifdef HAVE_LIBASOUND
+	if (settings.alsaPeriods >= 0)
+	{
+		currentSettings.alsaPeriods = settings.alsaPeriods;
+		AudioDriver_ALSA* alsaDriver = static_cast<AudioDriver_ALSA*>(mixer->getAudioDriverByName("ALSA"));
+		if (alsaDriver && alsaDriver->getNumPeriods() != (mp_uint32)settings.alsaPeriods)
+		{
+			// the driver picks the new count up when the device is opened again
+			if (alsaDriver == mixer->getAudioDriver())
+			{
+				mixer->closeAudioDevice();
+				restart = true;
+			}
+			alsaDriver->setNumPeriods(settings.alsaPeriods);
+		}
+	}
+#endif
+
 	if (settings.mixerVolume >= 0)
 		currentSettings.mixerVolume = settings.mixerVolume;
 
@@ -446,7 +478,7 @@ void PlayerMaster::getCurrentSamplePeak(pp_int32& left, pp_int32& right)
 		return;
 	}
 
-	mp_sint32 pos = mixer->getAudioDriver()->getBufferPos();
+	mp_sint32 pos = mixer->getCurrentSamplePosition();
 
 	left = mixer->getCurrentSamplePeak(pos, 0);
 	right = mixer->getCurrentSamplePeak(pos, 1);
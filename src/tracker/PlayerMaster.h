@@ -56,6 +56,11 @@ struct TMixerSettings
     pp_uint32 numPlayerChannels;
 	// 0 means disable virtual channels, negative value means ignore
 	pp_int32 numVirtualChannels;
+	// buffers mixed ahead of the audio callback, 0 = mix in the callback,
+	// negative values means ignore
+	pp_int32 renderAhead;
+	// number of periods of the ALSA device, negative values means ignore
+	pp_int32 alsaPeriods;
 
 	TMixerSettings() :
 		mixFreq(-1),
@@ -67,7 +72,9 @@ struct TMixerSettings
 		ramping(-1),
 		audioDriverName(NULL),
         numPlayerChannels(TrackerConfig::numPlayerChannels),
-		numVirtualChannels(-1)
+		numVirtualChannels(-1),
+		renderAhead(-1),
+		alsaPeriods(-1)
 	{
 	}
 
@@ -118,6 +125,12 @@ struct TMixerSettings
 		if (numVirtualChannels != source.numVirtualChannels)
 			return false;
 
+		if (renderAhead != source.renderAhead)
+			return false;
+
+		if (alsaPeriods != source.alsaPeriods)
+			return false;
+
 		return strcmp(audioDriverName, source.audioDriverName) == 0;
 	}
 
@@ -168,7 +181,7 @@ class PlayerMaster
 	static pp_uint32 roundToNearestPowerOfTwo(pp_uint32 v);
 	static float convertBufferSizeToMillis(pp_uint32 sampleRate, pp_uint32 bufferSize);
 
-	PlayerController* createPlayerController(bool fakeScopes);
+	PlayerController* createPlayerController();
 	bool destroyPlayerController(PlayerController* playerController);
 
 	pp_int32 getNumPlayerControllers() const;
@@ -368,7 +368,7 @@ void ScopesControl::paint(PPGraphicsAbstract* g)
 			ScopePainter scopePainter(g, count, channelHeight, scopebColor, scopedColor, locx, locy, appearance);
 
 			if (enabled)
-				playerController->grabSampleData(c, count, 160, scopePainter);
+				playerController->grabSampleData(c, count, scopePainter);
 			else
 			{
 				for (pp_int32 i = 0; i < count; i++)
@@ -468,13 +468,29 @@ void ScopesControl::paint(PPGraphicsAbstract* g)
 
 }
 
+void ScopesControl::show(bool visible)
+{
+	PPControl::show(visible);
+	updateScopeRecording();
+}
+
 void ScopesControl::attachSource(PlayerController* playerController)
 {
+	if (this->playerController && this->playerController != playerController)
+		this->playerController->setScopeRecording(false);
+
 	this->playerController = playerController;
+	updateScopeRecording();
 	// should force redraw
 	lastNumChannels = 0;
 }
 
+void ScopesControl::updateScopeRecording()
+{
+	if (playerController)
+		playerController->setScopeRecording(isVisible());
+}
+
 bool ScopesControl::needsUpdate()
 {
 	if (playerController == NULL ||
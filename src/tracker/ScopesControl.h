@@ -98,6 +98,8 @@ class ScopesControl : public PPControl
 
 	ClickTypes currentClickType;
 
+	void updateScopeRecording();
+
 public:
 	enum ChangeValueTypes
 	{
@@ -123,6 +125,9 @@ class ScopesControl : public PPControl
 
 	virtual pp_int32 dispatchEvent(PPEvent* event);
 
+	// the source records scopes only while they are shown
+	virtual void show(bool visible);
+
 	void attachSource(PlayerController* playerController);
 
 	void setNumChannels(pp_int32 numChannels) { this->numChannels = numChannels; }
@@ -64,6 +64,10 @@
 
 #include "ControlIDs.h"
 
+#ifdef HAVE_LIBASOUND
+#include "drivers/alsa/AudioDriver_ALSA.h"
+#endif
+
 #ifdef __LOWRES__
 #define SECTIONHEIGHT		148
 #else
@@ -156,6 +160,9 @@ enum ControlIDs
 	RADIOGROUP_SETTINGS_MIXFREQ,
 	BUTTON_SETTINGS_CHOOSEDRIVER,
     RADIOGROUP_SETTINGS_XMCHANNELLIMIT,
+	STATICTEXT_SETTINGS_ALSAPERIODS,
+	BUTTON_SETTINGS_ALSAPERIODS_PLUS,
+	BUTTON_SETTINGS_ALSAPERIODS_MINUS,
 
 	// PAGE I (2)
 	CHECKBOX_SETTINGS_VIRTUALCHANNELS,
@@ -746,18 +753,21 @@ class TabPageIO_3 : public TabPage
 
 };
 
-#ifdef __AMIGA__
-struct AmigaDriverStatInterface
+#if defined(__AMIGA__) || defined(HAVE_LIBASOUND)
+struct DriverStatInterface
 {
 	virtual const AudioDriverInterface * getCurrentAudioDriver() = 0;
 	virtual void forceRepaint() = 0;
 };
 
-class AmigaDriverStat : public PPStaticText
+// polls a statistics value of the current audio driver, when a driver ID
+// is given the value is only shown while that driver is in use
+class DriverStat : public PPStaticText
 {
 private:
-	AmigaDriverStatInterface * statInterface;
+	DriverStatInterface * statInterface;
 	pp_uint32 dataSource;
+	const char * driverID;
 	pp_uint32 nFrames;
 public:
 	pp_int32 dispatchEvent(PPEvent* event)
@@ -768,10 +778,13 @@ class AmigaDriverStat : public PPStaticText
 			if((nFrames % 100) == 0) {
 				AudioDriverInterface * audioDriver = (AudioDriverInterface *) statInterface->getCurrentAudioDriver();
 				if(audioDriver) {
-					pp_int32 val = audioDriver->getStatValue(dataSource);
-
 					char buffer[32];
-					sprintf(buffer, "%06ld", val);
+					if(driverID && strcmp(audioDriver->getDriverID(), driverID) != 0) {
+						strcpy(buffer, "n/a");
+					} else {
+						pp_int32 val = audioDriver->getStatValue(dataSource);
+						sprintf(buffer, "%06ld", (long)val);
+					}
 					setText(PPString(buffer));
 
 					statInterface->forceRepaint();
@@ -787,24 +800,26 @@ class AmigaDriverStat : public PPStaticText
 		return true;
 	}
 
-	AmigaDriverStat(
+	DriverStat(
 		pp_int32 id,
 		PPScreen* parentScreen,
 		EventListenerInterface* eventListener,
 		const PPPoint& location,
 		const PPString& text,
-		AmigaDriverStatInterface * statInterface,
-		pp_uint32 dataSource
+		DriverStatInterface * statInterface,
+		pp_uint32 dataSource,
+		const char * driverID = NULL
 	)
 	: PPStaticText(id, parentScreen, eventListener, location, text)
-	, dataSource(dataSource)
 	, statInterface(statInterface)
+	, dataSource(dataSource)
+	, driverID(driverID)
 	, nFrames(0)
 	{
 
 	}
 
-	virtual ~AmigaDriverStat()
+	virtual ~DriverStat()
 	{
 
 	}
@@ -813,8 +828,8 @@ class AmigaDriverStat : public PPStaticText
 #endif
 
 class TabPageIO_4 : public TabPage
-#ifdef __AMIGA__
-	, AmigaDriverStatInterface
+#if defined(__AMIGA__) || defined(HAVE_LIBASOUND)
+	, DriverStatInterface
 #endif
 {
 private:
@@ -822,9 +837,9 @@ class TabPageIO_4 : public TabPage
 	PPScreen * screen;
 
 #ifdef __AMIGA__
-	AmigaDriverStat * statVBMix;
-	AmigaDriverStat * statABRCnt;
-	AmigaDriverStat * statRBFCnt;
+	DriverStat * statVBMix;
+	DriverStat * statABRCnt;
+	DriverStat * statRBFCnt;
 #endif
 
 public:
@@ -873,12 +888,32 @@ class TabPageIO_4 : public TabPage
 		container->addControl(new PPStaticText(0, NULL, NULL, PPPoint(x2 + 2, y2 + 82), "ABRCnt="));
 		container->addControl(new PPStaticText(0, NULL, NULL, PPPoint(x2 + 2, y2 + 93), "RBFCnt="));
 
-		statVBMix = new AmigaDriverStat(0, NULL, NULL, PPPoint(x2 + 61, y2 + 71), "n/a", this, 0);
+		statVBMix = new DriverStat(0, NULL, NULL, PPPoint(x2 + 61, y2 + 71), "n/a", this, 0);
 		container->addControl(statVBMix);
-		statABRCnt = new AmigaDriverStat(0, NULL, NULL, PPPoint(x2 + 61, y2 + 82), "n/a", this, 1);
+		statABRCnt = new DriverStat(0, NULL, NULL, PPPoint(x2 + 61, y2 + 82), "n/a", this, 1);
 		container->addControl(statABRCnt);
-		statRBFCnt = new AmigaDriverStat(0, NULL, NULL, PPPoint(x2 + 61, y2 + 93), "n/a", this, 2);
+		statRBFCnt = new DriverStat(0, NULL, NULL, PPPoint(x2 + 61, y2 + 93), "n/a", this, 2);
 		container->addControl(statRBFCnt);
+#elif defined(HAVE_LIBASOUND)
+		container->addControl(new PPStaticText(0, NULL, NULL, PPPoint(x2 + 2, y2 + 58), "ALSA driver", true, true));
+
+		container->addControl(new PPStaticText(STATICTEXT_SETTINGS_ALSAPERIODS, NULL, NULL, PPPoint(x2 + 4, y2 + 71), "Periods: xx", false));
+
+		PPButton* button = new PPButton(BUTTON_SETTINGS_ALSAPERIODS_PLUS, screen, this, PPPoint(x2 + 4 + 15*8 + 4, y2 + 71), PPSize(12, 9));
+		button->setText(TrackerConfig::stringButtonPlus);
+		container->addControl(button);
+
+		button = new PPButton(BUTTON_SETTINGS_ALSAPERIODS_MINUS, screen, this, PPPoint(x2 + 4 + 15*8 + 4 + 13, y2 + 71), PPSize(13, 9));
+		button->setText(TrackerConfig::stringButtonMinus);
+		container->addControl(button);
+
+		container->addControl(new PPStaticText(0, NULL, NULL, PPPoint(x2 + 4, y2 + 82), "XRuns="));
+		container->addControl(new PPStaticText(0, NULL, NULL, PPPoint(x2 + 4, y2 + 93), "Lat.us="));
+		container->addControl(new PPStaticText(0, NULL, NULL, PPPoint(x2 + 4, y2 + 104), "Max.us="));
+
+		container->addControl(new DriverStat(0, NULL, NULL, PPPoint(x2 + 61, y2 + 82), "n/a", this, AudioDriver_ALSA::StatXRuns, "ALSA"));
+		container->addControl(new DriverStat(0, NULL, NULL, PPPoint(x2 + 61, y2 + 93), "n/a", this, AudioDriver_ALSA::StatLatency, "ALSA"));
+		container->addControl(new DriverStat(0, NULL, NULL, PPPoint(x2 + 61, y2 + 104), "n/a", this, AudioDriver_ALSA::StatMaxLatency, "ALSA"));
 #endif
 
         container->addControl(radioGroup);
@@ -901,6 +936,12 @@ class TabPageIO_4 : public TabPage
                 break;
 
         }
+
+#if !defined(__AMIGA__) && defined(HAVE_LIBASOUND)
+		char buffer[100];
+		sprintf(buffer, "Periods: %02i", settingsDatabase->restore("ALSAPERIODS")->getIntValue());
+		static_cast<PPStaticText*>(container->getControlByID(STATICTEXT_SETTINGS_ALSAPERIODS))->setText(buffer);
+#endif
     }
 
 };
@@ -2139,6 +2180,26 @@ pp_int32 SectionSettings::handleEvent(PPObject* sender, PPEvent* event)
 				break;
 			}
 
+			case BUTTON_SETTINGS_ALSAPERIODS_PLUS:
+			{
+				pp_int32 v = tracker.settingsDatabase->restore("ALSAPERIODS")->getIntValue() + 1;
+				if (v > 16)
+					v = 16;
+				tracker.settingsDatabase->store("ALSAPERIODS", v);
+				update();
+				break;
+			}
+
+			case BUTTON_SETTINGS_ALSAPERIODS_MINUS:
+			{
+				pp_int32 v = tracker.settingsDatabase->restore("ALSAPERIODS")->getIntValue() - 1;
+				if (v < 2)
+					v = 2;
+				tracker.settingsDatabase->store("ALSAPERIODS", v);
+				update();
+				break;
+			}
+
 			case CHECKBOX_SETTINGS_MULTICHN_RECORD:
 			{
 				if (event->getID() != eCommand)
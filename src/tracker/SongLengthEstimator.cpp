@@ -30,17 +30,36 @@
 
 #include "SongLengthEstimator.h"
 #include "MilkyPlay.h"
-#include "AudioDriver_NULL.h"
+
+#define FNV_OFFSET_BASIS	2166136261U
+#define FNV_PRIME			16777619U
+
+static mp_uint32 hashBytes(mp_uint32 hash, const void* data, mp_uint32 size)
+{
+	const mp_ubyte* bytes = static_cast<const mp_ubyte*>(data);
+	for (mp_uint32 i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+	return hash;
+}
 
 SongLengthEstimator::SongLengthEstimator(XModule* theModule) :
 	player(NULL),
-	module(theModule)
+	module(theModule),
+	numOrders(-1),
+	songLength(0),
+	headerHash(0)
 {
 }
 
 SongLengthEstimator::SongLengthEstimator(const SongLengthEstimator& src) :
 	player(NULL),
-	module(src.module)
+	module(src.module),
+	numOrders(-1),
+	songLength(0),
+	headerHash(0)
 {
 }
 
@@ -54,29 +73,130 @@ const SongLengthEstimator& SongLengthEstimator::operator=(const SongLengthEstima
 	if (&src != this)
 	{
 		module = src.module;
+		invalidate();
 	}
 	return *this;
 }
 
-mp_sint32 SongLengthEstimator::estimateSongLengthInSeconds()
+mp_uint32 SongLengthEstimator::calculateHeaderHash() const
+{
+	const TXMHeader& header = module->header;
+
+	const XModule::ModuleTypes type = module->getType();
+
+	mp_uint32 hash = hashBytes(FNV_OFFSET_BASIS, &type, sizeof(type));
+	hash = hashBytes(hash, &header.ordnum, sizeof(header.ordnum));
+	hash = hashBytes(hash, &header.restart, sizeof(header.restart));
+	hash = hashBytes(hash, &header.channum, sizeof(header.channum));
+	hash = hashBytes(hash, &header.freqtab, sizeof(header.freqtab));
+	hash = hashBytes(hash, &header.flags, sizeof(header.flags));
+	hash = hashBytes(hash, &header.tempo, sizeof(header.tempo));
+	hash = hashBytes(hash, &header.speed, sizeof(header.speed));
+	return hash;
+}
+
+mp_uint32 SongLengthEstimator::calculateOrderHash(mp_sint32 index) const
+{
+	const mp_ubyte patternIndex = module->header.ord[index];
+
+	mp_uint32 hash = hashBytes(FNV_OFFSET_BASIS, &patternIndex, sizeof(patternIndex));
+
+	if (patternIndex < module->header.patnum)
+	{
+		const TXMPattern& pattern = module->phead[patternIndex];
+
+		hash = hashBytes(hash, &pattern.rows, sizeof(pattern.rows));
+		hash = hashBytes(hash, &pattern.channum, sizeof(pattern.channum));
+		hash = hashBytes(hash, &pattern.effnum, sizeof(pattern.effnum));
+		if (pattern.patternData)
+			hash = hashBytes(hash, pattern.patternData, pattern.rows * pattern.channum * (pattern.effnum * 2 + 2));
+	}
+
+	return hash;
+}
+
+mp_sint32 SongLengthEstimator::findResumeOrder(mp_sint32 firstChangedOrder) const
+{
+	// every position before the resume position must have been played
+	mp_sint32 lastReachedOrder = 0;
+	while (lastReachedOrder < firstChangedOrder && orderTimings[lastReachedOrder + 1].samplePos >= 0)
+		lastReachedOrder++;
+
+	// and none of the following ones before it
+	for (mp_sint32 resumeOrder = lastReachedOrder; resumeOrder > 0; resumeOrder--)
+	{
+		const mp_sint32 resumePos = orderTimings[resumeOrder].samplePos;
+
+		bool laterOrderPlayedBefore = false;
+		for (mp_sint32 i = resumeOrder + 1; i < numOrders; i++)
+		{
+			if (orderTimings[i].samplePos >= 0 && orderTimings[i].samplePos < resumePos)
+			{
+				laterOrderPlayedBefore = true;
+				break;
+			}
+		}
+
+		if (!laterOrderPlayedBefore)
+			return resumeOrder;
+	}
+
+	return -1;
+}
+
+void SongLengthEstimator::update()
 {
 	if (!player)
 	{
 		player = new PlayerGeneric(44100);
 
 		if (!player)
-			return -1;
+			return;
+	}
+
+	const mp_uint32 newHeaderHash = calculateHeaderHash();
+
+	mp_sint32 firstChangedOrder = numOrders >= 0 && newHeaderHash == headerHash ? numOrders : 0;
 
-		player->setBufferSize(1024);
-		player->setResamplerType((ChannelMixer::ResamplerTypes)0);
-		player->setMasterVolume(256);
-		player->setDisableMixing(true);
+	for (mp_sint32 i = 0; i < module->header.ordnum; i++)
+	{
+		const mp_uint32 orderHash = calculateOrderHash(i);
+		if (orderHash != orderHashes[i] && i < firstChangedOrder)
+			firstChangedOrder = i;
+		orderHashes[i] = orderHash;
 	}
 
-	AudioDriver_NULL* audioDriver = new AudioDriver_NULL;
-	mp_sint32 res = player->exportToWAV(NULL, module, 0, -1, NULL, module->header.channum, NULL, audioDriver) / player->getMixFrequency();
-    delete audioDriver;
+	// nothing has changed
+	if (firstChangedOrder >= module->header.ordnum)
+		return;
+
+	const mp_sint32 resumeOrder = firstChangedOrder > 0 ? findResumeOrder(firstChangedOrder) : -1;
+
+	headerHash = newHeaderHash;
+	numOrders = module->header.ordnum;
 
-	return res;
+	songLength = player->calculateOrderTimings(module, orderTimings, resumeOrder);
+
+	if (songLength < 0)
+		invalidate();
 }
 
+mp_sint32 SongLengthEstimator::estimateSongLengthInSeconds()
+{
+	update();
+
+	if (numOrders < 0)
+		return -1;
+
+	return songLength / player->getMixFrequency();
+}
+
+mp_sint32 SongLengthEstimator::getOrderTimeInMillis(mp_sint32 index)
+{
+	update();
+
+	if (numOrders < 0 || index < 0 || index >= numOrders || orderTimings[index].samplePos < 0)
+		return -1;
+
+	return (mp_sint32)((mp_int64)orderTimings[index].samplePos * 1000 / player->getMixFrequency());
+}
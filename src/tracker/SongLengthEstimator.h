@@ -32,16 +32,34 @@
 #define SONGLENGTHESTIMATOR__H
 
 #include "MilkyPlayTypes.h"
+#include "XModule.h"
+#include "PlayerGeneric.h"
 
-class PlayerGeneric;
-class XModule;
-
+/*
+ * Keeps the time every position in the orderlist is reached at. The module
+ * is edited in place, so changes are found by comparing hashes of the
+ * header and of each position including its pattern. Only the part of the
+ * song following the first changed position is played again.
+ */
 class SongLengthEstimator
 {
 private:
 	PlayerGeneric* player;
 	XModule* module;
-	
+
+	mp_sint32 numOrders;				// -1 if nothing has been calculated
+	mp_sint32 songLength;				// in samples
+	mp_uint32 headerHash;
+	mp_uint32 orderHashes[MP_MAXORDERS];
+	PlayerGeneric::OrderTiming orderTimings[MP_MAXORDERS];
+
+	mp_uint32 calculateHeaderHash() const;
+	mp_uint32 calculateOrderHash(mp_sint32 index) const;
+
+	mp_sint32 findResumeOrder(mp_sint32 firstChangedOrder) const;
+
+	void update();
+
 public:
 	SongLengthEstimator(XModule* theModule);
 	SongLengthEstimator(const SongLengthEstimator& src);
@@ -49,7 +67,13 @@ class SongLengthEstimator
 	
 	const SongLengthEstimator& operator=(const SongLengthEstimator& src);
 	
+	// forget everything, the next estimation plays the whole song
+	void invalidate() { numOrders = -1; }
+
 	mp_sint32 estimateSongLengthInSeconds();
+	
+	// time the position is reached first in milliseconds, -1 if it's never played
+	mp_sint32 getOrderTimeInMillis(mp_sint32 index);
 };
 
 #endif
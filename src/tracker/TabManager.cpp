@@ -87,13 +87,7 @@ ModuleEditor* TabManager::createModuleEditor()
 
 PlayerController* TabManager::createPlayerController()
 {
-	// use "fake" scopes on the PDA
-	// fake scopes are always showing linear interpolated output
-#ifdef __LOWRES__
-	PlayerController* playerController = tracker.playerMaster->createPlayerController(true);
-#else
-	PlayerController* playerController = tracker.playerMaster->createPlayerController(false);
-#endif
+	PlayerController* playerController = tracker.playerMaster->createPlayerController();
 
 	if (playerController == NULL)
 		return NULL;
@@ -2631,8 +2631,24 @@ bool Tracker::prepareLoading(FileTypes eType, const PPSystemString& fileName, bo
 	if (type == FileIdentificator::FileTypeCompressed)
 	{
 		// if this is compressed, try to decompress
-		PPSystemString tempFile(ModuleEditor::getTempFilename());
 		Decompressor decompressor(fileName);
+
+		// modules are loaded straight from memory
+		if (eType == FileTypes::FileTypeSongAllModules)
+		{
+			loadingParameters.unpackedFile = new XMBufferFile();
+			if (decompressor.decompress(*loadingParameters.unpackedFile, (DecompressorBase::Hints)fileTypeToHint(eType)))
+			{
+				loadingParameters.unpackedFile->seek(0);
+				return true;
+			}
+
+			// some archives can only be unpacked into a file
+			delete loadingParameters.unpackedFile;
+			loadingParameters.unpackedFile = NULL;
+		}
+
+		PPSystemString tempFile(ModuleEditor::getTempFilename());
 		if (decompressor.decompress(tempFile, (DecompressorBase::Hints)fileTypeToHint(eType)))
 		{
 			// we compressed to a temporary file
@@ -2677,6 +2693,9 @@ bool Tracker::finishLoading()
 	if (loadingParameters.deleteFile)
 		Decompressor::removeFile(loadingParameters.filename);
 
+	delete loadingParameters.unpackedFile;
+	loadingParameters.unpackedFile = NULL;
+
 	if (!loadingParameters.res && loadingParameters.didOpenTab)
 		tabManager->closeTab();
 
@@ -2693,7 +2712,10 @@ bool Tracker::loadTypeFromFile(FileTypes eType, const PPSystemString& fileName,
 	{
 		case FileTypes::FileTypeSongAllModules:
 		{
-			if (loadingParameters.preferredFilename.length())
+			if (loadingParameters.unpackedFile)
+				loadingParameters.res = moduleEditor->openSong(*loadingParameters.unpackedFile,
+				loadingParameters.preferredFilename);
+			else if (loadingParameters.preferredFilename.length())
 				loadingParameters.res = moduleEditor->openSong(loadingParameters.filename,
 				loadingParameters.preferredFilename);
 			else
@@ -389,11 +389,14 @@ class Tracker : public EventListenerInterface
 		bool abortLoading;
 		bool deleteFile;
 		bool didOpenTab;
+		// packed modules are unpacked into memory, filename is the packed file then
+		XMBufferFile* unpackedFile;
 
 		TPrepareLoadingParameters() :
 			abortLoading(false),
 			deleteFile(false),
-			didOpenTab(false)
+			didOpenTab(false),
+			unpackedFile(NULL)
 		{
 		}
 	} loadingParameters;
@@ -79,6 +79,8 @@ void Tracker::buildDefaultSettings()
 	settingsDatabase->store("MIXERVOLUME", 256);
 	settingsDatabase->store("MIXERSHIFT", 1);
 	settingsDatabase->store("RAMPING", 1);
+	settingsDatabase->store("RENDERAHEAD", 0);
+	settingsDatabase->store("ALSAPERIODS", 2);
 	settingsDatabase->store("INTERPOLATION", 1);
 	settingsDatabase->store("MIXERFREQ", PlayerMaster::getPreferredSampleRate());
 #ifdef __FORCEPOWEROFTWOBUFFERSIZE__
@@ -301,6 +303,14 @@ void Tracker::applySettingByKey(PPDictionaryKey* theKey, TMixerSettings& setting
 	{
 		settings.ramping = v2;
 	}
+	else if (theKey->getKey().compareTo("RENDERAHEAD") == 0)
+	{
+		settings.renderAhead = v2;
+	}
+	else if (theKey->getKey().compareTo("ALSAPERIODS") == 0)
+	{
+		settings.alsaPeriods = v2;
+	}
 	else if (theKey->getKey().compareTo("INTERPOLATION") == 0)
 	{
 		settings.resampler = v2;
@@ -728,6 +738,8 @@ void Tracker::getMixerSettingsFromDatabase(TMixerSettings& mixerSettings,
 	mixerSettings.powerOfTwoCompensation = currentSettings.restore("FORCEPOWEROFTWOBUFFERSIZE")->getIntValue();
 	mixerSettings.resampler = currentSettings.restore("INTERPOLATION")->getIntValue();
 	mixerSettings.ramping = currentSettings.restore("RAMPING")->getIntValue();
+	mixerSettings.renderAhead = currentSettings.restore("RENDERAHEAD")->getIntValue();
+	mixerSettings.alsaPeriods = currentSettings.restore("ALSAPERIODS")->getIntValue();
 	mixerSettings.setAudioDriverName(currentSettings.restore("AUDIODRIVER")->getStringValue());
     mixerSettings.numPlayerChannels = currentSettings.restore("XMCHANNELLIMIT")->getIntValue();
 	mixerSettings.numVirtualChannels = currentSettings.restore("VIRTUALCHANNELS")->getIntValue();